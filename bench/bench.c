@@ -0,0 +1,1075 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <wayland-client.h>
+#include <xkbcommon/xkbcommon.h>
+#include "../include/fill.h"
+#include "../include/font.h"
+#include "../include/hittest.h"
+#include "../include/scrollback.h"
+#include "../include/sdf.h"
+#include "../include/yuv.h"
+
+/**********************************************
+ * @BENCHMARK RUNNER
+ **********************************************
+ *
+ * One binary for every benchmark in the tree, run by `./build.sh bench`
+ * (which goes through scripts/bench.sh to provide a headless compositor).
+ *
+ * @MICRO (in process):
+ * - fill.*       the pixel loops the clients run per frame: solid fill,
+ *                the waylandbook checkerboard, bitmap text, the rect
+ *                fill kernels of include/fill.h and the I420
+ *                conversion kernels of include/yuv.h.
+ * - keymap.*     compiling the keymap string a wl_keyboard.keymap event
+ *                delivers, and keysym/UTF-8 lookup per key press.
+ * - scrollback.* line lookup in a large transcript.
+ * - hittest.*    pointer lookups among N random regions on a 1920x1080
+ *                surface, grid (include/hittest.h) against a linear scan;
+ *                lookups/s is printed alongside.
+ * - text.*       building renderlock's distance field atlas (include/sdf.h)
+ *                against the coverage atlases one per text size x output
+ *                scale would take, in time and in KiB.
+ * - registry.*   connect, fetch and bind the core globals, disconnect.
+ *                Needs a compositor.
+ *
+ * Each micro benchmark first doubles its iteration count until one
+ * repetition takes at least --min-time, then records --reps repetitions
+ * of (time / iterations).
+ *
+ * @MACRO (spawned clients, needs a compositor):
+ * - startup.*    wall time from exec until the client exits right after
+ *                its first frame (MYWAYLAND_STARTUP_EXIT=1, see
+ *                include/startup.h).
+ * - frames.*     y4mplay presenting a generated one-second clip: wall time
+ *                and frames dropped.
+ *
+ * @OUTPUT:
+ * - JSON on stdout (or --output), one metric per line with median, mean,
+ *   standard deviation, min and max over the repetitions. A saved output
+ *   is a baseline.
+ * - --baseline compares every metric's median with the baseline's. Lower
+ *   is better for all of them; a metric more than --threshold percent
+ *   above its baseline is a regression and the exit status is 1.
+ *   Benchmarks that cannot run here (no compositor, no keymap data) are
+ *   reported as skipped and never fail the comparison.
+ **********************************************/
+
+#define BENCH_MAX_METRICS 64
+#define BENCH_MAX_REPS    1000
+#define BENCH_SPAWN_TIMEOUT_MS 20000
+
+struct bench_metric {
+    char name[64];
+    const char *unit;
+    bool skipped;
+    char note[128];
+    int samples;
+    double median, mean, stddev, min, max;
+};
+
+struct bench_options {
+    int reps;
+    int macro_reps;
+    double min_time_ms;
+    double threshold;           // Percent
+    const char *filter;
+    const char *output;
+    const char *baseline;
+    const char *bin_dir;
+    bool micro, macro;
+};
+
+static struct bench_metric metrics[BENCH_MAX_METRICS];
+static int metric_count;
+static struct bench_options options = {
+    .reps = 11,
+    .macro_reps = 5,
+    .min_time_ms = 20,
+    .threshold = 10,
+    .bin_dir = "bin",
+    .micro = true,
+    .macro = true,
+};
+
+// Written by the kernels so the compiler cannot drop their work
+static volatile uint32_t bench_sink;
+
+static double
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool
+selected(const char *name)
+{
+    return !options.filter || strstr(name, options.filter);
+}
+
+static struct bench_metric *
+add_metric(const char *name, const char *unit)
+{
+    if (metric_count == BENCH_MAX_METRICS) {
+        fprintf(stderr, "[BENCH] Too many metrics\n");
+        exit(2);
+    }
+    struct bench_metric *metric = &metrics[metric_count++];
+    memset(metric, 0, sizeof(*metric));
+    snprintf(metric->name, sizeof(metric->name), "%s", name);
+    metric->unit = unit;
+    return metric;
+}
+
+static void
+skip_metric(const char *name, const char *unit, const char *why)
+{
+    struct bench_metric *metric = add_metric(name, unit);
+    metric->skipped = true;
+    snprintf(metric->note, sizeof(metric->note), "%s", why);
+    fprintf(stderr, "[BENCH] %-36s skipped: %s\n", name, why);
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void
+record_samples(const char *name, const char *unit, double *samples, int count)
+{
+    struct bench_metric *metric = add_metric(name, unit);
+    qsort(samples, count, sizeof(samples[0]), compare_doubles);
+
+    double sum = 0;
+    for (int i = 0; i < count; ++i) {
+        sum += samples[i];
+    }
+    double mean = sum / count, variance = 0;
+    for (int i = 0; i < count; ++i) {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+
+    metric->samples = count;
+    metric->median = count % 2 ? samples[count / 2]
+                               : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    metric->mean = mean;
+    metric->stddev = count > 1 ? sqrt(variance / (count - 1)) : 0;
+    metric->min = samples[0];
+    metric->max = samples[count - 1];
+    fprintf(stderr, "[BENCH] %-36s median %12.3f %s  (stddev %.3f, n=%d)\n",
+            name, metric->median, unit, metric->stddev, count);
+}
+
+/*******************************************
+ * Micro benchmark driver:
+ * - `fn(ctx, iterations)` performs `iterations` operations; the recorded
+ *   value is nanoseconds per operation.
+ *******************************************/
+typedef void (*bench_fn)(void *ctx, long iterations);
+
+static void
+run_micro(const char *name, bench_fn fn, void *ctx)
+{
+    if (!selected(name)) {
+        return;
+    }
+
+    // Calibrate, which doubles as warm-up
+    long iterations = 1;
+    for (;;) {
+        double start = now_ns();
+        fn(ctx, iterations);
+        double elapsed = now_ns() - start;
+        if (elapsed >= options.min_time_ms * 1e6 || iterations >= (1L << 40)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double samples[BENCH_MAX_REPS];
+    for (int rep = 0; rep < options.reps; ++rep) {
+        double start = now_ns();
+        fn(ctx, iterations);
+        samples[rep] = (now_ns() - start) / iterations;
+    }
+    record_samples(name, "ns", samples, options.reps);
+}
+
+/*******************************************
+ * Fill kernels
+ *******************************************/
+struct fill_ctx {
+    uint32_t *pixels;
+    int width, height;
+};
+
+static void
+bench_fill_solid(void *data, long iterations)
+{
+    struct fill_ctx *ctx = data;
+    for (long i = 0; i < iterations; ++i) {
+        uint32_t color = 0xff000000u | (uint32_t)i;
+        for (int p = 0; p < ctx->width * ctx->height; ++p) {
+            ctx->pixels[p] = color;
+        }
+        bench_sink = ctx->pixels[i % (ctx->width * ctx->height)];
+    }
+}
+
+// The loop from waylandbook.example.c's draw_frame
+static void
+bench_fill_checkerboard(void *data, long iterations)
+{
+    struct fill_ctx *ctx = data;
+    for (long i = 0; i < iterations; ++i) {
+        for (int y = 0; y < ctx->height; ++y) {
+            for (int x = 0; x < ctx->width; ++x) {
+                if ((x + y / 8 * 8) % 16 < 8)
+                    ctx->pixels[y * ctx->width + x] = 0xFF666666;
+                else
+                    ctx->pixels[y * ctx->width + x] = 0xFFEEEEEE;
+            }
+        }
+        bench_sink = ctx->pixels[i % (ctx->width * ctx->height)];
+    }
+}
+
+// The lock screen clock: five glyphs at scale 12
+static void
+bench_fill_text(void *data, long iterations)
+{
+    struct fill_ctx *ctx = data;
+    for (long i = 0; i < iterations; ++i) {
+        font_draw_text(ctx->pixels, ctx->width, ctx->height, ctx->width * 4, NULL,
+                       10, 10, 12, 0xffffffffu, i & 1 ? "12:34" : "12:35");
+        bench_sink = ctx->pixels[10 * ctx->width + 10];
+    }
+}
+
+struct rect_ctx {
+    fill_row_fn row_fn;
+    uint32_t *pixels;
+    int width, height;
+};
+
+// A full repaint by renderlock's shm backend, without background image
+static void
+bench_fill_rect(void *data, long iterations)
+{
+    struct rect_ctx *ctx = data;
+    for (long i = 0; i < iterations; ++i) {
+        fill_rect(ctx->row_fn, ctx->pixels, ctx->width * 4, 0, 0, ctx->width, ctx->height,
+                  0xff000000u | (uint32_t)i);
+        bench_sink = ctx->pixels[i % (ctx->width * ctx->height)];
+    }
+}
+
+struct yuv_ctx {
+    yuv_row_fn row_fn;
+    struct yuv_frame frame;
+    uint32_t *dst;
+};
+
+static void
+bench_fill_yuv(void *data, long iterations)
+{
+    struct yuv_ctx *ctx = data;
+    for (long i = 0; i < iterations; ++i) {
+        yuv_convert_rows(ctx->row_fn, &ctx->frame, ctx->dst, ctx->frame.width * 4,
+                         0, ctx->frame.height);
+        bench_sink = ctx->dst[i % ctx->frame.width];
+    }
+}
+
+static void
+run_fill_benchmarks(void)
+{
+    struct fill_ctx fill = { .width = 640, .height = 480 };
+    fill.pixels = calloc((size_t)fill.width * fill.height, 4);
+    if (!fill.pixels) {
+        fprintf(stderr, "[BENCH] Out of memory\n");
+        exit(2);
+    }
+    run_micro("fill.solid_640x480", bench_fill_solid, &fill);
+    run_micro("fill.checkerboard_640x480", bench_fill_checkerboard, &fill);
+    run_micro("fill.text_clock_scale12", bench_fill_text, &fill);
+    free(fill.pixels);
+
+    static const char *const kernels[] = { "scalar", "sse2", "avx2" };
+    struct rect_ctx rect = { .width = 1920, .height = 1080 };
+    rect.pixels = malloc((size_t)rect.width * rect.height * 4);
+    if (!rect.pixels) {
+        fprintf(stderr, "[BENCH] Out of memory\n");
+        exit(2);
+    }
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        char name[64];
+        snprintf(name, sizeof(name), "fill.rect_%s_1920x1080", kernels[k]);
+        const char *chosen;
+        rect.row_fn = fill_select(kernels[k], &chosen);
+        if (strcmp(chosen, kernels[k]) != 0) {
+            if (selected(name)) {
+                skip_metric(name, "ns", "kernel not supported by this CPU");
+            }
+            continue;
+        }
+        run_micro(name, bench_fill_rect, &rect);
+    }
+    free(rect.pixels);
+
+    // Mid-grey 720p frame with a chroma ramp
+    const int width = 1280, height = 720;
+    uint8_t *planes = malloc((size_t)width * height * 3 / 2);
+    struct yuv_ctx yuv = { .dst = malloc((size_t)width * height * 4) };
+    if (!planes || !yuv.dst) {
+        fprintf(stderr, "[BENCH] Out of memory\n");
+        exit(2);
+    }
+    memset(planes, 128, (size_t)width * height);
+    for (int i = 0; i < width * height / 2; ++i) {
+        planes[width * height + i] = i % 256;
+    }
+    yuv.frame = (struct yuv_frame){
+        .y = planes,
+        .u = planes + width * height,
+        .v = planes + width * height * 5 / 4,
+        .width = width, .height = height,
+        .y_stride = width, .uv_stride = width / 2,
+    };
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        char name[64];
+        snprintf(name, sizeof(name), "fill.yuv_%s_1280x720", kernels[k]);
+        const char *chosen;
+        yuv.row_fn = yuv_select(kernels[k], &chosen);
+        if (strcmp(chosen, kernels[k]) != 0) {
+            if (selected(name)) {
+                skip_metric(name, "ns", "kernel not supported by this CPU");
+            }
+            continue;
+        }
+        run_micro(name, bench_fill_yuv, &yuv);
+    }
+    free(planes);
+    free(yuv.dst);
+}
+
+/*******************************************
+ * Keymap benchmarks:
+ * - The keymap string comes from the system's default RMLVO names, the
+ *   same kind of text a compositor sends in wl_keyboard.keymap.
+ *******************************************/
+struct keymap_ctx {
+    struct xkb_context *context;
+    char *keymap_string;
+    struct xkb_state *state;
+};
+
+static void
+bench_keymap_compile(void *data, long iterations)
+{
+    struct keymap_ctx *ctx = data;
+    for (long i = 0; i < iterations; ++i) {
+        struct xkb_keymap *keymap = xkb_keymap_new_from_string(ctx->context, ctx->keymap_string,
+                XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS);
+        bench_sink = keymap != NULL;
+        xkb_keymap_unref(keymap);
+    }
+}
+
+// What gettext.c does per wl_keyboard.key: keysym and UTF-8 text
+static void
+bench_keymap_lookup(void *data, long iterations)
+{
+    struct keymap_ctx *ctx = data;
+    char utf8[16];
+    for (long i = 0; i < iterations; ++i) {
+        xkb_keycode_t keycode = 9 + i % 48;     // evdev 1..48 + 8
+        xkb_keysym_t sym = xkb_state_key_get_one_sym(ctx->state, keycode);
+        xkb_state_key_get_utf8(ctx->state, keycode, utf8, sizeof(utf8));
+        bench_sink = sym + (uint8_t)utf8[0];
+    }
+}
+
+static void
+run_keymap_benchmarks(void)
+{
+    if (!selected("keymap.")) {
+        return;
+    }
+    struct keymap_ctx ctx = { .context = xkb_context_new(XKB_CONTEXT_NO_FLAGS) };
+    struct xkb_keymap *keymap = ctx.context
+        ? xkb_keymap_new_from_names(ctx.context, NULL, XKB_KEYMAP_COMPILE_NO_FLAGS)
+        : NULL;
+    if (!keymap) {
+        skip_metric("keymap.compile", "ns", "no xkb context or keymap data");
+        skip_metric("keymap.lookup", "ns", "no xkb context or keymap data");
+        if (ctx.context) {
+            xkb_context_unref(ctx.context);
+        }
+        return;
+    }
+    ctx.keymap_string = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    ctx.state = xkb_state_new(keymap);
+
+    run_micro("keymap.compile", bench_keymap_compile, &ctx);
+    run_micro("keymap.lookup", bench_keymap_lookup, &ctx);
+
+    xkb_state_unref(ctx.state);
+    free(ctx.keymap_string);
+    xkb_keymap_unref(keymap);
+    xkb_context_unref(ctx.context);
+}
+
+/*******************************************
+ * Scrollback lookup over a million lines
+ *******************************************/
+static void
+bench_scrollback_lookup(void *data, long iterations)
+{
+    struct scrollback *sb = data;
+    uint64_t index = 12345;
+    for (long i = 0; i < iterations; ++i) {
+        size_t length;
+        const char *line = scrollback_line(sb, index, &length);
+        bench_sink = line[0] + length;
+        index = (index * 6364136223846793005ull + 1442695040888963407ull) >> 1;
+        index %= sb->line_count;
+    }
+}
+
+static void
+run_scrollback_benchmarks(void)
+{
+    if (!selected("scrollback.")) {
+        return;
+    }
+    struct scrollback sb = {0};
+    for (int i = 0; i < 1000000; ++i) {
+        char line[64];
+        int length = snprintf(line, sizeof(line), "Filler line %d", i);
+        if (scrollback_append(&sb, line, length) != 0) {
+            fprintf(stderr, "[BENCH] Out of memory\n");
+            exit(2);
+        }
+    }
+    run_micro("scrollback.lookup_1M", bench_scrollback_lookup, &sb);
+    scrollback_free(&sb);
+}
+
+/*******************************************
+ * Text atlases:
+ * - The bitmap side is every size renderlock draws (clock, date, prompt,
+ *   password dots) at the output scales compositors commonly use; the
+ *   distance field covers them all with one atlas.
+ *******************************************/
+static const float text_sizes[] = { 2, 3, 4, 12 };
+static const float text_output_scales[] = { 1, 1.25f, 1.5f, 2, 2.5f, 3 };
+
+static void
+bench_text_sdf_atlas(void *data, long iterations)
+{
+    (void)data;
+    for (long i = 0; i < iterations; ++i) {
+        struct sdf_atlas atlas;
+        if (!sdf_atlas_build(&atlas)) {
+            fprintf(stderr, "[BENCH] Out of memory\n");
+            exit(2);
+        }
+        bench_sink = atlas.texels[atlas.bytes / 2];
+        sdf_atlas_free(&atlas);
+    }
+}
+
+// One operation builds the whole set; returns its size in bytes
+static size_t
+build_coverage_atlases(void)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < sizeof(text_sizes) / sizeof(text_sizes[0]); ++i) {
+        for (size_t j = 0; j < sizeof(text_output_scales) / sizeof(text_output_scales[0]); ++j) {
+            struct coverage_atlas atlas;
+            if (!coverage_atlas_build(&atlas, text_sizes[i] * text_output_scales[j])) {
+                fprintf(stderr, "[BENCH] Out of memory\n");
+                exit(2);
+            }
+            bench_sink = atlas.texels[atlas.bytes / 2];
+            bytes += atlas.bytes;
+            coverage_atlas_free(&atlas);
+        }
+    }
+    return bytes;
+}
+
+static void
+bench_text_coverage_atlases(void *data, long iterations)
+{
+    (void)data;
+    for (long i = 0; i < iterations; ++i) {
+        build_coverage_atlases();
+    }
+}
+
+static void
+run_text_benchmarks(void)
+{
+    run_micro("text.sdf_atlas", bench_text_sdf_atlas, NULL);
+    run_micro("text.coverage_atlases", bench_text_coverage_atlases, NULL);
+
+    // Sizes are exact, one sample each
+    if (selected("text.sdf_atlas_kib")) {
+        struct sdf_atlas atlas;
+        if (!sdf_atlas_build(&atlas)) {
+            fprintf(stderr, "[BENCH] Out of memory\n");
+            exit(2);
+        }
+        double kib = atlas.bytes / 1024.0;
+        record_samples("text.sdf_atlas_kib", "KiB", &kib, 1);
+        sdf_atlas_free(&atlas);
+    }
+    if (selected("text.coverage_atlases_kib")) {
+        double kib = build_coverage_atlases() / 1024.0;
+        record_samples("text.coverage_atlases_kib", "KiB", &kib, 1);
+    }
+}
+
+/*******************************************
+ * Hit-testing:
+ * - Regions are 8-128 px rects at random spots, the points a fixed
+ *   pseudo-random walk over the surface.
+ *******************************************/
+#define HIT_POINTS 4096
+
+struct hit_ctx {
+    struct hit_index index;
+    int32_t points[HIT_POINTS][2];
+};
+
+static void
+bench_hit_grid(void *data, long iterations)
+{
+    struct hit_ctx *ctx = data;
+    for (long i = 0; i < iterations; ++i) {
+        const int32_t *p = ctx->points[i % HIT_POINTS];
+        bench_sink = hit_index_lookup(&ctx->index, p[0], p[1]);
+    }
+}
+
+static void
+bench_hit_linear(void *data, long iterations)
+{
+    struct hit_ctx *ctx = data;
+    for (long i = 0; i < iterations; ++i) {
+        const int32_t *p = ctx->points[i % HIT_POINTS];
+        bench_sink = hit_index_lookup_linear(&ctx->index, p[0], p[1]);
+    }
+}
+
+static void
+run_hit_micro(const char *name, bench_fn fn, struct hit_ctx *ctx)
+{
+    int before = metric_count;
+    run_micro(name, fn, ctx);
+    if (metric_count > before && metrics[before].median > 0) {
+        fprintf(stderr, "[BENCH] %-36s %.1f M lookups/s\n", name, 1e3 / metrics[before].median);
+    }
+}
+
+static void
+run_hittest_benchmarks(void)
+{
+    if (!selected("hittest.")) {
+        return;
+    }
+    static const int counts[] = { 16, 128, 1024, 8192 };
+    static struct hit_ctx ctx;
+    uint32_t seed = 1;
+    for (int i = 0; i < HIT_POINTS; ++i) {
+        seed = seed * 1103515245 + 12345;
+        ctx.points[i][0] = (seed >> 8) % 1920;
+        seed = seed * 1103515245 + 12345;
+        ctx.points[i][1] = (seed >> 8) % 1080;
+    }
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        if (!hit_index_init(&ctx.index, 1920, 1080)) {
+            fprintf(stderr, "[BENCH] Out of memory\n");
+            exit(2);
+        }
+        for (int i = 0; i < counts[c]; ++i) {
+            uint32_t r[4];
+            for (int j = 0; j < 4; ++j) {
+                seed = seed * 1103515245 + 12345;
+                r[j] = seed >> 8;
+            }
+            if (hit_index_add(&ctx.index, r[0] % 1920, r[1] % 1080, 8 + r[2] % 120, 8 + r[3] % 120) < 0) {
+                fprintf(stderr, "[BENCH] Out of memory\n");
+                exit(2);
+            }
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "hittest.grid_%d", counts[c]);
+        run_hit_micro(name, bench_hit_grid, &ctx);
+        snprintf(name, sizeof(name), "hittest.linear_%d", counts[c]);
+        run_hit_micro(name, bench_hit_linear, &ctx);
+        hit_index_free(&ctx.index);
+    }
+}
+
+/*******************************************
+ * Registry binding:
+ * - One operation is a whole client lifetime up to "globals bound":
+ *   connect, get the registry, bind compositor/shm/seat/output, one
+ *   roundtrip for the binds to reach the server, disconnect.
+ *******************************************/
+struct registry_binds {
+    int bound;
+};
+
+static void
+bench_registry_global(void *data, struct wl_registry *registry,
+                      uint32_t name, const char *interface, uint32_t version)
+{
+    struct registry_binds *binds = data;
+    const struct wl_interface *wanted = NULL;
+    if (strcmp(interface, wl_compositor_interface.name) == 0) {
+        wanted = &wl_compositor_interface;
+    } else if (strcmp(interface, wl_shm_interface.name) == 0) {
+        wanted = &wl_shm_interface;
+    } else if (strcmp(interface, wl_seat_interface.name) == 0) {
+        wanted = &wl_seat_interface;
+    } else if (strcmp(interface, wl_output_interface.name) == 0) {
+        wanted = &wl_output_interface;
+    }
+    if (wanted) {
+        wl_registry_bind(registry, name, wanted, 1);
+        ++binds->bound;
+    }
+}
+
+static void
+bench_registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+}
+
+static const struct wl_registry_listener bench_registry_listener = {
+    .global = bench_registry_global,
+    .global_remove = bench_registry_global_remove,
+};
+
+static void
+bench_registry_bind(void *data, long iterations)
+{
+    for (long i = 0; i < iterations; ++i) {
+        struct wl_display *display = wl_display_connect(NULL);
+        if (!display) {
+            fprintf(stderr, "[BENCH] Lost the compositor during registry.bind\n");
+            exit(2);
+        }
+        struct registry_binds binds = {0};
+        struct wl_registry *registry = wl_display_get_registry(display);
+        wl_registry_add_listener(registry, &bench_registry_listener, &binds);
+        wl_display_roundtrip(display);      // globals
+        wl_display_roundtrip(display);      // binds
+        bench_sink = binds.bound;
+        wl_display_disconnect(display);
+    }
+}
+
+static void
+run_registry_benchmarks(bool have_compositor)
+{
+    if (!selected("registry.bind")) {
+        return;
+    }
+    if (!have_compositor) {
+        skip_metric("registry.bind", "ns", "no compositor (WAYLAND_DISPLAY)");
+        return;
+    }
+    run_micro("registry.bind", bench_registry_bind, NULL);
+}
+
+/*******************************************
+ * Spawning clients:
+ * - Runs `argv` with MYWAYLAND_STARTUP_EXIT=1, captures its stderr and
+ *   returns the wall time in ms, or a negative value when the client
+ *   failed, timed out or could not be started.
+ *******************************************/
+static double
+spawn_client(char *const argv[], char *output, size_t output_size)
+{
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) < 0) {
+        return -1;
+    }
+
+    double start = now_ns();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(pipe_fds[1], STDERR_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+        }
+        setenv("MYWAYLAND_STARTUP_EXIT", "1", 1);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    close(pipe_fds[1]);
+
+    size_t used = 0;
+    bool timed_out = false;
+    struct pollfd pfd = { .fd = pipe_fds[0], .events = POLLIN };
+    for (;;) {
+        int remaining = BENCH_SPAWN_TIMEOUT_MS - (int)((now_ns() - start) / 1e6);
+        if (remaining <= 0) {
+            timed_out = true;
+            kill(pid, SIGKILL);
+            break;
+        }
+        int ret = poll(&pfd, 1, remaining);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            continue;   // Timeout is handled at the top
+        }
+        char scratch[4096];
+        ssize_t n = read(pipe_fds[0], scratch, sizeof(scratch));
+        if (n <= 0) {
+            break;      // Client closed stderr, i.e. exited
+        }
+        size_t copy = (size_t)n < output_size - 1 - used ? (size_t)n : output_size - 1 - used;
+        memcpy(output + used, scratch, copy);
+        used += copy;
+    }
+    output[used] = '\0';
+    close(pipe_fds[0]);
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    double elapsed_ms = (now_ns() - start) / 1e6;
+    if (timed_out || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+    return elapsed_ms;
+}
+
+static void
+client_path(char *path, size_t size, const char *program)
+{
+    snprintf(path, size, "%s/%s", options.bin_dir, program);
+}
+
+static void
+run_startup_benchmark(const char *program, bool have_compositor)
+{
+    char name[64], path[512];
+    snprintf(name, sizeof(name), "startup.%s", program);
+    if (!selected(name)) {
+        return;
+    }
+    client_path(path, sizeof(path), program);
+    if (!have_compositor) {
+        skip_metric(name, "ms", "no compositor (WAYLAND_DISPLAY)");
+        return;
+    }
+    if (access(path, X_OK) != 0) {
+        skip_metric(name, "ms", "client not built");
+        return;
+    }
+
+    double samples[BENCH_MAX_REPS];
+    char output[16384];
+    char *argv[] = { path, NULL };
+    for (int rep = 0; rep < options.macro_reps; ++rep) {
+        samples[rep] = spawn_client(argv, output, sizeof(output));
+        if (samples[rep] < 0) {
+            skip_metric(name, "ms", "client failed (no GL or protocol support?)");
+            return;
+        }
+    }
+    record_samples(name, "ms", samples, options.macro_reps);
+}
+
+// Writes a one-second 640x360@60 clip with a moving gradient
+static bool
+write_test_clip(const char *path)
+{
+    const int width = 640, height = 360, frames = 60;
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg\n", width, height);
+    uint8_t *frame = malloc((size_t)width * height * 3 / 2);
+    if (!frame) {
+        fclose(file);
+        return false;
+    }
+    for (int f = 0; f < frames; ++f) {
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                frame[y * width + x] = 16 + (x + y + f * 4) % 220;
+            }
+        }
+        memset(frame + width * height, 128 + f, (size_t)width * height / 2);
+        fputs("FRAME\n", file);
+        fwrite(frame, 1, (size_t)width * height * 3 / 2, file);
+    }
+    free(frame);
+    return fclose(file) == 0;
+}
+
+static void
+run_frames_benchmark(bool have_compositor)
+{
+    if (!selected("frames.y4mplay")) {
+        return;
+    }
+    char path[512];
+    client_path(path, sizeof(path), "y4mplay");
+    if (!have_compositor) {
+        skip_metric("frames.y4mplay_wall", "ms", "no compositor (WAYLAND_DISPLAY)");
+        skip_metric("frames.y4mplay_dropped", "frames", "no compositor (WAYLAND_DISPLAY)");
+        return;
+    }
+    if (access(path, X_OK) != 0) {
+        skip_metric("frames.y4mplay_wall", "ms", "client not built");
+        skip_metric("frames.y4mplay_dropped", "frames", "client not built");
+        return;
+    }
+
+    char clip[] = "/tmp/mywayland-bench-XXXXXX.y4m";
+    int fd = mkstemps(clip, 4);
+    if (fd < 0 || (close(fd), !write_test_clip(clip))) {
+        skip_metric("frames.y4mplay_wall", "ms", "could not write the test clip");
+        skip_metric("frames.y4mplay_dropped", "frames", "could not write the test clip");
+        if (fd >= 0) {
+            unlink(clip);
+        }
+        return;
+    }
+
+    double wall[BENCH_MAX_REPS], dropped[BENCH_MAX_REPS];
+    char output[16384];
+    char *argv[] = { path, clip, NULL };
+    for (int rep = 0; rep < options.macro_reps; ++rep) {
+        wall[rep] = spawn_client(argv, output, sizeof(output));
+        const char *report = strstr(output, "[Y4M] presented");
+        unsigned long long shown, lost;
+        if (wall[rep] < 0 || !report ||
+            sscanf(report, "[Y4M] presented %llu frames, dropped %llu", &shown, &lost) != 2) {
+            skip_metric("frames.y4mplay_wall", "ms", "y4mplay failed");
+            skip_metric("frames.y4mplay_dropped", "frames", "y4mplay failed");
+            unlink(clip);
+            return;
+        }
+        dropped[rep] = lost;
+    }
+    unlink(clip);
+    record_samples("frames.y4mplay_wall", "ms", wall, options.macro_reps);
+    record_samples("frames.y4mplay_dropped", "frames", dropped, options.macro_reps);
+}
+
+/*******************************************
+ * JSON output:
+ * - One metric object per line. compare_baseline() relies on that and
+ *   only looks for the "name" and "median" keys on each line.
+ *******************************************/
+static int
+write_json(FILE *out)
+{
+    fprintf(out, "{\n  \"version\": 1,\n  \"reps\": %d,\n  \"macro_reps\": %d,\n  \"metrics\": [\n",
+            options.reps, options.macro_reps);
+    for (int i = 0; i < metric_count; ++i) {
+        const struct bench_metric *m = &metrics[i];
+        const char *comma = i + 1 < metric_count ? "," : "";
+        if (m->skipped) {
+            fprintf(out, "    {\"name\": \"%s\", \"unit\": \"%s\", \"skipped\": true, \"note\": \"%s\"}%s\n",
+                    m->name, m->unit, m->note, comma);
+        } else {
+            fprintf(out, "    {\"name\": \"%s\", \"unit\": \"%s\", \"samples\": %d, \"median\": %.9g, "
+                    "\"mean\": %.9g, \"stddev\": %.9g, \"min\": %.9g, \"max\": %.9g}%s\n",
+                    m->name, m->unit, m->samples, m->median, m->mean, m->stddev,
+                    m->min, m->max, comma);
+        }
+    }
+    fprintf(out, "  ]\n}\n");
+    return ferror(out) ? -1 : 0;
+}
+
+static bool
+parse_baseline_line(const char *line, char *name, size_t name_size, double *median)
+{
+    const char *key = strstr(line, "\"name\": \"");
+    const char *value = strstr(line, "\"median\": ");
+    if (!key || !value) {
+        return false;
+    }
+    key += strlen("\"name\": \"");
+    const char *end = strchr(key, '"');
+    if (!end || (size_t)(end - key) >= name_size) {
+        return false;
+    }
+    memcpy(name, key, end - key);
+    name[end - key] = '\0';
+    *median = strtod(value + strlen("\"median\": "), NULL);
+    return true;
+}
+
+// Returns the number of regressed metrics, or -1 if the baseline is unreadable
+static int
+compare_baseline(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "[BENCH] Cannot open baseline %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(stderr, "\n[BENCH] Against %s (threshold %.1f%%):\n", path, options.threshold);
+    bool compared[BENCH_MAX_METRICS] = {0};
+    int regressions = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        char name[64];
+        double base;
+        if (!parse_baseline_line(line, name, sizeof(name), &base)) {
+            continue;
+        }
+        for (int i = 0; i < metric_count; ++i) {
+            struct bench_metric *m = &metrics[i];
+            if (compared[i] || strcmp(m->name, name) != 0) {
+                continue;
+            }
+            compared[i] = true;
+            if (m->skipped) {
+                break;
+            }
+            double delta = base > 0 ? (m->median - base) / base * 100 : (m->median > 0 ? INFINITY : 0);
+            bool regressed = delta > options.threshold;
+            regressions += regressed;
+            fprintf(stderr, "  %-36s %12.3f -> %12.3f %-6s %+7.1f%%%s\n", m->name, base,
+                    m->median, m->unit, delta, regressed ? "  REGRESSION" : "");
+            break;
+        }
+    }
+    fclose(file);
+
+    for (int i = 0; i < metric_count; ++i) {
+        if (!compared[i] && !metrics[i].skipped) {
+            fprintf(stderr, "  %-36s not in baseline\n", metrics[i].name);
+        }
+    }
+    fprintf(stderr, "[BENCH] %d regression(s)\n", regressions);
+    return regressions;
+}
+
+static void
+usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--reps N] [--macro-reps N] [--min-time ms] [--filter substring]\n"
+            "       [--micro-only | --macro-only] [--bin dir] [--output file.json]\n"
+            "       [--baseline file.json] [--threshold percent]\n", argv0);
+}
+
+int
+main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--reps") == 0 && has_value) {
+            options.reps = atoi(argv[++i]);
+        } else if (strcmp(arg, "--macro-reps") == 0 && has_value) {
+            options.macro_reps = atoi(argv[++i]);
+        } else if (strcmp(arg, "--min-time") == 0 && has_value) {
+            options.min_time_ms = atof(argv[++i]);
+        } else if (strcmp(arg, "--filter") == 0 && has_value) {
+            options.filter = argv[++i];
+        } else if (strcmp(arg, "--bin") == 0 && has_value) {
+            options.bin_dir = argv[++i];
+        } else if (strcmp(arg, "--output") == 0 && has_value) {
+            options.output = argv[++i];
+        } else if (strcmp(arg, "--baseline") == 0 && has_value) {
+            options.baseline = argv[++i];
+        } else if (strcmp(arg, "--threshold") == 0 && has_value) {
+            options.threshold = atof(argv[++i]);
+        } else if (strcmp(arg, "--micro-only") == 0) {
+            options.macro = false;
+        } else if (strcmp(arg, "--macro-only") == 0) {
+            options.micro = false;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.reps < 1 || options.reps > BENCH_MAX_REPS ||
+        options.macro_reps < 1 || options.macro_reps > BENCH_MAX_REPS) {
+        fprintf(stderr, "[BENCH] Repetitions must be between 1 and %d\n", BENCH_MAX_REPS);
+        return 2;
+    }
+
+    struct wl_display *probe = wl_display_connect(NULL);
+    bool have_compositor = probe != NULL;
+    if (probe) {
+        wl_display_disconnect(probe);
+    }
+
+    if (options.micro) {
+        run_fill_benchmarks();
+        run_keymap_benchmarks();
+        run_scrollback_benchmarks();
+        run_text_benchmarks();
+        run_hittest_benchmarks();
+        run_registry_benchmarks(have_compositor);
+    }
+    if (options.macro) {
+        run_startup_benchmark("render", have_compositor);
+        run_startup_benchmark("renderlock", have_compositor);
+        run_frames_benchmark(have_compositor);
+    }
+
+    FILE *out = stdout;
+    if (options.output && !(out = fopen(options.output, "w"))) {
+        fprintf(stderr, "[BENCH] Cannot write %s: %s\n", options.output, strerror(errno));
+        return 2;
+    }
+    if (write_json(out) < 0 || (out != stdout && fclose(out) != 0)) {
+        fprintf(stderr, "[BENCH] Failed to write the results\n");
+        return 2;
+    }
+
+    if (options.baseline) {
+        int regressions = compare_baseline(options.baseline);
+        if (regressions < 0) {
+            return 2;
+        }
+        return regressions > 0 ? 1 : 0;
+    }
+    return 0;
+}
@@ -1,2 +1,62 @@
 #!/bin/bash
+#
+# Builds every client into bin/
+#
+#   ./build.sh            build all programs
+#   ./build.sh clean      remove the binaries
+#   ./build.sh bench ...  build everything plus bin/bench and run it through
+#                         scripts/bench.sh (extra arguments go to bin/bench)
+#
+# Environment:
+#   CC, CFLAGS            compiler and flags (default: cc, -O2 -g)
+#   EAGER_GL=1            link libEGL/libGLESv2 directly instead of loading
+#                         them on demand (see include/egl_loader.h)
+#
+set -e
+cd "$(dirname "$0")"
 
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-O2 -g"}
+CFLAGS="$CFLAGS -Iprotocols -Iprotocols/src"
+
+WAYLAND=$(pkg-config --cflags --libs wayland-client)
+XKB=$(pkg-config --cflags --libs xkbcommon)
+CURSOR=$(pkg-config --cflags --libs wayland-cursor)
+
+# The GL headers are always needed; the libraries only for EAGER_GL builds
+GL="$(pkg-config --cflags egl glesv2 wayland-egl) -ldl"
+if [ "${EAGER_GL:-0}" = "1" ]; then
+    GL="$GL -DMYWAYLAND_EAGER_GL $(pkg-config --libs egl glesv2 wayland-egl)"
+fi
+
+build_all() {
+    mkdir -p bin
+    $CC $CFLAGS gettext.c -o bin/seat_listeners $WAYLAND $XKB -lpthread
+    $CC $CFLAGS seat_listeners_lite.c -o bin/seat_listeners_lite $XKB
+    $CC $CFLAGS render.c -o bin/render $WAYLAND $GL -lpthread
+    $CC $CFLAGS renderlocksession.c -o bin/renderlock $WAYLAND $GL -lpthread -lm
+    $CC $CFLAGS waylandbook.example.c -o bin/waylandbookexp $WAYLAND $XKB -lrt -lpthread
+    $CC $CFLAGS xdg-shell-demo.c -o bin/xdg-shell-demo $WAYLAND $CURSOR -lpthread
+    $CC $CFLAGS y4mplay.c -o bin/y4mplay $WAYLAND -lrt -lpthread
+    $CC $CFLAGS inputlat.c -o bin/inputlat $WAYLAND $XKB -lpthread
+}
+
+case "${1:-all}" in
+    all)
+        build_all
+        ;;
+    bench)
+        build_all
+        $CC $CFLAGS bench/bench.c -o bin/bench $WAYLAND $XKB -lm
+        shift
+        exec scripts/bench.sh "$@"
+        ;;
+    clean)
+        rm -f bin/seat_listeners bin/seat_listeners_lite bin/render bin/renderlock bin/waylandbookexp bin/xdg-shell-demo bin/y4mplay bin/inputlat
+        rm -f bin/bench bench/results.json
+        ;;
+    *)
+        echo "usage: $0 [all|bench|clean]" >&2
+        exit 1
+        ;;
+esac
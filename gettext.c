@@ -1,12 +1,25 @@
+#define _GNU_SOURCE    // For memfd_create
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
 #include <sys/mman.h>  // For mmap, munmap, PROT_READ, MAP_SHARED, MAP_FAILED
 #include <unistd.h>    // For close
 #include <wayland-client.h>
 #include <xkbcommon/xkbcommon.h>
 #include <xkbcommon/xkbcommon-compose.h>  // For composing keys
+#include "include/trace.h"                // Timeline spans (MYWAYLAND_TRACE)
+#include "include/probes.h"               // USDT probes for bpftrace/perf
+#include "include/font.h"                 // Built-in bitmap font for the transcript
+#include "include/scrollback.h"           // Chunked line store for the transcript
+#include "include/shm.h"                  // wl_shm backing files
+#include "include/async.h"                // Continuations instead of roundtrips
+#include "include/flood.h"                // Deferred logging under event floods
+#include "include/input.h"                // Seat devices by capability
+#include "include/startup.h"              // Time and RSS to "globals ready"
+#include "xdg-shell-client-protocol.h"
+#include "xdg-shell-client-protocol.c"
 
 /*******************************************
  * Keymap Handling:
@@ -83,7 +96,10 @@
  * - If the seat has a keyboard capability, the client binds to the keyboard
  *   and sets up the keyboard listener to handle key events.
  * - xkbcommon is initialized to handle keyboard input, including keymaps and state.
- * - If pointer or touch capabilities are present, they are also initialized.
+ * - Only the keyboard is acquired (include/input.h). Pointer and touch would
+ *   deliver events nobody handles; --all-devices acquires them anyway and
+ *   counts what they send, for comparison. The per-class counts are printed
+ *   on exit.
  *******************************************/
 
 /*******************************************
@@ -93,13 +109,16 @@
  *******************************************/
 
 /*******************************************
- * wl_display_roundtrip:
- * - Sends all pending requests to the server and waits for all responses.
- * - This ensures that the server has processed the initial seat and keyboard
- *   bindings before the client proceeds.
- * - In this case, two roundtrips are performed:
- *   1. To ensure the seat is bound and available.
- *   2. To ensure the keyboard listener receives keymap and modifier events.
+ * Startup without roundtrips:
+ * - wl_display_roundtrip would block until the server has answered, and
+ *   nothing else could happen meanwhile.
+ * - Instead, async_registry_ready (include/async.h) queues a sync right
+ *   after the registry request, and on_registry_ready runs from the main
+ *   loop once every global has been announced: it checks that a seat was
+ *   bound and opens the transcript window.
+ * - The keymap and modifier events need no wait of their own; the keyboard
+ *   listener handles them whenever they arrive. Work that needs no globals
+ *   (filling the transcript) overlaps with the server's reply.
  *******************************************/
 
 /*******************************************
@@ -110,6 +129,22 @@
  *   and other events in real time.
  *******************************************/
 
+/*******************************************
+ * Transcript window (--transcript):
+ * - Every key line is also appended to a scrollback store
+ *   (include/scrollback.h) and shown in a window of its own.
+ * - Only the visible lines are ever looked at. Finding the first visible
+ *   line is O(log n), so the cost of a frame does not depend on how many
+ *   lines the log holds; --transcript-fill N pre-loads N lines to check.
+ * - The visible rows are kept in a private canvas. Scrolling by k lines
+ *   memmoves the canvas and rasterizes just the k newly exposed rows; a
+ *   line appended into empty space rasterizes only that row.
+ * - The canvas is copied into a free wl_shm buffer and committed on the
+ *   next frame callback, so redraws never outrun the compositor.
+ * - Up/Down, Page Up/Down and Home scroll; End jumps back to the tail and
+ *   keeps following new lines.
+ *******************************************/
+
 /*******************************************
  * Cleanup:
  * - Before exiting, resources are released:
@@ -123,15 +158,21 @@ struct globals {
     struct wl_display *display;
     struct wl_registry *registry;
     struct wl_seat *seat;
-    struct wl_keyboard *keyboard;
-    struct wl_pointer *pointer;
-    struct wl_touch *touch;
+    struct input_seat input;       // Keyboard only, unless --all-devices
+    bool all_devices;
 
     bool error;
     struct xkb_context *xkb_context;
     struct xkb_keymap *keymap;
     struct xkb_state *xkb_state;
     struct wl_surface *focused_surface;  // Track focused surface
+
+    // Only bound when the transcript window is requested
+    struct wl_compositor *compositor;
+    struct wl_shm *shm;
+    struct xdg_wm_base *wm_base;
+    struct transcript *transcript;
+    struct flood *flood;           // Set with --flood-safe or --flood
 };
 
 // Helper function to indicate errors
@@ -139,9 +180,423 @@ static void errorOccurred(struct globals *globals) {
     globals->error = true;
 }
 
+/*******************************************
+ * Transcript window
+ *******************************************/
+#define TRANSCRIPT_SCALE       2
+#define TRANSCRIPT_LINE_HEIGHT (FONT_LINE_HEIGHT * TRANSCRIPT_SCALE)
+#define TRANSCRIPT_MARGIN      8
+#define TRANSCRIPT_BUFFERS     2
+#define TRANSCRIPT_BACKGROUND  0xff1d1f21
+#define TRANSCRIPT_FOREGROUND  0xffc5c8c6
+
+struct transcript_buffer {
+    struct wl_buffer *buffer;
+    uint32_t *pixels;
+    bool busy;                       // Held by the compositor until release
+};
+
+struct transcript {
+    struct scrollback log;
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *xdg_toplevel;
+    int32_t width, height;
+    int32_t pending_width, pending_height;
+    bool configured;
+    bool closed;
+
+    struct transcript_buffer buffers[TRANSCRIPT_BUFFERS];
+    void *pool_data;
+    size_t pool_size;
+    uint32_t *canvas;                // Private copy of what is on screen
+    int rows;                        // Text rows that fit in the window
+
+    uint64_t top;                    // First visible line
+    bool follow;                     // Keep the last line in view
+    bool canvas_valid;
+    uint64_t drawn_top;              // top and line count the canvas shows
+    uint64_t drawn_lines;
+    bool dirty;
+    bool frame_pending;
+
+    uint64_t frames;
+    uint64_t rows_rasterized;
+    uint64_t scrolled_frames;        // Frames that reused pixels via memmove
+    double total_ms, max_ms;
+};
+
+static void transcript_render(struct transcript *t);
+
+static void
+transcript_buffer_release(void *data, struct wl_buffer *wl_buffer)
+{
+    struct transcript *t = data;
+    for (int i = 0; i < TRANSCRIPT_BUFFERS; ++i) {
+        if (t->buffers[i].buffer == wl_buffer) {
+            t->buffers[i].busy = false;
+        }
+    }
+    // A frame skipped for lack of a buffer can go out now
+    if (t->dirty && !t->frame_pending) {
+        transcript_render(t);
+    }
+}
+
+static const struct wl_buffer_listener transcript_buffer_listener = {
+    .release = transcript_buffer_release,
+};
+
+static void
+transcript_free_buffers(struct transcript *t)
+{
+    for (int i = 0; i < TRANSCRIPT_BUFFERS; ++i) {
+        if (t->buffers[i].buffer) {
+            wl_buffer_destroy(t->buffers[i].buffer);
+        }
+        t->buffers[i] = (struct transcript_buffer){0};
+    }
+    if (t->pool_data) {
+        munmap(t->pool_data, t->pool_size);
+        t->pool_data = NULL;
+    }
+    free(t->canvas);
+    t->canvas = NULL;
+}
+
+// (Re)creates the canvas and both shm buffers for the current size
+static bool
+transcript_alloc_buffers(struct globals *globals, struct transcript *t)
+{
+    transcript_free_buffers(t);
+
+    int stride = t->width * 4;
+    size_t buffer_size = (size_t)stride * t->height;
+    t->pool_size = buffer_size * TRANSCRIPT_BUFFERS;
+    int fd = shm_allocate(t->pool_size);
+    if (fd < 0) {
+        return false;
+    }
+    t->pool_data = mmap(NULL, t->pool_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (t->pool_data == MAP_FAILED) {
+        t->pool_data = NULL;
+        close(fd);
+        return false;
+    }
+
+    struct wl_shm_pool *pool = wl_shm_create_pool(globals->shm, fd, t->pool_size);
+    for (int i = 0; i < TRANSCRIPT_BUFFERS; ++i) {
+        t->buffers[i].buffer = wl_shm_pool_create_buffer(pool, buffer_size * i,
+                t->width, t->height, stride, WL_SHM_FORMAT_XRGB8888);
+        t->buffers[i].pixels = (uint32_t *)((uint8_t *)t->pool_data + buffer_size * i);
+        wl_buffer_add_listener(t->buffers[i].buffer, &transcript_buffer_listener, t);
+    }
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    t->canvas = malloc(buffer_size);
+    if (!t->canvas) {
+        return false;
+    }
+    for (size_t i = 0; i < buffer_size / 4; ++i) {
+        t->canvas[i] = TRANSCRIPT_BACKGROUND;
+    }
+    int rows = (t->height - 2 * TRANSCRIPT_MARGIN) / TRANSCRIPT_LINE_HEIGHT;
+    t->rows = rows > 0 ? rows : 0;
+    t->canvas_valid = false;
+    return true;
+}
+
+// Rasterizes one text row of the canvas from the log
+static void
+transcript_draw_row(struct transcript *t, int row)
+{
+    int y = TRANSCRIPT_MARGIN + row * TRANSCRIPT_LINE_HEIGHT;
+    for (int py = y; py < y + TRANSCRIPT_LINE_HEIGHT; ++py) {
+        uint32_t *pixels = t->canvas + (size_t)py * t->width;
+        for (int px = 0; px < t->width; ++px) {
+            pixels[px] = TRANSCRIPT_BACKGROUND;
+        }
+    }
+
+    size_t length;
+    const char *line = scrollback_line(&t->log, t->top + row, &length);
+    if (line) {
+        // Only as many characters as can be visible
+        char text[SCROLLBACK_MAX_LINE + 1];
+        size_t fit = (t->width - TRANSCRIPT_MARGIN) / (FONT_ADVANCE * TRANSCRIPT_SCALE) + 1;
+        length = length < fit ? length : fit;
+        memcpy(text, line, length);
+        text[length] = '\0';
+        font_draw_text(t->canvas, t->width, t->height, t->width * 4, NULL,
+                       TRANSCRIPT_MARGIN, y + TRANSCRIPT_SCALE, TRANSCRIPT_SCALE,
+                       TRANSCRIPT_FOREGROUND, text);
+    }
+    ++t->rows_rasterized;
+}
+
+static void
+transcript_frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+    struct transcript *t = data;
+    wl_callback_destroy(callback);
+    t->frame_pending = false;
+    if (t->dirty) {
+        transcript_render(t);
+    }
+}
+
+static const struct wl_callback_listener transcript_frame_listener = {
+    .done = transcript_frame_done,
+};
+
+/*******************************************
+ * transcript_render:
+ * - Brings the canvas up to date with as little rasterization as possible,
+ *   then copies it into a free buffer and commits.
+ * - Everything here is bounded by the window size, never the log size.
+ *******************************************/
+static void
+transcript_render(struct transcript *t)
+{
+    if (!t->configured || !t->canvas) {
+        return;
+    }
+    struct transcript_buffer *buffer = NULL;
+    for (int i = 0; i < TRANSCRIPT_BUFFERS && !buffer; ++i) {
+        if (!t->buffers[i].busy) {
+            buffer = &t->buffers[i];
+        }
+    }
+    if (!buffer) {
+        return;  // Retried from the buffer release
+    }
+
+    TRACE_BEGIN("render", "transcript");
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    uint64_t lines = t->log.line_count;
+    uint64_t max_top = lines > (uint64_t)t->rows ? lines - t->rows : 0;
+    if (t->follow || t->top > max_top) {
+        t->top = max_top;
+    }
+
+    int rows = t->rows;
+    int64_t delta = (int64_t)t->top - (int64_t)t->drawn_top;
+    bool full = !t->canvas_valid || delta >= rows || -delta >= rows;
+    size_t row_bytes = (size_t)t->width * 4 * TRANSCRIPT_LINE_HEIGHT;
+    uint8_t *band = (uint8_t *)t->canvas + (size_t)TRANSCRIPT_MARGIN * t->width * 4;
+
+    // Reuse the rows that are still visible, shifted into place
+    if (!full && delta > 0) {
+        memmove(band, band + delta * row_bytes, (rows - delta) * row_bytes);
+        ++t->scrolled_frames;
+    } else if (!full && delta < 0) {
+        memmove(band - delta * row_bytes, band, (rows + delta) * row_bytes);
+        ++t->scrolled_frames;
+    }
+
+    int first_damaged = rows, last_damaged = -1;
+    for (int row = 0; row < rows; ++row) {
+        uint64_t line = t->top + row;
+        bool exposed = delta > 0 ? row >= rows - delta : row < -delta;
+        bool appended = line >= t->drawn_lines && line < lines;
+        if (full || exposed || appended) {
+            transcript_draw_row(t, row);
+            first_damaged = row < first_damaged ? row : first_damaged;
+            last_damaged = row;
+        }
+    }
+    t->drawn_top = t->top;
+    t->drawn_lines = lines;
+    t->canvas_valid = true;
+    t->dirty = false;
+
+    memcpy(buffer->pixels, t->canvas, (size_t)t->width * 4 * t->height);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    ++t->frames;
+    t->total_ms += ms;
+    t->max_ms = ms > t->max_ms ? ms : t->max_ms;
+    TRACE_END("render", "transcript");
+
+    wl_surface_attach(t->surface, buffer->buffer, 0, 0);
+    if (full || delta != 0) {
+        wl_surface_damage(t->surface, 0, 0, t->width, t->height);
+    } else if (last_damaged >= 0) {
+        wl_surface_damage(t->surface, 0, TRANSCRIPT_MARGIN + first_damaged * TRANSCRIPT_LINE_HEIGHT,
+                          t->width, (last_damaged - first_damaged + 1) * TRANSCRIPT_LINE_HEIGHT);
+    }
+    struct wl_callback *callback = wl_surface_frame(t->surface);
+    wl_callback_add_listener(callback, &transcript_frame_listener, t);
+    wl_surface_commit(t->surface);
+    buffer->busy = true;
+    t->frame_pending = true;
+}
+
+// Asks for a redraw; it happens now or on the next frame callback
+static void
+transcript_schedule(struct transcript *t)
+{
+    t->dirty = true;
+    if (!t->frame_pending) {
+        transcript_render(t);
+    }
+}
+
+static void
+transcript_append(struct transcript *t, const char *line)
+{
+    if (scrollback_append(&t->log, line, strlen(line)) == 0) {
+        transcript_schedule(t);
+    }
+}
+
+static void
+transcript_scroll(struct transcript *t, int64_t lines)
+{
+    uint64_t max_top = t->log.line_count > (uint64_t)t->rows ? t->log.line_count - t->rows : 0;
+    int64_t top = (int64_t)t->top + lines;
+    top = top < 0 ? 0 : top;
+    t->top = (uint64_t)top > max_top ? max_top : (uint64_t)top;
+    t->follow = t->top == max_top;
+    transcript_schedule(t);
+}
+
+static void
+transcript_handle_key(struct transcript *t, xkb_keysym_t sym)
+{
+    switch (sym) {
+    case XKB_KEY_Up:        transcript_scroll(t, -1); break;
+    case XKB_KEY_Down:      transcript_scroll(t, 1); break;
+    case XKB_KEY_Page_Up:   transcript_scroll(t, -t->rows); break;
+    case XKB_KEY_Page_Down: transcript_scroll(t, t->rows); break;
+    case XKB_KEY_Home:      transcript_scroll(t, -(int64_t)t->log.line_count); break;
+    case XKB_KEY_End:       transcript_scroll(t, t->log.line_count); break;
+    }
+}
+
+static void
+transcript_wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener transcript_wm_base_listener = {
+    .ping = transcript_wm_base_ping,
+};
+
+static void
+transcript_toplevel_configure(void *data, struct xdg_toplevel *toplevel,
+                              int32_t width, int32_t height, struct wl_array *states)
+{
+    struct transcript *t = data;
+    t->pending_width = width;
+    t->pending_height = height;
+}
+
+static void
+transcript_toplevel_close(void *data, struct xdg_toplevel *toplevel)
+{
+    struct transcript *t = data;
+    t->closed = true;
+}
+
+static void
+transcript_toplevel_configure_bounds(void *data, struct xdg_toplevel *toplevel, int32_t width, int32_t height)
+{
+}
+
+static void
+transcript_toplevel_wm_capabilities(void *data, struct xdg_toplevel *toplevel, struct wl_array *capabilities)
+{
+}
+
+static const struct xdg_toplevel_listener transcript_toplevel_listener = {
+    .configure = transcript_toplevel_configure,
+    .close = transcript_toplevel_close,
+    .configure_bounds = transcript_toplevel_configure_bounds,
+    .wm_capabilities = transcript_toplevel_wm_capabilities,
+};
+
+static void
+transcript_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+    struct globals *globals = data;
+    struct transcript *t = globals->transcript;
+    PROBE1(configure_received, serial);
+    xdg_surface_ack_configure(xdg_surface, serial);
+    PROBE1(configure_acked, serial);
+
+    int32_t width = t->pending_width > 0 ? t->pending_width : 800;
+    int32_t height = t->pending_height > 0 ? t->pending_height : 600;
+    if (width != t->width || height != t->height || !t->canvas) {
+        t->width = width;
+        t->height = height;
+        if (!transcript_alloc_buffers(globals, t)) {
+            fprintf(stderr, "Failed to allocate transcript buffers\n");
+            errorOccurred(globals);
+            return;
+        }
+    }
+    t->configured = true;
+    // A configure always needs a new commit, even mid-frame
+    t->frame_pending = false;
+    transcript_schedule(t);
+}
+
+static const struct xdg_surface_listener transcript_surface_listener = {
+    .configure = transcript_surface_configure,
+};
+
+static bool
+transcript_create_window(struct globals *globals)
+{
+    struct transcript *t = globals->transcript;
+    if (!globals->compositor || !globals->shm || !globals->wm_base) {
+        fprintf(stderr, "The transcript window needs wl_compositor, wl_shm and xdg_wm_base\n");
+        return false;
+    }
+    xdg_wm_base_add_listener(globals->wm_base, &transcript_wm_base_listener, globals);
+    t->surface = wl_compositor_create_surface(globals->compositor);
+    t->xdg_surface = xdg_wm_base_get_xdg_surface(globals->wm_base, t->surface);
+    xdg_surface_add_listener(t->xdg_surface, &transcript_surface_listener, globals);
+    t->xdg_toplevel = xdg_surface_get_toplevel(t->xdg_surface);
+    xdg_toplevel_add_listener(t->xdg_toplevel, &transcript_toplevel_listener, t);
+    xdg_toplevel_set_title(t->xdg_toplevel, "Key transcript");
+    wl_surface_commit(t->surface);
+    return true;
+}
+
+static void
+transcript_destroy(struct transcript *t)
+{
+    if (t->frames) {
+        fprintf(stderr, "[TRANSCRIPT] %llu lines (%.1f MiB in %zu chunks), %llu frames: "
+                "avg %.3f ms, max %.3f ms, %llu rows rasterized, %llu frames scrolled in place\n",
+                (unsigned long long)t->log.line_count, t->log.bytes / 1048576.0, t->log.chunk_count,
+                (unsigned long long)t->frames, t->total_ms / t->frames, t->max_ms,
+                (unsigned long long)t->rows_rasterized, (unsigned long long)t->scrolled_frames);
+    }
+    transcript_free_buffers(t);
+    if (t->xdg_toplevel) {
+        xdg_toplevel_destroy(t->xdg_toplevel);
+    }
+    if (t->xdg_surface) {
+        xdg_surface_destroy(t->xdg_surface);
+    }
+    if (t->surface) {
+        wl_surface_destroy(t->surface);
+    }
+    scrollback_free(&t->log);
+}
+
 // Callback for handling the keymap event (opcode 0)
 static void keyboard_handle_keymap(void *data, struct wl_keyboard *keyboard, uint32_t format, int32_t fd, uint32_t size) {
     struct globals *globals = data;
+    input_seat_event(&globals->input, WL_SEAT_CAPABILITY_KEYBOARD);
 
     // Read the keymap from the provided file descriptor
     char *keymap_string = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
@@ -152,7 +607,11 @@ static void keyboard_handle_keymap(void *data, struct wl_keyboard *keyboard, uin
     }
 
     // Create a new keymap using xkbcommon
+    TRACE_BEGIN("input", "keymap compile");
+    PROBE1(keymap_compile_start, size);
     struct xkb_keymap *keymap = xkb_keymap_new_from_string(globals->xkb_context, keymap_string, XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    PROBE1(keymap_compile_end, keymap != NULL);
+    TRACE_END("input", "keymap compile");
     munmap(keymap_string, size);
     close(fd);
 
@@ -178,31 +637,75 @@ static void keyboard_handle_keymap(void *data, struct wl_keyboard *keyboard, uin
     }
 }
 
+// Deferred record for one key event (flood-safe mode)
+#define KEY_RECORD 1
+
+struct key_record {
+    xkb_keysym_t sym;
+    uint32_t state;
+};
+
+// Prints the key line and feeds the transcript; the expensive part of a key event
+static void key_log(struct globals *globals, xkb_keysym_t sym, uint32_t state) {
+    // Check if the key pressed is Backspace
+    char line[96];
+    if (sym == XKB_KEY_BackSpace) {
+        if (state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+            snprintf(line, sizeof(line), "Backspace pressed");
+            // You can handle backspace logic here (e.g., remove character from input buffer)
+        } else {
+            snprintf(line, sizeof(line), "Backspace released");
+        }
+    } else {
+        // Handle other keys
+        char name[64];
+        xkb_keysym_get_name(sym, name, sizeof(name));
+        snprintf(line, sizeof(line), "Key %s %s", name, state == WL_KEYBOARD_KEY_STATE_PRESSED ? "pressed" : "released");
+    }
+    printf("%s\n", line);
+
+    if (globals->transcript) {
+        transcript_append(globals->transcript, line);
+        if (state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+            transcript_handle_key(globals->transcript, sym);
+        }
+    }
+}
+
+// Runs deferred records from flood_dispatch, within its budget
+static void drain_record(void *data, const struct flood_record *record) {
+    struct globals *globals = data;
+    if (record->kind == KEY_RECORD) {
+        struct key_record key;
+        memcpy(&key, record->payload, sizeof(key));
+        key_log(globals, key.sym, key.state);
+    }
+}
+
 // Callback for handling keyboard key events
 static void keyboard_handle_key(void *data, struct wl_keyboard *keyboard, uint32_t serial,
                        uint32_t time, uint32_t key, uint32_t state) {
     struct globals *globals = data;
+    input_seat_event(&globals->input, WL_SEAT_CAPABILITY_KEYBOARD);
+    FLOOD_HANDLER_BEGIN(globals->flood);
+    TRACE_BEGIN("input", "key");
+    PROBE2(key, key, state);
 
-    // Convert Wayland keycode to XKB keycode
+    // Convert Wayland keycode to XKB keycode. The lookup must happen now,
+    // against the current modifier state; only the logging can wait.
     uint32_t keycode = key + 8;
     const xkb_keysym_t *syms;
     int num_syms = xkb_state_key_get_syms(globals->xkb_state, keycode, &syms);
     if (num_syms > 0) {
-        // Check if the key pressed is Backspace
-        if (syms[0] == XKB_KEY_BackSpace) {
-            if (state == WL_KEYBOARD_KEY_STATE_PRESSED) {
-                printf("Backspace pressed\n");
-                // You can handle backspace logic here (e.g., remove character from input buffer)
-            } else {
-                printf("Backspace released\n");
-            }
+        if (globals->flood && globals->flood->enabled) {
+            struct key_record record = { syms[0], state };
+            flood_push(globals->flood, KEY_RECORD, time, &record, sizeof(record));
         } else {
-            // Handle other keys
-            char name[64];
-            xkb_keysym_get_name(syms[0], name, sizeof(name));
-            printf("Key %s %s\n", name, state == WL_KEYBOARD_KEY_STATE_PRESSED ? "pressed" : "released");
+            key_log(globals, syms[0], state);
         }
     }
+    TRACE_END("input", "key");
+    FLOOD_HANDLER_END(globals->flood);
 }
 
 
@@ -210,8 +713,10 @@ static void keyboard_handle_key(void *data, struct wl_keyboard *keyboard, uint32
 static void keyboard_handle_enter(void *data, struct wl_keyboard *keyboard, uint32_t serial,
                                   struct wl_surface *surface, struct wl_array *keys) {
     struct globals *globals = data;
+    input_seat_event(&globals->input, WL_SEAT_CAPABILITY_KEYBOARD);
 
     globals->focused_surface = surface;  // Track the focused surface
+    TRACE_INSTANT("input", "keyboard enter");
     printf("Keyboard entered a surface\n");
 }
 
@@ -219,8 +724,10 @@ static void keyboard_handle_enter(void *data, struct wl_keyboard *keyboard, uint
 static void keyboard_handle_leave(void *data, struct wl_keyboard *keyboard, uint32_t serial,
                                   struct wl_surface *surface) {
     struct globals *globals = data;
+    input_seat_event(&globals->input, WL_SEAT_CAPABILITY_KEYBOARD);
 
     globals->focused_surface = NULL;  // Clear the focused surface
+    TRACE_INSTANT("input", "keyboard leave");
     printf("Keyboard left a surface\n");
 }
 
@@ -229,6 +736,8 @@ static void keyboard_handle_modifiers(void *data, struct wl_keyboard *keyboard,
                                       uint32_t mods_depressed, uint32_t mods_latched, 
                                       uint32_t mods_locked, uint32_t group) {
     struct globals *globals = data;
+    input_seat_event(&globals->input, WL_SEAT_CAPABILITY_KEYBOARD);
+    TRACE_INSTANT("input", "modifiers");
     xkb_state_update_mask(globals->xkb_state, mods_depressed, mods_latched, mods_locked, 0, 0, group);
 }
 
@@ -244,36 +753,28 @@ static const struct wl_keyboard_listener keyboard_listener = {
 // Callback for seat capabilities (pointer, keyboard, touch)
 static void seat_handle_capabilities(void *data, struct wl_seat *seat, uint32_t caps) {
     struct globals *globals = data;
+    TRACE_INSTANT("registry", "seat capabilities");
 
-    if (caps & WL_SEAT_CAPABILITY_KEYBOARD) {
-        globals->keyboard = wl_seat_get_keyboard(seat);
-        wl_keyboard_add_listener(globals->keyboard, &keyboard_listener, globals);
-        printf("Keyboard capability present\n");
-
-        // Initialize xkbcommon for keyboard handling
-        globals->xkb_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-        if (!globals->xkb_context) {
-            fprintf(stderr, "Failed to create XKB context\n");
-            errorOccurred(globals);
-            return;
-        }
-    } else {
-        globals->keyboard = NULL;
+    input_seat_capabilities(&globals->input, caps);
+    if (!globals->input.keyboard) {
         errorOccurred(globals);
+        return;
     }
-
-    if (caps & WL_SEAT_CAPABILITY_POINTER) {
-        globals->pointer = wl_seat_get_pointer(seat);
+    printf("Keyboard capability present\n");
+    if (globals->input.pointer) {
         printf("Pointer capability present\n");
-    } else {
-        globals->pointer = NULL;
     }
-
-    if (caps & WL_SEAT_CAPABILITY_TOUCH) {
-        globals->touch = wl_seat_get_touch(seat);
+    if (globals->input.touch) {
         printf("Touch capability present\n");
-    } else {
-        globals->touch = NULL;
+    }
+
+    // Initialize xkbcommon for keyboard handling
+    if (!globals->xkb_context) {
+        globals->xkb_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    }
+    if (!globals->xkb_context) {
+        fprintf(stderr, "Failed to create XKB context\n");
+        errorOccurred(globals);
     }
 }
 
@@ -293,11 +794,25 @@ static void registry_handler(void *data, struct wl_registry *registry,
                              uint32_t id, const char *interface, uint32_t version) {
     struct globals *globals = data;
 
+    TRACE_BEGIN("registry", "global");
     if (strcmp(interface, "wl_seat") == 0) {
-        globals->seat = wl_registry_bind(registry, id, &wl_seat_interface, 1);
+        // v3 for wl_keyboard_release; v4 would add repeat_info, which is unhandled
+        globals->seat = wl_registry_bind(registry, id, &wl_seat_interface, version < 3 ? version : 3);
+        uint32_t wanted = WL_SEAT_CAPABILITY_KEYBOARD;
+        if (globals->all_devices) {
+            wanted |= WL_SEAT_CAPABILITY_POINTER | WL_SEAT_CAPABILITY_TOUCH;
+        }
+        input_seat_init(&globals->input, globals->seat, wanted, NULL, &keyboard_listener, NULL, globals);
         wl_seat_add_listener(globals->seat, &seat_listener, globals);
         printf("Seat bound\n");
+    } else if (globals->transcript && strcmp(interface, "wl_compositor") == 0) {
+        globals->compositor = wl_registry_bind(registry, id, &wl_compositor_interface, 1);
+    } else if (globals->transcript && strcmp(interface, "wl_shm") == 0) {
+        globals->shm = wl_registry_bind(registry, id, &wl_shm_interface, 1);
+    } else if (globals->transcript && strcmp(interface, "xdg_wm_base") == 0) {
+        globals->wm_base = wl_registry_bind(registry, id, &xdg_wm_base_interface, 1);
     }
+    TRACE_END("registry", "global");
 }
 
 // Callback for registry global remove event
@@ -311,9 +826,55 @@ static const struct wl_registry_listener registry_listener = {
     registry_remover,
 };
 
-int main() {
+// Runs once every global has been announced (see "Startup without roundtrips")
+static void on_registry_ready(void *data) {
+    struct globals *globals = data;
+    TRACE_INSTANT("registry", "globals ready");
+
+    // Ensure that the seat has been bound
+    if (!globals->seat) {
+        fprintf(stderr, "Seat is NULL\n");
+        errorOccurred(globals);
+        return;
+    }
+    // Same point as seat_listeners_lite, for scripts/lite_compare.sh
+    startup_report("globals ready");
+
+    if (globals->transcript && !transcript_create_window(globals)) {
+        errorOccurred(globals);
+    }
+}
+
+int main(int argc, char **argv) {
+    startup_begin();
     // Initialize globals struct
     struct globals globals = {0};
+    struct transcript transcript = { .follow = true };
+    unsigned long long fill = 0;
+    unsigned long long flood_count = 0;
+    bool flood_safe = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--transcript") == 0) {
+            globals.transcript = &transcript;
+        } else if (strcmp(argv[i], "--transcript-fill") == 0 && i + 1 < argc) {
+            globals.transcript = &transcript;
+            fill = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--flood-safe") == 0) {
+            flood_safe = true;
+        } else if (strcmp(argv[i], "--flood") == 0 && i + 1 < argc) {
+            flood_count = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--all-devices") == 0) {
+            globals.all_devices = true;
+        } else {
+            fprintf(stderr, "usage: %s [--transcript] [--transcript-fill lines] "
+                    "[--flood-safe] [--flood syncs] [--all-devices]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    // Optional timeline tracing, enabled through MYWAYLAND_TRACE
+    trace_init("seat_listeners");
 
     // Connect to Wayland display
     globals.display = wl_display_connect(NULL);
@@ -322,29 +883,91 @@ int main() {
         return -1;
     }
 
+    // The ring is large, keep it off the stack
+    static struct flood flood;
+    if (flood_safe || flood_count) {
+        flood_init(&flood, globals.display, flood_safe);
+        globals.flood = &flood;
+    }
+
     // Get the registry and add a listener
     globals.registry = wl_display_get_registry(globals.display);
     wl_registry_add_listener(globals.registry, &registry_listener, &globals);
 
-    // Perform a roundtrip to process events
-    wl_display_roundtrip(globals.display);
-
-    // Ensure that the seat has been bound
-    if (!globals.seat) {
-        fprintf(stderr, "Seat is NULL\n");
+    TRACE_BEGIN("registry", "request");
+    if (async_registry_ready(globals.display, on_registry_ready, &globals) < 0) {
+        fprintf(stderr, "Failed to queue registry sync\n");
         wl_display_disconnect(globals.display);
         return -1;
     }
+    wl_display_flush(globals.display);
+    TRACE_END("registry", "request");
+
+    if (globals.transcript && fill) {
+        // Synthetic history, to show frame time does not grow with the log.
+        // Runs while the compositor answers the registry request.
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (unsigned long long i = 0; i < fill; ++i) {
+            char line[64];
+            int length = snprintf(line, sizeof(line), "Filler line %llu of %llu", i + 1, fill);
+            if (scrollback_append(&transcript.log, line, length) != 0) {
+                fprintf(stderr, "Out of memory after %llu filler lines\n", i);
+                break;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        fprintf(stderr, "[TRANSCRIPT] Filled %llu lines in %.1f ms\n", fill,
+                (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+    }
 
-    // Perform a second roundtrip to ensure seat listener gets events
-    wl_display_roundtrip(globals.display);
+    if (flood_count && flood_start(&flood, globals.display, flood_count, drain_record, &globals) < 0) {
+        fprintf(stderr, "[FLOOD] Connection lost while sending the flood\n");
+        errorOccurred(&globals);
+    }
 
     // Main loop: process Wayland events
-    while (wl_display_dispatch(globals.display) != -1 && !globals.error) {
+    bool flood_reported = false;
+    while (!globals.error && !transcript.closed && !trace_stop_requested()) {
         // Process Wayland events in a loop
+        int ret;
+        if (globals.flood) {
+            ret = flood_dispatch(globals.display, globals.flood, -1, drain_record, &globals);
+        } else {
+            TRACE_BEGIN("dispatch", "wl_display_dispatch");
+            ret = trace_dispatch(globals.display);
+            TRACE_END("dispatch", "wl_display_dispatch");
+        }
+        if (ret == -1) {
+            break;
+        }
+        if (flood_count && !flood_reported && flood.flood_done == flood.flood_sent &&
+            flood_depth(&flood) == 0) {
+            flood_report(&flood, "seat_listeners");
+            flood_reported = true;
+        }
+    }
+    if (globals.flood) {
+        flood_report(globals.flood, "seat_listeners");
+    }
+    if (globals.seat) {
+        input_seat_report(&globals.input, "seat_listeners");
+        input_seat_finish(&globals.input);
     }
 
     // Cleanup
+    if (globals.transcript) {
+        transcript_destroy(globals.transcript);
+    }
+    if (globals.wm_base) {
+        xdg_wm_base_destroy(globals.wm_base);
+    }
+    if (globals.shm) {
+        wl_shm_destroy(globals.shm);
+    }
+    if (globals.compositor) {
+        wl_compositor_destroy(globals.compositor);
+    }
     if (globals.xkb_state) {
         xkb_state_unref(globals.xkb_state);
     }
@@ -354,14 +977,10 @@ int main() {
     if (globals.xkb_context) {
         xkb_context_unref(globals.xkb_context);
     }
-    if (globals.keyboard) {
-        wl_keyboard_destroy(globals.keyboard);
-    }
-    if (globals.pointer) {
-        wl_pointer_destroy(globals.pointer);
-    }
-    if (globals.touch) {
-        wl_touch_destroy(globals.touch);
+    if (!globals.seat) {
+        // The registry never announced a seat
+        wl_display_disconnect(globals.display);
+        return -1;
     }
     wl_seat_destroy(globals.seat);
     wl_display_disconnect(globals.display);
@@ -0,0 +1,197 @@
+#ifndef MYWAYLAND_ASYNC_H
+#define MYWAYLAND_ASYNC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <wayland-client.h>
+
+/*******************************************
+ * @ASYNC CONTINUATIONS
+ *******************************************
+ *
+ * The usual startup sequence is "wl_display_roundtrip, then check that
+ * the globals showed up". Every roundtrip stalls the client for a full
+ * trip through the compositor, and nothing else happens meanwhile
+ * (e.g. initializing EGL, which needs no globals at all).
+ *
+ * These helpers express "run this when X has happened" as a continuation
+ * (function + data) that the normal event loop invokes. A startup step can
+ * then be issued, followed immediately by unrelated work, with the rest
+ * of the sequence resuming when the compositor answers:
+ *
+ * - async_sync()            wl_display_sync done: everything sent before
+ *                           has been processed.
+ * - async_registry_ready()  every global has been announced (a sync
+ *                           issued right after wl_display_get_registry).
+ * - async_frame()           a surface's frame callback.
+ * - async_buffer_release()  wl_buffer.release, for buffers without another
+ *                           listener.
+ * - struct async_event      anything the program signals itself from its
+ *                           own listener, e.g. the first xdg_surface
+ *                           configure. Waiting on an event that already
+ *                           fired runs the continuation at once.
+ * - struct async_join       runs one continuation after N others finished,
+ *                           to let independent steps overlap.
+ *
+ * Continuations run from inside wl_display_dispatch*, like any listener.
+ *******************************************/
+
+typedef void (*async_fn)(void *data);
+
+#define ASYNC_MAX_WAITERS 8
+
+struct async_waiter {
+    async_fn fn;
+    void *data;
+};
+
+struct async_event {
+    struct async_waiter waiters[ASYNC_MAX_WAITERS];
+    int count;
+    bool fired;
+};
+
+// Queues `fn`, or runs it right away if the event has already fired
+static void
+async_event_wait(struct async_event *event, async_fn fn, void *data)
+{
+    if (event->fired) {
+        fn(data);
+        return;
+    }
+    if (event->count == ASYNC_MAX_WAITERS) {
+        fprintf(stderr, "[ASYNC] Too many waiters on one event\n");
+        abort();
+    }
+    event->waiters[event->count++] = (struct async_waiter){ fn, data };
+}
+
+// Marks the event as fired and runs everything waiting on it, in order
+static void
+async_event_fire(struct async_event *event)
+{
+    struct async_waiter waiters[ASYNC_MAX_WAITERS];
+    int count = event->count;
+    memcpy(waiters, event->waiters, sizeof(waiters[0]) * count);
+    event->count = 0;
+    event->fired = true;
+    for (int i = 0; i < count; ++i) {
+        waiters[i].fn(waiters[i].data);
+    }
+}
+
+struct async_join {
+    int pending;
+    async_fn fn;
+    void *data;
+};
+
+static void
+async_join_init(struct async_join *join, int pending, async_fn fn, void *data)
+{
+    join->pending = pending;
+    join->fn = fn;
+    join->data = data;
+}
+
+// An async_fn: pass the join as data to any of the other helpers
+static void
+async_join_done(void *data)
+{
+    struct async_join *join = data;
+    if (--join->pending == 0) {
+        join->fn(join->data);
+    }
+}
+
+/*******************************************
+ * Protocol-backed waits:
+ * - Each allocates a small record carrying the continuation; it is freed
+ *   once the continuation has run. Return -1 on allocation failure.
+ *******************************************/
+struct async_callback {
+    async_fn fn;
+    void *data;
+};
+
+static void
+async_callback_done(void *data, struct wl_callback *callback, uint32_t callback_data)
+{
+    struct async_callback record = *(struct async_callback *)data;
+    free(data);
+    wl_callback_destroy(callback);
+    record.fn(record.data);
+}
+
+static const struct wl_callback_listener async_callback_listener = {
+    .done = async_callback_done,
+};
+
+static int
+async_callback_attach(struct wl_callback *callback, async_fn fn, void *data)
+{
+    struct async_callback *record = malloc(sizeof(*record));
+    if (!callback || !record) {
+        free(record);
+        if (callback) {
+            wl_callback_destroy(callback);
+        }
+        return -1;
+    }
+    *record = (struct async_callback){ fn, data };
+    wl_callback_add_listener(callback, &async_callback_listener, record);
+    return 0;
+}
+
+static int
+async_sync(struct wl_display *display, async_fn fn, void *data)
+{
+    return async_callback_attach(wl_display_sync(display), fn, data);
+}
+
+/*******************************************
+ * async_registry_ready:
+ * - Call right after wl_display_get_registry (and adding its listener).
+ *   The compositor sends all wl_registry.global events before answering a
+ *   later sync, so when `fn` runs every global has been seen and bound.
+ *******************************************/
+static int
+async_registry_ready(struct wl_display *display, async_fn fn, void *data)
+{
+    return async_sync(display, fn, data);
+}
+
+static int
+async_frame(struct wl_surface *surface, async_fn fn, void *data)
+{
+    return async_callback_attach(wl_surface_frame(surface), fn, data);
+}
+
+static void
+async_buffer_released(void *data, struct wl_buffer *buffer)
+{
+    struct async_callback record = *(struct async_callback *)data;
+    free(data);
+    record.fn(record.data);
+}
+
+static const struct wl_buffer_listener async_buffer_listener = {
+    .release = async_buffer_released,
+};
+
+// One-shot: the buffer must not have another listener
+static int
+async_buffer_release(struct wl_buffer *buffer, async_fn fn, void *data)
+{
+    struct async_callback *record = malloc(sizeof(*record));
+    if (!record) {
+        return -1;
+    }
+    *record = (struct async_callback){ fn, data };
+    wl_buffer_add_listener(buffer, &async_buffer_listener, record);
+    return 0;
+}
+
+#endif
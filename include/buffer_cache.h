@@ -0,0 +1,290 @@
+#ifndef MYWAYLAND_BUFFER_CACHE_H
+#define MYWAYLAND_BUFFER_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <wayland-client.h>
+#include "probes.h"
+#include "shm.h"
+
+/*******************************************
+ * @CONTENT-ADDRESSED SHM BUFFERS
+ *******************************************
+ *
+ * A cache of XRGB8888 wl_shm buffers shared between surfaces. Surfaces
+ * that show the same content at the same size (two equal monitors behind
+ * one lock screen, say) attach the same wl_buffer, so it is drawn and
+ * stored once.
+ *
+ * - An entry is keyed by (key, width, height). The key names the content
+ *   and is chosen by the client, e.g. a generation counter bumped on every
+ *   change; BUFFER_CACHE_EMPTY marks an entry that holds nothing usable.
+ * - buffer_cache_lookup() finds an entry already drawn for a key.
+ *   Otherwise buffer_cache_reserve() hands out a free entry of that size
+ *   (the most recently drawn one, whose pixels are likely closest to the
+ *   new content) or allocates one; the client draws and sets the key.
+ * - Release is tracked per entry across surfaces: `surfaces` counts the
+ *   surfaces whose current buffer it is, `busy` is set on every attach
+ *   and cleared by wl_buffer.release, which the compositor sends once no
+ *   surface uses the buffer any more. Only entries with neither are
+ *   written to or evicted.
+ * - Every entry has its own single-buffer wl_shm_pool, so an eviction
+ *   returns its memory at once. When all BUFFER_CACHE_MAX slots are taken
+ *   the least recently used free entry makes room.
+ *******************************************/
+#define BUFFER_CACHE_MAX 16
+#define BUFFER_CACHE_EMPTY 0
+
+struct buffer_cache;
+
+struct buffer_cache_entry {
+    struct buffer_cache *cache;
+    uint64_t key;
+    int32_t width, height, stride;
+    struct wl_buffer *buffer;        // NULL for an unused slot
+    uint32_t *pixels;
+    size_t size;
+    int surfaces;                    // Surfaces showing it
+    bool busy;                       // Attached and not yet released
+    uint64_t frame;                  // Frame of the latest attach, for the buffer_release probe
+    uint64_t last_use;
+};
+
+struct buffer_cache {
+    struct wl_shm *shm;
+    struct buffer_cache_entry entries[BUFFER_CACHE_MAX];
+    uint64_t clock;
+
+    // Called after a release made an entry free, e.g. to resume a stalled frame
+    void (*released)(void *data);
+    void *data;
+
+    uint64_t attaches;
+    uint64_t hits;                   // Lookups that found the content already drawn
+    uint64_t allocations;
+    uint64_t evictions;
+    size_t bytes, peak_bytes;
+};
+
+static void
+buffer_cache_init(struct buffer_cache *cache, struct wl_shm *shm,
+                  void (*released)(void *data), void *data)
+{
+    *cache = (struct buffer_cache){ .shm = shm, .released = released, .data = data };
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        cache->entries[i].cache = cache;
+    }
+}
+
+static inline bool
+buffer_cache_free(const struct buffer_cache_entry *entry)
+{
+    return entry->buffer && entry->surfaces == 0 && !entry->busy;
+}
+
+static void
+buffer_cache_release(void *data, struct wl_buffer *wl_buffer)
+{
+    struct buffer_cache_entry *entry = data;
+    PROBE1(buffer_release, entry->frame);
+    entry->busy = false;
+    if (entry->surfaces == 0 && entry->cache->released) {
+        entry->cache->released(entry->cache->data);
+    }
+}
+
+static const struct wl_buffer_listener buffer_cache_buffer_listener = {
+    .release = buffer_cache_release,
+};
+
+static void
+buffer_cache_evict(struct buffer_cache_entry *entry)
+{
+    struct buffer_cache *cache = entry->cache;
+    wl_buffer_destroy(entry->buffer);
+    munmap(entry->pixels, entry->size);
+    cache->bytes -= entry->size;
+    ++cache->evictions;
+    *entry = (struct buffer_cache_entry){ .cache = cache };
+}
+
+// Allocates a new, undrawn entry; NULL when every slot is in use
+static struct buffer_cache_entry *
+buffer_cache_add(struct buffer_cache *cache, int32_t width, int32_t height)
+{
+    struct buffer_cache_entry *slot = NULL;
+    for (int i = 0; i < BUFFER_CACHE_MAX && !slot; ++i) {
+        if (!cache->entries[i].buffer) {
+            slot = &cache->entries[i];
+        }
+    }
+    for (int i = 0; i < BUFFER_CACHE_MAX && !slot; ++i) {
+        struct buffer_cache_entry *entry = &cache->entries[i];
+        if (buffer_cache_free(entry) && (!slot || entry->last_use < slot->last_use)) {
+            slot = entry;
+        }
+    }
+    if (!slot) {
+        return NULL;
+    }
+    if (slot->buffer) {
+        buffer_cache_evict(slot);
+    }
+
+    int32_t stride = width * 4;
+    size_t size = (size_t)stride * height;
+    int fd = shm_allocate(size);
+    if (fd < 0) {
+        return NULL;
+    }
+    void *pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pixels == MAP_FAILED) {
+        fprintf(stderr, "[SHM] Failed to map %zu bytes\n", size);
+        close(fd);
+        return NULL;
+    }
+    struct wl_shm_pool *pool = wl_shm_create_pool(cache->shm, fd, size);
+    close(fd);
+    slot->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);      // The buffer keeps the memory alive
+    wl_buffer_add_listener(slot->buffer, &buffer_cache_buffer_listener, slot);
+
+    slot->key = BUFFER_CACHE_EMPTY;
+    slot->width = width;
+    slot->height = height;
+    slot->stride = stride;
+    slot->pixels = pixels;
+    slot->size = size;
+    slot->last_use = ++cache->clock;
+    ++cache->allocations;
+    cache->bytes += size;
+    if (cache->bytes > cache->peak_bytes) {
+        cache->peak_bytes = cache->bytes;
+    }
+    return slot;
+}
+
+static struct buffer_cache_entry *
+buffer_cache_lookup(struct buffer_cache *cache, uint64_t key, int32_t width, int32_t height)
+{
+    if (key == BUFFER_CACHE_EMPTY) {
+        return NULL;
+    }
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        struct buffer_cache_entry *entry = &cache->entries[i];
+        if (entry->buffer && entry->key == key && entry->width == width && entry->height == height) {
+            ++cache->hits;
+            entry->last_use = ++cache->clock;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************
+ * buffer_cache_reserve:
+ * - Returns an entry of this size nobody uses, to be drawn into: the
+ *   most recently used free one, else a new one. Its key still names the
+ *   old content (BUFFER_CACHE_EMPTY when new) until the caller sets it.
+ * - NULL when every entry is shown or held by the compositor.
+ *******************************************/
+static struct buffer_cache_entry *
+buffer_cache_reserve(struct buffer_cache *cache, int32_t width, int32_t height)
+{
+    struct buffer_cache_entry *best = NULL;
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        struct buffer_cache_entry *entry = &cache->entries[i];
+        if (buffer_cache_free(entry) && entry->width == width && entry->height == height &&
+            (!best || entry->last_use > best->last_use)) {
+            best = entry;
+        }
+    }
+    if (!best) {
+        best = buffer_cache_add(cache, width, height);
+    }
+    if (best) {
+        best->last_use = ++cache->clock;
+    }
+    return best;
+}
+
+static int
+buffer_cache_count(const struct buffer_cache *cache, int32_t width, int32_t height)
+{
+    int count = 0;
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        const struct buffer_cache_entry *entry = &cache->entries[i];
+        count += entry->buffer && entry->width == width && entry->height == height;
+    }
+    return count;
+}
+
+// `*current` is the surface's reference: the new entry takes it over.
+// `frame` is the number the client's commit probe carries.
+static void
+buffer_cache_attach(struct buffer_cache_entry **current, struct buffer_cache_entry *entry,
+                    struct wl_surface *surface, uint64_t frame)
+{
+    wl_surface_attach(surface, entry->buffer, 0, 0);
+    if (*current != entry) {
+        if (*current) {
+            --(*current)->surfaces;
+        }
+        ++entry->surfaces;
+        *current = entry;
+    }
+    entry->busy = true;
+    entry->frame = frame;
+    ++entry->cache->attaches;
+}
+
+// The surface is going away; the compositor still releases the buffer
+static void
+buffer_cache_detach(struct buffer_cache_entry **current)
+{
+    if (*current) {
+        --(*current)->surfaces;
+        *current = NULL;
+    }
+}
+
+// Frees the unused entries of one size, e.g. once no output has it any more
+static void
+buffer_cache_evict_size(struct buffer_cache *cache, int32_t width, int32_t height)
+{
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        struct buffer_cache_entry *entry = &cache->entries[i];
+        if (buffer_cache_free(entry) && entry->width == width && entry->height == height) {
+            buffer_cache_evict(entry);
+        }
+    }
+}
+
+static void
+buffer_cache_finish(struct buffer_cache *cache)
+{
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        if (cache->entries[i].buffer) {
+            buffer_cache_evict(&cache->entries[i]);
+        }
+    }
+}
+
+static void
+buffer_cache_report(const struct buffer_cache *cache, const char *label)
+{
+    int entries = 0;
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        entries += cache->entries[i].buffer != NULL;
+    }
+    fprintf(stderr, "[SHM] %s: %d buffers (%.1f MiB, peak %.1f MiB), %llu allocated, "
+            "%llu evicted, %llu of %llu attaches reused an already drawn buffer\n", label,
+            entries, cache->bytes / 1048576.0, cache->peak_bytes / 1048576.0,
+            (unsigned long long)cache->allocations, (unsigned long long)cache->evictions,
+            (unsigned long long)cache->hits, (unsigned long long)cache->attaches);
+}
+
+#endif
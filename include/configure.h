@@ -0,0 +1,201 @@
+#ifndef MYWAYLAND_CONFIGURE_H
+#define MYWAYLAND_CONFIGURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <wayland-client.h>
+#include "trace.h"
+#include "probes.h"
+
+/*******************************************
+ * @CONFIGURE STATE MACHINE
+ *******************************************
+ *
+ * Shared xdg_surface configure handling for the shm clients. Include it
+ * after the xdg-shell protocol header.
+ *
+ * - xdg_toplevel.configure only records the pending size and states;
+ *   nothing is applied until the xdg_surface.configure that ends the
+ *   sequence.
+ * - xdg_surface.configure is acked at once and its pending size applied.
+ *   Only the redraw is paced: if no frame callback is outstanding the
+ *   frame is produced at once, otherwise it waits for the callback. A
+ *   hidden or occluded window never gets its callback, and compositors
+ *   that wait for the ack (to finish a resize or a tiling layout) must
+ *   not stall on it.
+ * - A configure that arrives while an earlier one is still waiting for
+ *   its frame replaces it and is counted as coalesced: only the latest
+ *   size is ever drawn.
+ * - Producing a frame means: request the next frame callback, let the
+ *   client draw and attach at the acked size, commit.
+ * - configure_request_redraw() is for content changes, paced the same way.
+ *
+ * During an interactive resize the compositor may send many configures
+ * per displayed frame; this turns them into one redraw per frame, always
+ * at the final size.
+ *******************************************/
+
+// Draws at `width` x `height` and attaches/damages the result; no commit
+typedef void (*configure_draw_fn)(void *data, int32_t width, int32_t height);
+
+struct configure_state {
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    configure_draw_fn draw;
+    void *data;
+
+    // Sent by the compositor, not yet applied
+    int32_t pending_width, pending_height;
+    uint32_t pending_states;        // Bit (1 << xdg_toplevel_state)
+    uint32_t serial;                // Last acked
+    bool serial_pending;            // Acked, not yet drawn at its size
+    bool redraw_pending;
+
+    // Applied with the last ack
+    int32_t width, height;
+    uint32_t states;
+    bool configured;
+
+    int32_t default_width, default_height;
+    bool frame_pending;             // Frame callback outstanding
+
+    // Counters for configure_report()
+    uint64_t toplevel_configures;
+    uint64_t surface_configures;
+    uint64_t acked;
+    uint64_t coalesced;
+    uint64_t redraws;
+};
+
+static void configure_flush(struct configure_state *state);
+
+static void
+configure_init(struct configure_state *state, struct wl_surface *surface,
+               struct xdg_surface *xdg_surface, int32_t default_width,
+               int32_t default_height, configure_draw_fn draw, void *data)
+{
+    *state = (struct configure_state){
+        .surface = surface,
+        .xdg_surface = xdg_surface,
+        .draw = draw,
+        .data = data,
+        .default_width = default_width,
+        .default_height = default_height,
+    };
+}
+
+// Call from xdg_toplevel.configure
+static void
+configure_toplevel(struct configure_state *state, int32_t width, int32_t height,
+                   struct wl_array *states)
+{
+    ++state->toplevel_configures;
+    state->pending_width = width;
+    state->pending_height = height;
+    state->pending_states = 0;
+    uint32_t *entry;
+    wl_array_for_each(entry, states) {
+        if (*entry < 32) {
+            state->pending_states |= 1u << *entry;
+        }
+    }
+}
+
+// Call from xdg_surface.configure
+static void
+configure_surface(struct configure_state *state, uint32_t serial)
+{
+    ++state->surface_configures;
+    PROBE1(configure_received, serial);
+    if (state->serial_pending) {
+        ++state->coalesced;
+        PROBE1(configure_coalesced, state->serial);
+        TRACE_INSTANT("configure", "coalesced");
+    }
+    state->serial = serial;
+    state->serial_pending = true;
+    state->redraw_pending = true;
+
+    TRACE_BEGIN("configure", "ack");
+    xdg_surface_ack_configure(state->xdg_surface, serial);
+    PROBE1(configure_acked, serial);
+    TRACE_END("configure", "ack");
+    ++state->acked;
+    state->configured = true;
+
+    // 0 leaves the size to us: keep the current one, or the default
+    state->width = state->pending_width > 0 ? state->pending_width
+                 : (state->width > 0 ? state->width : state->default_width);
+    state->height = state->pending_height > 0 ? state->pending_height
+                  : (state->height > 0 ? state->height : state->default_height);
+    state->states = state->pending_states;
+
+    if (!state->frame_pending) {
+        configure_flush(state);
+    }
+}
+
+static void
+configure_frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+    struct configure_state *state = data;
+    wl_callback_destroy(callback);
+    state->frame_pending = false;
+    if (state->redraw_pending) {
+        configure_flush(state);
+    }
+}
+
+static const struct wl_callback_listener configure_frame_listener = {
+    .done = configure_frame_done,
+};
+
+static void
+configure_flush(struct configure_state *state)
+{
+    if (!state->configured) {
+        return;     // Nothing may be attached before the first ack
+    }
+    state->serial_pending = false;
+    state->redraw_pending = false;
+
+    struct wl_callback *callback = wl_surface_frame(state->surface);
+    wl_callback_add_listener(callback, &configure_frame_listener, state);
+    state->frame_pending = true;
+
+    ++state->redraws;
+    state->draw(state->data, state->width, state->height);
+    wl_surface_commit(state->surface);
+}
+
+// Content changed: redraw on the next frame callback (or now, if idle)
+static void
+configure_request_redraw(struct configure_state *state)
+{
+    state->redraw_pending = true;
+    if (!state->frame_pending && state->configured) {
+        configure_flush(state);
+    }
+}
+
+static bool
+configure_has_state(const struct configure_state *state, enum xdg_toplevel_state which)
+{
+    return state->states & (1u << which);
+}
+
+static void
+configure_report(const struct configure_state *state, const char *label)
+{
+    fprintf(stderr, "[CONFIGURE] %s: %llu toplevel / %llu surface configures, "
+            "%llu acked, %llu coalesced, %llu redraws, final size %dx%d\n", label,
+            (unsigned long long)state->toplevel_configures,
+            (unsigned long long)state->surface_configures,
+            (unsigned long long)state->acked,
+            (unsigned long long)state->coalesced,
+            (unsigned long long)state->redraws,
+            state->width, state->height);
+}
+
+#endif
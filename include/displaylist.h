@@ -0,0 +1,561 @@
+#ifndef MYWAYLAND_DISPLAYLIST_H
+#define MYWAYLAND_DISPLAYLIST_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fill.h"
+#include "font.h"
+#include "trace.h"
+
+/*******************************************
+ * @DISPLAY LISTS AND TILED PLAYBACK
+ *******************************************
+ *
+ * Software drawing in two steps: a frame is first recorded as a list of
+ * operations (dl_fill, dl_checker, dl_text), then played back into the
+ * buffer. A recorded frame can be compared with the previous one and
+ * split across threads, which immediate drawing into the mapping can't.
+ *
+ * - dl_bin() sorts the operations into DL_TILE_SIZE square tiles: every
+ *   tile gets the indices of the operations overlapping it, in recording
+ *   order, and a hash of those operations. Same hash, same pixels.
+ * - A buffer keeps the hashes of what it holds (dl_target). Playing a
+ *   frame into it only redraws the tiles whose hash differs; with two or
+ *   three buffers in rotation that is the change since the buffer was
+ *   last used, not since the last frame.
+ * - The dirty tiles are shared out between a pool of worker threads and
+ *   the calling thread, a tile at a time. Tiles don't overlap, so no
+ *   locking is needed while drawing; every tile clips its operations to
+ *   itself.
+ * - dl_damage() gives the tiles that changed since the previous frame,
+ *   merged into row runs, for wl_surface.damage_buffer.
+ *
+ * Text is copied into the list, so callers may record from temporary
+ * strings.
+ *******************************************/
+#define DL_TILE_SIZE    64
+#define DL_MAX_THREADS  16
+
+enum dl_kind {
+    DL_FILL = 1,
+    DL_CHECKER,                      // Two colours in `cell` sized squares, rows offset by a cell
+    DL_TEXT,                         // include/font.h at an integer `scale`
+};
+
+struct dl_op {
+    uint32_t kind;
+    int32_t x, y, width, height;     // Bounds; text is measured when recorded
+    uint32_t color, color2;
+    int32_t param;                   // Checker cell or text scale
+    uint32_t text, text_length;      // Offset into `strings`
+};
+
+struct display_list {
+    struct dl_op *ops;
+    int count, capacity;
+    char *strings;
+    size_t strings_length, strings_capacity;
+    bool failed;                     // An allocation failed; the frame is incomplete
+};
+
+// Where a frame's operations land, rebuilt by every dl_bin()
+struct dl_tiles {
+    int width, height;               // Surface size in pixels
+    int columns, rows;
+    uint32_t *start;                 // columns * rows + 1 offsets into `bins`
+    uint32_t *bins;                  // Operation indices, tile after tile
+    size_t bins_capacity;
+    uint64_t *hash;                  // Per tile
+    uint64_t *previous;              // The frame before, for dl_damage()
+    uint64_t *op_hash;               // Per operation, scratch
+    int op_capacity;
+};
+
+// One buffer's pixels and the tile hashes they were drawn with
+struct dl_target {
+    uint32_t *pixels;
+    int stride;
+    uint64_t *hash;                  // 0 = unknown contents
+};
+
+static void
+dl_reset(struct display_list *list)
+{
+    list->count = 0;
+    list->strings_length = 0;
+    list->failed = false;
+}
+
+static void
+dl_free(struct display_list *list)
+{
+    free(list->ops);
+    free(list->strings);
+    *list = (struct display_list){0};
+}
+
+static struct dl_op *
+dl_push(struct display_list *list)
+{
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        struct dl_op *ops = realloc(list->ops, capacity * sizeof(*ops));
+        if (!ops) {
+            list->failed = true;
+            return NULL;
+        }
+        list->ops = ops;
+        list->capacity = capacity;
+    }
+    struct dl_op *op = &list->ops[list->count++];
+    memset(op, 0, sizeof(*op));
+    return op;
+}
+
+static void
+dl_fill(struct display_list *list, int32_t x, int32_t y, int32_t width, int32_t height,
+        uint32_t color)
+{
+    struct dl_op *op = dl_push(list);
+    if (op) {
+        *op = (struct dl_op){ DL_FILL, x, y, width, height, color };
+    }
+}
+
+static void
+dl_checker(struct display_list *list, int32_t x, int32_t y, int32_t width, int32_t height,
+           int32_t cell, uint32_t color, uint32_t color2)
+{
+    struct dl_op *op = dl_push(list);
+    if (op) {
+        *op = (struct dl_op){ DL_CHECKER, x, y, width, height, color, color2, cell };
+    }
+}
+
+static void
+dl_text(struct display_list *list, int32_t x, int32_t y, int32_t scale, uint32_t color,
+        const char *text)
+{
+    size_t length = strlen(text);
+    if (list->strings_length + length > list->strings_capacity) {
+        size_t capacity = list->strings_capacity ? list->strings_capacity : 256;
+        while (capacity < list->strings_length + length) {
+            capacity *= 2;
+        }
+        char *strings = realloc(list->strings, capacity);
+        if (!strings) {
+            list->failed = true;
+            return;
+        }
+        list->strings = strings;
+        list->strings_capacity = capacity;
+    }
+    struct dl_op *op = dl_push(list);
+    if (!op) {
+        return;
+    }
+    *op = (struct dl_op){
+        DL_TEXT, x, y, font_text_width(text, scale), FONT_GLYPH_HEIGHT * scale, color, 0, scale,
+        (uint32_t)list->strings_length, (uint32_t)length,
+    };
+    memcpy(list->strings + list->strings_length, text, length);
+    list->strings_length += length;
+}
+
+/* Binning */
+
+static inline uint64_t
+dl_hash_bytes(uint64_t hash, const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;     // FNV-1a
+    }
+    return hash;
+}
+
+static void
+dl_tiles_free(struct dl_tiles *tiles)
+{
+    free(tiles->start);
+    free(tiles->bins);
+    free(tiles->hash);
+    free(tiles->previous);
+    free(tiles->op_hash);
+    *tiles = (struct dl_tiles){0};
+}
+
+// Tile range an operation covers, false if it is outside the surface
+static inline bool
+dl_op_tiles(const struct dl_tiles *tiles, const struct dl_op *op,
+            int *c0, int *r0, int *c1, int *r1)
+{
+    int x0 = op->x > 0 ? op->x : 0, y0 = op->y > 0 ? op->y : 0;
+    int x1 = op->x + op->width < tiles->width ? op->x + op->width : tiles->width;
+    int y1 = op->y + op->height < tiles->height ? op->y + op->height : tiles->height;
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+    *c0 = x0 / DL_TILE_SIZE;
+    *r0 = y0 / DL_TILE_SIZE;
+    *c1 = (x1 - 1) / DL_TILE_SIZE;
+    *r1 = (y1 - 1) / DL_TILE_SIZE;
+    return true;
+}
+
+/*******************************************
+ * dl_bin:
+ * - Bins `list` for a `width` x `height` surface and hashes every tile.
+ *   A size change forgets the previous frame, so everything is damaged.
+ * - Returns false when out of memory.
+ *******************************************/
+static bool
+dl_bin(struct dl_tiles *tiles, const struct display_list *list, int width, int height)
+{
+    if (width != tiles->width || height != tiles->height) {
+        dl_tiles_free(tiles);
+        tiles->width = width;
+        tiles->height = height;
+        tiles->columns = (width + DL_TILE_SIZE - 1) / DL_TILE_SIZE;
+        tiles->rows = (height + DL_TILE_SIZE - 1) / DL_TILE_SIZE;
+        size_t count = (size_t)tiles->columns * tiles->rows;
+        tiles->start = calloc(count + 1, sizeof(*tiles->start));
+        tiles->hash = calloc(count, sizeof(*tiles->hash));
+        tiles->previous = calloc(count, sizeof(*tiles->previous));
+        if (!tiles->start || !tiles->hash || !tiles->previous) {
+            dl_tiles_free(tiles);
+            return false;
+        }
+    } else {
+        memcpy(tiles->previous, tiles->hash,
+               (size_t)tiles->columns * tiles->rows * sizeof(*tiles->hash));
+    }
+    if (list->count > tiles->op_capacity) {
+        uint64_t *op_hash = realloc(tiles->op_hash, list->count * sizeof(*op_hash));
+        if (!op_hash) {
+            return false;
+        }
+        tiles->op_hash = op_hash;
+        tiles->op_capacity = list->count;
+    }
+
+    // Count per tile, then turn the counts into offsets
+    int tile_count = tiles->columns * tiles->rows;
+    memset(tiles->start, 0, (tile_count + 1) * sizeof(*tiles->start));
+    for (int i = 0; i < list->count; ++i) {
+        const struct dl_op *op = &list->ops[i];
+        uint64_t hash = dl_hash_bytes(0xcbf29ce484222325ull, op, offsetof(struct dl_op, text));
+        if (op->kind == DL_TEXT) {
+            hash = dl_hash_bytes(hash, list->strings + op->text, op->text_length);
+        }
+        tiles->op_hash[i] = hash;
+
+        int c0, r0, c1, r1;
+        if (!dl_op_tiles(tiles, op, &c0, &r0, &c1, &r1)) {
+            continue;
+        }
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                ++tiles->start[r * tiles->columns + c + 1];
+            }
+        }
+    }
+    for (int t = 0; t < tile_count; ++t) {
+        tiles->start[t + 1] += tiles->start[t];
+    }
+    size_t total = tiles->start[tile_count];
+    if (total > tiles->bins_capacity) {
+        uint32_t *bins = realloc(tiles->bins, total * sizeof(*bins));
+        if (!bins) {
+            return false;
+        }
+        tiles->bins = bins;
+        tiles->bins_capacity = total;
+    }
+
+    // Fill in recording order, advancing start[t] and shifting it back after
+    for (int i = 0; i < list->count; ++i) {
+        int c0, r0, c1, r1;
+        if (!dl_op_tiles(tiles, &list->ops[i], &c0, &r0, &c1, &r1)) {
+            continue;
+        }
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                tiles->bins[tiles->start[r * tiles->columns + c]++] = i;
+            }
+        }
+    }
+    for (int t = tile_count; t > 0; --t) {
+        tiles->start[t] = tiles->start[t - 1];
+    }
+    tiles->start[0] = 0;
+
+    for (int t = 0; t < tile_count; ++t) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (uint32_t b = tiles->start[t]; b < tiles->start[t + 1]; ++b) {
+            hash = dl_hash_bytes(hash, &tiles->op_hash[tiles->bins[b]], sizeof(uint64_t));
+        }
+        tiles->hash[t] = hash | 1;       // Never 0, which marks unknown contents
+    }
+    return true;
+}
+
+/*******************************************
+ * dl_damage:
+ * - Calls `fn` for every run of horizontally adjacent tiles that changed
+ *   since the previous dl_bin(), clipped to the surface. Returns the
+ *   number of changed tiles.
+ *******************************************/
+static int
+dl_damage(const struct dl_tiles *tiles,
+          void (*fn)(void *data, int32_t x, int32_t y, int32_t width, int32_t height),
+          void *data)
+{
+    int changed = 0;
+    for (int r = 0; r < tiles->rows; ++r) {
+        for (int c = 0; c < tiles->columns;) {
+            int t = r * tiles->columns + c;
+            if (tiles->hash[t] == tiles->previous[t]) {
+                ++c;
+                continue;
+            }
+            int end = c;
+            while (end < tiles->columns
+                   && tiles->hash[r * tiles->columns + end] != tiles->previous[r * tiles->columns + end]) {
+                ++end;
+            }
+            changed += end - c;
+            int x = c * DL_TILE_SIZE, y = r * DL_TILE_SIZE;
+            int x1 = end * DL_TILE_SIZE < tiles->width ? end * DL_TILE_SIZE : tiles->width;
+            int y1 = y + DL_TILE_SIZE < tiles->height ? y + DL_TILE_SIZE : tiles->height;
+            fn(data, x, y, x1 - x, y1 - y);
+            c = end;
+        }
+    }
+    return changed;
+}
+
+/* Playback */
+
+static void
+dl_play_checker(fill_row_fn row_fn, const struct dl_op *op, uint32_t *pixels, int stride,
+                int x0, int y0, int x1, int y1)
+{
+    int cell = op->param > 0 ? op->param : 1;
+    for (int y = y0; y < y1; ++y) {
+        uint32_t *row = (uint32_t *)((uint8_t *)pixels + (size_t)y * stride);
+        // Same pattern as (x + y / cell * cell) % (2 * cell) < cell, a run at a time
+        int shift = (y - op->y) / cell * cell;
+        for (int x = x0; x < x1;) {
+            int phase = (x - op->x + shift) % (2 * cell);
+            int run = cell - phase % cell;
+            run = x + run < x1 ? run : x1 - x;
+            row_fn(row + x, phase < cell ? op->color : op->color2, run);
+            x += run;
+        }
+    }
+}
+
+// Draws tile `t` of `tiles` from `list` into `pixels`
+static void
+dl_play_tile(const struct display_list *list, const struct dl_tiles *tiles, int t,
+             fill_row_fn row_fn, uint32_t *pixels, int stride)
+{
+    int tx = t % tiles->columns * DL_TILE_SIZE, ty = t / tiles->columns * DL_TILE_SIZE;
+    int tx1 = tx + DL_TILE_SIZE < tiles->width ? tx + DL_TILE_SIZE : tiles->width;
+    int ty1 = ty + DL_TILE_SIZE < tiles->height ? ty + DL_TILE_SIZE : tiles->height;
+
+    for (uint32_t b = tiles->start[t]; b < tiles->start[t + 1]; ++b) {
+        const struct dl_op *op = &list->ops[tiles->bins[b]];
+        int x0 = op->x > tx ? op->x : tx, y0 = op->y > ty ? op->y : ty;
+        int x1 = op->x + op->width < tx1 ? op->x + op->width : tx1;
+        int y1 = op->y + op->height < ty1 ? op->y + op->height : ty1;
+        switch (op->kind) {
+        case DL_FILL:
+            fill_rect(row_fn, pixels, stride, x0, y0, x1 - x0, y1 - y0, op->color);
+            break;
+        case DL_CHECKER:
+            dl_play_checker(row_fn, op, pixels, stride, x0, y0, x1, y1);
+            break;
+        case DL_TEXT: {
+            char text[256];
+            uint32_t length = op->text_length < sizeof(text) - 1 ? op->text_length : sizeof(text) - 1;
+            memcpy(text, list->strings + op->text, length);
+            text[length] = '\0';
+            const int32_t clip[4] = { x0, y0, x1 - x0, y1 - y0 };
+            font_draw_text(pixels, tiles->width, tiles->height, stride, clip,
+                           op->x, op->y, op->param, op->color, text);
+            break;
+        }
+        }
+    }
+}
+
+/*******************************************
+ * dl_player:
+ * - The worker pool. dl_play() draws every tile whose hash differs from
+ *   `target`'s, updates `target`'s hashes and returns the number drawn.
+ * - Workers take tiles from a shared counter, so a few expensive tiles
+ *   don't leave the other threads idle.
+ *******************************************/
+struct dl_player;
+
+struct dl_worker {
+    pthread_t thread;
+    struct dl_player *player;
+};
+
+struct dl_player {
+    pthread_mutex_t mutex;
+    pthread_cond_t start, done;
+    uint64_t generation;
+    int pending;                     // Workers still busy with this generation
+    bool quit;
+    int threads;                     // Workers + the calling thread
+    fill_row_fn row_fn;
+    struct dl_worker workers[DL_MAX_THREADS];
+
+    // The frame being played
+    const struct display_list *list;
+    const struct dl_tiles *tiles;
+    struct dl_target *target;
+    uint32_t *dirty;
+    int dirty_count, dirty_capacity;
+    int next;                        // Next index into `dirty`, shared
+};
+
+static void
+dl_play_share(struct dl_player *player)
+{
+    for (;;) {
+        int i = __atomic_fetch_add(&player->next, 1, __ATOMIC_RELAXED);
+        if (i >= player->dirty_count) {
+            break;
+        }
+        dl_play_tile(player->list, player->tiles, player->dirty[i], player->row_fn,
+                     player->target->pixels, player->target->stride);
+    }
+}
+
+static void *
+dl_worker_main(void *data)
+{
+    struct dl_worker *worker = data;
+    struct dl_player *player = worker->player;
+    uint64_t seen = 0;
+
+    trace_set_thread_name("tiles");
+    pthread_mutex_lock(&player->mutex);
+    while (true) {
+        while (!player->quit && player->generation == seen) {
+            pthread_cond_wait(&player->start, &player->mutex);
+        }
+        if (player->quit) {
+            break;
+        }
+        seen = player->generation;
+        pthread_mutex_unlock(&player->mutex);
+
+        TRACE_BEGIN("render", "play tiles");
+        dl_play_share(player);
+        TRACE_END("render", "play tiles");
+
+        pthread_mutex_lock(&player->mutex);
+        if (--player->pending == 0) {
+            pthread_cond_signal(&player->done);
+        }
+    }
+    pthread_mutex_unlock(&player->mutex);
+    return NULL;
+}
+
+static void
+dl_player_start(struct dl_player *player, int threads, fill_row_fn row_fn)
+{
+    *player = (struct dl_player){ .row_fn = row_fn };
+    pthread_mutex_init(&player->mutex, NULL);
+    pthread_cond_init(&player->start, NULL);
+    pthread_cond_init(&player->done, NULL);
+    threads = threads < 1 ? 1 : threads > DL_MAX_THREADS ? DL_MAX_THREADS : threads;
+    player->threads = threads;
+    for (int i = 0; i < threads - 1; ++i) {
+        player->workers[i].player = player;
+        if (trace_thread_create(&player->workers[i].thread, dl_worker_main, &player->workers[i]) != 0) {
+            player->threads = i + 1;
+            break;
+        }
+    }
+}
+
+static void
+dl_player_stop(struct dl_player *player)
+{
+    pthread_mutex_lock(&player->mutex);
+    player->quit = true;
+    pthread_cond_broadcast(&player->start);
+    pthread_mutex_unlock(&player->mutex);
+    for (int i = 0; i < player->threads - 1; ++i) {
+        pthread_join(player->workers[i].thread, NULL);
+    }
+    free(player->dirty);
+    player->dirty = NULL;
+}
+
+// Returns the number of tiles drawn, or -1 when out of memory
+static int
+dl_play(struct dl_player *player, const struct display_list *list,
+        const struct dl_tiles *tiles, struct dl_target *target)
+{
+    int tile_count = tiles->columns * tiles->rows;
+    if (tile_count > player->dirty_capacity) {
+        uint32_t *dirty = realloc(player->dirty, tile_count * sizeof(*dirty));
+        if (!dirty) {
+            return -1;
+        }
+        player->dirty = dirty;
+        player->dirty_capacity = tile_count;
+    }
+    player->dirty_count = 0;
+    for (int t = 0; t < tile_count; ++t) {
+        if (target->hash[t] != tiles->hash[t]) {
+            player->dirty[player->dirty_count++] = t;
+        }
+    }
+    if (player->dirty_count == 0) {
+        return 0;
+    }
+
+    player->list = list;
+    player->tiles = tiles;
+    player->target = target;
+    player->next = 0;
+    // Not worth waking anyone for a tile or two
+    int helpers = player->dirty_count > 2 ? player->threads - 1 : 0;
+    if (helpers > 0) {
+        pthread_mutex_lock(&player->mutex);
+        player->pending = player->threads - 1;
+        ++player->generation;
+        pthread_cond_broadcast(&player->start);
+        pthread_mutex_unlock(&player->mutex);
+    }
+
+    dl_play_share(player);
+
+    if (helpers > 0) {
+        pthread_mutex_lock(&player->mutex);
+        while (player->pending > 0) {
+            pthread_cond_wait(&player->done, &player->mutex);
+        }
+        pthread_mutex_unlock(&player->mutex);
+    }
+    for (int i = 0; i < player->dirty_count; ++i) {
+        target->hash[player->dirty[i]] = tiles->hash[player->dirty[i]];
+    }
+    return player->dirty_count;
+}
+
+#endif
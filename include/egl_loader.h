@@ -0,0 +1,241 @@
+#ifndef MYWAYLAND_EGL_LOADER_H
+#define MYWAYLAND_EGL_LOADER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <dlfcn.h>
+#include <wayland-egl.h>
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+/*******************************************
+ * @LAZY EGL / GLES LOADING
+ *******************************************
+ *
+ * Linking -lEGL -lGLESv2 makes the dynamic loader map libEGL, libGLESv2,
+ * the Mesa/vendor driver and everything they depend on before main() even
+ * runs. That costs tens of milliseconds and several megabytes of RSS, and is
+ * pure waste for a run that ends up drawing with wl_shm.
+ *
+ * Instead, the GL clients are linked with only -ldl and call
+ * egl_loader_load() at the point where they actually pick the GL backend:
+ *
+ * - libEGL.so.1, libGLESv2.so.2 and libwayland-egl.so.1 are dlopen'ed.
+ * - Every entry point the programs use is resolved with dlsym, falling
+ *   back to eglGetProcAddress for GLES functions the library does not
+ *   export directly.
+ * - The macros at the bottom redirect the usual eglFoo/glFoo/wl_egl_* names
+ *   to the resolved pointers, so the rendering code reads exactly like it
+ *   would when linked normally.
+ *
+ * This header must be included after the EGL/GLES headers it wraps.
+ * Build with -DMYWAYLAND_EAGER_GL (EAGER_GL=1 ./build.sh) to link the
+ * libraries directly instead; egl_loader_load() then does nothing. That
+ * build exists to compare startup cost, see scripts/startup_compare.sh.
+ *******************************************/
+
+#ifdef MYWAYLAND_EAGER_GL
+
+static bool
+egl_loader_load(void)
+{
+    return true;
+}
+
+#else
+
+#define EGL_LOADER_EGL_FUNCS(X) \
+    X(eglGetProcAddress) \
+    X(eglGetError) \
+    X(eglGetDisplay) \
+    X(eglInitialize) \
+    X(eglTerminate) \
+    X(eglQueryString) \
+    X(eglChooseConfig) \
+    X(eglCreateContext) \
+    X(eglDestroyContext) \
+    X(eglCreateWindowSurface) \
+    X(eglDestroySurface) \
+    X(eglMakeCurrent) \
+    X(eglSwapBuffers)
+
+#define EGL_LOADER_GLES_FUNCS(X) \
+    X(glGetError) \
+    X(glGetString) \
+    X(glViewport) \
+    X(glClearColor) \
+    X(glClear) \
+    X(glCreateShader) \
+    X(glShaderSource) \
+    X(glCompileShader) \
+    X(glGetShaderiv) \
+    X(glCreateProgram) \
+    X(glAttachShader) \
+    X(glLinkProgram) \
+    X(glUseProgram) \
+    X(glGetAttribLocation) \
+    X(glVertexAttribPointer) \
+    X(glEnableVertexAttribArray) \
+    X(glDrawArrays) \
+    X(glFinish) \
+    X(glGetUniformLocation) \
+    X(glUniform1i) \
+    X(glActiveTexture) \
+    X(glGenTextures) \
+    X(glDeleteTextures) \
+    X(glBindTexture) \
+    X(glTexParameteri) \
+    X(glTexImage2D) \
+    X(glCompressedTexImage2D) \
+    X(glEnable) \
+    X(glDisable) \
+    X(glBlendFunc) \
+    X(glPixelStorei) \
+    X(glUniform1f) \
+    X(glUniform2f) \
+    X(glUniform4f) \
+    X(glUniformMatrix2fv) \
+    X(glDisableVertexAttribArray)
+
+#define EGL_LOADER_WAYLAND_EGL_FUNCS(X) \
+    X(wl_egl_window_create) \
+    X(wl_egl_window_destroy) \
+    X(wl_egl_window_resize)
+
+#define EGL_LOADER_DECLARE(name) __typeof__(name) *name;
+
+static struct {
+    bool attempted;
+    bool loaded;
+    void *libegl;
+    void *libgles;
+    void *libwayland_egl;
+    EGL_LOADER_EGL_FUNCS(EGL_LOADER_DECLARE)
+    EGL_LOADER_GLES_FUNCS(EGL_LOADER_DECLARE)
+    EGL_LOADER_WAYLAND_EGL_FUNCS(EGL_LOADER_DECLARE)
+} egl_api;
+
+#undef EGL_LOADER_DECLARE
+
+static void *
+egl_loader_open(const char *soname, const char *fallback)
+{
+    void *handle = dlopen(soname, RTLD_NOW | RTLD_LOCAL);
+    if (!handle && fallback) {
+        handle = dlopen(fallback, RTLD_NOW | RTLD_LOCAL);
+    }
+    if (!handle) {
+        fprintf(stderr, "[EGL] dlopen %s failed: %s\n", soname, dlerror());
+    }
+    return handle;
+}
+
+/*******************************************
+ * egl_loader_load:
+ * - Loads the libraries and resolves all entry points on first use.
+ * - Returns false when anything is missing, in which case the caller must
+ *   not touch any EGL/GLES function and should fall back to wl_shm.
+ * - Cheap to call again; the result of the first attempt is cached.
+ *******************************************/
+static bool
+egl_loader_load(void)
+{
+    if (egl_api.attempted) {
+        return egl_api.loaded;
+    }
+    egl_api.attempted = true;
+
+    egl_api.libegl = egl_loader_open("libEGL.so.1", "libEGL.so");
+    egl_api.libgles = egl_loader_open("libGLESv2.so.2", "libGLESv2.so");
+    egl_api.libwayland_egl = egl_loader_open("libwayland-egl.so.1", "libwayland-egl.so");
+    if (!egl_api.libegl || !egl_api.libgles || !egl_api.libwayland_egl) {
+        return false;
+    }
+
+    bool ok = true;
+#define EGL_LOADER_RESOLVE(lib, name) \
+    if (!(*(void **)&egl_api.name = dlsym(lib, #name))) { \
+        fprintf(stderr, "[EGL] Missing symbol %s\n", #name); \
+        ok = false; \
+    }
+#define EGL_LOADER_RESOLVE_EGL(name) EGL_LOADER_RESOLVE(egl_api.libegl, name)
+#define EGL_LOADER_RESOLVE_WAYLAND_EGL(name) EGL_LOADER_RESOLVE(egl_api.libwayland_egl, name)
+#define EGL_LOADER_RESOLVE_GLES(name) \
+    if (!(*(void **)&egl_api.name = dlsym(egl_api.libgles, #name)) && egl_api.eglGetProcAddress) { \
+        *(void **)&egl_api.name = (void *)egl_api.eglGetProcAddress(#name); \
+    } \
+    if (!egl_api.name) { \
+        fprintf(stderr, "[EGL] Missing symbol %s\n", #name); \
+        ok = false; \
+    }
+
+    EGL_LOADER_EGL_FUNCS(EGL_LOADER_RESOLVE_EGL)
+    EGL_LOADER_WAYLAND_EGL_FUNCS(EGL_LOADER_RESOLVE_WAYLAND_EGL)
+    EGL_LOADER_GLES_FUNCS(EGL_LOADER_RESOLVE_GLES)
+
+#undef EGL_LOADER_RESOLVE_GLES
+#undef EGL_LOADER_RESOLVE_WAYLAND_EGL
+#undef EGL_LOADER_RESOLVE_EGL
+#undef EGL_LOADER_RESOLVE
+
+    egl_api.loaded = ok;
+    return ok;
+}
+
+// Route the regular names through the table from here on
+#define eglGetProcAddress          egl_api.eglGetProcAddress
+#define eglGetError                egl_api.eglGetError
+#define eglGetDisplay              egl_api.eglGetDisplay
+#define eglInitialize              egl_api.eglInitialize
+#define eglTerminate               egl_api.eglTerminate
+#define eglQueryString             egl_api.eglQueryString
+#define eglChooseConfig            egl_api.eglChooseConfig
+#define eglCreateContext           egl_api.eglCreateContext
+#define eglDestroyContext          egl_api.eglDestroyContext
+#define eglCreateWindowSurface     egl_api.eglCreateWindowSurface
+#define eglDestroySurface          egl_api.eglDestroySurface
+#define eglMakeCurrent             egl_api.eglMakeCurrent
+#define eglSwapBuffers             egl_api.eglSwapBuffers
+#define glGetError                 egl_api.glGetError
+#define glGetString                egl_api.glGetString
+#define glViewport                 egl_api.glViewport
+#define glClearColor               egl_api.glClearColor
+#define glClear                    egl_api.glClear
+#define glCreateShader             egl_api.glCreateShader
+#define glShaderSource             egl_api.glShaderSource
+#define glCompileShader            egl_api.glCompileShader
+#define glGetShaderiv              egl_api.glGetShaderiv
+#define glCreateProgram            egl_api.glCreateProgram
+#define glAttachShader             egl_api.glAttachShader
+#define glLinkProgram              egl_api.glLinkProgram
+#define glUseProgram               egl_api.glUseProgram
+#define glGetAttribLocation        egl_api.glGetAttribLocation
+#define glVertexAttribPointer      egl_api.glVertexAttribPointer
+#define glEnableVertexAttribArray  egl_api.glEnableVertexAttribArray
+#define glDrawArrays               egl_api.glDrawArrays
+#define glFinish                   egl_api.glFinish
+#define glGetUniformLocation       egl_api.glGetUniformLocation
+#define glUniform1i                egl_api.glUniform1i
+#define glActiveTexture            egl_api.glActiveTexture
+#define glGenTextures              egl_api.glGenTextures
+#define glDeleteTextures           egl_api.glDeleteTextures
+#define glBindTexture              egl_api.glBindTexture
+#define glTexParameteri            egl_api.glTexParameteri
+#define glTexImage2D               egl_api.glTexImage2D
+#define glCompressedTexImage2D     egl_api.glCompressedTexImage2D
+#define glEnable                   egl_api.glEnable
+#define glDisable                  egl_api.glDisable
+#define glBlendFunc                egl_api.glBlendFunc
+#define glPixelStorei              egl_api.glPixelStorei
+#define glUniform1f                egl_api.glUniform1f
+#define glUniform2f                egl_api.glUniform2f
+#define glUniform4f                egl_api.glUniform4f
+#define glUniformMatrix2fv         egl_api.glUniformMatrix2fv
+#define glDisableVertexAttribArray egl_api.glDisableVertexAttribArray
+#define wl_egl_window_create       egl_api.wl_egl_window_create
+#define wl_egl_window_destroy      egl_api.wl_egl_window_destroy
+#define wl_egl_window_resize       egl_api.wl_egl_window_resize
+
+#endif /* MYWAYLAND_EAGER_GL */
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef MYWAYLAND_ETC2_H
+#define MYWAYLAND_ETC2_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*******************************************
+ * @ETC2 RGB8 ENCODER AND ON-DISK CACHE
+ *******************************************
+ *
+ * A fullscreen RGBA8 background is 4 bytes per pixel (33 MB at 3840x2160)
+ * and is sampled at that rate on every frame. ETC2 RGB8 stores a 4x4 block
+ * in 8 bytes, i.e. half a byte per pixel (4 MB at 4K), and every GLES 3.0
+ * implementation is required to support it.
+ *
+ * Encoding:
+ * - ETC2 RGB8 is a superset of ETC1. We only emit the ETC1 "individual"
+ *   and "differential" modes, which every ETC2 decoder reads unchanged.
+ *   The ETC2-only T/H/planar modes would add quality on sharp gradients
+ *   but a blurred lock-screen background does not need them.
+ * - Each block is split into two halves (2x4 side by side, or 4x2 stacked
+ *   when the flip bit is set). Each half gets a base colour and one of
+ *   eight intensity tables; each pixel then picks one of four offsets.
+ * - We try both flips, both modes and all tables and keep the combination
+ *   with the lowest squared error. That is slow-ish (a few seconds at 4K),
+ *   which is why the result is cached on disk and encoding happens once.
+ *
+ * Cache:
+ * - Keyed by the source path, size and mtime, so a cache hit never reads
+ *   or decodes the source image at all.
+ * - Stored in $XDG_CACHE_HOME/mywayland (or ~/.cache/mywayland) as a
+ *   small header followed by the raw blocks, ready for
+ *   glCompressedTexImage2D.
+ *******************************************/
+
+#define ETC2_GL_COMPRESSED_RGB8 0x9274  // GL_COMPRESSED_RGB8_ETC2
+
+static const int etc_modifier_table[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+};
+
+static inline size_t
+etc2_rgb8_size(int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+static inline int
+etc_clamp255(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+/*******************************************
+ * Scores one half-block against a base colour:
+ * - Finds the best intensity table and fills in each pixel's 2-bit index.
+ * - `pixels` holds 8 RGB triples, `slots` their position (x * 4 + y) in the
+ *   block, which is the bit position the index is stored at.
+ *******************************************/
+static uint32_t
+etc_fit_half(const uint8_t pixels[8][3], const int base[3],
+             int *best_table, uint8_t indices[8])
+{
+    uint32_t best_error = UINT32_MAX;
+
+    for (int t = 0; t < 8; ++t) {
+        const int mods[4] = {
+            etc_modifier_table[t][0], etc_modifier_table[t][1],
+            -etc_modifier_table[t][0], -etc_modifier_table[t][1],
+        };
+        uint32_t error = 0;
+        uint8_t candidate[8];
+
+        for (int p = 0; p < 8 && error < best_error; ++p) {
+            uint32_t pixel_best = UINT32_MAX;
+            for (int m = 0; m < 4; ++m) {
+                int dr = etc_clamp255(base[0] + mods[m]) - pixels[p][0];
+                int dg = etc_clamp255(base[1] + mods[m]) - pixels[p][1];
+                int db = etc_clamp255(base[2] + mods[m]) - pixels[p][2];
+                uint32_t e = dr * dr + dg * dg + db * db;
+                if (e < pixel_best) {
+                    pixel_best = e;
+                    candidate[p] = m;
+                }
+            }
+            error += pixel_best;
+        }
+
+        if (error < best_error) {
+            best_error = error;
+            *best_table = t;
+            memcpy(indices, candidate, 8);
+        }
+    }
+    return best_error;
+}
+
+/*******************************************
+ * Encodes one 4x4 block:
+ * - `block` is 16 RGB triples in row-major order (y * 4 + x).
+ * - Writes 8 bytes, most significant byte first as the format requires.
+ *******************************************/
+static void
+etc2_encode_block(const uint8_t block[16][3], uint8_t out[8])
+{
+    uint32_t best_error = UINT32_MAX;
+    uint64_t best_bits = 0;
+
+    for (int flip = 0; flip < 2; ++flip) {
+        uint8_t half[2][8][3];
+        int slot[2][8];
+        int sum[2][3] = {{0}};
+
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                int h = flip ? (y >= 2) : (x >= 2);
+                int i = flip ? ((y & 1) * 4 + x) : ((x & 1) * 4 + y);
+                memcpy(half[h][i], block[y * 4 + x], 3);
+                slot[h][i] = x * 4 + y;
+                for (int c = 0; c < 3; ++c) {
+                    sum[h][c] += block[y * 4 + x][c];
+                }
+            }
+        }
+
+        for (int differential = 0; differential < 2; ++differential) {
+            int quant[2][3], base[2][3];
+
+            for (int h = 0; h < 2; ++h) {
+                for (int c = 0; c < 3; ++c) {
+                    if (differential) {
+                        quant[h][c] = (sum[h][c] * 31 + 8 * 255 / 2) / (8 * 255);
+                        base[h][c] = quant[h][c] << 3 | quant[h][c] >> 2;
+                    } else {
+                        quant[h][c] = (sum[h][c] * 15 + 8 * 255 / 2) / (8 * 255);
+                        base[h][c] = quant[h][c] << 4 | quant[h][c];
+                    }
+                }
+            }
+
+            // Differential mode stores the second colour as a 3-bit signed delta
+            if (differential) {
+                bool representable = true;
+                for (int c = 0; c < 3; ++c) {
+                    int delta = quant[1][c] - quant[0][c];
+                    representable &= delta >= -4 && delta <= 3;
+                }
+                if (!representable) {
+                    continue;
+                }
+            }
+
+            int table[2];
+            uint8_t indices[2][8];
+            uint32_t error = etc_fit_half(half[0], base[0], &table[0], indices[0]);
+            if (error >= best_error) {
+                continue;
+            }
+            error += etc_fit_half(half[1], base[1], &table[1], indices[1]);
+            if (error >= best_error) {
+                continue;
+            }
+
+            uint64_t bits = 0;
+            for (int c = 0; c < 3; ++c) {
+                uint64_t byte;
+                if (differential) {
+                    byte = (uint64_t)quant[0][c] << 3 | ((quant[1][c] - quant[0][c]) & 7);
+                } else {
+                    byte = (uint64_t)quant[0][c] << 4 | quant[1][c];
+                }
+                bits |= byte << (56 - 8 * c);
+            }
+            bits |= (uint64_t)table[0] << 37 | (uint64_t)table[1] << 34;
+            bits |= (uint64_t)differential << 33 | (uint64_t)flip << 32;
+            for (int h = 0; h < 2; ++h) {
+                for (int i = 0; i < 8; ++i) {
+                    uint64_t index = indices[h][i];
+                    bits |= (index >> 1) << (16 + slot[h][i]);
+                    bits |= (index & 1) << slot[h][i];
+                }
+            }
+
+            best_error = error;
+            best_bits = bits;
+        }
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        out[i] = best_bits >> (56 - 8 * i);
+    }
+}
+
+/*******************************************
+ * etc2_encode_rgb8:
+ * - Compresses a tightly packed RGB8 image into `out`, which must hold
+ *   etc2_rgb8_size(width, height) bytes.
+ * - Partial blocks at the right/bottom edge repeat the last row/column.
+ *******************************************/
+static void
+etc2_encode_rgb8(const uint8_t *rgb, int width, int height, uint8_t *out)
+{
+    for (int by = 0; by < height; by += 4) {
+        for (int bx = 0; bx < width; bx += 4) {
+            uint8_t block[16][3];
+            for (int y = 0; y < 4; ++y) {
+                int sy = by + y < height ? by + y : height - 1;
+                for (int x = 0; x < 4; ++x) {
+                    int sx = bx + x < width ? bx + x : width - 1;
+                    memcpy(block[y * 4 + x], rgb + ((size_t)sy * width + sx) * 3, 3);
+                }
+            }
+            etc2_encode_block(block, out);
+            out += 8;
+        }
+    }
+}
+
+/*******************************************
+ * On-disk cache
+ *******************************************/
+struct etc2_cache_header {
+    char magic[8];            // "MWETC2\0\1"
+    uint32_t width, height;
+    uint64_t key;             // etc2_cache_key() of the source
+};
+
+static const char etc2_cache_magic[8] = { 'M', 'W', 'E', 'T', 'C', '2', 0, 1 };
+
+// FNV-1a over the source's path, size and mtime
+static uint64_t
+etc2_cache_key(const char *path, const struct stat *st)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const uint64_t fields[] = {
+        (uint64_t)st->st_size, (uint64_t)st->st_mtim.tv_sec, (uint64_t)st->st_mtim.tv_nsec,
+    };
+    for (const char *p = path; *p; ++p) {
+        hash = (hash ^ (uint8_t)*p) * 0x100000001b3ull;
+    }
+    for (size_t i = 0; i < sizeof(fields); ++i) {
+        hash = (hash ^ ((const uint8_t *)fields)[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Builds the cache file name for a key; creates the directory if needed
+static bool
+etc2_cache_path(uint64_t key, char *path, size_t size)
+{
+    char dir[PATH_MAX];
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+
+    if (xdg && *xdg) {
+        snprintf(dir, sizeof(dir), "%s", xdg);
+    } else if (home && *home) {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+    } else {
+        return false;
+    }
+    mkdir(dir, 0700);
+    strncat(dir, "/mywayland", sizeof(dir) - strlen(dir) - 1);
+    mkdir(dir, 0700);
+
+    snprintf(path, size, "%s/background-%016llx.etc2", dir, (unsigned long long)key);
+    return true;
+}
+
+/*******************************************
+ * etc2_cache_load:
+ * - Returns the compressed blocks for `key` (caller frees) and the image
+ *   size, or NULL on a miss or a corrupt/stale file.
+ *******************************************/
+static uint8_t *
+etc2_cache_load(uint64_t key, int *width, int *height)
+{
+    char path[PATH_MAX];
+    if (!etc2_cache_path(key, path, sizeof(path))) {
+        return NULL;
+    }
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    struct etc2_cache_header header;
+    uint8_t *blocks = NULL;
+    if (fread(&header, sizeof(header), 1, file) == 1 &&
+            memcmp(header.magic, etc2_cache_magic, sizeof(header.magic)) == 0 &&
+            header.key == key && header.width > 0 && header.height > 0 &&
+            header.width <= 16384 && header.height <= 16384) {
+        size_t size = etc2_rgb8_size(header.width, header.height);
+        blocks = malloc(size);
+        if (blocks && fread(blocks, 1, size, file) == size) {
+            *width = header.width;
+            *height = header.height;
+        } else {
+            free(blocks);
+            blocks = NULL;
+        }
+    }
+    fclose(file);
+    return blocks;
+}
+
+// Writes to a temporary name first so a crash never leaves a torn cache file
+static bool
+etc2_cache_store(uint64_t key, int width, int height, const uint8_t *blocks)
+{
+    char path[PATH_MAX], tmp[PATH_MAX + 16];
+    if (!etc2_cache_path(key, path, sizeof(path))) {
+        return false;
+    }
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+
+    FILE *file = fopen(tmp, "wb");
+    if (!file) {
+        return false;
+    }
+    struct etc2_cache_header header = { .width = width, .height = height, .key = key };
+    memcpy(header.magic, etc2_cache_magic, sizeof(header.magic));
+    size_t size = etc2_rgb8_size(width, height);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(blocks, 1, size, file) == size;
+    ok &= fclose(file) == 0;
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
+
+#endif
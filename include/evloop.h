@@ -0,0 +1,596 @@
+#ifndef MYWAYLAND_EVLOOP_H
+#define MYWAYLAND_EVLOOP_H
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+
+/*******************************************
+ * @EVENT LOOP BACKENDS
+ *******************************************
+ *
+ * The client's main loop: the Wayland socket, periodic timers and file
+ * reads/writes (assets in, recordings out), with two interchangeable
+ * backends picked at runtime, so their cost per frame can be compared.
+ *
+ * - EVLOOP_EPOLL is the usual loop: fds and timerfds in one epoll set,
+ *   one epoll_wait per iteration, then a read() per expired timerfd, and
+ *   pread()/pwrite() done synchronously when queued.
+ * - EVLOOP_URING puts the same work on an io_uring: the fds are
+ *   IORING_OP_POLL_ADD (one-shot, so level-triggered like epoll, re-armed
+ *   after every completion), timers are IORING_OP_TIMEOUT and file I/O is
+ *   IORING_OP_READ/WRITE. Everything queued during an iteration, re-arms
+ *   included, goes to the kernel in the single io_uring_enter that also
+ *   waits, so a quiet iteration costs one syscall and I/O never blocks the
+ *   loop. A re-arm that finds no free SQE is retried at the start of the
+ *   next iteration, after the completions have been reaped; a watch is
+ *   never silently dropped.
+ * - Raw syscalls against <linux/io_uring.h>, no liburing. If the ring
+ *   can't be set up (old kernel, io_uring disabled by sysctl or seccomp)
+ *   evloop_init() falls back to epoll and says so.
+ * - Both count their own syscalls, the wakeups (waits that returned with
+ *   work) and the operations submitted, for evloop_report(). Syscalls made
+ *   elsewhere, e.g. libwayland's sendmsg/recvmsg, are not included; they
+ *   are the same for both.
+ * - Buffers passed to evloop_read()/evloop_write() must stay valid until
+ *   their callback has run. Callbacks always run from evloop_run_once().
+ *******************************************/
+#define EVLOOP_MAX_WATCHES 8
+#define EVLOOP_MAX_TIMERS  8
+#define EVLOOP_MAX_IO      64        // File operations in flight
+#define EVLOOP_RING_SIZE   128
+
+enum evloop_backend {
+    EVLOOP_EPOLL,
+    EVLOOP_URING,
+};
+
+typedef void (*evloop_fd_fn)(void *data, uint32_t events);      // POLLIN, POLLOUT, POLLERR, ...
+typedef void (*evloop_timer_fn)(void *data);
+typedef void (*evloop_io_fn)(void *data, ssize_t result);       // Bytes, or -errno
+
+struct evloop_watch {
+    int fd;
+    uint32_t events;
+    evloop_fd_fn fn;
+    void *data;
+    bool armed;                      // io_uring: a POLL_ADD is queued or in flight
+};
+
+struct evloop_timer {
+    int fd;                          // timerfd, epoll only
+    struct __kernel_timespec interval;
+    evloop_timer_fn fn;
+    void *data;
+    bool armed;                      // io_uring: a TIMEOUT is queued or in flight
+};
+
+struct evloop_io {
+    bool busy, done;                 // done: epoll has the result, callback pending
+    ssize_t result;
+    evloop_io_fn fn;
+    void *data;
+};
+
+struct evloop_ring {
+    int fd;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned sq_entries;
+    unsigned tail;                   // Local SQ tail, published on submit
+    unsigned queued;                 // SQEs not yet submitted
+};
+
+struct evloop {
+    enum evloop_backend backend;
+    int epoll_fd;
+    struct evloop_ring ring;
+    struct evloop_watch watches[EVLOOP_MAX_WATCHES];
+    struct evloop_timer timers[EVLOOP_MAX_TIMERS];
+    struct evloop_io io[EVLOOP_MAX_IO];
+    int watch_count, timer_count, io_pending;
+
+    uint64_t iterations, wakeups, syscalls, submitted;
+};
+
+// io_uring user_data / epoll data: kind in the top byte, index below
+enum {
+    EVLOOP_TAG_WATCH = 1,
+    EVLOOP_TAG_TIMER,
+    EVLOOP_TAG_IO,
+    EVLOOP_TAG_WAIT,
+};
+#define EVLOOP_TAG(kind, index) ((uint64_t)(kind) << 56 | (uint64_t)(index))
+
+static const char *
+evloop_backend_name(enum evloop_backend backend)
+{
+    return backend == EVLOOP_URING ? "io_uring" : "epoll";
+}
+
+static inline int
+evloop_uring_enter(struct evloop *loop, unsigned submit, unsigned wait, unsigned flags)
+{
+    ++loop->syscalls;
+    return (int)syscall(__NR_io_uring_enter, loop->ring.fd, submit, wait, flags, NULL, 0);
+}
+
+static void
+evloop_ring_free(struct evloop_ring *ring)
+{
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_size);
+    }
+    if (ring->sq_ptr) {
+        munmap(ring->sq_ptr, ring->sq_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    *ring = (struct evloop_ring){ .fd = -1 };
+}
+
+static bool
+evloop_ring_init(struct evloop_ring *ring)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    *ring = (struct evloop_ring){ .fd = -1 };
+    ring->fd = (int)syscall(__NR_io_uring_setup, EVLOOP_RING_SIZE, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) {
+        ring->sq_size = ring->cq_size = ring->sq_size > ring->cq_size ? ring->sq_size : ring->cq_size;
+    }
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        ring->sq_ptr = NULL;
+        evloop_ring_free(ring);
+        return false;
+    }
+    ring->cq_ptr = single ? ring->sq_ptr
+                 : mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->cq_ptr == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        ring->cq_ptr = ring->cq_ptr == MAP_FAILED ? NULL : ring->cq_ptr;
+        ring->sqes = ring->sqes == MAP_FAILED ? NULL : ring->sqes;
+        evloop_ring_free(ring);
+        return false;
+    }
+
+    char *sq = ring->sq_ptr, *cq = ring->cq_ptr;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring->sq_entries = params.sq_entries;
+    ring->tail = *ring->sq_tail;
+    return true;
+}
+
+// Publishes the queued SQEs; the next io_uring_enter picks them up
+static inline unsigned
+evloop_ring_publish(struct evloop_ring *ring)
+{
+    unsigned queued = ring->queued;
+    __atomic_store_n(ring->sq_tail, ring->tail, __ATOMIC_RELEASE);
+    ring->queued = 0;
+    return queued;
+}
+
+// Next free SQE, zeroed; submits early only if the ring is full
+static struct io_uring_sqe *
+evloop_sqe(struct evloop *loop, uint8_t opcode, uint64_t user_data)
+{
+    struct evloop_ring *ring = &loop->ring;
+    if (ring->tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        unsigned queued = evloop_ring_publish(ring);
+        int ret;
+        while ((ret = evloop_uring_enter(loop, queued, 0, 0)) < 0 && errno == EINTR) {
+        }
+        if (ret < 0) {
+            return NULL;             // E.g. EBUSY: the completions must be reaped first
+        }
+    }
+    unsigned index = ring->tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    ++ring->tail;
+    ++ring->queued;
+    ++loop->submitted;
+    return sqe;
+}
+
+static void
+evloop_arm_watch(struct evloop *loop, int index)
+{
+    struct io_uring_sqe *sqe = evloop_sqe(loop, IORING_OP_POLL_ADD, EVLOOP_TAG(EVLOOP_TAG_WATCH, index));
+    loop->watches[index].armed = sqe != NULL;
+    if (sqe) {
+        sqe->fd = loop->watches[index].fd;
+        sqe->poll32_events = loop->watches[index].events;
+    }
+}
+
+static void
+evloop_arm_timer(struct evloop *loop, int index)
+{
+    struct io_uring_sqe *sqe = evloop_sqe(loop, IORING_OP_TIMEOUT, EVLOOP_TAG(EVLOOP_TAG_TIMER, index));
+    loop->timers[index].armed = sqe != NULL;
+    if (sqe) {
+        sqe->addr = (uint64_t)(uintptr_t)&loop->timers[index].interval;
+        sqe->len = 1;
+    }
+}
+
+// Retries the re-arms that found the ring full; false if one still fails
+static bool
+evloop_rearm(struct evloop *loop)
+{
+    for (int i = 0; i < loop->watch_count; ++i) {
+        if (!loop->watches[i].armed) {
+            evloop_arm_watch(loop, i);
+            if (!loop->watches[i].armed) {
+                return false;
+            }
+        }
+    }
+    for (int i = 0; i < loop->timer_count; ++i) {
+        if (!loop->timers[i].armed) {
+            evloop_arm_timer(loop, i);
+            if (!loop->timers[i].armed) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*******************************************
+ * evloop_init:
+ * - Sets up `backend`; io_uring falls back to epoll when the kernel
+ *   refuses it. loop->backend is what is actually in use.
+ *******************************************/
+static bool
+evloop_init(struct evloop *loop, enum evloop_backend backend)
+{
+    memset(loop, 0, sizeof(*loop));
+    loop->epoll_fd = -1;
+    loop->ring.fd = -1;
+    if (backend == EVLOOP_URING) {
+        if (evloop_ring_init(&loop->ring)) {
+            loop->backend = EVLOOP_URING;
+            return true;
+        }
+        fprintf(stderr, "[LOOP] io_uring unavailable (%s), using epoll\n", strerror(errno));
+    }
+    loop->backend = EVLOOP_EPOLL;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    return loop->epoll_fd >= 0;
+}
+
+static void
+evloop_finish(struct evloop *loop)
+{
+    for (int i = 0; i < loop->timer_count; ++i) {
+        if (loop->timers[i].fd >= 0) {
+            close(loop->timers[i].fd);
+        }
+    }
+    if (loop->epoll_fd >= 0) {
+        close(loop->epoll_fd);
+    }
+    evloop_ring_free(&loop->ring);
+    loop->epoll_fd = -1;
+    loop->watch_count = loop->timer_count = 0;
+}
+
+// Calls `fn` whenever `fd` has any of `events` (POLLIN, POLLOUT)
+static bool
+evloop_add_fd(struct evloop *loop, int fd, uint32_t events, evloop_fd_fn fn, void *data)
+{
+    if (loop->watch_count == EVLOOP_MAX_WATCHES) {
+        return false;
+    }
+    int index = loop->watch_count;
+    loop->watches[index] = (struct evloop_watch){ fd, events, fn, data };
+    if (loop->backend == EVLOOP_EPOLL) {
+        // POLLIN/POLLOUT/POLLERR/POLLHUP share their values with EPOLL*
+        struct epoll_event event = { .events = events, .data.u64 = EVLOOP_TAG(EVLOOP_TAG_WATCH, index) };
+        ++loop->syscalls;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            return false;
+        }
+    } else {
+        evloop_arm_watch(loop, index);
+    }
+    ++loop->watch_count;
+    return true;
+}
+
+// Calls `fn` every `interval_ms`
+static bool
+evloop_add_timer(struct evloop *loop, int interval_ms, evloop_timer_fn fn, void *data)
+{
+    if (loop->timer_count == EVLOOP_MAX_TIMERS || interval_ms <= 0) {
+        return false;
+    }
+    int index = loop->timer_count;
+    struct evloop_timer *timer = &loop->timers[index];
+    *timer = (struct evloop_timer){ .fd = -1, .fn = fn, .data = data };
+    timer->interval.tv_sec = interval_ms / 1000;
+    timer->interval.tv_nsec = (long long)(interval_ms % 1000) * 1000000;
+    if (loop->backend == EVLOOP_EPOLL) {
+        struct timespec interval = { interval_ms / 1000, (long)(interval_ms % 1000) * 1000000 };
+        struct itimerspec spec = { interval, interval };
+        struct epoll_event event = { .events = EPOLLIN, .data.u64 = EVLOOP_TAG(EVLOOP_TAG_TIMER, index) };
+        loop->syscalls += 3;
+        timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (timer->fd < 0 || timerfd_settime(timer->fd, 0, &spec, NULL) < 0
+            || epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, timer->fd, &event) < 0) {
+            if (timer->fd >= 0) {
+                close(timer->fd);
+            }
+            return false;
+        }
+    } else {
+        evloop_arm_timer(loop, index);
+    }
+    ++loop->timer_count;
+    return true;
+}
+
+static int
+evloop_io_slot(struct evloop *loop)
+{
+    for (int i = 0; i < EVLOOP_MAX_IO; ++i) {
+        if (!loop->io[i].busy) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*******************************************
+ * evloop_read / evloop_write:
+ * - Queue a pread/pwrite of `length` bytes at `offset`; `fn` gets the
+ *   result from a later evloop_run_once(). Return false when
+ *   EVLOOP_MAX_IO operations are already in flight.
+ * - io_uring submits them with the next wait. The epoll backend has no
+ *   asynchronous file I/O, so it does the call right here.
+ *******************************************/
+static bool
+evloop_io(struct evloop *loop, bool write, int fd, void *buffer, size_t length, uint64_t offset,
+          evloop_io_fn fn, void *data)
+{
+    int index = evloop_io_slot(loop);
+    if (index < 0) {
+        return false;
+    }
+    struct evloop_io *io = &loop->io[index];
+    *io = (struct evloop_io){ .busy = true, .fn = fn, .data = data };
+    ++loop->io_pending;
+    if (loop->backend == EVLOOP_EPOLL) {
+        ++loop->syscalls;
+        ++loop->submitted;
+        io->result = write ? pwrite(fd, buffer, length, offset) : pread(fd, buffer, length, offset);
+        io->result = io->result < 0 ? -errno : io->result;
+        io->done = true;
+        return true;
+    }
+    struct io_uring_sqe *sqe = evloop_sqe(loop, write ? IORING_OP_WRITE : IORING_OP_READ,
+                                          EVLOOP_TAG(EVLOOP_TAG_IO, index));
+    if (!sqe) {
+        io->busy = false;
+        --loop->io_pending;
+        return false;
+    }
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = length;
+    sqe->off = offset;
+    return true;
+}
+
+static inline bool
+evloop_read(struct evloop *loop, int fd, void *buffer, size_t length, uint64_t offset,
+            evloop_io_fn fn, void *data)
+{
+    return evloop_io(loop, false, fd, buffer, length, offset, fn, data);
+}
+
+static inline bool
+evloop_write(struct evloop *loop, int fd, const void *buffer, size_t length, uint64_t offset,
+             evloop_io_fn fn, void *data)
+{
+    return evloop_io(loop, true, fd, (void *)buffer, length, offset, fn, data);
+}
+
+static void
+evloop_complete_io(struct evloop *loop, int index, ssize_t result)
+{
+    struct evloop_io *io = &loop->io[index];
+    io->busy = io->done = false;
+    --loop->io_pending;
+    io->fn(io->data, result);
+}
+
+// Callbacks for the epoll backend's already finished file I/O
+static int
+evloop_complete_sync_io(struct evloop *loop)
+{
+    int completed = 0;
+    for (int i = 0; i < EVLOOP_MAX_IO; ++i) {
+        if (loop->io[i].busy && loop->io[i].done) {
+            evloop_complete_io(loop, i, loop->io[i].result);
+            ++completed;
+        }
+    }
+    return completed;
+}
+
+static int
+evloop_run_epoll(struct evloop *loop, int timeout_ms)
+{
+    if (evloop_complete_sync_io(loop) > 0) {
+        timeout_ms = 0;              // Don't sleep with callbacks delivered
+    }
+    struct epoll_event events[EVLOOP_MAX_WATCHES + EVLOOP_MAX_TIMERS];
+    ++loop->syscalls;
+    int count = epoll_wait(loop->epoll_fd, events, EVLOOP_MAX_WATCHES + EVLOOP_MAX_TIMERS, timeout_ms);
+    if (count < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    for (int i = 0; i < count; ++i) {
+        unsigned kind = events[i].data.u64 >> 56, index = (unsigned)(events[i].data.u64 & 0xffffff);
+        if (kind == EVLOOP_TAG_WATCH) {
+            loop->watches[index].fn(loop->watches[index].data, events[i].events);
+        } else if (kind == EVLOOP_TAG_TIMER) {
+            uint64_t expirations;
+            ++loop->syscalls;
+            if (read(loop->timers[index].fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                loop->timers[index].fn(loop->timers[index].data);
+            }
+        }
+    }
+    return count;
+}
+
+static int
+evloop_run_uring(struct evloop *loop, int timeout_ms)
+{
+    struct evloop_ring *ring = &loop->ring;
+    struct __kernel_timespec timeout = { timeout_ms / 1000, (long long)(timeout_ms % 1000) * 1000000 };
+    bool ready = *ring->cq_head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    // With completions waiting, reaping them below frees room for the retry
+    if (!evloop_rearm(loop) && !ready) {
+        fprintf(stderr, "[LOOP] Cannot re-arm a watch: %s\n", strerror(errno));
+        return -1;
+    }
+    if (!ready && timeout_ms >= 0) {
+        // Completes on its own, or with the first other completion (off = 1)
+        struct io_uring_sqe *sqe = evloop_sqe(loop, IORING_OP_TIMEOUT, EVLOOP_TAG(EVLOOP_TAG_WAIT, 0));
+        if (sqe) {
+            sqe->addr = (uint64_t)(uintptr_t)&timeout;
+            sqe->len = 1;
+            sqe->off = 1;
+        }
+    }
+
+    // Everything queued since the last iteration goes in with the wait
+    unsigned queued = evloop_ring_publish(ring);
+    if (evloop_uring_enter(loop, queued, ready ? 0 : 1, ready ? 0 : IORING_ENTER_GETEVENTS) < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int count = 0;
+    unsigned head = *ring->cq_head, tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        struct io_uring_cqe cqe = ring->cqes[head & *ring->cq_mask];
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+        unsigned kind = cqe.user_data >> 56, index = (unsigned)(cqe.user_data & 0xffffff);
+        if (kind == EVLOOP_TAG_WATCH) {
+            ++count;
+            evloop_arm_watch(loop, index);
+            if (cqe.res > 0) {
+                loop->watches[index].fn(loop->watches[index].data, (uint32_t)cqe.res);
+            }
+        } else if (kind == EVLOOP_TAG_TIMER) {
+            ++count;
+            evloop_arm_timer(loop, index);
+            if (cqe.res == -ETIME) {
+                loop->timers[index].fn(loop->timers[index].data);
+            }
+        } else if (kind == EVLOOP_TAG_IO) {
+            ++count;
+            evloop_complete_io(loop, index, cqe.res);
+        }
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    }
+    return count;
+}
+
+/*******************************************
+ * evloop_run_once:
+ * - One iteration: waits up to `timeout_ms` (-1: forever) for the first
+ *   event and runs the callbacks of everything that is ready. Returns the
+ *   number of events handled, 0 on timeout or EINTR, -1 on error.
+ *******************************************/
+static int
+evloop_run_once(struct evloop *loop, int timeout_ms)
+{
+    ++loop->iterations;
+    int count = loop->backend == EVLOOP_URING ? evloop_run_uring(loop, timeout_ms)
+                                              : evloop_run_epoll(loop, timeout_ms);
+    if (count > 0) {
+        ++loop->wakeups;
+    }
+    return count;
+}
+
+// Waits for the file I/O still in flight, e.g. before closing its fds
+static void
+evloop_drain(struct evloop *loop)
+{
+    while (loop->io_pending > 0) {
+        if (loop->backend == EVLOOP_EPOLL) {
+            evloop_complete_sync_io(loop);
+        } else if (evloop_run_uring(loop, -1) < 0) {
+            break;
+        }
+    }
+}
+
+// Syscalls and wakeups per `frames` frames
+static void
+evloop_report(const struct evloop *loop, uint64_t frames)
+{
+    if (!loop->iterations) {
+        return;
+    }
+    double per = frames ? 1.0 / frames : 0;
+    fprintf(stderr, "[LOOP] %s: %llu iterations, %llu wakeups, %llu syscalls, %llu ops submitted",
+            evloop_backend_name(loop->backend), (unsigned long long)loop->iterations,
+            (unsigned long long)loop->wakeups, (unsigned long long)loop->syscalls,
+            (unsigned long long)loop->submitted);
+    if (frames) {
+        fprintf(stderr, "; per frame: %.2f wakeups, %.2f syscalls", loop->wakeups * per,
+                loop->syscalls * per);
+    }
+    fprintf(stderr, "\n");
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef MYWAYLAND_FILL_H
+#define MYWAYLAND_FILL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILL_X86 1
+#endif
+
+/*******************************************
+ * @XRGB8888 RECTANGLE FILLS
+ *******************************************
+ *
+ * Solid fills and copies for software-rendered wl_shm buffers.
+ *
+ * - A fill is one row kernel applied to every row of a rectangle. The
+ *   SSE2 kernel stores 4 pixels per instruction and the AVX2 one 8, four
+ *   stores per iteration; the scalar loop mops up the ragged end.
+ * - Like include/yuv.h the kernels use target attributes, so the same
+ *   binary runs on any x86-64; fill_select() picks one with
+ *   __builtin_cpu_supports.
+ * - Copies (e.g. restoring a damaged rect from a pre-scaled background)
+ *   go through memcpy, which libc already vectorizes.
+ *******************************************/
+
+typedef void (*fill_row_fn)(uint32_t *dst, uint32_t color, int width);
+
+static void
+fill_row_scalar(uint32_t *dst, uint32_t color, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        dst[x] = color;
+    }
+}
+
+#ifdef FILL_X86
+
+__attribute__((target("sse2")))
+static void
+fill_row_sse2(uint32_t *dst, uint32_t color, int width)
+{
+    const __m128i value = _mm_set1_epi32((int)color);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        _mm_storeu_si128((__m128i *)(dst + x + 0), value);
+        _mm_storeu_si128((__m128i *)(dst + x + 4), value);
+        _mm_storeu_si128((__m128i *)(dst + x + 8), value);
+        _mm_storeu_si128((__m128i *)(dst + x + 12), value);
+    }
+    for (; x + 4 <= width; x += 4) {
+        _mm_storeu_si128((__m128i *)(dst + x), value);
+    }
+    fill_row_scalar(dst + x, color, width - x);
+}
+
+__attribute__((target("avx2")))
+static void
+fill_row_avx2(uint32_t *dst, uint32_t color, int width)
+{
+    const __m256i value = _mm256_set1_epi32((int)color);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        _mm256_storeu_si256((__m256i *)(dst + x + 0), value);
+        _mm256_storeu_si256((__m256i *)(dst + x + 8), value);
+        _mm256_storeu_si256((__m256i *)(dst + x + 16), value);
+        _mm256_storeu_si256((__m256i *)(dst + x + 24), value);
+    }
+    for (; x + 8 <= width; x += 8) {
+        _mm256_storeu_si256((__m256i *)(dst + x), value);
+    }
+    fill_row_scalar(dst + x, color, width - x);
+}
+
+#endif /* FILL_X86 */
+
+/*******************************************
+ * fill_select:
+ * - Returns the fastest row kernel this CPU supports, or the one named by
+ *   `name` ("scalar", "sse2", "avx2") when given and supported.
+ * - `*chosen` receives the kernel's name.
+ *******************************************/
+static fill_row_fn
+fill_select(const char *name, const char **chosen)
+{
+#ifdef FILL_X86
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse2 = __builtin_cpu_supports("sse2");
+    if (avx2 && (!name || strcmp(name, "avx2") == 0)) {
+        *chosen = "avx2";
+        return fill_row_avx2;
+    }
+    if (sse2 && (!name || strcmp(name, "avx2") == 0 || strcmp(name, "sse2") == 0)) {
+        *chosen = "sse2";
+        return fill_row_sse2;
+    }
+#endif
+    *chosen = "scalar";
+    return fill_row_scalar;
+}
+
+// Fills `width` x `height` pixels at (x, y); the rect must lie inside the buffer
+static void
+fill_rect(fill_row_fn row_fn, uint32_t *pixels, int stride,
+          int x, int y, int width, int height, uint32_t color)
+{
+    for (int row = y; row < y + height; ++row) {
+        row_fn((uint32_t *)((uint8_t *)pixels + (size_t)row * stride) + x, color, width);
+    }
+}
+
+// Copies the same rect between two buffers of equal size
+static void
+fill_copy_rect(uint32_t *dst, const uint32_t *src, int stride,
+               int x, int y, int width, int height)
+{
+    for (int row = y; row < y + height; ++row) {
+        size_t offset = (size_t)row * stride + (size_t)x * 4;
+        memcpy((uint8_t *)dst + offset, (const uint8_t *)src + offset, (size_t)width * 4);
+    }
+}
+
+#endif
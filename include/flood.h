@@ -0,0 +1,353 @@
+#ifndef MYWAYLAND_FLOOD_H
+#define MYWAYLAND_FLOOD_H
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-client.h>
+#include "trace.h"
+
+/*******************************************
+ * @EVENT FLOOD RESILIENCE
+ *******************************************
+ *
+ * A client whose listeners print every event cannot keep up with a
+ * high-rate mouse or a compositor sending thousands of events at once.
+ * Its socket fills up and the compositor disconnects it. The
+ * "flood-safe" mode built from these helpers:
+ *
+ * - Raises the connection buffer limit with
+ *   wl_display_set_max_buffer_size (libwayland >= 1.23), so a burst is
+ *   buffered instead of fatal.
+ * - Keeps listeners to the state updates that must happen in order
+ *   (xkb modifiers, focus, ...). Everything else, mostly the logging,
+ *   goes into a fixed-size ring as a small record. A record that merely
+ *   supersedes the previous one (pointer motion) replaces it. When the
+ *   ring is full, new records are dropped and counted: they are only
+ *   diagnostics.
+ * - Runs the loop with flood_dispatch(): read and dispatch everything
+ *   that arrived (listeners are cheap now), then drain at most
+ *   FLOOD_BUDGET_RECORDS records or FLOOD_BUDGET_MS of deferred work
+ *   before going back to the socket.
+ *
+ * With `enabled` false the same loop runs but listeners keep doing their
+ * work inline, which gives the numbers to compare against.
+ *
+ * --flood N (flood_start) makes the client flood itself. It sends N
+ * wl_display_sync requests in a burst, and the compositor answers each
+ * with a done and a delete_id event. The report shows:
+ * - the peak libwayland queue depth (events dispatched in one go)
+ * - the peak ring depth
+ * - per-event handler time, per-dispatch drain time
+ * - the time until the last reply, and the process CPU time per reply
+ *******************************************/
+
+#define FLOOD_RING_SIZE       8192    // Records; power of two
+#define FLOOD_PAYLOAD         64
+#define FLOOD_BUDGET_RECORDS  256
+#define FLOOD_BUDGET_MS       2.0
+#define FLOOD_BUFFER_SIZE     (1 << 20)
+#define FLOOD_KIND_SYNC       0       // Reserved for the synthetic flood
+
+struct flood_record {
+    uint32_t kind;
+    uint32_t time;
+    unsigned char payload[FLOOD_PAYLOAD];
+};
+
+struct flood_stats {
+    uint64_t pushed, coalesced, dropped, drained;
+    uint32_t peak_ring_depth;
+    uint32_t peak_queue_depth;          // Events in one wl_display_dispatch_pending
+    uint64_t dispatches;
+    uint64_t handler_events;
+    double handler_ns, handler_ns_max;
+    double drain_ns, drain_ns_max;
+};
+
+struct flood {
+    bool enabled;                       // Defer to the ring (flood-safe mode)
+    bool buffer_raised;
+    struct flood_record ring[FLOOD_RING_SIZE];
+    uint32_t head, tail;                // Free-running; depth = tail - head
+    struct flood_stats stats;
+
+    // Synthetic flood
+    uint64_t flood_sent, flood_done;
+    double flood_start_ns, flood_end_ns;
+    double flood_cpu_start_ns, flood_cpu_end_ns;
+};
+
+static inline double
+flood_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline double
+flood_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*******************************************
+ * Handler timing:
+ * - Wrap listener bodies in FLOOD_HANDLER_BEGIN / FLOOD_HANDLER_END to get
+ *   per-event cost in the report, in either mode.
+ *******************************************/
+#define FLOOD_HANDLER_BEGIN(flood) double flood_handler_start_ = (flood) ? flood_now_ns() : 0
+#define FLOOD_HANDLER_END(flood) do { \
+        if (flood) { \
+            flood_handler_account((flood), flood_now_ns() - flood_handler_start_); \
+        } \
+    } while (0)
+
+static inline void
+flood_handler_account(struct flood *flood, double ns)
+{
+    ++flood->stats.handler_events;
+    flood->stats.handler_ns += ns;
+    if (ns > flood->stats.handler_ns_max) {
+        flood->stats.handler_ns_max = ns;
+    }
+}
+
+// Raises the connection buffer limit if this libwayland can
+static void
+flood_init(struct flood *flood, struct wl_display *display, bool enabled)
+{
+    memset(flood, 0, sizeof(*flood));
+    flood->enabled = enabled;
+    if (!enabled) {
+        return;
+    }
+#if WAYLAND_VERSION_MAJOR > 1 || (WAYLAND_VERSION_MAJOR == 1 && WAYLAND_VERSION_MINOR >= 23)
+    wl_display_set_max_buffer_size(display, FLOOD_BUFFER_SIZE);
+    flood->buffer_raised = true;
+#endif
+}
+
+static inline uint32_t
+flood_depth(const struct flood *flood)
+{
+    return flood->tail - flood->head;
+}
+
+// Queues a record; false (and counted) when the ring is full
+static bool
+flood_push(struct flood *flood, uint32_t kind, uint32_t time, const void *payload, size_t size)
+{
+    if (flood_depth(flood) == FLOOD_RING_SIZE) {
+        ++flood->stats.dropped;
+        return false;
+    }
+    struct flood_record *record = &flood->ring[flood->tail % FLOOD_RING_SIZE];
+    record->kind = kind;
+    record->time = time;
+    if (size) {
+        memcpy(record->payload, payload, size < FLOOD_PAYLOAD ? size : FLOOD_PAYLOAD);
+    }
+    ++flood->tail;
+    ++flood->stats.pushed;
+    if (flood_depth(flood) > flood->stats.peak_ring_depth) {
+        flood->stats.peak_ring_depth = flood_depth(flood);
+    }
+    return true;
+}
+
+// Like flood_push, but replaces the newest record if it has the same kind
+static bool
+flood_push_coalesce(struct flood *flood, uint32_t kind, uint32_t time, const void *payload, size_t size)
+{
+    if (flood_depth(flood) > 0) {
+        struct flood_record *last = &flood->ring[(flood->tail - 1) % FLOOD_RING_SIZE];
+        if (last->kind == kind) {
+            last->time = time;
+            memcpy(last->payload, payload, size < FLOOD_PAYLOAD ? size : FLOOD_PAYLOAD);
+            ++flood->stats.coalesced;
+            return true;
+        }
+    }
+    return flood_push(flood, kind, time, payload, size);
+}
+
+/*******************************************
+ * Synthetic flood
+ *******************************************/
+static void
+flood_sync_done(void *data, struct wl_callback *callback, uint32_t serial)
+{
+    struct flood *flood = data;
+    FLOOD_HANDLER_BEGIN(flood);
+    wl_callback_destroy(callback);
+    if (flood->enabled) {
+        flood_push(flood, FLOOD_KIND_SYNC, serial, NULL, 0);
+    } else {
+        fprintf(stderr, "[FLOOD] sync %u done\n", serial);
+    }
+    if (++flood->flood_done == flood->flood_sent) {
+        flood->flood_end_ns = flood_now_ns();
+        flood->flood_cpu_end_ns = flood_cpu_ns();
+    }
+    FLOOD_HANDLER_END(flood);
+}
+
+static const struct wl_callback_listener flood_sync_listener = {
+    .done = flood_sync_done,
+};
+
+/*******************************************
+ * flood_dispatch:
+ * - One iteration of the flood-safe loop. Blocks for at most `timeout_ms`
+ *   (-1: forever) when no deferred work is pending, reads and dispatches
+ *   whatever arrived, then hands at most one budget's worth of records
+ *   to `drain` (synthetic-flood records are handled here).
+ * - Returns -1 when the connection failed, like wl_display_dispatch.
+ *******************************************/
+typedef void (*flood_drain_fn)(void *data, const struct flood_record *record);
+
+static int
+flood_dispatch(struct wl_display *display, struct flood *flood, int timeout_ms,
+               flood_drain_fn drain, void *data)
+{
+    while (wl_display_prepare_read(display) != 0) {
+        if (wl_display_dispatch_pending(display) < 0) {
+            return -1;
+        }
+    }
+    if (wl_display_flush(display) < 0 && errno != EAGAIN) {
+        wl_display_cancel_read(display);
+        return -1;
+    }
+
+    // The trace signal pipe is -1 (ignored by poll) unless tracing is on
+    struct pollfd fds[2] = {
+        { .fd = wl_display_get_fd(display), .events = POLLIN },
+        { .fd = trace_signal_fd(), .events = POLLIN },
+    };
+    int ready = poll(fds, 2, flood_depth(flood) > 0 ? 0 : timeout_ms);
+    if (ready > 0 && (fds[0].revents & (POLLIN | POLLERR | POLLHUP))) {
+        if (wl_display_read_events(display) < 0) {
+            return -1;
+        }
+    } else {
+        wl_display_cancel_read(display);
+        if (ready < 0 && errno != EINTR) {
+            return -1;
+        }
+    }
+
+    TRACE_BEGIN("dispatch", "flood dispatch_pending");
+    int events = wl_display_dispatch_pending(display);
+    TRACE_END("dispatch", "flood dispatch_pending");
+    if (events < 0) {
+        return -1;
+    }
+    ++flood->stats.dispatches;
+    if ((uint32_t)events > flood->stats.peak_queue_depth) {
+        flood->stats.peak_queue_depth = events;
+    }
+
+    // Bounded deferred work, then back to the socket
+    TRACE_BEGIN("dispatch", "flood drain");
+    double start = flood_now_ns();
+    for (int i = 0; i < FLOOD_BUDGET_RECORDS && flood_depth(flood) > 0; ++i) {
+        const struct flood_record *record = &flood->ring[flood->head % FLOOD_RING_SIZE];
+        if (record->kind == FLOOD_KIND_SYNC) {
+            fprintf(stderr, "[FLOOD] sync %u done\n", record->time);
+        } else {
+            drain(data, record);
+        }
+        ++flood->head;
+        ++flood->stats.drained;
+        if (flood_now_ns() - start > FLOOD_BUDGET_MS * 1e6) {
+            break;
+        }
+    }
+    double elapsed = flood_now_ns() - start;
+    flood->stats.drain_ns += elapsed;
+    if (elapsed > flood->stats.drain_ns_max) {
+        flood->stats.drain_ns_max = elapsed;
+    }
+    TRACE_END("dispatch", "flood drain");
+    return events;
+}
+
+/*******************************************
+ * flood_start:
+ * - Sends `count` syncs in one burst. When the socket is full it keeps
+ *   reading (through flood_dispatch) while waiting for room, since the
+ *   replies pile up just as fast.
+ *******************************************/
+static int
+flood_start(struct flood *flood, struct wl_display *display, uint64_t count,
+            flood_drain_fn drain, void *data)
+{
+    flood->flood_sent = count;
+    flood->flood_done = 0;
+    flood->flood_start_ns = flood_now_ns();
+    flood->flood_cpu_start_ns = flood_cpu_ns();
+    for (uint64_t i = 0; i < count; ++i) {
+        struct wl_callback *callback = wl_display_sync(display);
+        if (!callback) {
+            return -1;
+        }
+        wl_callback_add_listener(callback, &flood_sync_listener, flood);
+        if (i % 128 != 127) {
+            continue;
+        }
+        while (wl_display_flush(display) < 0) {
+            if (errno != EAGAIN) {
+                return -1;
+            }
+            struct pollfd pfd = { .fd = wl_display_get_fd(display), .events = POLLIN | POLLOUT };
+            poll(&pfd, 1, -1);
+            if ((pfd.revents & POLLIN) && flood_dispatch(display, flood, 0, drain, data) < 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void
+flood_report(const struct flood *flood, const char *label)
+{
+    const struct flood_stats *s = &flood->stats;
+    fprintf(stderr, "[FLOOD] %s: %s mode, connection buffer %s\n", label,
+            flood->enabled ? "flood-safe" : "inline",
+            flood->buffer_raised ? "raised to 1 MiB" : "at the libwayland default");
+    if (flood->flood_sent) {
+        double cpu_ns = (flood->flood_cpu_end_ns ? flood->flood_cpu_end_ns : flood_cpu_ns())
+                      - flood->flood_cpu_start_ns;
+        fprintf(stderr, "[FLOOD] synthetic flood: %llu/%llu syncs answered%s %.1f ms, %.2f us CPU per reply\n",
+                (unsigned long long)flood->flood_done, (unsigned long long)flood->flood_sent,
+                flood->flood_done == flood->flood_sent ? " in" : ", running for",
+                ((flood->flood_end_ns ? flood->flood_end_ns : flood_now_ns()) - flood->flood_start_ns) / 1e6,
+                flood->flood_done ? cpu_ns / flood->flood_done / 1e3 : 0.0);
+    }
+    fprintf(stderr, "[FLOOD] handlers: %llu events, avg %.2f us, max %.2f us\n",
+            (unsigned long long)s->handler_events,
+            s->handler_events ? s->handler_ns / s->handler_events / 1e3 : 0.0,
+            s->handler_ns_max / 1e3);
+    fprintf(stderr, "[FLOOD] peak queue depth %u events in one dispatch\n", s->peak_queue_depth);
+    if (flood->enabled) {
+        fprintf(stderr, "[FLOOD] peak deferred %u/%u records\n", s->peak_ring_depth, FLOOD_RING_SIZE);
+        fprintf(stderr, "[FLOOD] deferred: %llu queued, %llu coalesced, %llu dropped, %llu drained; "
+                "drain avg %.2f us, max %.2f us per dispatch\n",
+                (unsigned long long)s->pushed, (unsigned long long)s->coalesced,
+                (unsigned long long)s->dropped, (unsigned long long)s->drained,
+                s->dispatches ? s->drain_ns / s->dispatches / 1e3 : 0.0, s->drain_ns_max / 1e3);
+    }
+}
+
+#endif
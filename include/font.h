@@ -0,0 +1,186 @@
+#ifndef MYWAYLAND_FONT_H
+#define MYWAYLAND_FONT_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*******************************************
+ * @5x7 BITMAP FONT
+ *******************************************
+ *
+ * A tiny built-in font so the clients can put text on screen without
+ * depending on fontconfig/freetype.
+ *
+ * - Printable ASCII (32..126). Each glyph is 7 rows of 5 pixels; bit 4 of
+ *   a row is the leftmost pixel.
+ * - Glyphs advance by FONT_ADVANCE pixels (one blank column), lines by
+ *   FONT_LINE_HEIGHT. Everything scales by an integer factor.
+ * - font_draw_text() rasterizes into an XRGB8888 buffer for the wl_shm
+ *   paths; the GL paths build a texture atlas from font_glyph() instead.
+ *******************************************/
+
+#define FONT_GLYPH_WIDTH  5
+#define FONT_GLYPH_HEIGHT 7
+#define FONT_ADVANCE      6
+#define FONT_LINE_HEIGHT  9
+#define FONT_FIRST_CHAR   32
+#define FONT_LAST_CHAR    126
+
+static const uint8_t font_glyphs[FONT_LAST_CHAR - FONT_FIRST_CHAR + 1][FONT_GLYPH_HEIGHT] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ' '
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 },  // '!'
+    { 0x0a, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00 },  // '"'
+    { 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a },  // '#'
+    { 0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04 },  // '$'
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 },  // '%'
+    { 0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d },  // '&'
+    { 0x04, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00 },  // quote
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 },  // '('
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 },  // ')'
+    { 0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00 },  // '*'
+    { 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00 },  // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08 },  // ','
+    { 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 },  // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c },  // '.'
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },  // '/'
+    { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e },  // '0'
+    { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e },  // '1'
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f },  // '2'
+    { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e },  // '3'
+    { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 },  // '4'
+    { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e },  // '5'
+    { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e },  // '6'
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },  // '7'
+    { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e },  // '8'
+    { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c },  // '9'
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 },  // ':'
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08 },  // ';'
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 },  // '<'
+    { 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00 },  // '='
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 },  // '>'
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 },  // '?'
+    { 0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e },  // '@'
+    { 0x0e, 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11 },  // 'A'
+    { 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e },  // 'B'
+    { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e },  // 'C'
+    { 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c },  // 'D'
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f },  // 'E'
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 },  // 'F'
+    { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f },  // 'G'
+    { 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },  // 'H'
+    { 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e },  // 'I'
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c },  // 'J'
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },  // 'K'
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f },  // 'L'
+    { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 },  // 'M'
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },  // 'N'
+    { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },  // 'O'
+    { 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 },  // 'P'
+    { 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d },  // 'Q'
+    { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 },  // 'R'
+    { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e },  // 'S'
+    { 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },  // 'T'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },  // 'U'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 },  // 'V'
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a },  // 'W'
+    { 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 },  // 'X'
+    { 0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04 },  // 'Y'
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f },  // 'Z'
+    { 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e },  // '['
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 },  // backslash
+    { 0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e },  // ']'
+    { 0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00 },  // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f },  // '_'
+    { 0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00 },  // '`'
+    { 0x00, 0x00, 0x0e, 0x01, 0x0f, 0x11, 0x0f },  // 'a'
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1e },  // 'b'
+    { 0x00, 0x00, 0x0e, 0x10, 0x10, 0x11, 0x0e },  // 'c'
+    { 0x01, 0x01, 0x0d, 0x13, 0x11, 0x11, 0x0f },  // 'd'
+    { 0x00, 0x00, 0x0e, 0x11, 0x1f, 0x10, 0x0e },  // 'e'
+    { 0x06, 0x09, 0x08, 0x1c, 0x08, 0x08, 0x08 },  // 'f'
+    { 0x00, 0x0f, 0x11, 0x11, 0x0f, 0x01, 0x0e },  // 'g'
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11 },  // 'h'
+    { 0x04, 0x00, 0x0c, 0x04, 0x04, 0x04, 0x0e },  // 'i'
+    { 0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0c },  // 'j'
+    { 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12 },  // 'k'
+    { 0x0c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e },  // 'l'
+    { 0x00, 0x00, 0x1a, 0x15, 0x15, 0x11, 0x11 },  // 'm'
+    { 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11 },  // 'n'
+    { 0x00, 0x00, 0x0e, 0x11, 0x11, 0x11, 0x0e },  // 'o'
+    { 0x00, 0x00, 0x1e, 0x11, 0x1e, 0x10, 0x10 },  // 'p'
+    { 0x00, 0x00, 0x0d, 0x13, 0x0f, 0x01, 0x01 },  // 'q'
+    { 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10 },  // 'r'
+    { 0x00, 0x00, 0x0e, 0x10, 0x0e, 0x01, 0x1e },  // 's'
+    { 0x08, 0x08, 0x1c, 0x08, 0x08, 0x09, 0x06 },  // 't'
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0d },  // 'u'
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x0a, 0x04 },  // 'v'
+    { 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0a },  // 'w'
+    { 0x00, 0x00, 0x11, 0x0a, 0x04, 0x0a, 0x11 },  // 'x'
+    { 0x00, 0x00, 0x11, 0x11, 0x0f, 0x01, 0x0e },  // 'y'
+    { 0x00, 0x00, 0x1f, 0x02, 0x04, 0x08, 0x1f },  // 'z'
+    { 0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02 },  // '{'
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },  // '|'
+    { 0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08 },  // '}'
+    { 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00 },  // '~'
+};
+
+// Returns the rows of a glyph; anything outside printable ASCII draws as '?'
+static inline const uint8_t *
+font_glyph(unsigned char c)
+{
+    if (c < FONT_FIRST_CHAR || c > FONT_LAST_CHAR) {
+        c = '?';
+    }
+    return font_glyphs[c - FONT_FIRST_CHAR];
+}
+
+static inline int
+font_text_width(const char *text, int scale)
+{
+    return (int)strlen(text) * FONT_ADVANCE * scale;
+}
+
+/*******************************************
+ * font_draw_text:
+ * - Draws `text` with its top-left corner at (x, y) into an XRGB8888
+ *   buffer of `width` x `height` pixels and `stride` bytes per row.
+ * - Only the foreground is written; pixels are clipped to the buffer and
+ *   to the optional `clip` rectangle (x, y, width, height), which lets
+ *   callers redraw a damaged band without touching anything else.
+ *******************************************/
+static void
+font_draw_text(uint32_t *pixels, int width, int height, int stride,
+               const int32_t clip[4], int x, int y, int scale,
+               uint32_t color, const char *text)
+{
+    int x0 = 0, y0 = 0, x1 = width, y1 = height;
+    if (clip) {
+        x0 = clip[0] > 0 ? clip[0] : 0;
+        y0 = clip[1] > 0 ? clip[1] : 0;
+        x1 = clip[0] + clip[2] < width ? clip[0] + clip[2] : width;
+        y1 = clip[1] + clip[3] < height ? clip[1] + clip[3] : height;
+    }
+
+    for (; *text; ++text, x += FONT_ADVANCE * scale) {
+        if (x >= x1 || x + FONT_GLYPH_WIDTH * scale <= x0) {
+            continue;
+        }
+        const uint8_t *rows = font_glyph((unsigned char)*text);
+        for (int gy = 0; gy < FONT_GLYPH_HEIGHT * scale; ++gy) {
+            int py = y + gy;
+            if (py < y0 || py >= y1) {
+                continue;
+            }
+            uint32_t *row = (uint32_t *)((uint8_t *)pixels + (size_t)py * stride);
+            uint8_t bits = rows[gy / scale];
+            for (int gx = 0; gx < FONT_GLYPH_WIDTH * scale; ++gx) {
+                int px = x + gx;
+                if (px >= x0 && px < x1 && (bits & (0x10 >> (gx / scale)))) {
+                    row[px] = color;
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef MYWAYLAND_HITTEST_H
+#define MYWAYLAND_HITTEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************
+ * @POINTER HIT-TESTING
+ *******************************************
+ *
+ * Finds the region under the pointer without looking at every region.
+ * At pointer rates of 1-8 kHz a linear scan over a few hundred widgets
+ * costs more than the rest of the event handling.
+ *
+ * - Regions are rectangles with dense ids; a higher id is on top.
+ * - The surface is cut into HIT_CELL_SIZE square cells, and every cell
+ *   lists the ids of the regions overlapping it, highest first. A lookup
+ *   reads one cell and stops at the first region that contains the
+ *   point, so its cost is set by how crowded that cell is, not by the
+ *   region count.
+ * - hit_index_move() updates only the cells a region leaves and enters;
+ *   nothing is rebuilt when one widget moves or resizes. A new surface
+ *   size (hit_index_resize) re-bins everything.
+ * - hit_index_lookup_linear() is the scan it replaces, kept as the
+ *   reference and benchmark baseline.
+ * - `lookups` and `tests` (regions examined) are counted for reports.
+ *******************************************/
+#define HIT_CELL_SIZE 32
+
+struct hit_region {
+    int32_t x, y, width, height;     // Empty when removed
+};
+
+struct hit_cell {
+    uint32_t *ids;                   // Descending
+    uint32_t count, capacity;
+};
+
+struct hit_index {
+    int32_t width, height;
+    int columns, rows;
+    struct hit_cell *cells;
+    struct hit_region *regions;
+    int count, capacity;
+    uint64_t lookups, tests;
+};
+
+static inline bool
+hit_region_contains(const struct hit_region *region, int32_t x, int32_t y)
+{
+    return x >= region->x && y >= region->y
+        && x < region->x + region->width && y < region->y + region->height;
+}
+
+// Cells a region overlaps, false if none
+static inline bool
+hit_region_cells(const struct hit_index *index, const struct hit_region *region,
+                 int *c0, int *r0, int *c1, int *r1)
+{
+    int32_t x0 = region->x > 0 ? region->x : 0, y0 = region->y > 0 ? region->y : 0;
+    int32_t x1 = region->x + region->width < index->width ? region->x + region->width : index->width;
+    int32_t y1 = region->y + region->height < index->height ? region->y + region->height : index->height;
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+    *c0 = x0 / HIT_CELL_SIZE;
+    *r0 = y0 / HIT_CELL_SIZE;
+    *c1 = (x1 - 1) / HIT_CELL_SIZE;
+    *r1 = (y1 - 1) / HIT_CELL_SIZE;
+    return true;
+}
+
+static bool
+hit_cell_insert(struct hit_cell *cell, uint32_t id)
+{
+    if (cell->count == cell->capacity) {
+        uint32_t capacity = cell->capacity ? cell->capacity * 2 : 4;
+        uint32_t *ids = realloc(cell->ids, capacity * sizeof(*ids));
+        if (!ids) {
+            return false;
+        }
+        cell->ids = ids;
+        cell->capacity = capacity;
+    }
+    uint32_t at = 0;
+    while (at < cell->count && cell->ids[at] > id) {
+        ++at;
+    }
+    memmove(&cell->ids[at + 1], &cell->ids[at], (cell->count - at) * sizeof(*cell->ids));
+    cell->ids[at] = id;
+    ++cell->count;
+    return true;
+}
+
+static void
+hit_cell_remove(struct hit_cell *cell, uint32_t id)
+{
+    for (uint32_t i = 0; i < cell->count; ++i) {
+        if (cell->ids[i] == id) {
+            memmove(&cell->ids[i], &cell->ids[i + 1], (cell->count - i - 1) * sizeof(*cell->ids));
+            --cell->count;
+            return;
+        }
+    }
+}
+
+static bool
+hit_index_bin(struct hit_index *index, uint32_t id)
+{
+    int c0, r0, c1, r1;
+    if (!hit_region_cells(index, &index->regions[id], &c0, &r0, &c1, &r1)) {
+        return true;
+    }
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            if (!hit_cell_insert(&index->cells[r * index->columns + c], id)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void
+hit_index_free(struct hit_index *index)
+{
+    for (int i = 0; i < index->columns * index->rows; ++i) {
+        free(index->cells[i].ids);
+    }
+    free(index->cells);
+    free(index->regions);
+    *index = (struct hit_index){0};
+}
+
+// Re-bins every region for a `width` x `height` surface
+static bool
+hit_index_resize(struct hit_index *index, int32_t width, int32_t height)
+{
+    for (int i = 0; i < index->columns * index->rows; ++i) {
+        free(index->cells[i].ids);
+    }
+    free(index->cells);
+    index->width = width;
+    index->height = height;
+    index->columns = (width + HIT_CELL_SIZE - 1) / HIT_CELL_SIZE;
+    index->rows = (height + HIT_CELL_SIZE - 1) / HIT_CELL_SIZE;
+    index->cells = calloc((size_t)index->columns * index->rows, sizeof(*index->cells));
+    if (!index->cells) {
+        index->columns = index->rows = 0;
+        return false;
+    }
+    for (int id = 0; id < index->count; ++id) {
+        if (!hit_index_bin(index, id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+hit_index_init(struct hit_index *index, int32_t width, int32_t height)
+{
+    *index = (struct hit_index){0};
+    return hit_index_resize(index, width, height);
+}
+
+// Adds a region on top of all others; returns its id, or -1
+static int
+hit_index_add(struct hit_index *index, int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    if (index->count == index->capacity) {
+        int capacity = index->capacity ? index->capacity * 2 : 64;
+        struct hit_region *regions = realloc(index->regions, capacity * sizeof(*regions));
+        if (!regions) {
+            return -1;
+        }
+        index->regions = regions;
+        index->capacity = capacity;
+    }
+    int id = index->count++;
+    index->regions[id] = (struct hit_region){ x, y, width, height };
+    return hit_index_bin(index, id) ? id : -1;
+}
+
+static inline bool
+hit_cells_contain(bool any, int c0, int r0, int c1, int r1, int c, int r)
+{
+    return any && c >= c0 && c <= c1 && r >= r0 && r <= r1;
+}
+
+// Moves or resizes region `id`; a 0 x 0 size removes it from lookups.
+// Cells covered before and after keep their entry untouched.
+static bool
+hit_index_move(struct hit_index *index, int id, int32_t x, int32_t y,
+               int32_t width, int32_t height)
+{
+    struct hit_region *region = &index->regions[id];
+    if (region->x == x && region->y == y && region->width == width && region->height == height) {
+        return true;
+    }
+    int old_c0, old_r0, old_c1, old_r1, new_c0, new_r0, new_c1, new_r1;
+    bool had = hit_region_cells(index, region, &old_c0, &old_r0, &old_c1, &old_r1);
+    *region = (struct hit_region){ x, y, width, height };
+    bool has = hit_region_cells(index, region, &new_c0, &new_r0, &new_c1, &new_r1);
+
+    // Cells it leaves
+    for (int r = old_r0; had && r <= old_r1; ++r) {
+        for (int c = old_c0; c <= old_c1; ++c) {
+            if (!hit_cells_contain(has, new_c0, new_r0, new_c1, new_r1, c, r)) {
+                hit_cell_remove(&index->cells[r * index->columns + c], id);
+            }
+        }
+    }
+    // Cells it enters
+    for (int r = new_r0; has && r <= new_r1; ++r) {
+        for (int c = new_c0; c <= new_c1; ++c) {
+            if (!hit_cells_contain(had, old_c0, old_r0, old_c1, old_r1, c, r) &&
+                    !hit_cell_insert(&index->cells[r * index->columns + c], id)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Topmost region containing (x, y), or -1
+static inline int
+hit_index_lookup(struct hit_index *index, int32_t x, int32_t y)
+{
+    ++index->lookups;
+    if (x < 0 || y < 0 || x >= index->width || y >= index->height) {
+        return -1;
+    }
+    const struct hit_cell *cell = &index->cells[y / HIT_CELL_SIZE * index->columns + x / HIT_CELL_SIZE];
+    for (uint32_t i = 0; i < cell->count; ++i) {
+        ++index->tests;
+        if (hit_region_contains(&index->regions[cell->ids[i]], x, y)) {
+            return cell->ids[i];
+        }
+    }
+    return -1;
+}
+
+static inline int
+hit_index_lookup_linear(struct hit_index *index, int32_t x, int32_t y)
+{
+    ++index->lookups;
+    if (x < 0 || y < 0 || x >= index->width || y >= index->height) {
+        return -1;
+    }
+    for (int id = index->count - 1; id >= 0; --id) {
+        ++index->tests;
+        if (hit_region_contains(&index->regions[id], x, y)) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef MYWAYLAND_INPUT_H
+#define MYWAYLAND_INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+/*******************************************
+ * @SEAT DEVICES BY CAPABILITY
+ *******************************************
+ *
+ * A client says which input classes it consumes and gets seat devices for
+ * exactly those. A wl_pointer or wl_touch that nobody listens to still has
+ * every event routed, marshalled and woken up for; libwayland only drops
+ * them after they were read.
+ *
+ * - `wanted` holds WL_SEAT_CAPABILITY_* bits. input_seat_capabilities()
+ *   (from wl_seat.capabilities) and input_seat_want() reconcile the
+ *   devices with wanted & present: missing ones are acquired with the
+ *   client's listener, surplus ones are given back with
+ *   wl_*_release (seat v3+; destroy on older seats, which leaves the
+ *   compositor side alive until disconnect).
+ * - A wanted class without a listener gets a counting dispatcher instead:
+ *   every event is counted and dropped, like an unlistened device used to
+ *   be. That is how a client measures what it is spared.
+ * - Clients count their own events with input_seat_event();
+ *   input_seat_report() prints the per-class totals.
+ *
+ * Bind wl_seat at version 3 or later (min with what the compositor has)
+ * so devices can be released.
+ *******************************************/
+#define INPUT_CLASSES 3                  // Pointer, keyboard, touch
+
+static const char *const input_class_names[INPUT_CLASSES] = { "pointer", "keyboard", "touch" };
+
+struct input_seat {
+    struct wl_seat *seat;
+    uint32_t wanted;                     // WL_SEAT_CAPABILITY_* the client consumes
+    uint32_t present;                    // From the last wl_seat.capabilities
+    struct wl_pointer *pointer;
+    struct wl_keyboard *keyboard;
+    struct wl_touch *touch;
+    const struct wl_pointer_listener *pointer_listener;
+    const struct wl_keyboard_listener *keyboard_listener;
+    const struct wl_touch_listener *touch_listener;
+    void *data;
+
+    uint64_t events[INPUT_CLASSES];
+    uint64_t dropped[INPUT_CLASSES];     // Counted by the dispatcher, never handled
+    uint64_t acquires, releases;
+};
+
+// WL_SEAT_CAPABILITY_POINTER/KEYBOARD/TOUCH are 1, 2, 4
+static inline int
+input_class_index(uint32_t capability)
+{
+    return __builtin_ctz(capability);
+}
+
+static inline void
+input_seat_event(struct input_seat *input, uint32_t capability)
+{
+    ++input->events[input_class_index(capability)];
+}
+
+// Counts and drops an event; `implementation` is the class's counter
+static int
+input_count_dispatcher(const void *implementation, void *target, uint32_t opcode,
+                       const struct wl_message *message, union wl_argument *args)
+{
+    ++*(uint64_t *)implementation;
+    // Whoever would have handled it would have owned its fds (wl_keyboard.keymap)
+    int arg = 0;
+    for (const char *s = message->signature; *s; ++s) {
+        if (*s == '?' || (*s >= '0' && *s <= '9')) {
+            continue;
+        }
+        if (*s == 'h') {
+            close(args[arg].h);
+        }
+        ++arg;
+    }
+    return 0;
+}
+
+static void
+input_seat_init(struct input_seat *input, struct wl_seat *seat, uint32_t wanted,
+                const struct wl_pointer_listener *pointer_listener,
+                const struct wl_keyboard_listener *keyboard_listener,
+                const struct wl_touch_listener *touch_listener, void *data)
+{
+    *input = (struct input_seat){
+        .seat = seat, .wanted = wanted,
+        .pointer_listener = pointer_listener, .keyboard_listener = keyboard_listener,
+        .touch_listener = touch_listener, .data = data,
+    };
+}
+
+static void
+input_seat_listen(struct input_seat *input, struct wl_proxy *device, uint32_t capability,
+                  const void *listener)
+{
+    if (listener) {
+        wl_proxy_add_listener(device, (void (**)(void))listener, input->data);
+    } else {
+        wl_proxy_add_dispatcher(device, input_count_dispatcher,
+                                &input->dropped[input_class_index(capability)], input);
+    }
+    ++input->acquires;
+}
+
+static void
+input_seat_reconcile(struct input_seat *input)
+{
+    uint32_t use = input->wanted & input->present;
+
+    if ((use & WL_SEAT_CAPABILITY_POINTER) && !input->pointer) {
+        input->pointer = wl_seat_get_pointer(input->seat);
+        input_seat_listen(input, (struct wl_proxy *)input->pointer,
+                          WL_SEAT_CAPABILITY_POINTER, input->pointer_listener);
+    } else if (!(use & WL_SEAT_CAPABILITY_POINTER) && input->pointer) {
+        if (wl_pointer_get_version(input->pointer) >= WL_POINTER_RELEASE_SINCE_VERSION) {
+            wl_pointer_release(input->pointer);
+        } else {
+            wl_pointer_destroy(input->pointer);
+        }
+        input->pointer = NULL;
+        ++input->releases;
+    }
+
+    if ((use & WL_SEAT_CAPABILITY_KEYBOARD) && !input->keyboard) {
+        input->keyboard = wl_seat_get_keyboard(input->seat);
+        input_seat_listen(input, (struct wl_proxy *)input->keyboard,
+                          WL_SEAT_CAPABILITY_KEYBOARD, input->keyboard_listener);
+    } else if (!(use & WL_SEAT_CAPABILITY_KEYBOARD) && input->keyboard) {
+        if (wl_keyboard_get_version(input->keyboard) >= WL_KEYBOARD_RELEASE_SINCE_VERSION) {
+            wl_keyboard_release(input->keyboard);
+        } else {
+            wl_keyboard_destroy(input->keyboard);
+        }
+        input->keyboard = NULL;
+        ++input->releases;
+    }
+
+    if ((use & WL_SEAT_CAPABILITY_TOUCH) && !input->touch) {
+        input->touch = wl_seat_get_touch(input->seat);
+        input_seat_listen(input, (struct wl_proxy *)input->touch,
+                          WL_SEAT_CAPABILITY_TOUCH, input->touch_listener);
+    } else if (!(use & WL_SEAT_CAPABILITY_TOUCH) && input->touch) {
+        if (wl_touch_get_version(input->touch) >= WL_TOUCH_RELEASE_SINCE_VERSION) {
+            wl_touch_release(input->touch);
+        } else {
+            wl_touch_destroy(input->touch);
+        }
+        input->touch = NULL;
+        ++input->releases;
+    }
+}
+
+static void
+input_seat_capabilities(struct input_seat *input, uint32_t capabilities)
+{
+    input->present = capabilities;
+    input_seat_reconcile(input);
+}
+
+// The client's needs changed, e.g. the only pointer-driven surface closed
+static void
+input_seat_want(struct input_seat *input, uint32_t wanted)
+{
+    input->wanted = wanted;
+    input_seat_reconcile(input);
+}
+
+static void
+input_seat_finish(struct input_seat *input)
+{
+    input_seat_want(input, 0);
+}
+
+/*******************************************
+ * input_surface_region:
+ * - Limits where `surface` takes pointer and touch input to `count`
+ *   rects (x, y, width, height); none gives an empty region. Outside it
+ *   the compositor hands input to whatever is below instead of waking us.
+ * - Applied with the surface's next commit.
+ *******************************************/
+static void
+input_surface_region(struct wl_compositor *compositor, struct wl_surface *surface,
+                     const int32_t (*rects)[4], int count)
+{
+    struct wl_region *region = wl_compositor_create_region(compositor);
+    for (int i = 0; i < count; ++i) {
+        wl_region_add(region, rects[i][0], rects[i][1], rects[i][2], rects[i][3]);
+    }
+    wl_surface_set_input_region(surface, region);
+    wl_region_destroy(region);
+}
+
+static void
+input_seat_report(const struct input_seat *input, const char *label)
+{
+    fprintf(stderr, "[INPUT] %s: %llu devices acquired, %llu released;", label,
+            (unsigned long long)input->acquires, (unsigned long long)input->releases);
+    for (int i = 0; i < INPUT_CLASSES; ++i) {
+        uint32_t capability = 1u << i;
+        if (!(input->wanted & capability) && !input->events[i] && !input->dropped[i]) {
+            fprintf(stderr, " %s not subscribed%s", input_class_names[i],
+                    i + 1 < INPUT_CLASSES ? "," : "\n");
+            continue;
+        }
+        fprintf(stderr, " %s %llu handled, %llu unused%s", input_class_names[i],
+                (unsigned long long)input->events[i], (unsigned long long)input->dropped[i],
+                i + 1 < INPUT_CLASSES ? "," : "\n");
+    }
+}
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef MYWAYLAND_LAYOUT_H
+#define MYWAYLAND_LAYOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+/*******************************************
+ * @INCREMENTAL LAYOUT
+ *******************************************
+ *
+ * A lock screen is a handful of elements (clock, date, password field,
+ * status line) of which at most one changes at a time. Redrawing and
+ * re-laying-out everything for a ticking clock wastes CPU and, worse, makes
+ * the compositor recomposite the whole output. This is a tiny retained
+ * layout tree that does only the work a change requires.
+ *
+ * - Nodes are leaves (measured by a callback) or containers that stack
+ *   their children in a column or a row, centred within their own rect.
+ * - layout_mark_dirty() flags a node and sets LAYOUT_DIRTY_CHILDREN on its
+ *   ancestors, stopping at the first one already flagged. Clean subtrees
+ *   are never visited.
+ * - layout_update() re-measures only flagged nodes, re-arranges only
+ *   containers with a flagged descendant, and records damage:
+ *     - a leaf whose content changed but whose size did not damages only
+ *       its own rect;
+ *     - a node that moved or resized damages its old and new rect, which
+ *       covers its whole subtree.
+ * - The resulting rectangles (surface coordinates, top-left origin) are
+ *   handed to whichever renderer is in use: partial redraw for wl_shm,
+ *   eglSwapBuffersWithDamage for GL.
+ * - Each update is timed; with nothing dirty it returns after one flag
+ *   test, so an idle lock screen costs effectively nothing.
+ *******************************************/
+
+#define LAYOUT_MAX_DAMAGE 8
+
+struct layout_rect {
+    int32_t x, y, width, height;
+};
+
+enum layout_kind {
+    LAYOUT_LEAF,
+    LAYOUT_COLUMN,
+    LAYOUT_ROW,
+};
+
+enum layout_dirty {
+    LAYOUT_DIRTY_CONTENT = 1 << 0,   // Leaf content changed, size may have too
+    LAYOUT_DIRTY_CHILDREN = 1 << 1,  // Some descendant is dirty
+};
+
+struct layout_node {
+    const char *name;
+    enum layout_kind kind;
+    struct layout_node *parent;
+    struct layout_node *first_child, *last_child, *next_sibling;
+    int32_t spacing;                 // Gap between children of a container
+    int32_t min_width, min_height;   // Lets a field keep its size as content changes
+
+    // Leaves report their content size here
+    void (*measure)(struct layout_node *node, int32_t *width, int32_t *height);
+    void *data;
+
+    int32_t measured_width, measured_height;
+    struct layout_rect rect;         // Position after the last layout_update()
+    uint32_t dirty;                  // enum layout_dirty
+};
+
+struct layout_damage {
+    struct layout_rect rects[LAYOUT_MAX_DAMAGE];
+    int count;
+    bool full;                       // Whole surface, e.g. after a resize
+};
+
+struct layout_stats {
+    uint64_t updates;                // layout_update() calls
+    uint64_t idle_updates;           // ... that found nothing to do
+    uint64_t nodes_visited;
+    double total_us, idle_us, max_us;
+};
+
+struct layout_tree {
+    struct layout_node *root;
+    int32_t width, height;
+    bool needs_full;
+    struct layout_damage damage;     // Output of the last layout_update()
+    struct layout_stats stats;
+};
+
+static void
+layout_append(struct layout_node *parent, struct layout_node *child)
+{
+    child->parent = parent;
+    child->next_sibling = NULL;
+    if (parent->last_child) {
+        parent->last_child->next_sibling = child;
+    } else {
+        parent->first_child = child;
+    }
+    parent->last_child = child;
+    child->dirty |= LAYOUT_DIRTY_CONTENT;
+}
+
+static void
+layout_mark_dirty(struct layout_node *node)
+{
+    node->dirty |= LAYOUT_DIRTY_CONTENT;
+    for (struct layout_node *p = node->parent; p && !(p->dirty & LAYOUT_DIRTY_CHILDREN); p = p->parent) {
+        p->dirty |= LAYOUT_DIRTY_CHILDREN;
+    }
+}
+
+static void
+layout_resize(struct layout_tree *tree, int32_t width, int32_t height)
+{
+    if (tree->width != width || tree->height != height) {
+        tree->width = width;
+        tree->height = height;
+        tree->needs_full = true;
+    }
+}
+
+static inline bool
+layout_rect_equal(const struct layout_rect *a, const struct layout_rect *b)
+{
+    return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+}
+
+static inline bool
+layout_rect_touch(const struct layout_rect *a, const struct layout_rect *b)
+{
+    return a->x <= b->x + b->width && b->x <= a->x + a->width &&
+           a->y <= b->y + b->height && b->y <= a->y + a->height;
+}
+
+static inline struct layout_rect
+layout_rect_union(const struct layout_rect *a, const struct layout_rect *b)
+{
+    int32_t x0 = a->x < b->x ? a->x : b->x;
+    int32_t y0 = a->y < b->y ? a->y : b->y;
+    int32_t x1 = a->x + a->width > b->x + b->width ? a->x + a->width : b->x + b->width;
+    int32_t y1 = a->y + a->height > b->y + b->height ? a->y + a->height : b->y + b->height;
+    return (struct layout_rect){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+// Adds a rectangle, merging it into an existing one it touches
+static void
+layout_damage_add(struct layout_damage *damage, struct layout_rect rect)
+{
+    if (rect.width <= 0 || rect.height <= 0 || damage->full) {
+        return;
+    }
+    for (int i = 0; i < damage->count; ++i) {
+        if (layout_rect_touch(&damage->rects[i], &rect)) {
+            rect = layout_rect_union(&damage->rects[i], &rect);
+            damage->rects[i] = damage->rects[--damage->count];
+            i = -1;  // The grown rect may now touch others
+        }
+    }
+    if (damage->count == LAYOUT_MAX_DAMAGE) {
+        // Out of slots: fold everything into one bounding box
+        for (int i = 1; i < damage->count; ++i) {
+            damage->rects[0] = layout_rect_union(&damage->rects[0], &damage->rects[i]);
+        }
+        damage->rects[0] = layout_rect_union(&damage->rects[0], &rect);
+        damage->count = 1;
+        return;
+    }
+    damage->rects[damage->count++] = rect;
+}
+
+// Bottom-up size computation, skipping subtrees that are not dirty
+static void
+layout_measure(struct layout_tree *tree, struct layout_node *node, bool force)
+{
+    if (!force && !node->dirty) {
+        return;
+    }
+    ++tree->stats.nodes_visited;
+
+    int32_t width = 0, height = 0;
+    if (node->kind == LAYOUT_LEAF) {
+        if (node->measure) {
+            node->measure(node, &width, &height);
+        }
+    } else {
+        int children = 0;
+        for (struct layout_node *c = node->first_child; c; c = c->next_sibling, ++children) {
+            layout_measure(tree, c, force);
+            if (node->kind == LAYOUT_COLUMN) {
+                width = c->measured_width > width ? c->measured_width : width;
+                height += c->measured_height;
+            } else {
+                width += c->measured_width;
+                height = c->measured_height > height ? c->measured_height : height;
+            }
+        }
+        if (children > 1) {
+            if (node->kind == LAYOUT_COLUMN) {
+                height += node->spacing * (children - 1);
+            } else {
+                width += node->spacing * (children - 1);
+            }
+        }
+    }
+    node->measured_width = width > node->min_width ? width : node->min_width;
+    node->measured_height = height > node->min_height ? height : node->min_height;
+}
+
+/*******************************************
+ * Top-down placement:
+ * - `covered` is true when an ancestor already damaged an area containing
+ *   this whole subtree, so no further rectangles are needed below it.
+ *******************************************/
+static void
+layout_arrange(struct layout_tree *tree, struct layout_node *node,
+               struct layout_rect rect, bool force, bool covered)
+{
+    bool moved = !layout_rect_equal(&rect, &node->rect);
+    if (!force && !moved && !node->dirty) {
+        return;
+    }
+    ++tree->stats.nodes_visited;
+
+    if (!covered) {
+        if (moved) {
+            layout_damage_add(&tree->damage, node->rect);
+            layout_damage_add(&tree->damage, rect);
+            covered = true;
+        } else if (node->dirty & LAYOUT_DIRTY_CONTENT) {
+            layout_damage_add(&tree->damage, rect);
+            covered = true;
+        }
+    }
+    node->rect = rect;
+
+    if (node->kind != LAYOUT_LEAF) {
+        // Centre the stacked children within our rect
+        int32_t cursor;
+        if (node->kind == LAYOUT_COLUMN) {
+            cursor = rect.y + (rect.height - node->measured_height) / 2;
+        } else {
+            cursor = rect.x + (rect.width - node->measured_width) / 2;
+        }
+
+        for (struct layout_node *c = node->first_child; c; c = c->next_sibling) {
+            struct layout_rect child;
+            if (node->kind == LAYOUT_COLUMN) {
+                child = (struct layout_rect){
+                    rect.x + (rect.width - c->measured_width) / 2, cursor,
+                    c->measured_width, c->measured_height,
+                };
+                cursor += c->measured_height + node->spacing;
+            } else {
+                child = (struct layout_rect){
+                    cursor, rect.y + (rect.height - c->measured_height) / 2,
+                    c->measured_width, c->measured_height,
+                };
+                cursor += c->measured_width + node->spacing;
+            }
+            layout_arrange(tree, c, child, force, covered);
+        }
+    }
+    node->dirty = 0;
+}
+
+/*******************************************
+ * layout_update:
+ * - Brings every rect up to date and leaves the damaged areas in
+ *   tree->damage (count == 0 means nothing needs repainting).
+ *******************************************/
+static void
+layout_update(struct layout_tree *tree)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    tree->damage.count = 0;
+    tree->damage.full = false;
+    bool idle = !tree->needs_full && !tree->root->dirty;
+
+    if (!idle) {
+        bool force = tree->needs_full;
+        layout_measure(tree, tree->root, force);
+        struct layout_rect surface = { 0, 0, tree->width, tree->height };
+        layout_arrange(tree, tree->root, surface, force, force);
+        if (force) {
+            tree->damage.rects[0] = surface;
+            tree->damage.count = 1;
+            tree->damage.full = true;
+        }
+        tree->needs_full = false;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double us = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+    ++tree->stats.updates;
+    tree->stats.total_us += us;
+    if (idle) {
+        ++tree->stats.idle_updates;
+        tree->stats.idle_us += us;
+    }
+    if (us > tree->stats.max_us) {
+        tree->stats.max_us = us;
+    }
+}
+
+#endif
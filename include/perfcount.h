@@ -0,0 +1,241 @@
+#ifndef MYWAYLAND_PERFCOUNT_H
+#define MYWAYLAND_PERFCOUNT_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+/*******************************************
+ * @PER-PHASE PERFORMANCE COUNTERS
+ *******************************************
+ *
+ * CPU counters around the phases of a frame, so a slow frame can be told
+ * apart as compute bound (many instructions, high IPC), memory bound (low
+ * IPC, cache misses), faulting in fresh pages or being descheduled.
+ *
+ * - Every phase owns one perf_event_open group on the thread that runs
+ *   it: cycles, instructions, cache misses, task clock, page faults and
+ *   context switches. perf_phase_begin()/perf_phase_end() each do a
+ *   single read() of the whole group, so the counters cover exactly the
+ *   same instructions.
+ * - Counters that can't be opened are left out: in VMs and containers
+ *   there is often no PMU, and perf_event_paranoid may rule out kernel
+ *   counting (events are then retried user-space only). Without hardware
+ *   events the group degrades to the software ones (task clock, faults,
+ *   context switches), which the kernel always has. Without
+ *   perf_event_open at all the phases do nothing.
+ * - If the kernel multiplexes the PMU, values are scaled by
+ *   enabled / running time, as perf stat does.
+ * - Groups count the calling thread only: open a phase on the thread
+ *   that will run it.
+ *******************************************/
+enum perf_counter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_TASK_CLOCK,                 // ns on CPU
+    PERF_PAGE_FAULTS,
+    PERF_CONTEXT_SWITCHES,
+    PERF_COUNTERS,
+};
+
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} perf_counter_events[PERF_COUNTERS] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "task-clock-ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+struct perf_phase {
+    const char *name;
+    bool counting;                   // Zeroed (never opened) or nothing opened: inert
+    int leader;
+    int fds[PERF_COUNTERS];
+    uint64_t ids[PERF_COUNTERS];
+    bool open[PERF_COUNTERS];
+    int open_errno;                  // Why the first hardware event failed, 0 if none did
+    uint64_t start[PERF_COUNTERS];
+    uint64_t start_enabled, start_running;
+    bool started;
+
+    uint64_t samples;
+    double totals[PERF_COUNTERS];
+};
+
+static int
+perf_event_open_counter(int counter, int group_fd, bool exclude_kernel)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_counter_events[counter].type;
+    attr.config = perf_counter_events[counter].config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID
+                     | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = group_fd < 0;    // The leader starts the group
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+/*******************************************
+ * perf_phase_open:
+ * - Opens the group on the calling thread. Returns false if nothing could
+ *   be opened; the phase then stays inert.
+ *******************************************/
+static bool
+perf_phase_open(struct perf_phase *phase, const char *name)
+{
+    memset(phase, 0, sizeof(*phase));
+    phase->name = name;
+    phase->leader = -1;
+    for (int i = 0; i < PERF_COUNTERS; ++i) {
+        phase->fds[i] = -1;
+        int fd = perf_event_open_counter(i, phase->leader, false);
+        if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+            fd = perf_event_open_counter(i, phase->leader, true);
+        }
+        if (fd < 0) {
+            if (perf_counter_events[i].type == PERF_TYPE_HARDWARE && !phase->open_errno) {
+                phase->open_errno = errno;
+            }
+            continue;
+        }
+        if (ioctl(fd, PERF_EVENT_IOC_ID, &phase->ids[i]) < 0) {
+            close(fd);
+            continue;
+        }
+        phase->fds[i] = fd;
+        phase->open[i] = true;
+        if (phase->leader < 0) {
+            phase->leader = fd;
+        }
+    }
+    if (phase->leader < 0) {
+        return false;
+    }
+    ioctl(phase->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(phase->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    phase->counting = true;
+    return true;
+}
+
+static void
+perf_phase_close(struct perf_phase *phase)
+{
+    for (int i = 0; i < PERF_COUNTERS; ++i) {
+        if (phase->fds[i] >= 0) {
+            close(phase->fds[i]);
+            phase->fds[i] = -1;
+        }
+    }
+    phase->leader = -1;
+    phase->counting = false;
+}
+
+// One read of the whole group into `values`, by counter
+static bool
+perf_phase_read(const struct perf_phase *phase, uint64_t values[PERF_COUNTERS],
+                uint64_t *enabled, uint64_t *running)
+{
+    struct {
+        uint64_t nr, time_enabled, time_running;
+        struct { uint64_t value, id; } values[PERF_COUNTERS];
+    } data;
+    if (read(phase->leader, &data, sizeof(data)) < (ssize_t)(3 * sizeof(uint64_t))) {
+        return false;
+    }
+    for (uint64_t n = 0; n < data.nr && n < PERF_COUNTERS; ++n) {
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            if (phase->open[i] && phase->ids[i] == data.values[n].id) {
+                values[i] = data.values[n].value;
+            }
+        }
+    }
+    *enabled = data.time_enabled;
+    *running = data.time_running;
+    return true;
+}
+
+static inline void
+perf_phase_begin(struct perf_phase *phase)
+{
+    if (phase->counting) {
+        phase->started = perf_phase_read(phase, phase->start, &phase->start_enabled,
+                                         &phase->start_running);
+    }
+}
+
+static inline void
+perf_phase_end(struct perf_phase *phase)
+{
+    if (!phase->counting || !phase->started) {
+        return;
+    }
+    phase->started = false;
+    uint64_t values[PERF_COUNTERS] = {0}, enabled, running;
+    if (!perf_phase_read(phase, values, &enabled, &running)) {
+        return;
+    }
+    uint64_t d_enabled = enabled - phase->start_enabled, d_running = running - phase->start_running;
+    double scale = d_running > 0 && d_running < d_enabled ? (double)d_enabled / d_running : 1.0;
+    for (int i = 0; i < PERF_COUNTERS; ++i) {
+        if (phase->open[i]) {
+            phase->totals[i] += (values[i] - phase->start[i]) * scale;
+        }
+    }
+    ++phase->samples;
+}
+
+/*******************************************
+ * perf_phase_report:
+ * - Per-sample averages of every open counter, with IPC and cache misses
+ *   per 1000 instructions when both are there.
+ *******************************************/
+static void
+perf_phase_report(const struct perf_phase *phase, const char *label)
+{
+    if (!phase->samples) {
+        if (phase->name && !phase->counting) {
+            fprintf(stderr, "[PERF] %s %s: no counters (perf_event_open unavailable)\n",
+                    label, phase->name);
+        }
+        return;
+    }
+    fprintf(stderr, "[PERF] %s %s: %llu samples, per sample:", label, phase->name,
+            (unsigned long long)phase->samples);
+    for (int i = 0; i < PERF_COUNTERS; ++i) {
+        if (phase->open[i]) {
+            fprintf(stderr, " %s %.0f", perf_counter_events[i].name, phase->totals[i] / phase->samples);
+        }
+    }
+    if (phase->open[PERF_CYCLES] && phase->open[PERF_INSTRUCTIONS] && phase->totals[PERF_CYCLES] > 0) {
+        fprintf(stderr, ", IPC %.2f", phase->totals[PERF_INSTRUCTIONS] / phase->totals[PERF_CYCLES]);
+    }
+    if (phase->open[PERF_CACHE_MISSES] && phase->open[PERF_INSTRUCTIONS]
+        && phase->totals[PERF_INSTRUCTIONS] > 0) {
+        fprintf(stderr, ", %.2f misses/1k instructions",
+                1000 * phase->totals[PERF_CACHE_MISSES] / phase->totals[PERF_INSTRUCTIONS]);
+    }
+    if (phase->open_errno) {
+        bool some = phase->open[PERF_CYCLES] || phase->open[PERF_INSTRUCTIONS]
+                 || phase->open[PERF_CACHE_MISSES];
+        fprintf(stderr, " (%s hardware counters: %s)", some ? "missing some" : "no",
+                strerror(phase->open_errno));
+    }
+    fprintf(stderr, "\n");
+}
+
+#endif
@@ -0,0 +1,480 @@
+#ifndef MYWAYLAND_POPUP_H
+#define MYWAYLAND_POPUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <wayland-client.h>
+#include "trace.h"
+#include "font.h"
+#include "shm.h"
+#include "input.h"
+
+/*******************************************
+ * @POP-UP MENUS
+ *******************************************
+ *
+ * xdg_popup menus with nothing to draw when they open. Include it after
+ * the xdg-shell protocol header.
+ *
+ * - popup_menu_init() rasterizes the menu once, ahead of time: one
+ *   wl_buffer with no item highlighted and one per highlighted item, all
+ *   in a single wl_shm_pool. Hovering only attaches another buffer.
+ * - POPUP_POOL wl_surface + xdg_surface pairs are created up front and
+ *   reused: closing a menu destroys only the xdg_popup role object and
+ *   unmaps the surface, which may take the same role again.
+ * - Opening is get_popup + grab + commit; the configure that follows is
+ *   answered with ack + attach + commit. No pixels are touched on the way.
+ * - A menu opened while one is showing is moved with
+ *   xdg_popup.reposition when xdg_wm_base is v3 or later, keeping its
+ *   surface, instead of being closed and opened again.
+ * - Click to visible is timed per open: from the button handler to the
+ *   commit, and to the frame callback of that commit, i.e. the first time
+ *   the compositor drew the popup.
+ *
+ * `cold` (--popup-cold) does it the straightforward way for comparison:
+ * a new surface pair per open, rasterized at its first configure, all
+ * destroyed at close.
+ *******************************************/
+#define POPUP_MAX_ITEMS 8
+#define POPUP_POOL 2
+#define POPUP_TEXT_SCALE 2
+#define POPUP_PADDING 8
+#define POPUP_ITEM_HEIGHT (FONT_LINE_HEIGHT * POPUP_TEXT_SCALE + POPUP_PADDING)
+
+#define POPUP_BACKGROUND  0xffe8e8e8u
+#define POPUP_HIGHLIGHT   0xff3465a4u
+#define POPUP_TEXT        0xff202020u
+#define POPUP_TEXT_ACTIVE 0xffffffffu
+#define POPUP_BORDER      0xff808080u
+
+// Called when an item was clicked; the menu is already closed
+typedef void (*popup_selected_fn)(void *data, int item);
+
+struct popup_slot {
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    bool in_use;
+};
+
+struct popup_menu {
+    struct wl_shm *shm;
+    struct wl_compositor *compositor;
+    struct xdg_wm_base *wm_base;
+    const char *items[POPUP_MAX_ITEMS];
+    int count;
+    int32_t width, height;
+    bool cold;
+    popup_selected_fn selected;
+    void *data;
+
+    // [0]: nothing highlighted, [1 + i]: item i highlighted
+    struct wl_buffer *buffers[POPUP_MAX_ITEMS + 1];
+    void *memory;
+    size_t size;
+    struct xdg_positioner *positioner;
+    struct popup_slot pool[POPUP_POOL];
+
+    // The menu on screen, if any
+    struct popup_slot *slot;
+    struct xdg_popup *popup;
+    int highlighted;                 // -1 for none
+    bool mapped;                     // A buffer is attached
+    bool timing;                     // Waiting for the first frame since the click
+    struct timespec clicked;
+    uint32_t reposition_token;
+
+    uint64_t opens, repositions, rasterizations, visible;
+    double prerender_ms;
+    double commit_ms_total, commit_ms_max;
+    double visible_ms_total, visible_ms_max;
+};
+
+static double
+popup_ms_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void
+popup_fill(uint32_t *pixels, int32_t stride_pixels, int32_t x, int32_t y,
+           int32_t width, int32_t height, uint32_t color)
+{
+    for (int32_t row = y; row < y + height; ++row) {
+        for (int32_t col = x; col < x + width; ++col) {
+            pixels[(size_t)row * stride_pixels + col] = color;
+        }
+    }
+}
+
+// Draws the menu with item `highlighted` (or none, for -1)
+static void
+popup_rasterize(const struct popup_menu *menu, uint32_t *pixels, int highlighted)
+{
+    int32_t w = menu->width, h = menu->height;
+    popup_fill(pixels, w, 0, 0, w, h, POPUP_BORDER);
+    popup_fill(pixels, w, 1, 1, w - 2, h - 2, POPUP_BACKGROUND);
+    for (int i = 0; i < menu->count; ++i) {
+        int32_t y = 1 + i * POPUP_ITEM_HEIGHT;
+        uint32_t color = POPUP_TEXT;
+        if (i == highlighted) {
+            popup_fill(pixels, w, 1, y, w - 2, POPUP_ITEM_HEIGHT, POPUP_HIGHLIGHT);
+            color = POPUP_TEXT_ACTIVE;
+        }
+        font_draw_text(pixels, w, h, w * 4, NULL, 1 + POPUP_PADDING,
+                       y + (POPUP_ITEM_HEIGHT - FONT_GLYPH_HEIGHT * POPUP_TEXT_SCALE) / 2,
+                       POPUP_TEXT_SCALE, color, menu->items[i]);
+    }
+}
+
+// Every variant of the menu, drawn into one pool
+static bool
+popup_prepare_buffers(struct popup_menu *menu)
+{
+    TRACE_BEGIN("render", "popup_rasterize");
+    int32_t stride = menu->width * 4;
+    size_t buffer_size = (size_t)stride * menu->height;
+    int variants = menu->count + 1;
+    menu->size = buffer_size * variants;
+    int fd = shm_allocate(menu->size);
+    if (fd < 0) {
+        TRACE_END("render", "popup_rasterize");
+        return false;
+    }
+    menu->memory = mmap(NULL, menu->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (menu->memory == MAP_FAILED) {
+        fprintf(stderr, "[POPUP] Failed to map %zu bytes\n", menu->size);
+        menu->memory = NULL;
+        close(fd);
+        TRACE_END("render", "popup_rasterize");
+        return false;
+    }
+    struct wl_shm_pool *pool = wl_shm_create_pool(menu->shm, fd, menu->size);
+    close(fd);
+    for (int v = 0; v < variants; ++v) {
+        popup_rasterize(menu, (uint32_t *)((uint8_t *)menu->memory + v * buffer_size), v - 1);
+        menu->buffers[v] = wl_shm_pool_create_buffer(pool, v * buffer_size, menu->width,
+                                                     menu->height, stride, WL_SHM_FORMAT_XRGB8888);
+    }
+    wl_shm_pool_destroy(pool);
+    ++menu->rasterizations;
+    TRACE_END("render", "popup_rasterize");
+    return true;
+}
+
+static void
+popup_free_buffers(struct popup_menu *menu)
+{
+    for (int v = 0; v <= menu->count; ++v) {
+        if (menu->buffers[v]) {
+            wl_buffer_destroy(menu->buffers[v]);
+            menu->buffers[v] = NULL;
+        }
+    }
+    if (menu->memory) {
+        munmap(menu->memory, menu->size);
+        menu->memory = NULL;
+    }
+}
+
+static const struct xdg_surface_listener popup_xdg_surface_listener;
+
+static void
+popup_slot_create(struct popup_menu *menu, struct popup_slot *slot)
+{
+    slot->surface = wl_compositor_create_surface(menu->compositor);
+    slot->xdg_surface = xdg_wm_base_get_xdg_surface(menu->wm_base, slot->surface);
+    xdg_surface_add_listener(slot->xdg_surface, &popup_xdg_surface_listener, menu);
+    // Only the items take the pointer, not the border
+    const int32_t items[1][4] = {{ 1, 1, menu->width - 2, menu->count * POPUP_ITEM_HEIGHT }};
+    input_surface_region(menu->compositor, slot->surface, items, 1);
+}
+
+static void
+popup_slot_destroy(struct popup_slot *slot)
+{
+    if (slot->xdg_surface) {
+        xdg_surface_destroy(slot->xdg_surface);
+        wl_surface_destroy(slot->surface);
+    }
+    *slot = (struct popup_slot){0};
+}
+
+/*******************************************
+ * popup_menu_init:
+ * - Sizes the menu for its longest label. Unless `cold`, rasterizes every
+ *   variant and creates the surface pool now, off the critical path.
+ *******************************************/
+static bool
+popup_menu_init(struct popup_menu *menu, struct wl_shm *shm, struct wl_compositor *compositor,
+                struct xdg_wm_base *wm_base, const char *const *items, int count, bool cold,
+                popup_selected_fn selected, void *data)
+{
+    *menu = (struct popup_menu){
+        .shm = shm, .compositor = compositor, .wm_base = wm_base,
+        .count = count < POPUP_MAX_ITEMS ? count : POPUP_MAX_ITEMS,
+        .cold = cold, .selected = selected, .data = data, .highlighted = -1,
+    };
+    int32_t text_width = 0;
+    for (int i = 0; i < menu->count; ++i) {
+        menu->items[i] = items[i];
+        int32_t w = font_text_width(items[i], POPUP_TEXT_SCALE);
+        text_width = w > text_width ? w : text_width;
+    }
+    menu->width = text_width + 2 * POPUP_PADDING + 2;
+    menu->height = menu->count * POPUP_ITEM_HEIGHT + 2;
+    menu->positioner = xdg_wm_base_create_positioner(wm_base);
+    xdg_positioner_set_size(menu->positioner, menu->width, menu->height);
+    xdg_positioner_set_anchor(menu->positioner, XDG_POSITIONER_ANCHOR_BOTTOM_RIGHT);
+    xdg_positioner_set_gravity(menu->positioner, XDG_POSITIONER_GRAVITY_BOTTOM_RIGHT);
+    xdg_positioner_set_constraint_adjustment(menu->positioner,
+            XDG_POSITIONER_CONSTRAINT_ADJUSTMENT_FLIP_X | XDG_POSITIONER_CONSTRAINT_ADJUSTMENT_FLIP_Y |
+            XDG_POSITIONER_CONSTRAINT_ADJUSTMENT_SLIDE_X | XDG_POSITIONER_CONSTRAINT_ADJUSTMENT_SLIDE_Y);
+    if (cold) {
+        return true;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!popup_prepare_buffers(menu)) {
+        return false;
+    }
+    for (int i = 0; i < POPUP_POOL; ++i) {
+        popup_slot_create(menu, &menu->pool[i]);
+    }
+    menu->prerender_ms = popup_ms_since(&start);
+    return true;
+}
+
+static void
+popup_menu_close(struct popup_menu *menu)
+{
+    if (!menu->popup) {
+        return;
+    }
+    xdg_popup_destroy(menu->popup);
+    menu->popup = NULL;
+    menu->timing = false;
+    if (menu->cold) {
+        popup_slot_destroy(menu->slot);
+        popup_free_buffers(menu);
+    } else if (menu->mapped) {
+        // Unmapped, the pair can take the popup role again
+        wl_surface_attach(menu->slot->surface, NULL, 0, 0);
+        wl_surface_commit(menu->slot->surface);
+    }
+    menu->slot->in_use = false;
+    menu->slot = NULL;
+    menu->mapped = false;
+    menu->highlighted = -1;
+}
+
+static void
+popup_frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+    struct popup_menu *menu = data;
+    wl_callback_destroy(callback);
+    if (!menu->timing) {
+        return;     // Closed before it was drawn
+    }
+    menu->timing = false;
+    double ms = popup_ms_since(&menu->clicked);
+    ++menu->visible;
+    menu->visible_ms_total += ms;
+    menu->visible_ms_max = ms > menu->visible_ms_max ? ms : menu->visible_ms_max;
+    TRACE_INSTANT("popup", "visible");
+}
+
+static const struct wl_callback_listener popup_frame_listener = {
+    .done = popup_frame_done,
+};
+
+static void
+popup_attach(struct popup_menu *menu)
+{
+    struct wl_surface *surface = menu->slot->surface;
+    wl_surface_attach(surface, menu->buffers[menu->highlighted + 1], 0, 0);
+    wl_surface_damage_buffer(surface, 0, 0, menu->width, menu->height);
+    menu->mapped = true;
+}
+
+static void
+popup_xdg_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+    struct popup_menu *menu = data;
+    xdg_surface_ack_configure(xdg_surface, serial);
+    if (!menu->slot || menu->slot->xdg_surface != xdg_surface) {
+        return;
+    }
+    if (menu->cold && !menu->buffers[0] && !popup_prepare_buffers(menu)) {
+        popup_menu_close(menu);
+        return;
+    }
+    TRACE_BEGIN("popup", "attach");
+    popup_attach(menu);
+    if (menu->timing) {
+        struct wl_callback *callback = wl_surface_frame(menu->slot->surface);
+        wl_callback_add_listener(callback, &popup_frame_listener, menu);
+        double ms = popup_ms_since(&menu->clicked);
+        menu->commit_ms_total += ms;
+        menu->commit_ms_max = ms > menu->commit_ms_max ? ms : menu->commit_ms_max;
+    }
+    wl_surface_commit(menu->slot->surface);
+    TRACE_END("popup", "attach");
+}
+
+static const struct xdg_surface_listener popup_xdg_surface_listener = {
+    .configure = popup_xdg_surface_configure,
+};
+
+static void
+popup_configure(void *data, struct xdg_popup *popup, int32_t x, int32_t y,
+                int32_t width, int32_t height)
+{
+    // The size is fixed; where it ended up is the compositor's business
+}
+
+static void
+popup_done(void *data, struct xdg_popup *popup)
+{
+    popup_menu_close(data);
+}
+
+static void
+popup_repositioned(void *data, struct xdg_popup *popup, uint32_t token)
+{
+}
+
+static const struct xdg_popup_listener popup_listener = {
+    .configure = popup_configure,
+    .popup_done = popup_done,
+    .repositioned = popup_repositioned,
+};
+
+/*******************************************
+ * popup_menu_open:
+ * - Shows the menu below-right of (x, y) on `parent`, grabbing with the
+ *   serial of the button press that asked for it.
+ *******************************************/
+static void
+popup_menu_open(struct popup_menu *menu, struct xdg_surface *parent, struct wl_seat *seat,
+                uint32_t serial, int32_t x, int32_t y)
+{
+    clock_gettime(CLOCK_MONOTONIC, &menu->clicked);
+    xdg_positioner_set_anchor_rect(menu->positioner, x, y, 1, 1);
+
+    if (menu->popup && xdg_popup_get_version(menu->popup) >= XDG_POPUP_REPOSITION_SINCE_VERSION) {
+        TRACE_BEGIN("popup", "reposition");
+        ++menu->repositions;
+        menu->timing = true;
+        xdg_popup_reposition(menu->popup, menu->positioner, ++menu->reposition_token);
+        TRACE_END("popup", "reposition");
+        return;
+    }
+    popup_menu_close(menu);
+
+    TRACE_BEGIN("popup", "open");
+    struct popup_slot *slot = NULL;
+    if (menu->cold) {
+        slot = &menu->pool[0];
+        popup_slot_create(menu, slot);
+    } else {
+        for (int i = 0; i < POPUP_POOL && !slot; ++i) {
+            if (!menu->pool[i].in_use) {
+                slot = &menu->pool[i];
+            }
+        }
+    }
+    slot->in_use = true;
+    menu->slot = slot;
+    menu->timing = true;
+    ++menu->opens;
+
+    menu->popup = xdg_surface_get_popup(slot->xdg_surface, parent, menu->positioner);
+    xdg_popup_add_listener(menu->popup, &popup_listener, menu);
+    xdg_popup_grab(menu->popup, seat, serial);
+    wl_surface_commit(slot->surface);
+    TRACE_END("popup", "open");
+}
+
+static int
+popup_item_at(const struct popup_menu *menu, double x, double y)
+{
+    if (x < 0 || x >= menu->width || y < 1) {
+        return -1;
+    }
+    int item = (int)(y - 1) / POPUP_ITEM_HEIGHT;
+    return item < menu->count ? item : -1;
+}
+
+static bool
+popup_menu_owns(const struct popup_menu *menu, const struct wl_surface *surface)
+{
+    return menu->slot && surface && menu->slot->surface == surface;
+}
+
+// Pointer moved over the popup: swap in the pre-drawn highlight
+static void
+popup_menu_motion(struct popup_menu *menu, double x, double y)
+{
+    int item = popup_item_at(menu, x, y);
+    if (!menu->mapped || item == menu->highlighted) {
+        return;
+    }
+    menu->highlighted = item;
+    popup_attach(menu);
+    wl_surface_commit(menu->slot->surface);
+}
+
+// A click on the popup picks the item under it
+static void
+popup_menu_click(struct popup_menu *menu, double x, double y)
+{
+    int item = popup_item_at(menu, x, y);
+    if (item < 0) {
+        return;
+    }
+    popup_menu_close(menu);
+    if (menu->selected) {
+        menu->selected(menu->data, item);
+    }
+}
+
+static void
+popup_menu_report(const struct popup_menu *menu, const char *label)
+{
+    if (!menu->opens) {
+        return;
+    }
+    uint64_t committed = menu->opens + menu->repositions;
+    fprintf(stderr, "[POPUP] %s (%s): %llu opens, %llu repositions, %llu rasterizations "
+            "(%.2f ms up front); click to commit avg %.3f ms, max %.3f ms; "
+            "click to visible avg %.3f ms, max %.3f ms over %llu frames\n",
+            label, menu->cold ? "cold" : "pre-rendered",
+            (unsigned long long)menu->opens, (unsigned long long)menu->repositions,
+            (unsigned long long)menu->rasterizations, menu->prerender_ms,
+            menu->commit_ms_total / committed, menu->commit_ms_max,
+            menu->visible ? menu->visible_ms_total / menu->visible : 0.0, menu->visible_ms_max,
+            (unsigned long long)menu->visible);
+}
+
+static void
+popup_menu_finish(struct popup_menu *menu)
+{
+    popup_menu_close(menu);
+    for (int i = 0; i < POPUP_POOL; ++i) {
+        popup_slot_destroy(&menu->pool[i]);
+    }
+    popup_free_buffers(menu);
+    if (menu->positioner) {
+        xdg_positioner_destroy(menu->positioner);
+        menu->positioner = NULL;
+    }
+}
+
+#endif
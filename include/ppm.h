@@ -0,0 +1,78 @@
+#ifndef MYWAYLAND_PPM_H
+#define MYWAYLAND_PPM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <ctype.h>
+
+/*******************************************
+ * Binary PPM (P6) loader:
+ * - The simplest image format there is, so backgrounds can be loaded
+ *   without pulling in libpng/libjpeg. Convert anything else with
+ *   `magick wallpaper.jpg -resize 3840x2160 wallpaper.ppm`.
+ * - Only maxval 255 is accepted. Returns tightly packed RGB8 (caller
+ *   frees) or NULL.
+ *******************************************/
+
+// Reads the next header integer, skipping whitespace and # comments
+static int
+ppm_read_int(FILE *file)
+{
+    int c = fgetc(file);
+    while (c != EOF && (isspace(c) || c == '#')) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') {
+                c = fgetc(file);
+            }
+        }
+        c = fgetc(file);
+    }
+    int value = 0;
+    if (!isdigit(c)) {
+        return -1;
+    }
+    while (c != EOF && isdigit(c)) {
+        value = value * 10 + (c - '0');
+        if (value > 65535) {
+            return -1;
+        }
+        c = fgetc(file);
+    }
+    return value;   // The single whitespace after maxval has been consumed too
+}
+
+static uint8_t *
+ppm_load(const char *path, int *width, int *height)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return NULL;
+    }
+
+    uint8_t *rgb = NULL;
+    if (fgetc(file) == 'P' && fgetc(file) == '6') {
+        int w = ppm_read_int(file);
+        int h = ppm_read_int(file);
+        int maxval = ppm_read_int(file);
+        if (w > 0 && h > 0 && w <= 16384 && h <= 16384 && maxval == 255) {
+            size_t size = (size_t)w * h * 3;
+            rgb = malloc(size);
+            if (rgb && fread(rgb, 1, size, file) == size) {
+                *width = w;
+                *height = h;
+            } else {
+                free(rgb);
+                rgb = NULL;
+            }
+        }
+    }
+    if (!rgb) {
+        fprintf(stderr, "%s is not a binary 8-bit PPM (P6) image\n", path);
+    }
+    fclose(file);
+    return rgb;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef MYWAYLAND_PROBES_H
+#define MYWAYLAND_PROBES_H
+
+/*******************************************
+ * @USDT STATIC PROBES
+ *******************************************
+ *
+ * SystemTap SDT probes (the same mechanism used by glibc, Python, Postgres)
+ * placed on the client hot paths, so bpftrace/perf can attach to a running
+ * program without rebuilding it.
+ *
+ * - A probe compiles down to a single `nop` plus a note in the ELF
+ *   `.note.stapsdt` section. Nothing is executed until a tracer attaches,
+ *   which is what makes them usable in production builds.
+ * - All probes live under the provider "mywayland":
+ *
+ *     keymap_compile_start(size)    keymap_compile_end(ok)
+ *     key(key, state)               pointer_frame(event_mask)
+ *     configure_received(serial)    configure_acked(serial)
+ *     configure_coalesced(serial)
+ *     frame_start(frame)            frame_end(frame)
+ *     swap(frame)                   commit(frame)
+ *     buffer_release(frame)
+ *
+ * - List them with `readelf -n bin/<program>` or
+ *   `bpftrace -l 'usdt:./bin/<program>:mywayland:*'`; ready-made latency
+ *   histograms live in scripts/bpftrace/.
+ *
+ * Without <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel) or with
+ * -DMYWAYLAND_NO_SDT the macros expand to nothing.
+ *******************************************/
+
+#if !defined(MYWAYLAND_NO_SDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MYWAYLAND_HAVE_SDT 1
+#endif
+#endif
+
+#ifdef MYWAYLAND_HAVE_SDT
+#define PROBE0(name)             STAP_PROBE(mywayland, name)
+#define PROBE1(name, a)          STAP_PROBE1(mywayland, name, a)
+#define PROBE2(name, a, b)       STAP_PROBE2(mywayland, name, a, b)
+#else
+#define PROBE0(name)             do { } while (0)
+#define PROBE1(name, a)          do { (void)(a); } while (0)
+#define PROBE2(name, a, b)       do { (void)(a); (void)(b); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef MYWAYLAND_SCROLLBACK_H
+#define MYWAYLAND_SCROLLBACK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************
+ * @SCROLLBACK STORE
+ *******************************************
+ *
+ * Append-only text log that stays cheap to append to and to look up in,
+ * however many lines it holds.
+ *
+ * - Text lives in fixed 64 KiB chunks. A line never spans two chunks, and
+ *   chunks are never reallocated, so appending never copies old text and
+ *   pointers returned by scrollback_line() stay valid.
+ * - Each chunk keeps the offsets of its own lines plus the number of the
+ *   first line it holds. Finding line N is a binary search over the chunk
+ *   directory followed by an array lookup: O(log n).
+ * - Lines are stored without their newline; overly long ones are cut at
+ *   SCROLLBACK_MAX_LINE bytes.
+ *******************************************/
+
+#define SCROLLBACK_CHUNK_SIZE (64 * 1024)
+#define SCROLLBACK_MAX_LINE   1024
+
+struct scrollback_chunk {
+    uint64_t first_line;          // Global index of this chunk's first line
+    uint32_t used;                // Bytes of text
+    uint32_t line_count;
+    uint32_t line_capacity;
+    uint32_t *line_offsets;       // Start of each line within text
+    char text[SCROLLBACK_CHUNK_SIZE];
+};
+
+struct scrollback {
+    struct scrollback_chunk **chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+    uint64_t line_count;
+    uint64_t bytes;
+};
+
+static struct scrollback_chunk *
+scrollback_new_chunk(struct scrollback *sb)
+{
+    if (sb->chunk_count == sb->chunk_capacity) {
+        size_t capacity = sb->chunk_capacity ? sb->chunk_capacity * 2 : 16;
+        struct scrollback_chunk **chunks = realloc(sb->chunks, capacity * sizeof(*chunks));
+        if (!chunks) {
+            return NULL;
+        }
+        sb->chunks = chunks;
+        sb->chunk_capacity = capacity;
+    }
+    struct scrollback_chunk *chunk = malloc(sizeof(*chunk));
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->first_line = sb->line_count;
+    chunk->used = 0;
+    chunk->line_count = 0;
+    chunk->line_capacity = 0;
+    chunk->line_offsets = NULL;
+    sb->chunks[sb->chunk_count++] = chunk;
+    return chunk;
+}
+
+// Appends one line; returns 0 on success, -1 when out of memory
+static int
+scrollback_append(struct scrollback *sb, const char *text, size_t length)
+{
+    if (length > SCROLLBACK_MAX_LINE) {
+        length = SCROLLBACK_MAX_LINE;
+    }
+    struct scrollback_chunk *chunk = sb->chunk_count ? sb->chunks[sb->chunk_count - 1] : NULL;
+    if (!chunk || chunk->used + length > SCROLLBACK_CHUNK_SIZE) {
+        chunk = scrollback_new_chunk(sb);
+        if (!chunk) {
+            return -1;
+        }
+    }
+    if (chunk->line_count == chunk->line_capacity) {
+        uint32_t capacity = chunk->line_capacity ? chunk->line_capacity * 2 : 256;
+        uint32_t *offsets = realloc(chunk->line_offsets, capacity * sizeof(*offsets));
+        if (!offsets) {
+            return -1;
+        }
+        chunk->line_offsets = offsets;
+        chunk->line_capacity = capacity;
+    }
+
+    chunk->line_offsets[chunk->line_count++] = chunk->used;
+    memcpy(chunk->text + chunk->used, text, length);
+    chunk->used += length;
+    ++sb->line_count;
+    sb->bytes += length;
+    return 0;
+}
+
+/*******************************************
+ * scrollback_line:
+ * - Returns line `index` (not NUL-terminated) and its length, or NULL when
+ *   the index is past the end.
+ *******************************************/
+static const char *
+scrollback_line(const struct scrollback *sb, uint64_t index, size_t *length)
+{
+    if (index >= sb->line_count) {
+        return NULL;
+    }
+
+    // Last chunk whose first line is <= index
+    size_t lo = 0, hi = sb->chunk_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sb->chunks[mid]->first_line <= index) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const struct scrollback_chunk *chunk = sb->chunks[lo];
+    uint32_t line = index - chunk->first_line;
+    uint32_t start = chunk->line_offsets[line];
+    uint32_t end = line + 1 < chunk->line_count ? chunk->line_offsets[line + 1] : chunk->used;
+    *length = end - start;
+    return chunk->text + start;
+}
+
+static void
+scrollback_free(struct scrollback *sb)
+{
+    for (size_t i = 0; i < sb->chunk_count; ++i) {
+        free(sb->chunks[i]->line_offsets);
+        free(sb->chunks[i]);
+    }
+    free(sb->chunks);
+    memset(sb, 0, sizeof(*sb));
+}
+
+#endif
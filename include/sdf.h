@@ -0,0 +1,215 @@
+#ifndef MYWAYLAND_SDF_H
+#define MYWAYLAND_SDF_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "font.h"
+
+/*******************************************
+ * @SIGNED DISTANCE FIELD GLYPHS
+ *******************************************
+ *
+ * One atlas for the built-in font (include/font.h) that draws text at any
+ * size and output scale, instead of a rasterization per size.
+ *
+ * - Every texel stores distances to the glyph outline rather than
+ *   coverage; a shader thresholds the bilinearly filtered distance at 0.5
+ *   and antialiases over one screen pixel, so magnifying keeps edges sharp.
+ * - It is multi-channel (MSDF): red holds the signed pseudo-distance to
+ *   the nearest horizontal edge, blue to the nearest vertical edge, green
+ *   the true signed distance. The median of the three keeps the corners
+ *   square, where a single channel would round them. The glyphs are made
+ *   of whole font pixels, so horizontal/vertical is the whole edge colouring.
+ * - SDF_TEXELS texels per font pixel, SDF_PAD font pixels of margin and a
+ *   distance range of +-SDF_RANGE font pixels mapped to 0..255.
+ * - Glyphs sit in a grid of SDF_COLUMNS cells, 3 bytes per texel (GL_RGB).
+ *
+ * coverage_atlas_build() is the per-size alternative for comparison: the
+ * exact pixel coverage of every glyph at one size, 1 byte per texel, to be
+ * built again for every text size x output scale on screen.
+ *******************************************/
+#define SDF_TEXELS  4
+#define SDF_PAD     1
+#define SDF_RANGE   1.0f
+#define SDF_COLUMNS 16
+#define SDF_GLYPHS  (FONT_LAST_CHAR - FONT_FIRST_CHAR + 1)
+#define SDF_CELL_WIDTH  ((FONT_GLYPH_WIDTH + 2 * SDF_PAD) * SDF_TEXELS)
+#define SDF_CELL_HEIGHT ((FONT_GLYPH_HEIGHT + 2 * SDF_PAD) * SDF_TEXELS)
+
+struct sdf_atlas {
+    uint8_t *texels;                 // RGB, `width` x `height`
+    int width, height;
+    size_t bytes;
+};
+
+static inline bool
+sdf_lit(int glyph, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= FONT_GLYPH_WIDTH || y >= FONT_GLYPH_HEIGHT) {
+        return false;
+    }
+    return font_glyphs[glyph][y] & (0x10 >> x);
+}
+
+// Distance from (px, py) to a unit segment starting at (x, y), along x or y
+static inline float
+sdf_segment_distance(float px, float py, float x, float y, bool horizontal)
+{
+    float along = horizontal ? px - x : py - y;
+    float across = horizontal ? py - y : px - x;
+    float outside = along < 0 ? -along : along > 1 ? along - 1 : 0;
+    return sqrtf(outside * outside + across * across);
+}
+
+static inline uint8_t
+sdf_encode(float distance)
+{
+    float v = distance / (2 * SDF_RANGE) + 0.5f;
+    v = v < 0 ? 0 : v > 1 ? 1 : v;
+    return (uint8_t)(v * 255.0f + 0.5f);
+}
+
+/*******************************************
+ * sdf_glyph:
+ * - Fills one glyph's cell. Edges are the unit boundaries between a lit
+ *   font pixel and an unlit one, each with the direction towards the lit
+ *   side, so pseudo-distances come out positive inside.
+ *******************************************/
+static void
+sdf_glyph(struct sdf_atlas *atlas, int glyph)
+{
+    struct { float x, y, inward; bool horizontal; } edges[2 * (FONT_GLYPH_WIDTH + 1) * (FONT_GLYPH_HEIGHT + 1)];
+    int count = 0;
+    for (int y = 0; y <= FONT_GLYPH_HEIGHT; ++y) {
+        for (int x = 0; x <= FONT_GLYPH_WIDTH; ++x) {
+            bool here = sdf_lit(glyph, x, y);
+            bool above = sdf_lit(glyph, x, y - 1), left = sdf_lit(glyph, x - 1, y);
+            if (here != above) {
+                edges[count++] = (typeof(edges[0])){ x, y, here ? 1 : -1, true };
+            }
+            if (here != left) {
+                edges[count++] = (typeof(edges[0])){ x, y, here ? 1 : -1, false };
+            }
+        }
+    }
+
+    int cell_x = glyph % SDF_COLUMNS * SDF_CELL_WIDTH, cell_y = glyph / SDF_COLUMNS * SDF_CELL_HEIGHT;
+    for (int ty = 0; ty < SDF_CELL_HEIGHT; ++ty) {
+        for (int tx = 0; tx < SDF_CELL_WIDTH; ++tx) {
+            float px = (tx + 0.5f) / SDF_TEXELS - SDF_PAD, py = (ty + 0.5f) / SDF_TEXELS - SDF_PAD;
+            bool inside = sdf_lit(glyph, (int)floorf(px), (int)floorf(py));
+            float best[2] = { INFINITY, INFINITY }, pseudo[2] = { -SDF_RANGE, -SDF_RANGE };
+            float nearest = INFINITY;
+            for (int e = 0; e < count; ++e) {
+                float d = sdf_segment_distance(px, py, edges[e].x, edges[e].y, edges[e].horizontal);
+                int channel = edges[e].horizontal ? 0 : 1;
+                if (d < best[channel]) {
+                    best[channel] = d;
+                    pseudo[channel] = (edges[e].horizontal ? py - edges[e].y : px - edges[e].x) * edges[e].inward;
+                }
+                nearest = d < nearest ? d : nearest;
+            }
+            uint8_t *texel = &atlas->texels[((size_t)(cell_y + ty) * atlas->width + cell_x + tx) * 3];
+            texel[0] = sdf_encode(pseudo[0]);
+            texel[1] = sdf_encode(inside ? nearest : -nearest);
+            texel[2] = sdf_encode(pseudo[1]);
+        }
+    }
+}
+
+static bool
+sdf_atlas_build(struct sdf_atlas *atlas)
+{
+    atlas->width = SDF_COLUMNS * SDF_CELL_WIDTH;
+    atlas->height = (SDF_GLYPHS + SDF_COLUMNS - 1) / SDF_COLUMNS * SDF_CELL_HEIGHT;
+    atlas->bytes = (size_t)atlas->width * atlas->height * 3;
+    atlas->texels = calloc(1, atlas->bytes);
+    if (!atlas->texels) {
+        return false;
+    }
+    for (int g = 0; g < SDF_GLYPHS; ++g) {
+        sdf_glyph(atlas, g);
+    }
+    return true;
+}
+
+static void
+sdf_atlas_free(struct sdf_atlas *atlas)
+{
+    free(atlas->texels);
+    atlas->texels = NULL;
+}
+
+// Texture coordinates of a character's cell, padding included
+static inline void
+sdf_glyph_uv(const struct sdf_atlas *atlas, unsigned char c, float uv[4])
+{
+    int glyph = (int)(font_glyph(c) - font_glyphs[0]) / FONT_GLYPH_HEIGHT;
+    uv[0] = (float)(glyph % SDF_COLUMNS * SDF_CELL_WIDTH) / atlas->width;
+    uv[1] = (float)(glyph / SDF_COLUMNS * SDF_CELL_HEIGHT) / atlas->height;
+    uv[2] = uv[0] + (float)SDF_CELL_WIDTH / atlas->width;
+    uv[3] = uv[1] + (float)SDF_CELL_HEIGHT / atlas->height;
+}
+
+/*******************************************
+ * coverage_atlas_build:
+ * - Rasterizes every glyph at `size` screen pixels per font pixel (any
+ *   positive value: text scale x output scale) into a row of cells, each
+ *   texel holding the exact fraction of it the glyph covers.
+ *******************************************/
+struct coverage_atlas {
+    uint8_t *texels;                 // 1 byte per texel
+    int width, height, cell_width;
+    size_t bytes;
+};
+
+static inline float
+coverage_overlap(float a0, float a1, float b0, float b1)
+{
+    float lo = a0 > b0 ? a0 : b0, hi = a1 < b1 ? a1 : b1;
+    return hi > lo ? hi - lo : 0;
+}
+
+static bool
+coverage_atlas_build(struct coverage_atlas *atlas, float size)
+{
+    atlas->cell_width = (int)ceilf(FONT_ADVANCE * size);
+    atlas->width = atlas->cell_width * SDF_GLYPHS;
+    atlas->height = (int)ceilf(FONT_GLYPH_HEIGHT * size);
+    atlas->bytes = (size_t)atlas->width * atlas->height;
+    atlas->texels = calloc(1, atlas->bytes);
+    if (!atlas->texels) {
+        return false;
+    }
+    for (int g = 0; g < SDF_GLYPHS; ++g) {
+        for (int y = 0; y < FONT_GLYPH_HEIGHT; ++y) {
+            for (int x = 0; x < FONT_GLYPH_WIDTH; ++x) {
+                if (!sdf_lit(g, x, y)) {
+                    continue;
+                }
+                // Add the font pixel's area to every texel it touches
+                float x0 = x * size, x1 = x0 + size, y0 = y * size, y1 = y0 + size;
+                for (int ty = (int)y0; ty < (int)ceilf(y1); ++ty) {
+                    for (int tx = (int)x0; tx < (int)ceilf(x1); ++tx) {
+                        float area = coverage_overlap(tx, tx + 1, x0, x1) * coverage_overlap(ty, ty + 1, y0, y1);
+                        uint8_t *texel = &atlas->texels[(size_t)ty * atlas->width + g * atlas->cell_width + tx];
+                        int value = *texel + (int)(area * 255.0f + 0.5f);
+                        *texel = value > 255 ? 255 : value;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static void
+coverage_atlas_free(struct coverage_atlas *atlas)
+{
+    free(atlas->texels);
+    atlas->texels = NULL;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef MYWAYLAND_SHM_H
+#define MYWAYLAND_SHM_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/*******************************************
+ * Anonymous shared memory for wl_shm pools:
+ * - memfd_create when the libc has it (glibc >= 2.27), no name in /dev/shm
+ *   and nothing to unlink.
+ * - Otherwise the classic shm_open with a random name, unlinked at once.
+ * - Returns a file descriptor of `size` bytes, or -1.
+ *******************************************/
+
+static int
+shm_create_fd(void)
+{
+#ifdef MFD_CLOEXEC
+    int fd = memfd_create("mywayland-shm", MFD_CLOEXEC);
+    if (fd >= 0) {
+        return fd;
+    }
+#endif
+    for (int retries = 100; retries > 0; --retries) {
+        char name[] = "/mywayland-XXXXXX";
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        long r = ts.tv_nsec;
+        for (int i = 0; i < 6; ++i) {
+            name[sizeof(name) - 7 + i] = 'A' + (r & 15) + (r & 16) * 2;
+            r >>= 5;
+        }
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            shm_unlink(name);
+            return fd;
+        }
+        if (errno != EEXIST) {
+            break;
+        }
+    }
+    return -1;
+}
+
+static int
+shm_allocate(size_t size)
+{
+    int fd = shm_create_fd();
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create shm file\n");
+        return -1;
+    }
+    int ret;
+    do {
+        ret = ftruncate(fd, size);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        fprintf(stderr, "Failed to size shm file to %zu bytes\n", size);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif
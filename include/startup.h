@@ -0,0 +1,78 @@
+#ifndef MYWAYLAND_STARTUP_H
+#define MYWAYLAND_STARTUP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*******************************************
+ * @STARTUP STATISTICS
+ *******************************************
+ *
+ * Small helpers to answer "how long until the first frame, and how much
+ * memory did it take to get there":
+ *
+ * - startup_begin() stamps the time at the top of main().
+ * - startup_report(label) prints the time since then together with the
+ *   current and peak resident set size from /proc/self/status.
+ * - With MYWAYLAND_STARTUP_EXIT=1 the report also ends the process, which
+ *   lets scripts/startup_compare.sh time many cold starts in a row.
+ *
+ * Work done by the dynamic loader before main() (e.g. mapping eagerly
+ * linked GL drivers) is not included in the in-process number; the
+ * comparison script measures whole-process wall time for that.
+ *******************************************/
+
+static struct timespec startup_time;
+
+static void
+startup_begin(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &startup_time);
+}
+
+static double
+startup_elapsed_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - startup_time.tv_sec) * 1e3 +
+           (now.tv_nsec - startup_time.tv_nsec) / 1e6;
+}
+
+// Reads a "Key:   1234 kB" line from /proc/self/status, 0 if unavailable
+static long
+startup_status_kb(const char *key)
+{
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status) {
+        return 0;
+    }
+    char line[256];
+    long value = 0;
+    size_t key_len = strlen(key);
+    while (fgets(line, sizeof(line), status)) {
+        if (strncmp(line, key, key_len) == 0 && line[key_len] == ':') {
+            value = strtol(line + key_len + 1, NULL, 10);
+            break;
+        }
+    }
+    fclose(status);
+    return value;
+}
+
+static void
+startup_report(const char *label)
+{
+    fprintf(stderr, "[STARTUP] %s: %.2f ms since main, RSS %ld KiB (peak %ld KiB)\n",
+            label, startup_elapsed_ms(),
+            startup_status_kb("VmRSS"), startup_status_kb("VmHWM"));
+
+    const char *exit_after = getenv("MYWAYLAND_STARTUP_EXIT");
+    if (exit_after && strcmp(exit_after, "1") == 0) {
+        exit(EXIT_SUCCESS);
+    }
+}
+
+#endif
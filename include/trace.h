@@ -0,0 +1,588 @@
+#ifndef MYWAYLAND_TRACE_H
+#define MYWAYLAND_TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <wayland-client.h>
+
+/*******************************************
+ * @TIMELINE TRACING
+ *******************************************
+ *
+ * Aggregate numbers ("frames took 4ms on average") cannot tell you why one
+ * particular frame was late. This header records individual spans so that
+ * a single run of any client can be inspected on a timeline in
+ * chrome://tracing or https://ui.perfetto.dev
+ *
+ * - Spans are pairs of TRACE_BEGIN / TRACE_END with a category and a name.
+ *   Both must be string literals (only the pointer is stored).
+ * - Flow events (TRACE_FLOW_BEGIN / TRACE_FLOW_END) draw an arrow between
+ *   two points of the timeline that share an id, e.g. from the configure
+ *   event that caused a frame to the buffer release that retired it.
+ * - Every thread records into its own buffer, so the hot path never takes
+ *   a lock. The buffer list is only walked once, at exit.
+ *
+ * Tracing is off unless the MYWAYLAND_TRACE environment variable names an
+ * output file:
+ *
+ *   MYWAYLAND_TRACE=/tmp/render.json      ./bin/render    # Chrome JSON
+ *   MYWAYLAND_TRACE=/tmp/render.pftrace   ./bin/render    # Perfetto protobuf
+ *
+ * When disabled every macro is a single predictable branch on a global.
+ * The trace is written on normal exit. SIGINT/SIGTERM only ask the main
+ * loop to stop (trace_dispatch, trace_stop_requested), so the program
+ * leaves through its normal cleanup and the trace is written at exit.
+ *******************************************/
+
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS 65536
+#endif
+
+enum trace_phase {
+    TRACE_PHASE_BEGIN,
+    TRACE_PHASE_END,
+    TRACE_PHASE_INSTANT,
+    TRACE_PHASE_FLOW_BEGIN,
+    TRACE_PHASE_FLOW_END,
+};
+
+struct trace_event {
+    uint64_t ts_ns;           // CLOCK_BOOTTIME, which is also Perfetto's default clock
+    uint64_t flow_id;         // Only meaningful for flow events
+    const char *category;
+    const char *name;
+    uint8_t phase;            // enum trace_phase
+};
+
+struct trace_buffer {
+    struct trace_buffer *next;
+    pid_t tid;
+    char thread_name[16];
+    size_t count;
+    uint64_t dropped;         // Events lost because the buffer was full
+    struct trace_event events[TRACE_BUFFER_EVENTS];
+};
+
+static struct {
+    bool enabled;
+    bool perfetto;
+    const char *path;
+    const char *process_name;
+    pthread_mutex_t lock;     // Only guards the buffer list
+    struct trace_buffer *buffers;
+    bool written;
+    uint64_t oversized;       // Perfetto packets left out for not fitting struct trace_pb
+    int signal_pipe[2];       // Self-pipe written by the signal handler
+    volatile sig_atomic_t stop_signal;
+} trace_state = { .lock = PTHREAD_MUTEX_INITIALIZER, .signal_pipe = { -1, -1 } };
+
+static __thread struct trace_buffer *trace_local;
+
+static inline uint64_t
+trace_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Slow path: first event on a thread allocates and registers its buffer
+static struct trace_buffer *
+trace_thread_buffer(void)
+{
+    if (trace_local) {
+        return trace_local;
+    }
+
+    struct trace_buffer *buffer = calloc(1, sizeof(*buffer));
+    if (!buffer) {
+        return NULL;
+    }
+    buffer->tid = (pid_t)syscall(SYS_gettid);
+
+    pthread_mutex_lock(&trace_state.lock);
+    buffer->next = trace_state.buffers;
+    trace_state.buffers = buffer;
+    pthread_mutex_unlock(&trace_state.lock);
+
+    trace_local = buffer;
+    return buffer;
+}
+
+static void
+trace_emit(uint8_t phase, const char *category, const char *name, uint64_t flow_id)
+{
+    struct trace_buffer *buffer = trace_thread_buffer();
+    if (!buffer) {
+        return;
+    }
+    if (buffer->count == TRACE_BUFFER_EVENTS) {
+        ++buffer->dropped;
+        return;
+    }
+
+    struct trace_event *event = &buffer->events[buffer->count++];
+    event->ts_ns = trace_now_ns();
+    event->flow_id = flow_id;
+    event->category = category;
+    event->name = name;
+    event->phase = phase;
+}
+
+#define TRACE_BEGIN(cat, name) \
+    do { if (trace_state.enabled) trace_emit(TRACE_PHASE_BEGIN, cat, name, 0); } while (0)
+#define TRACE_END(cat, name) \
+    do { if (trace_state.enabled) trace_emit(TRACE_PHASE_END, cat, name, 0); } while (0)
+#define TRACE_INSTANT(cat, name) \
+    do { if (trace_state.enabled) trace_emit(TRACE_PHASE_INSTANT, cat, name, 0); } while (0)
+#define TRACE_FLOW_BEGIN(cat, name, id) \
+    do { if (trace_state.enabled) trace_emit(TRACE_PHASE_FLOW_BEGIN, cat, name, (uint64_t)(id)); } while (0)
+#define TRACE_FLOW_END(cat, name, id) \
+    do { if (trace_state.enabled) trace_emit(TRACE_PHASE_FLOW_END, cat, name, (uint64_t)(id)); } while (0)
+
+// Name the calling thread in the exported timeline
+static void
+trace_set_thread_name(const char *name)
+{
+    if (!trace_state.enabled) {
+        return;
+    }
+    struct trace_buffer *buffer = trace_thread_buffer();
+    if (buffer) {
+        snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%s", name);
+    }
+}
+
+/*******************************************
+ * Chrome JSON export:
+ * - The "JSON Array/Object Format" understood by chrome://tracing and Perfetto.
+ * - Timestamps are microseconds; flows use ph "s"/"f" with "bp":"e" so the
+ *   arrow binds to the enclosing slice.
+ *******************************************/
+static void
+trace_json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', out);
+        }
+        fputc((unsigned char)*s < 0x20 ? '?' : *s, out);
+    }
+    fputc('"', out);
+}
+
+static void
+trace_write_json(FILE *out)
+{
+    static const char *phase_code[] = {
+        [TRACE_PHASE_BEGIN] = "B",
+        [TRACE_PHASE_END] = "E",
+        [TRACE_PHASE_INSTANT] = "i",
+        [TRACE_PHASE_FLOW_BEGIN] = "s",
+        [TRACE_PHASE_FLOW_END] = "f",
+    };
+    pid_t pid = getpid();
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(out, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":", pid);
+    trace_json_string(out, trace_state.process_name);
+    fprintf(out, "}}");
+
+    for (struct trace_buffer *b = trace_state.buffers; b; b = b->next) {
+        fprintf(out, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                pid, b->tid);
+        trace_json_string(out, b->thread_name[0] ? b->thread_name : "thread");
+        fprintf(out, "}}");
+
+        for (size_t i = 0; i < b->count; ++i) {
+            const struct trace_event *e = &b->events[i];
+            fprintf(out, ",\n{\"ph\":\"%s\",\"cat\":", phase_code[e->phase]);
+            trace_json_string(out, e->category);
+            fprintf(out, ",\"name\":");
+            trace_json_string(out, e->name);
+            fprintf(out, ",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+                    e->ts_ns / 1000.0, pid, b->tid);
+            if (e->phase == TRACE_PHASE_INSTANT) {
+                fprintf(out, ",\"s\":\"t\"");
+            } else if (e->phase == TRACE_PHASE_FLOW_BEGIN || e->phase == TRACE_PHASE_FLOW_END) {
+                fprintf(out, ",\"id\":%llu,\"bp\":\"e\"", (unsigned long long)e->flow_id);
+            }
+            fputc('}', out);
+        }
+    }
+    fprintf(out, "\n]}\n");
+}
+
+/*******************************************
+ * Perfetto protobuf export:
+ * - A Trace is a sequence of TracePacket messages (field 1). Each thread gets
+ *   a TrackDescriptor packet, then one TrackEvent packet per event.
+ * - Encoded by hand so there is no dependency on the Perfetto SDK. Only the
+ *   handful of fields below are used:
+ *     TracePacket:     timestamp=8, trusted_packet_sequence_id=10,
+ *                      track_event=11, track_descriptor=60
+ *     TrackDescriptor: uuid=1, name=2, thread=4
+ *     ThreadDescriptor: pid=1, tid=2, thread_name=5
+ *     TrackEvent:      type=9, track_uuid=11, categories=22, name=23,
+ *                      flow_ids=47, terminating_flow_ids=48
+ *******************************************/
+struct trace_pb {
+    uint8_t data[512];
+    size_t len;
+    bool overflow;            // A field did not fit: never write this message
+};
+
+// Appends raw bytes, or marks the message as overflowed when they do not fit
+static void
+trace_pb_append(struct trace_pb *pb, const void *bytes, size_t len)
+{
+    if (pb->overflow || len > sizeof(pb->data) - pb->len) {
+        pb->overflow = true;
+        return;
+    }
+    memcpy(pb->data + pb->len, bytes, len);
+    pb->len += len;
+}
+
+static void
+trace_pb_varint(struct trace_pb *pb, uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t len = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bytes[len++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    trace_pb_append(pb, bytes, len);
+}
+
+static void
+trace_pb_uint(struct trace_pb *pb, uint32_t field, uint64_t value)
+{
+    trace_pb_varint(pb, (uint64_t)field << 3 | 0);
+    trace_pb_varint(pb, value);
+}
+
+static void
+trace_pb_fixed64(struct trace_pb *pb, uint32_t field, uint64_t value)
+{
+    trace_pb_varint(pb, (uint64_t)field << 3 | 1);
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = (value >> (8 * i)) & 0xff;
+    }
+    trace_pb_append(pb, bytes, sizeof(bytes));
+}
+
+static void
+trace_pb_bytes(struct trace_pb *pb, uint32_t field, const void *bytes, size_t len)
+{
+    trace_pb_varint(pb, (uint64_t)field << 3 | 2);
+    trace_pb_varint(pb, len);
+    trace_pb_append(pb, bytes, len);
+}
+
+static void
+trace_pb_string(struct trace_pb *pb, uint32_t field, const char *s)
+{
+    trace_pb_bytes(pb, field, s, strlen(s));
+}
+
+// Embeds a nested message; an overflowed one overflows its parent too
+static void
+trace_pb_message(struct trace_pb *pb, uint32_t field, const struct trace_pb *message)
+{
+    if (message->overflow) {
+        pb->overflow = true;
+        return;
+    }
+    trace_pb_bytes(pb, field, message->data, message->len);
+}
+
+// Wraps one finished TracePacket as Trace.packet (field 1) and writes it out.
+// A packet that overflowed is dropped whole and counted, never truncated.
+static bool
+trace_pb_write_packet(FILE *out, const struct trace_pb *packet)
+{
+    if (packet->overflow) {
+        ++trace_state.oversized;
+        return false;
+    }
+    struct trace_pb header = {0};
+    trace_pb_varint(&header, 1 << 3 | 2);
+    trace_pb_varint(&header, packet->len);
+    fwrite(header.data, 1, header.len, out);
+    fwrite(packet->data, 1, packet->len, out);
+    return true;
+}
+
+static void
+trace_write_perfetto(FILE *out)
+{
+    pid_t pid = getpid();
+    uint32_t sequence = 1;
+
+    for (struct trace_buffer *b = trace_state.buffers; b; b = b->next, ++sequence) {
+        uint64_t track_uuid = (uint64_t)pid << 32 | (uint32_t)b->tid;
+
+        struct trace_pb thread = {0}, track = {0}, packet = {0};
+        trace_pb_uint(&thread, 1, pid);
+        trace_pb_uint(&thread, 2, b->tid);
+        trace_pb_string(&thread, 5, b->thread_name[0] ? b->thread_name : trace_state.process_name);
+        trace_pb_uint(&track, 1, track_uuid);
+        trace_pb_message(&track, 4, &thread);
+        trace_pb_message(&packet, 60, &track);
+        trace_pb_uint(&packet, 10, sequence);
+        trace_pb_write_packet(out, &packet);
+
+        // Slices whose begin was dropped, by nesting depth, so their end is too
+        uint64_t dropped_begins = 0;
+        unsigned depth = 0;
+        for (size_t i = 0; i < b->count; ++i) {
+            const struct trace_event *e = &b->events[i];
+            struct trace_pb event = {0};
+
+            if (e->phase == TRACE_PHASE_END && depth > 0) {
+                --depth;
+                uint64_t bit = depth < 64 ? 1ull << depth : 0;
+                if (dropped_begins & bit) {
+                    dropped_begins &= ~bit;
+                    ++trace_state.oversized;
+                    continue;
+                }
+            }
+
+            switch (e->phase) {
+            case TRACE_PHASE_BEGIN:
+                trace_pb_uint(&event, 9, 1);    // TYPE_SLICE_BEGIN
+                break;
+            case TRACE_PHASE_END:
+                trace_pb_uint(&event, 9, 2);    // TYPE_SLICE_END
+                break;
+            default:
+                trace_pb_uint(&event, 9, 3);    // TYPE_INSTANT
+                break;
+            }
+            trace_pb_uint(&event, 11, track_uuid);
+            trace_pb_string(&event, 22, e->category);
+            if (e->phase != TRACE_PHASE_END) {
+                trace_pb_string(&event, 23, e->name);
+            }
+            if (e->phase == TRACE_PHASE_FLOW_BEGIN) {
+                trace_pb_fixed64(&event, 47, e->flow_id);
+            } else if (e->phase == TRACE_PHASE_FLOW_END) {
+                trace_pb_fixed64(&event, 48, e->flow_id);
+            }
+
+            packet = (struct trace_pb){0};
+            trace_pb_uint(&packet, 8, e->ts_ns);
+            trace_pb_uint(&packet, 10, sequence);
+            trace_pb_message(&packet, 11, &event);
+            bool written = trace_pb_write_packet(out, &packet);
+            if (e->phase == TRACE_PHASE_BEGIN) {
+                if (!written && depth < 64) {
+                    dropped_begins |= 1ull << depth;
+                }
+                ++depth;
+            }
+        }
+    }
+}
+
+// Writes the trace file. Safe to call more than once; only the first call writes.
+static void
+trace_shutdown(void)
+{
+    if (!trace_state.enabled || trace_state.written) {
+        return;
+    }
+    trace_state.written = true;
+    trace_state.enabled = false;  // Stop recording while we walk the buffers
+
+    FILE *out = fopen(trace_state.path, "wb");
+    if (!out) {
+        fprintf(stderr, "[TRACE] Failed to open %s\n", trace_state.path);
+        return;
+    }
+    if (trace_state.perfetto) {
+        trace_write_perfetto(out);
+    } else {
+        trace_write_json(out);
+    }
+    fclose(out);
+
+    uint64_t events = 0, dropped = 0;
+    for (struct trace_buffer *b = trace_state.buffers; b; b = b->next) {
+        events += b->count;
+        dropped += b->dropped;
+    }
+    fprintf(stderr, "[TRACE] Wrote %llu events to %s (%llu dropped)\n",
+            (unsigned long long)events, trace_state.path, (unsigned long long)dropped);
+    if (trace_state.oversized) {
+        fprintf(stderr, "[TRACE] Left out %llu packets that did not fit %zu bytes, "
+                "with the ends of the slices they began\n",
+                (unsigned long long)trace_state.oversized, sizeof(((struct trace_pb *)0)->data));
+    }
+}
+
+/*******************************************
+ * Ctrl-C:
+ * - Writing the trace takes stdio and walks buffers that other threads may
+ *   still be appending to, so it cannot run in a signal handler: the
+ *   signal can interrupt any thread anywhere, even inside malloc().
+ * - The handler only records the signal and writes a byte to a self-pipe.
+ *   trace_dispatch() polls that pipe next to the display fd (libwayland's
+ *   own dispatch retries poll() on EINTR and would never notice), the main
+ *   loop sees trace_stop_requested(), stops its threads and returns, and
+ *   atexit() writes the trace.
+ * - trace_init() installs this when tracing. Programs that always leave
+ *   their loop on Ctrl-C (y4mplay prints a report) call
+ *   trace_catch_stop_signals() themselves and watch the same pipe.
+ * - A second signal kills the process as usual, in case the loop is stuck.
+ *******************************************/
+static void
+trace_signal_handler(int sig)
+{
+    if (trace_state.stop_signal) {
+        signal(sig, SIG_DFL);
+        raise(sig);
+        return;
+    }
+    int saved_errno = errno;
+    trace_state.stop_signal = sig;
+    ssize_t ignored = write(trace_state.signal_pipe[1], "", 1);
+    (void)ignored;
+    errno = saved_errno;
+}
+
+// True once a caught SIGINT/SIGTERM arrived; main loops should exit.
+static inline bool
+trace_stop_requested(void)
+{
+    return trace_state.stop_signal != 0;
+}
+
+// pthread_create() with SIGINT/SIGTERM blocked in the new thread, so stop
+// signals are always delivered to the main thread and its loop.
+static int
+trace_thread_create(pthread_t *thread, void *(*start)(void *), void *arg)
+{
+    sigset_t stop, saved;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, &saved);
+    int ret = pthread_create(thread, NULL, start, arg);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    return ret;
+}
+
+// Read end of the self-pipe for loops with their own poll(), -1 when disabled.
+static inline int
+trace_signal_fd(void)
+{
+    return trace_state.signal_pipe[0];
+}
+
+/*******************************************
+ * trace_dispatch:
+ * - wl_display_dispatch() that also returns, with 0, once a stop signal
+ *   arrived. Plain wl_display_dispatch() when tracing is off.
+ *******************************************/
+static int
+trace_dispatch(struct wl_display *display)
+{
+    if (trace_signal_fd() < 0) {
+        return wl_display_dispatch(display);
+    }
+    while (wl_display_prepare_read(display) != 0) {
+        int events = wl_display_dispatch_pending(display);
+        if (events != 0) {
+            return events;
+        }
+    }
+    if (wl_display_flush(display) < 0 && errno != EAGAIN) {
+        wl_display_cancel_read(display);
+        return -1;
+    }
+
+    struct pollfd fds[2] = {
+        { .fd = wl_display_get_fd(display), .events = POLLIN },
+        { .fd = trace_signal_fd(), .events = POLLIN },
+    };
+    while (!trace_stop_requested() && poll(fds, 2, -1) < 0) {
+        if (errno != EINTR) {
+            wl_display_cancel_read(display);
+            return -1;
+        }
+    }
+    if (!(fds[0].revents & (POLLIN | POLLERR | POLLHUP))) {
+        wl_display_cancel_read(display);
+        return 0;
+    }
+    if (wl_display_read_events(display) < 0) {
+        return -1;
+    }
+    return wl_display_dispatch_pending(display);
+}
+
+// Routes SIGINT/SIGTERM to the self-pipe; safe to call more than once
+static bool
+trace_catch_stop_signals(void)
+{
+    if (trace_state.signal_pipe[0] >= 0) {
+        return true;
+    }
+    if (pipe(trace_state.signal_pipe) != 0) {
+        trace_state.signal_pipe[0] = trace_state.signal_pipe[1] = -1;
+        return false;
+    }
+    for (int i = 0; i < 2; ++i) {
+        fcntl(trace_state.signal_pipe[i], F_SETFD, FD_CLOEXEC);
+        fcntl(trace_state.signal_pipe[i], F_SETFL, O_NONBLOCK);
+    }
+    struct sigaction action = { .sa_handler = trace_signal_handler };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    return true;
+}
+
+static void
+trace_init(const char *process_name)
+{
+    const char *path = getenv("MYWAYLAND_TRACE");
+    if (!path || !*path) {
+        return;
+    }
+
+    size_t len = strlen(path);
+    trace_state.path = path;
+    trace_state.process_name = process_name;
+    trace_state.perfetto = (len > 8 && strcmp(path + len - 8, ".pftrace") == 0) ||
+                           (len > 15 && strcmp(path + len - 15, ".perfetto-trace") == 0);
+    trace_state.enabled = true;
+
+    atexit(trace_shutdown);
+    if (!trace_catch_stop_signals()) {
+        fprintf(stderr, "[TRACE] No signal pipe; Ctrl-C will lose the trace\n");
+    }
+    trace_set_thread_name("main");
+    fprintf(stderr, "[TRACE] Recording %s trace to %s\n",
+            trace_state.perfetto ? "Perfetto" : "Chrome JSON", path);
+}
+
+#endif
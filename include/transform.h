@@ -0,0 +1,98 @@
+#ifndef MYWAYLAND_TRANSFORM_H
+#define MYWAYLAND_TRANSFORM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************
+ * @BUFFER TRANSFORMS
+ *******************************************
+ *
+ * Drawing in an output's native orientation. A client that knows its
+ * output is rotated (wl_output.geometry) can draw its buffers already
+ * rotated and say so with wl_surface.set_buffer_transform; the compositor
+ * then composites or scans out the buffer as is instead of rotating it
+ * every frame.
+ *
+ * - Surface coordinates are what the layout uses; buffer coordinates are
+ *   the pixels in memory. For the 90/270 transforms the buffer is the
+ *   surface with width and height swapped.
+ * - transform_rect() maps a surface rect of a `width` x `height` surface
+ *   to buffer pixels (the same mapping compositors use to read damage).
+ *   Mapping back is transform_rect() with transform_invert() and the
+ *   buffer size.
+ * - transform_ndc[] is the same mapping as a 2x2 column-major matrix on
+ *   GL normalized device coordinates (y up), for vertex shaders.
+ *
+ * The values are those of enum wl_output_transform.
+ *******************************************/
+
+struct transform_rect {
+    int32_t x, y, width, height;
+};
+
+static inline bool
+transform_swaps(uint32_t transform)
+{
+    return transform & 1;
+}
+
+static inline uint32_t
+transform_invert(uint32_t transform)
+{
+    // Only the plain 90/270 rotations are not their own inverse
+    return transform == 1 ? 3 : transform == 3 ? 1 : transform;
+}
+
+// Buffer size for a surface of `width` x `height`
+static inline void
+transform_size(uint32_t transform, int32_t width, int32_t height,
+               int32_t *buffer_width, int32_t *buffer_height)
+{
+    *buffer_width = transform_swaps(transform) ? height : width;
+    *buffer_height = transform_swaps(transform) ? width : height;
+}
+
+static inline void
+transform_point(uint32_t transform, int32_t width, int32_t height,
+                int32_t x, int32_t y, int32_t *bx, int32_t *by)
+{
+    switch (transform & 7) {
+    case 0: *bx = x;          *by = y;          break;     // normal
+    case 1: *bx = y;          *by = width - x;  break;     // 90
+    case 2: *bx = width - x;  *by = height - y; break;     // 180
+    case 3: *bx = height - y; *by = x;          break;     // 270
+    case 4: *bx = width - x;  *by = y;          break;     // flipped
+    case 5: *bx = y;          *by = x;          break;     // flipped-90
+    case 6: *bx = x;          *by = height - y; break;     // flipped-180
+    case 7: *bx = height - y; *by = width - x;  break;     // flipped-270
+    }
+}
+
+static inline struct transform_rect
+transform_rect(uint32_t transform, int32_t width, int32_t height, struct transform_rect rect)
+{
+    if (transform == 0) {
+        return rect;
+    }
+    int32_t x0, y0, x1, y1;
+    transform_point(transform, width, height, rect.x, rect.y, &x0, &y0);
+    transform_point(transform, width, height, rect.x + rect.width, rect.y + rect.height, &x1, &y1);
+    return (struct transform_rect){
+        x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1,
+        x0 < x1 ? x1 - x0 : x0 - x1, y0 < y1 ? y1 - y0 : y0 - y1,
+    };
+}
+
+static const float transform_ndc[8][4] = {
+    {  1,  0,  0,  1 },     // normal
+    {  0,  1, -1,  0 },     // 90:          (x, y) -> (-y,  x)
+    { -1,  0,  0, -1 },     // 180:         (x, y) -> (-x, -y)
+    {  0, -1,  1,  0 },     // 270:         (x, y) -> ( y, -x)
+    { -1,  0,  0,  1 },     // flipped:     (x, y) -> (-x,  y)
+    {  0, -1, -1,  0 },     // flipped-90:  (x, y) -> (-y, -x)
+    {  1,  0,  0, -1 },     // flipped-180: (x, y) -> ( x, -y)
+    {  0,  1,  1,  0 },     // flipped-270: (x, y) -> ( y,  x)
+};
+
+#endif
@@ -0,0 +1,483 @@
+#ifndef MYWAYLAND_WIRE_H
+#define MYWAYLAND_WIRE_H
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*******************************************
+ * @MINIMAL WAYLAND WIRE CLIENT
+ *******************************************
+ *
+ * The part of libwayland-client a listen-only client actually uses: the
+ * socket, the wire format, fd passing and an object table. No proxies,
+ * no event queues, no interface introspection, no malloc; everything
+ * lives in one struct wire the caller places where it likes.
+ *
+ * - Connection: $WAYLAND_SOCKET (an inherited fd) or
+ *   $XDG_RUNTIME_DIR/$WAYLAND_DISPLAY (default wayland-0; an absolute
+ *   WAYLAND_DISPLAY is used as is), like wl_display_connect.
+ * - Messages are a header of object id and (size << 16 | opcode), then
+ *   32-bit arguments: strings and arrays are length-prefixed and padded
+ *   to 4 bytes, fds travel out of band as SCM_RIGHTS and are taken from
+ *   a queue in order of arrival.
+ * - Objects: a static table indexed by id. Interfaces only describe their
+ *   events, one signature per opcode in libwayland's letters (i u f s o
+ *   n a h). Decoded arguments point into the receive buffer and are valid
+ *   for the duration of the handler.
+ * - Ids: the lowest free slot or the next one, which is what the server
+ *   accepts. A slot is freed only by wl_display.delete_id. An object the
+ *   client has destroyed keeps its interface with no handler until then,
+ *   so events still in flight (and their fds) are consumed properly.
+ * - wire_send() flushes when the output buffer is full and, if the socket
+ *   is full too, reads and dispatches until it has room, like
+ *   wl_display_flush callers have to.
+ * - Counters: messages each way, and the recvmsg/sendmsg calls they took.
+ *
+ * Events for ids outside the table are skipped; one carrying an fd would
+ * desynchronize the fd queue, so the client must only create objects
+ * through wire_new_object().
+ *******************************************/
+#define WIRE_MAX_OBJECTS 1024
+#define WIRE_IN_SIZE     16384
+#define WIRE_OUT_SIZE    4096
+#define WIRE_MAX_FDS     28          // libwayland's per-message limit
+#define WIRE_MAX_ARGS    8
+#define WIRE_DISPLAY_ID  1
+
+union wire_arg {
+    int32_t i;                       // i, f (24.8 fixed point)
+    uint32_t u;                      // u, o, n
+    int fd;                          // h, owned by the handler
+    const char *s;                   // NULL for a null string
+    struct {
+        const void *data;
+        uint32_t size;
+    } a;
+};
+
+typedef void (*wire_event_fn)(void *data, uint32_t id, uint16_t opcode, const union wire_arg *args);
+
+struct wire_interface {
+    const char *name;
+    int event_count;
+    const char *const *events;
+};
+
+struct wire_object {
+    const struct wire_interface *interface;     // NULL: free slot
+    wire_event_fn fn;                           // NULL: destroyed, events are dropped
+    void *data;
+};
+
+struct wire {
+    int fd;
+    bool error;
+    struct wire_object objects[WIRE_MAX_OBJECTS];
+    uint32_t next_id;                // One past the highest id in use so far
+    uint8_t in[WIRE_IN_SIZE];
+    size_t in_length;
+    uint8_t out[WIRE_OUT_SIZE];
+    size_t out_length;
+    int fds[WIRE_MAX_FDS];
+    int fd_count;
+
+    uint64_t messages_in, messages_out, reads, writes;
+};
+
+static const char *const wire_display_events[] = {
+    "ous",                           // error
+    "u",                             // delete_id
+};
+
+static const struct wire_interface wire_display_interface = {
+    "wl_display", 2, wire_display_events,
+};
+
+static const char *const wire_callback_events[] = {
+    "u",                             // done
+};
+
+static const struct wire_interface wire_callback_interface = {
+    "wl_callback", 1, wire_callback_events,
+};
+
+static void
+wire_display_event(void *data, uint32_t id, uint16_t opcode, const union wire_arg *args)
+{
+    struct wire *wire = data;
+    if (opcode == 0) {
+        const struct wire_object *object = args[0].u < WIRE_MAX_OBJECTS ? &wire->objects[args[0].u] : NULL;
+        fprintf(stderr, "[WIRE] protocol error on %s@%u, code %u: %s\n",
+                object && object->interface ? object->interface->name : "unknown", args[0].u,
+                args[1].u, args[2].s ? args[2].s : "");
+        wire->error = true;
+    } else if (args[0].u > WIRE_DISPLAY_ID && args[0].u < WIRE_MAX_OBJECTS) {
+        wire->objects[args[0].u] = (struct wire_object){0};
+    }
+}
+
+static bool
+wire_connect(struct wire *wire)
+{
+    memset(wire, 0, sizeof(*wire));
+    wire->objects[WIRE_DISPLAY_ID] = (struct wire_object){ &wire_display_interface, wire_display_event, wire };
+    wire->next_id = WIRE_DISPLAY_ID + 1;
+
+    const char *inherited = getenv("WAYLAND_SOCKET");
+    if (inherited) {
+        wire->fd = atoi(inherited);
+        unsetenv("WAYLAND_SOCKET");
+        return wire->fd >= 0;
+    }
+
+    const char *display = getenv("WAYLAND_DISPLAY");
+    const char *runtime = getenv("XDG_RUNTIME_DIR");
+    display = display ? display : "wayland-0";
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int length = display[0] == '/'
+               ? snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", display)
+               : snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/%s", runtime ? runtime : "", display);
+    if ((display[0] != '/' && !runtime) || length >= (int)sizeof(addr.sun_path)) {
+        errno = ENOENT;
+        return false;
+    }
+    wire->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (wire->fd < 0) {
+        return false;
+    }
+    if (connect(wire->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(wire->fd);
+        wire->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+static void
+wire_disconnect(struct wire *wire)
+{
+    for (int i = 0; i < wire->fd_count; ++i) {
+        close(wire->fds[i]);
+    }
+    wire->fd_count = 0;
+    if (wire->fd >= 0) {
+        close(wire->fd);
+        wire->fd = -1;
+    }
+}
+
+// New client object; returns its id, or 0 when the table is full
+static uint32_t
+wire_new_object(struct wire *wire, const struct wire_interface *interface, wire_event_fn fn, void *data)
+{
+    uint32_t id = WIRE_DISPLAY_ID + 1;
+    while (id < wire->next_id && wire->objects[id].interface) {
+        ++id;
+    }
+    if (id >= WIRE_MAX_OBJECTS) {
+        return 0;
+    }
+    if (id == wire->next_id) {
+        ++wire->next_id;
+    }
+    wire->objects[id] = (struct wire_object){ interface, fn, data };
+    return id;
+}
+
+// After a destructor request: drop events until the server's delete_id
+static inline void
+wire_destroy_object(struct wire *wire, uint32_t id)
+{
+    if (id < WIRE_MAX_OBJECTS) {
+        wire->objects[id].fn = NULL;
+    }
+}
+
+// Sends what is buffered; false on a dead connection (a full socket is fine)
+static bool
+wire_flush(struct wire *wire)
+{
+    while (wire->out_length > 0) {
+        ++wire->writes;
+        ssize_t sent = send(wire->fd, wire->out, wire->out_length, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return true;
+            }
+            wire->error = true;
+            return false;
+        }
+        memmove(wire->out, wire->out + sent, wire->out_length - sent);
+        wire->out_length -= sent;
+    }
+    return true;
+}
+
+/*******************************************
+ * wire_read:
+ * - One recvmsg into the free end of the receive buffer, fds appended to
+ *   the queue. Blocks unless `wait` is false. Returns the bytes read, 0
+ *   if nothing was there (or EINTR), -1 when the connection is gone.
+ *******************************************/
+static ssize_t
+wire_read(struct wire *wire, bool wait)
+{
+    if (wire->in_length == sizeof(wire->in)) {
+        return 0;                    // Dispatch first
+    }
+    struct iovec iov = { wire->in + wire->in_length, sizeof(wire->in) - wire->in_length };
+    char control[CMSG_SPACE(sizeof(int) * WIRE_MAX_FDS)];
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof(control),
+    };
+    ++wire->reads;
+    ssize_t length = recvmsg(wire->fd, &msg, MSG_CMSG_CLOEXEC | (wait ? 0 : MSG_DONTWAIT));
+    if (length < 0) {
+        if (errno == EINTR || errno == EAGAIN) {
+            return 0;
+        }
+        wire->error = true;
+        return -1;
+    }
+    if (length == 0) {
+        fprintf(stderr, "[WIRE] compositor closed the connection\n");
+        wire->error = true;
+        return -1;
+    }
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (int i = 0; i < count; ++i) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (wire->fd_count < WIRE_MAX_FDS) {
+                wire->fds[wire->fd_count++] = fd;
+            } else {
+                close(fd);
+            }
+        }
+    }
+    wire->in_length += length;
+    return length;
+}
+
+// Decodes one message's arguments against `signature`; false if malformed
+static bool
+wire_decode(struct wire *wire, const char *signature, const uint8_t *body, size_t size,
+            union wire_arg *args)
+{
+    size_t offset = 0;
+    int count = 0;
+    for (const char *c = signature; *c; ++c) {
+        if (*c == '?') {
+            continue;
+        }
+        if (count == WIRE_MAX_ARGS) {
+            return false;
+        }
+        union wire_arg *arg = &args[count++];
+        if (*c == 'h') {
+            if (wire->fd_count == 0) {
+                return false;
+            }
+            arg->fd = wire->fds[0];
+            memmove(wire->fds, wire->fds + 1, --wire->fd_count * sizeof(int));
+            continue;
+        }
+        if (offset + 4 > size) {
+            return false;
+        }
+        uint32_t word;
+        memcpy(&word, body + offset, 4);
+        offset += 4;
+        if (*c == 's' || *c == 'a') {
+            size_t padded = ((size_t)word + 3) & ~(size_t)3;
+            if (offset + padded > size) {
+                return false;
+            }
+            if (*c == 's') {
+                if (word > 0 && body[offset + word - 1] != '\0') {
+                    return false;
+                }
+                arg->s = word ? (const char *)body + offset : NULL;
+            } else {
+                arg->a.data = body + offset;
+                arg->a.size = word;
+            }
+            offset += padded;
+        } else {
+            arg->u = word;
+        }
+    }
+    return true;
+}
+
+/*******************************************
+ * wire_dispatch:
+ * - Runs the handlers of every complete message in the receive buffer and
+ *   keeps a trailing partial one for the next read. Returns the number of
+ *   messages, or -1 on a malformed one.
+ *******************************************/
+static int
+wire_dispatch(struct wire *wire)
+{
+    size_t offset = 0;
+    int dispatched = 0;
+    while (!wire->error && wire->in_length - offset >= 8) {
+        uint32_t header[2];
+        memcpy(header, wire->in + offset, sizeof(header));
+        uint32_t id = header[0], size = header[1] >> 16;
+        uint16_t opcode = header[1] & 0xffff;
+        if (size < 8 || size % 4 != 0) {
+            fprintf(stderr, "[WIRE] bad message size %u\n", size);
+            wire->error = true;
+            return -1;
+        }
+        if (wire->in_length - offset < size) {
+            break;
+        }
+
+        const struct wire_object *object = id < WIRE_MAX_OBJECTS ? &wire->objects[id] : NULL;
+        if (object && object->interface) {
+            union wire_arg args[WIRE_MAX_ARGS];
+            if (opcode >= object->interface->event_count ||
+                !wire_decode(wire, object->interface->events[opcode], wire->in + offset + 8, size - 8, args)) {
+                fprintf(stderr, "[WIRE] malformed %s event %u\n", object->interface->name, opcode);
+                wire->error = true;
+                return -1;
+            }
+            if (object->fn) {
+                object->fn(object->data, id, opcode, args);
+            } else if (strchr(object->interface->events[opcode], 'h')) {
+                // Destroyed object: still close what it was sent
+                int arg = 0;
+                for (const char *c = object->interface->events[opcode]; *c; ++c) {
+                    if (*c == 'h') {
+                        close(args[arg].fd);
+                    }
+                    arg += *c != '?';
+                }
+            }
+        }
+        ++wire->messages_in;
+        ++dispatched;
+        offset += size;
+    }
+    memmove(wire->in, wire->in + offset, wire->in_length - offset);
+    wire->in_length -= offset;
+    return dispatched;
+}
+
+/*******************************************
+ * wire_wait:
+ * - Waits until the socket is readable (or writable, with output
+ *   pending), then reads, dispatches and flushes. Returns -1 when the
+ *   connection is gone; EINTR returns 0 so signals are noticed.
+ *******************************************/
+static int
+wire_wait(struct wire *wire)
+{
+    if (!wire_flush(wire)) {
+        return -1;
+    }
+    struct pollfd pfd = { .fd = wire->fd, .events = POLLIN | (wire->out_length ? POLLOUT : 0) };
+    if (poll(&pfd, 1, -1) < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    int dispatched = 0;
+    if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+        if (wire_read(wire, false) < 0) {
+            return -1;
+        }
+        dispatched = wire_dispatch(wire);
+    }
+    return wire->error || !wire_flush(wire) ? -1 : dispatched;
+}
+
+/*******************************************
+ * wire_send:
+ * - Marshals one request. `signature` has one letter per argument:
+ *   u/i/o/n (32-bit) or s (string, NULL allowed). No fds are ever sent.
+ *******************************************/
+static bool
+wire_send(struct wire *wire, uint32_t id, uint16_t opcode, const char *signature, ...)
+{
+    va_list ap;
+    size_t size = 8;
+    va_start(ap, signature);
+    for (const char *c = signature; *c; ++c) {
+        if (*c == 's') {
+            const char *s = va_arg(ap, const char *);
+            size += 4 + (s ? (strlen(s) + 1 + 3) & ~(size_t)3 : 0);
+        } else {
+            (void)va_arg(ap, uint32_t);
+            size += 4;
+        }
+    }
+    va_end(ap);
+    if (size > sizeof(wire->out) || size > 0xffff) {
+        return false;
+    }
+    while (wire->out_length + size > sizeof(wire->out)) {
+        if (!wire_flush(wire) || (wire->out_length + size > sizeof(wire->out) && wire_wait(wire) < 0)) {
+            return false;
+        }
+    }
+
+    uint8_t *out = wire->out + wire->out_length;
+    uint32_t header[2] = { id, (uint32_t)size << 16 | opcode };
+    memcpy(out, header, sizeof(header));
+    size_t offset = sizeof(header);
+    va_start(ap, signature);
+    for (const char *c = signature; *c; ++c) {
+        if (*c == 's') {
+            const char *s = va_arg(ap, const char *);
+            uint32_t length = s ? strlen(s) + 1 : 0;
+            memcpy(out + offset, &length, 4);
+            offset += 4;
+            if (s) {
+                size_t padded = (length + 3) & ~(size_t)3;
+                memset(out + offset + length, 0, padded - length);
+                memcpy(out + offset, s, length);
+                offset += padded;
+            }
+        } else {
+            uint32_t word = va_arg(ap, uint32_t);
+            memcpy(out + offset, &word, 4);
+            offset += 4;
+        }
+    }
+    va_end(ap);
+    wire->out_length += size;
+    ++wire->messages_out;
+    return true;
+}
+
+static void
+wire_report(const struct wire *wire, const char *label)
+{
+    fprintf(stderr, "[WIRE] %s: %llu events in %llu reads, %llu requests in %llu writes, "
+            "%u object ids used\n", label,
+            (unsigned long long)wire->messages_in, (unsigned long long)wire->reads,
+            (unsigned long long)wire->messages_out, (unsigned long long)wire->writes,
+            wire->next_id - 1);
+}
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef MYWAYLAND_YUV_H
+#define MYWAYLAND_YUV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define YUV_X86 1
+#endif
+
+/*******************************************
+ * @I420 -> XRGB8888 CONVERSION
+ *******************************************
+ *
+ * Converts planar 4:2:0 YUV (BT.601, limited range, the Y4M default) into
+ * the XRGB8888 layout wl_shm buffers use.
+ *
+ * - Fixed point with 6 fractional bits, small enough that every term fits
+ *   a signed 16-bit lane:
+ *       c = (Y - 16) * 74,  d = U - 128,  e = V - 128
+ *       R = (c + 102 e) >> 6
+ *       G = (c -  25 d - 52 e) >> 6
+ *       B = (c + 129 d) >> 6
+ *   Additions saturate, which only matters for B on the brightest blues
+ *   and is clamped to 255 anyway. The scalar path computes exactly the
+ *   same values, so every kernel produces identical output.
+ * - SSE2 converts 16 pixels per iteration and AVX2 32. Both are compiled
+ *   with target attributes, so the file needs no -mavx2 and the same
+ *   binary runs on any x86-64. yuv_select() picks one with
+ *   __builtin_cpu_supports.
+ * - Work is done in whole rows, so callers can split a frame into row
+ *   bands and convert them on different threads.
+ *******************************************/
+
+struct yuv_frame {
+    const uint8_t *y, *u, *v;
+    int width, height;
+    int y_stride, uv_stride;
+};
+
+typedef void (*yuv_row_fn)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                           uint32_t *dst, int width);
+
+static inline uint8_t
+yuv_clamp(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static inline int
+yuv_sat16(int v)
+{
+    return v < -32768 ? -32768 : (v > 32767 ? 32767 : v);
+}
+
+static inline uint32_t
+yuv_pixel(int y, int u, int v)
+{
+    int c = (y - 16) * 74, d = u - 128, e = v - 128;
+    int r = yuv_sat16(c + 102 * e) >> 6;
+    int g = yuv_sat16(yuv_sat16(c - 25 * d) - 52 * e) >> 6;
+    int b = yuv_sat16(c + 129 * d) >> 6;
+    return 0xff000000u | (uint32_t)yuv_clamp(r) << 16 | (uint32_t)yuv_clamp(g) << 8 | yuv_clamp(b);
+}
+
+static void
+yuv_row_scalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t *dst, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        dst[x] = yuv_pixel(y[x], u[x / 2], v[x / 2]);
+    }
+}
+
+#ifdef YUV_X86
+
+// R, G, B for 8 pixels in 16-bit lanes
+#define YUV_RGB16(prefix, type, c, d, e, r, g, b) do { \
+        type c_ = prefix##_mullo_epi16(prefix##_sub_epi16(c, prefix##_set1_epi16(16)), prefix##_set1_epi16(74)); \
+        type d_ = prefix##_sub_epi16(d, prefix##_set1_epi16(128)); \
+        type e_ = prefix##_sub_epi16(e, prefix##_set1_epi16(128)); \
+        r = prefix##_srai_epi16(prefix##_adds_epi16(c_, prefix##_mullo_epi16(e_, prefix##_set1_epi16(102))), 6); \
+        g = prefix##_srai_epi16(prefix##_subs_epi16(prefix##_subs_epi16(c_, \
+                prefix##_mullo_epi16(d_, prefix##_set1_epi16(25))), \
+                prefix##_mullo_epi16(e_, prefix##_set1_epi16(52))), 6); \
+        b = prefix##_srai_epi16(prefix##_adds_epi16(c_, prefix##_mullo_epi16(d_, prefix##_set1_epi16(129))), 6); \
+    } while (0)
+
+__attribute__((target("sse2")))
+static void
+yuv_row_sse2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i y8 = _mm_loadu_si128((const __m128i *)(y + x));
+        __m128i u8 = _mm_loadl_epi64((const __m128i *)(u + x / 2));
+        __m128i v8 = _mm_loadl_epi64((const __m128i *)(v + x / 2));
+
+        __m128i u16 = _mm_unpacklo_epi8(u8, zero);
+        __m128i v16 = _mm_unpacklo_epi8(v8, zero);
+        // Each chroma sample covers two pixels
+        __m128i u_lo = _mm_unpacklo_epi16(u16, u16), u_hi = _mm_unpackhi_epi16(u16, u16);
+        __m128i v_lo = _mm_unpacklo_epi16(v16, v16), v_hi = _mm_unpackhi_epi16(v16, v16);
+
+        __m128i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+        YUV_RGB16(_mm, __m128i, _mm_unpacklo_epi8(y8, zero), u_lo, v_lo, r_lo, g_lo, b_lo);
+        YUV_RGB16(_mm, __m128i, _mm_unpackhi_epi8(y8, zero), u_hi, v_hi, r_hi, g_hi, b_hi);
+
+        __m128i r = _mm_packus_epi16(r_lo, r_hi);
+        __m128i g = _mm_packus_epi16(g_lo, g_hi);
+        __m128i b = _mm_packus_epi16(b_lo, b_hi);
+
+        // Little-endian XRGB8888 is B, G, R, X in memory
+        __m128i bg_lo = _mm_unpacklo_epi8(b, g), bg_hi = _mm_unpackhi_epi8(b, g);
+        __m128i ra_lo = _mm_unpacklo_epi8(r, alpha), ra_hi = _mm_unpackhi_epi8(r, alpha);
+        _mm_storeu_si128((__m128i *)(dst + x + 0), _mm_unpacklo_epi16(bg_lo, ra_lo));
+        _mm_storeu_si128((__m128i *)(dst + x + 4), _mm_unpackhi_epi16(bg_lo, ra_lo));
+        _mm_storeu_si128((__m128i *)(dst + x + 8), _mm_unpacklo_epi16(bg_hi, ra_hi));
+        _mm_storeu_si128((__m128i *)(dst + x + 12), _mm_unpackhi_epi16(bg_hi, ra_hi));
+    }
+    yuv_row_scalar(y + x, u + x / 2, v + x / 2, dst + x, width - x);
+}
+
+/*******************************************
+ * AVX2 unpacks work within 128-bit lanes, so the chroma is spread with a
+ * cross-lane permute first and the packed bytes are put back in order
+ * with another; the final interleave stays lane-local and is stored as
+ * two halves.
+ *******************************************/
+__attribute__((target("avx2")))
+static void
+yuv_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint32_t *dst, int width)
+{
+    const __m256i alpha = _mm256_set1_epi8((char)0xff);
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        __m256i y_lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(y + x)));
+        __m256i y_hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(y + x + 16)));
+        __m256i u16 = _mm256_permute4x64_epi64(
+                _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + x / 2))), 0xd8);
+        __m256i v16 = _mm256_permute4x64_epi64(
+                _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + x / 2))), 0xd8);
+        __m256i u_lo = _mm256_unpacklo_epi16(u16, u16), u_hi = _mm256_unpackhi_epi16(u16, u16);
+        __m256i v_lo = _mm256_unpacklo_epi16(v16, v16), v_hi = _mm256_unpackhi_epi16(v16, v16);
+
+        __m256i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+        YUV_RGB16(_mm256, __m256i, y_lo, u_lo, v_lo, r_lo, g_lo, b_lo);
+        YUV_RGB16(_mm256, __m256i, y_hi, u_hi, v_hi, r_hi, g_hi, b_hi);
+
+        __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(r_lo, r_hi), 0xd8);
+        __m256i g = _mm256_permute4x64_epi64(_mm256_packus_epi16(g_lo, g_hi), 0xd8);
+        __m256i b = _mm256_permute4x64_epi64(_mm256_packus_epi16(b_lo, b_hi), 0xd8);
+
+        // Lane 0 holds pixels 0-7 / 8-15, lane 1 pixels 16-23 / 24-31
+        __m256i bg_lo = _mm256_unpacklo_epi8(b, g), bg_hi = _mm256_unpackhi_epi8(b, g);
+        __m256i ra_lo = _mm256_unpacklo_epi8(r, alpha), ra_hi = _mm256_unpackhi_epi8(r, alpha);
+        __m256i p0 = _mm256_unpacklo_epi16(bg_lo, ra_lo);   // 0-3   | 16-19
+        __m256i p1 = _mm256_unpackhi_epi16(bg_lo, ra_lo);   // 4-7   | 20-23
+        __m256i p2 = _mm256_unpacklo_epi16(bg_hi, ra_hi);   // 8-11  | 24-27
+        __m256i p3 = _mm256_unpackhi_epi16(bg_hi, ra_hi);   // 12-15 | 28-31
+        _mm256_storeu_si256((__m256i *)(dst + x + 0), _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + x + 8), _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + x + 16), _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256((__m256i *)(dst + x + 24), _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    yuv_row_sse2(y + x, u + x / 2, v + x / 2, dst + x, width - x);
+}
+
+#undef YUV_RGB16
+
+#endif /* YUV_X86 */
+
+/*******************************************
+ * yuv_select:
+ * - Returns the fastest row kernel this CPU supports, or the one named by
+ *   `name` ("scalar", "sse2", "avx2") when given and supported.
+ * - `*chosen` receives the kernel's name.
+ *******************************************/
+static yuv_row_fn
+yuv_select(const char *name, const char **chosen)
+{
+#ifdef YUV_X86
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse2 = __builtin_cpu_supports("sse2");
+    if (avx2 && (!name || strcmp(name, "avx2") == 0)) {
+        *chosen = "avx2";
+        return yuv_row_avx2;
+    }
+    if (sse2 && (!name || strcmp(name, "avx2") == 0 || strcmp(name, "sse2") == 0)) {
+        *chosen = "sse2";
+        return yuv_row_sse2;
+    }
+#endif
+    *chosen = "scalar";
+    return yuv_row_scalar;
+}
+
+// Converts rows [row_start, row_end) of `frame` into `dst`
+static void
+yuv_convert_rows(yuv_row_fn row_fn, const struct yuv_frame *frame,
+                 uint32_t *dst, int dst_stride, int row_start, int row_end)
+{
+    for (int row = row_start; row < row_end; ++row) {
+        row_fn(frame->y + (size_t)row * frame->y_stride,
+               frame->u + (size_t)(row / 2) * frame->uv_stride,
+               frame->v + (size_t)(row / 2) * frame->uv_stride,
+               (uint32_t *)((uint8_t *)dst + (size_t)row * dst_stride),
+               frame->width);
+    }
+}
+
+#endif
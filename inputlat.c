@@ -0,0 +1,702 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <linux/input-event-codes.h>
+#include <wayland-client.h>
+#include <xkbcommon/xkbcommon.h>
+#include "protocols/xdg-shell-client-protocol.h"
+#include "protocols/src/xdg-shell-client-protocol.c"
+#include "protocols/virtual-keyboard-unstable-v1-client-protocol.h"
+#include "protocols/src/virtual-keyboard-unstable-v1-client-protocol.c"
+#include "protocols/wlr-virtual-pointer-unstable-v1-client-protocol.h"
+#include "protocols/src/wlr-virtual-pointer-unstable-v1-client-protocol.c"
+#include "include/trace.h"
+#include "include/shm.h"
+#include "include/input.h"
+
+/**********************************************
+ * @LOOPBACK INPUT LATENCY
+ **********************************************
+ *
+ * Measures how long the compositor takes to turn an input event into a
+ * wl_keyboard / wl_pointer event on a focused surface, by being both ends:
+ *
+ * - A fullscreen xdg_toplevel takes keyboard focus and the pointer.
+ * - Key presses are injected through zwp_virtual_keyboard_v1 (with a
+ *   keymap compiled by xkbcommon), pointer motion through
+ *   zwlr_virtual_pointer_v1, on the same seat. Each kind runs only when
+ *   the compositor offers its manager.
+ * - One injection is in flight at a time: the request is timestamped
+ *   right before the flush, and the matching wl_keyboard.key (press) or
+ *   wl_pointer.motion is timestamped when its handler runs. Both stamps
+ *   come from CLOCK_MONOTONIC in this process, so the difference covers
+ *   the socket both ways, the compositor's input path and our dispatch.
+ * - Injections are --interval ms apart so they are never coalesced; one
+ *   that is not delivered within a second is counted as lost.
+ * - Each injection carries a unique event time, which the compositor
+ *   passes through to wl_keyboard.key / wl_pointer.motion. A delivery with
+ *   any other time belongs to an injection already counted as lost; it is
+ *   counted as late and never attributed to the one in flight.
+ *
+ * --load N runs N spinning threads alongside (one per CPU saturates the
+ * machine), so the same run can be repeated under increasing load;
+ * scripts/input_latency.sh does that on a headless compositor.
+ *
+ * @OUTPUT:
+ * - `[INPUTLAT] <kind>`: samples, lost, late, min/p50/p90/p99/max in µs.
+ * - A log2 histogram of the samples in µs below each summary.
+ **********************************************/
+
+#define INPUTLAT_TIMEOUT_MS 1000
+#define INPUTLAT_HISTOGRAM  24           // Buckets of [2^i, 2^(i+1)) µs
+#define INPUTLAT_WIDTH      320
+#define INPUTLAT_HEIGHT     240
+#define INPUTLAT_KEY        KEY_A
+
+enum inputlat_kind {
+    INPUTLAT_KEYBOARD,
+    INPUTLAT_POINTER,
+};
+
+struct inputlat {
+    struct wl_display *display;
+    struct wl_compositor *compositor;
+    struct wl_shm *shm;
+    struct xdg_wm_base *wm_base;
+    struct wl_seat *seat;
+    struct zwp_virtual_keyboard_manager_v1 *keyboard_manager;
+    struct zwlr_virtual_pointer_manager_v1 *pointer_manager;
+    struct zwp_virtual_keyboard_v1 *virtual_keyboard;
+    struct zwlr_virtual_pointer_v1 *virtual_pointer;
+    struct input_seat input;
+
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *xdg_toplevel;
+    struct wl_buffer *buffer;
+    bool configured;
+    bool closed;
+    bool keyboard_focus;
+    bool pointer_focus;
+
+    // The injection in flight
+    bool waiting;
+    enum inputlat_kind kind;
+    uint32_t stamp;                 // Its event time, unique per injection
+    double injected_ns;
+    double delivered_ns;
+    int late;                       // Deliveries of injections already lost
+};
+
+static atomic_bool load_stop;
+
+static double
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint32_t
+now_ms(void)
+{
+    return (uint32_t)(now_ns() / 1e6);
+}
+
+static void
+delivered(struct inputlat *lat, enum inputlat_kind kind, uint32_t time)
+{
+    if (lat->kind == kind && time != lat->stamp) {
+        ++lat->late;
+        return;
+    }
+    if (lat->waiting && lat->kind == kind) {
+        lat->delivered_ns = now_ns();
+        lat->waiting = false;
+        TRACE_INSTANT("input", kind == INPUTLAT_KEYBOARD ? "key delivered" : "motion delivered");
+    }
+}
+
+/* Keyboard */
+
+static void
+keyboard_keymap(void *data, struct wl_keyboard *keyboard, uint32_t format, int32_t fd, uint32_t size)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_KEYBOARD);
+    close(fd);      // Key codes are all we look at
+}
+
+static void
+keyboard_enter(void *data, struct wl_keyboard *keyboard, uint32_t serial,
+               struct wl_surface *surface, struct wl_array *keys)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_KEYBOARD);
+    lat->keyboard_focus = surface == lat->surface;
+}
+
+static void
+keyboard_leave(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_KEYBOARD);
+    lat->keyboard_focus = false;
+}
+
+static void
+keyboard_key(void *data, struct wl_keyboard *keyboard, uint32_t serial,
+             uint32_t time, uint32_t key, uint32_t state)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_KEYBOARD);
+    if (key == INPUTLAT_KEY && state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+        delivered(lat, INPUTLAT_KEYBOARD, time);
+    }
+}
+
+static void
+keyboard_modifiers(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t depressed,
+                   uint32_t latched, uint32_t locked, uint32_t group)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_KEYBOARD);
+}
+
+static const struct wl_keyboard_listener keyboard_listener = {
+    .keymap = keyboard_keymap,
+    .enter = keyboard_enter,
+    .leave = keyboard_leave,
+    .key = keyboard_key,
+    .modifiers = keyboard_modifiers,
+};
+
+/* Pointer */
+
+static void
+pointer_enter(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface,
+              wl_fixed_t x, wl_fixed_t y)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_POINTER);
+    lat->pointer_focus = surface == lat->surface;
+    wl_pointer_set_cursor(pointer, serial, NULL, 0, 0);
+}
+
+static void
+pointer_leave(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_POINTER);
+    lat->pointer_focus = false;
+}
+
+static void
+pointer_motion(void *data, struct wl_pointer *pointer, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_POINTER);
+    delivered(lat, INPUTLAT_POINTER, time);
+}
+
+static void
+pointer_button(void *data, struct wl_pointer *pointer, uint32_t serial, uint32_t time,
+               uint32_t button, uint32_t state)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_POINTER);
+}
+
+static void
+pointer_axis(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis, wl_fixed_t value)
+{
+    struct inputlat *lat = data;
+    input_seat_event(&lat->input, WL_SEAT_CAPABILITY_POINTER);
+}
+
+static const struct wl_pointer_listener pointer_listener = {
+    .enter = pointer_enter,
+    .leave = pointer_leave,
+    .motion = pointer_motion,
+    .button = pointer_button,
+    .axis = pointer_axis,
+};
+
+/* Seat and globals */
+
+static void
+seat_capabilities(void *data, struct wl_seat *seat, uint32_t capabilities)
+{
+    struct inputlat *lat = data;
+    input_seat_capabilities(&lat->input, capabilities);
+}
+
+static void
+seat_name(void *data, struct wl_seat *seat, const char *name)
+{
+}
+
+static const struct wl_seat_listener seat_listener = {
+    .capabilities = seat_capabilities,
+    .name = seat_name,
+};
+
+static void
+wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+    .ping = wm_base_ping,
+};
+
+static void
+registry_global(void *data, struct wl_registry *registry, uint32_t name,
+                const char *interface, uint32_t version)
+{
+    struct inputlat *lat = data;
+    if (strcmp(interface, wl_compositor_interface.name) == 0) {
+        lat->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 1);
+    } else if (strcmp(interface, wl_shm_interface.name) == 0) {
+        lat->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+    } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+        lat->wm_base = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+        xdg_wm_base_add_listener(lat->wm_base, &wm_base_listener, lat);
+    } else if (strcmp(interface, wl_seat_interface.name) == 0 && !lat->seat) {
+        lat->seat = wl_registry_bind(registry, name, &wl_seat_interface, version < 3 ? version : 3);
+        input_seat_init(&lat->input, lat->seat,
+                        WL_SEAT_CAPABILITY_KEYBOARD | WL_SEAT_CAPABILITY_POINTER,
+                        &pointer_listener, &keyboard_listener, NULL, lat);
+        wl_seat_add_listener(lat->seat, &seat_listener, lat);
+    } else if (strcmp(interface, zwp_virtual_keyboard_manager_v1_interface.name) == 0) {
+        lat->keyboard_manager = wl_registry_bind(registry, name,
+                &zwp_virtual_keyboard_manager_v1_interface, 1);
+    } else if (strcmp(interface, zwlr_virtual_pointer_manager_v1_interface.name) == 0) {
+        lat->pointer_manager = wl_registry_bind(registry, name,
+                &zwlr_virtual_pointer_manager_v1_interface, 1);
+    }
+}
+
+static void
+registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+/* Window */
+
+static void
+xdg_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+    struct inputlat *lat = data;
+    xdg_surface_ack_configure(xdg_surface, serial);
+    if (!lat->configured) {
+        // Any size will do: fullscreen centres and letterboxes it
+        wl_surface_attach(lat->surface, lat->buffer, 0, 0);
+        wl_surface_damage_buffer(lat->surface, 0, 0, INPUTLAT_WIDTH, INPUTLAT_HEIGHT);
+        lat->configured = true;
+    }
+    wl_surface_commit(lat->surface);
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure,
+};
+
+static void
+xdg_toplevel_configure(void *data, struct xdg_toplevel *toplevel, int32_t width, int32_t height,
+                       struct wl_array *states)
+{
+}
+
+static void
+xdg_toplevel_close(void *data, struct xdg_toplevel *toplevel)
+{
+    struct inputlat *lat = data;
+    lat->closed = true;
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .configure = xdg_toplevel_configure,
+    .close = xdg_toplevel_close,
+};
+
+static bool
+create_window(struct inputlat *lat)
+{
+    int32_t stride = INPUTLAT_WIDTH * 4;
+    size_t size = (size_t)stride * INPUTLAT_HEIGHT;
+    int fd = shm_allocate(size);
+    if (fd < 0) {
+        return false;
+    }
+    uint32_t *pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pixels == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    for (size_t i = 0; i < size / 4; ++i) {
+        pixels[i] = 0xff202830;
+    }
+    munmap(pixels, size);
+    struct wl_shm_pool *pool = wl_shm_create_pool(lat->shm, fd, size);
+    lat->buffer = wl_shm_pool_create_buffer(pool, 0, INPUTLAT_WIDTH, INPUTLAT_HEIGHT, stride,
+                                            WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    lat->surface = wl_compositor_create_surface(lat->compositor);
+    lat->xdg_surface = xdg_wm_base_get_xdg_surface(lat->wm_base, lat->surface);
+    xdg_surface_add_listener(lat->xdg_surface, &xdg_surface_listener, lat);
+    lat->xdg_toplevel = xdg_surface_get_toplevel(lat->xdg_surface);
+    xdg_toplevel_add_listener(lat->xdg_toplevel, &xdg_toplevel_listener, lat);
+    xdg_toplevel_set_title(lat->xdg_toplevel, "inputlat");
+    // Fullscreen, so the pointer is on us wherever the compositor put it
+    xdg_toplevel_set_fullscreen(lat->xdg_toplevel, NULL);
+    wl_surface_commit(lat->surface);
+    return true;
+}
+
+/* Virtual devices */
+
+static bool
+create_virtual_keyboard(struct inputlat *lat)
+{
+    struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    struct xkb_keymap *keymap = context ?
+        xkb_keymap_new_from_names(context, NULL, XKB_KEYMAP_COMPILE_NO_FLAGS) : NULL;
+    char *text = keymap ? xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1) : NULL;
+    xkb_keymap_unref(keymap);
+    xkb_context_unref(context);
+    if (!text) {
+        fprintf(stderr, "[INPUTLAT] Failed to compile a keymap for the virtual keyboard\n");
+        return false;
+    }
+
+    size_t size = strlen(text) + 1;
+    int fd = shm_allocate(size);
+    char *map = fd < 0 ? MAP_FAILED : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(text);
+        return false;
+    }
+    memcpy(map, text, size);
+    munmap(map, size);
+    free(text);
+
+    lat->virtual_keyboard = zwp_virtual_keyboard_manager_v1_create_virtual_keyboard(
+            lat->keyboard_manager, lat->seat);
+    zwp_virtual_keyboard_v1_keymap(lat->virtual_keyboard, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, fd, size);
+    close(fd);
+    return true;
+}
+
+static void
+inject(struct inputlat *lat, enum inputlat_kind kind, int sequence)
+{
+    lat->kind = kind;
+    lat->waiting = true;
+    // Wall-clock ms where possible, but never repeated
+    uint32_t time = now_ms();
+    lat->stamp = time > lat->stamp ? time : lat->stamp + 1;
+    time = lat->stamp;
+    if (kind == INPUTLAT_KEYBOARD) {
+        zwp_virtual_keyboard_v1_key(lat->virtual_keyboard, time, INPUTLAT_KEY,
+                                    WL_KEYBOARD_KEY_STATE_PRESSED);
+    } else {
+        // Back and forth, so the pointer never runs into an edge
+        double dx = sequence & 1 ? -1 : 1;
+        zwlr_virtual_pointer_v1_motion(lat->virtual_pointer, time,
+                                       wl_fixed_from_double(dx), wl_fixed_from_double(0));
+        zwlr_virtual_pointer_v1_frame(lat->virtual_pointer);
+    }
+    TRACE_INSTANT("input", kind == INPUTLAT_KEYBOARD ? "key injected" : "motion injected");
+    lat->injected_ns = now_ns();
+    wl_display_flush(lat->display);
+}
+
+static void
+release_key(struct inputlat *lat)
+{
+    zwp_virtual_keyboard_v1_key(lat->virtual_keyboard, now_ms(), INPUTLAT_KEY,
+                                WL_KEYBOARD_KEY_STATE_RELEASED);
+    wl_display_flush(lat->display);
+}
+
+/*******************************************
+ * dispatch_until:
+ * - Dispatches until `*flag` equals `value` or `timeout_ms` has passed;
+ *   returns false on timeout or a dead connection.
+ *******************************************/
+static bool
+dispatch_until(struct inputlat *lat, const bool *flag, bool value, int timeout_ms)
+{
+    double deadline = now_ns() + timeout_ms * 1e6;
+    while (*flag != value && !lat->closed && !trace_stop_requested()) {
+        while (wl_display_prepare_read(lat->display) != 0) {
+            if (wl_display_dispatch_pending(lat->display) < 0) {
+                return false;
+            }
+        }
+        if (*flag == value) {
+            wl_display_cancel_read(lat->display);
+            break;
+        }
+        wl_display_flush(lat->display);
+        int remaining = (int)((deadline - now_ns()) / 1e6);
+        if (remaining <= 0) {
+            wl_display_cancel_read(lat->display);
+            return false;
+        }
+        struct pollfd fds[2] = {
+            { .fd = wl_display_get_fd(lat->display), .events = POLLIN },
+            { .fd = trace_signal_fd(), .events = POLLIN },
+        };
+        int ret = poll(fds, 2, remaining);
+        if (ret <= 0 || !(fds[0].revents & (POLLIN | POLLERR | POLLHUP))) {
+            wl_display_cancel_read(lat->display);
+            if (ret < 0 && errno != EINTR) {
+                return false;
+            }
+            continue;
+        }
+        if (wl_display_read_events(lat->display) < 0 ||
+            wl_display_dispatch_pending(lat->display) < 0) {
+            return false;
+        }
+    }
+    return *flag == value;
+}
+
+static void
+sleep_ms(double ms)
+{
+    struct timespec ts = { (time_t)(ms / 1e3), (long)((ms - (time_t)(ms / 1e3) * 1e3) * 1e6) };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {
+    }
+}
+
+/* Load */
+
+static void *
+load_thread(void *data)
+{
+    volatile uint64_t spin = 0;
+    while (!atomic_load_explicit(&load_stop, memory_order_relaxed)) {
+        ++spin;
+    }
+    return NULL;
+}
+
+/* Statistics */
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void
+report(const char *label, double *samples, int count, int lost, int late, int load)
+{
+    if (count == 0) {
+        fprintf(stderr, "[INPUTLAT] %s: no samples (%d lost, %d late)\n", label, lost, late);
+        return;
+    }
+    qsort(samples, count, sizeof(double), compare_doubles);
+#define PCT(p) samples[(int)((count - 1) * (p))]
+    fprintf(stderr, "[INPUTLAT] %s (load %d): %d samples, %d lost, %d late; min %.1f, p50 %.1f, "
+            "p90 %.1f, p99 %.1f, max %.1f us\n", label, load, count, lost, late, samples[0],
+            PCT(0.5), PCT(0.9), PCT(0.99), samples[count - 1]);
+#undef PCT
+    int histogram[INPUTLAT_HISTOGRAM] = {0};
+    int peak = 0;
+    for (int i = 0; i < count; ++i) {
+        int bucket = 0;
+        while (bucket + 1 < INPUTLAT_HISTOGRAM && samples[i] >= (double)(2u << bucket)) {
+            ++bucket;
+        }
+        if (++histogram[bucket] > histogram[peak]) {
+            peak = bucket;
+        }
+    }
+    for (int b = 0; b < INPUTLAT_HISTOGRAM; ++b) {
+        if (!histogram[b]) {
+            continue;
+        }
+        char bar[41];
+        int width = histogram[b] * 40 / histogram[peak];
+        memset(bar, '#', width);
+        bar[width] = '\0';
+        fprintf(stderr, "    %8u - %8u us %6d %s\n", b ? 1u << b : 0, 2u << b, histogram[b], bar);
+    }
+}
+
+static void
+measure(struct inputlat *lat, enum inputlat_kind kind, int samples, double interval_ms, int load)
+{
+    const char *label = kind == INPUTLAT_KEYBOARD ? "wl_keyboard.key" : "wl_pointer.motion";
+    bool *focus = kind == INPUTLAT_KEYBOARD ? &lat->keyboard_focus : &lat->pointer_focus;
+
+    // Pointer focus only follows motion; a few nudges give it to us
+    for (int i = 0; i < 10 && !*focus; ++i) {
+        if (kind == INPUTLAT_POINTER) {
+            inject(lat, kind, i);
+        }
+        dispatch_until(lat, focus, true, 100);
+    }
+    lat->waiting = false;
+    if (!*focus) {
+        fprintf(stderr, "[INPUTLAT] %s: the window never got focus\n", label);
+        return;
+    }
+
+    double *latencies = calloc(samples, sizeof(double));
+    if (!latencies) {
+        fprintf(stderr, "[INPUTLAT] %s: out of memory for %d samples\n", label, samples);
+        return;
+    }
+    int count = 0, lost = 0;
+    lat->late = 0;      // Leftovers of the focus nudges are not ours
+    for (int i = 0; i < samples && !lat->closed && !trace_stop_requested(); ++i) {
+        inject(lat, kind, i);
+        if (dispatch_until(lat, &lat->waiting, false, INPUTLAT_TIMEOUT_MS)) {
+            latencies[count++] = (lat->delivered_ns - lat->injected_ns) / 1e3;
+        } else {
+            lat->waiting = false;
+            ++lost;
+        }
+        if (kind == INPUTLAT_KEYBOARD) {
+            release_key(lat);
+        }
+        sleep_ms(interval_ms);
+        wl_display_dispatch_pending(lat->display);
+    }
+    report(label, latencies, count, lost, lat->late, load);
+    free(latencies);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int samples = 1000, load = 0;
+    double interval_ms = 10;
+    bool keyboard = true, pointer = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            load = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--keyboard-only") == 0) {
+            pointer = false;
+        } else if (strcmp(argv[i], "--pointer-only") == 0) {
+            keyboard = false;
+        } else {
+            fprintf(stderr, "usage: %s [--samples N] [--interval ms] [--load threads] "
+                    "[--keyboard-only | --pointer-only]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (samples <= 0) {
+        samples = 1;
+    }
+
+    trace_init("inputlat");
+    struct inputlat lat = {0};
+    lat.display = wl_display_connect(NULL);
+    if (!lat.display) {
+        fprintf(stderr, "Failed to connect to the Wayland display\n");
+        return 1;
+    }
+    struct wl_registry *registry = wl_display_get_registry(lat.display);
+    wl_registry_add_listener(registry, &registry_listener, &lat);
+    wl_display_roundtrip(lat.display);
+    if (!lat.compositor || !lat.shm || !lat.wm_base || !lat.seat) {
+        fprintf(stderr, "[INPUTLAT] Needs wl_compositor, wl_shm, xdg_wm_base and wl_seat\n");
+        return 1;
+    }
+    if (keyboard && !lat.keyboard_manager) {
+        fprintf(stderr, "[INPUTLAT] No zwp_virtual_keyboard_manager_v1, skipping the keyboard\n");
+        keyboard = false;
+    }
+    if (pointer && !lat.pointer_manager) {
+        fprintf(stderr, "[INPUTLAT] No zwlr_virtual_pointer_manager_v1, skipping the pointer\n");
+        pointer = false;
+    }
+    if (!keyboard && !pointer) {
+        return 1;
+    }
+
+    // The virtual devices give a device-less (headless) seat its capabilities
+    if (keyboard && !create_virtual_keyboard(&lat)) {
+        keyboard = false;
+    }
+    if (pointer) {
+        lat.virtual_pointer = zwlr_virtual_pointer_manager_v1_create_virtual_pointer(
+                lat.pointer_manager, lat.seat);
+    }
+    if (!create_window(&lat)) {
+        fprintf(stderr, "[INPUTLAT] Failed to create the window\n");
+        return 1;
+    }
+    dispatch_until(&lat, &lat.configured, true, 2000);
+    if (keyboard) {
+        dispatch_until(&lat, &lat.keyboard_focus, true, 2000);
+    }
+
+    pthread_t *threads = load > 0 ? calloc(load, sizeof(pthread_t)) : NULL;
+    for (int i = 0; i < load; ++i) {
+        pthread_create(&threads[i], NULL, load_thread, NULL);
+    }
+
+    if (keyboard) {
+        measure(&lat, INPUTLAT_KEYBOARD, samples, interval_ms, load);
+    }
+    if (pointer) {
+        measure(&lat, INPUTLAT_POINTER, samples, interval_ms, load);
+    }
+
+    atomic_store(&load_stop, true);
+    for (int i = 0; i < load; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    input_seat_report(&lat.input, "inputlat");
+    input_seat_finish(&lat.input);
+    if (lat.virtual_keyboard) {
+        zwp_virtual_keyboard_v1_destroy(lat.virtual_keyboard);
+    }
+    if (lat.virtual_pointer) {
+        zwlr_virtual_pointer_v1_destroy(lat.virtual_pointer);
+    }
+    xdg_toplevel_destroy(lat.xdg_toplevel);
+    xdg_surface_destroy(lat.xdg_surface);
+    wl_surface_destroy(lat.surface);
+    wl_buffer_destroy(lat.buffer);
+    wl_display_roundtrip(lat.display);
+    wl_display_disconnect(lat.display);
+    return 0;
+}
@@ -8,6 +8,11 @@
 #include <GLES2/gl2.h>
 #include "protocols/xdg-shell-client-protocol.h"
 #include "protocols/src/xdg-shell-client-protocol.c"
+#include "include/trace.h"
+#include "include/probes.h"
+#include "include/egl_loader.h"  // Resolves EGL/GLES lazily, must follow the GL headers
+#include "include/startup.h"
+#include "include/async.h"
 
 /*******************************************
  * Global structures and variables:
@@ -22,12 +27,21 @@ struct globals {
     struct xdg_wm_base *wm_base;
     struct xdg_surface *xdg_surface;
     struct xdg_toplevel *xdg_toplevel;
+    struct async_event configured;      // First xdg_surface.configure seen
+    bool ready;                         // Window exists and may be drawn to
 };
 
 // EGL global variables
 EGLDisplay egl_display;
 EGLContext egl_context;
 EGLSurface egl_surface;
+EGLConfig egl_config;
+
+// Serial of the last configure not yet presented, used to link trace flows
+static uint32_t pending_configure_serial;
+
+// Number of the frame being rendered, reported by the USDT probes
+static uint64_t frame_number;
 
 // Simple triangle vertices for rendering
 static const GLfloat vertices[] = {
@@ -44,6 +58,7 @@ static const GLfloat vertices[] = {
 static void registry_handler(void *data, struct wl_registry *registry, uint32_t id, const char *interface, uint32_t version) {
     struct globals *globals = data;
 
+    TRACE_BEGIN("registry", "global");
     // If the interface is "wl_compositor", bind the compositor object
     if (strcmp(interface, "wl_compositor") == 0) {
         globals->compositor = wl_registry_bind(registry, id, &wl_compositor_interface, 1);
@@ -54,6 +69,7 @@ static void registry_handler(void *data, struct wl_registry *registry, uint32_t
         globals->wm_base = wl_registry_bind(registry, id, &xdg_wm_base_interface, 1);
         printf("xdg_wm_base bound\n");
     }
+    TRACE_END("registry", "global");
 }
 
 /*******************************************
@@ -75,10 +91,19 @@ static const struct wl_registry_listener registry_listener = {
 
 /*******************************************
  * Initialize EGL:
- * - Sets up the EGL display, context, and surface.
+ * - init_egl_display sets up the EGL display and context. It needs only the
+ *   wl_display, so it runs while the registry request is still in flight.
+ * - init_egl_surface binds a window surface to the wl_surface once that
+ *   exists.
  * - EGL is used to manage OpenGL ES rendering surfaces in Wayland.
  *******************************************/
-void init_egl(struct globals *globals) {
+void init_egl_display(struct globals *globals) {
+    // Load libEGL/libGLESv2 now that we know GL is going to be used
+    if (!egl_loader_load()) {
+        fprintf(stderr, "Failed to load EGL/GLES libraries\n");
+        exit(EXIT_FAILURE);
+    }
+
     // Get the EGL display connection using Wayland's display
     egl_display = eglGetDisplay((EGLNativeDisplayType)globals->display);
     if (egl_display == EGL_NO_DISPLAY) {
@@ -102,24 +127,25 @@ void init_egl(struct globals *globals) {
         EGL_ALPHA_SIZE, 8,
         EGL_NONE
     };
-    EGLConfig config;
     EGLint num_configs;
-    eglChooseConfig(egl_display, attribs, &config, 1, &num_configs);  // Choose the appropriate config
+    eglChooseConfig(egl_display, attribs, &egl_config, 1, &num_configs);  // Choose the appropriate config
 
     // Create an EGL context for OpenGL ES 2.0
     EGLint context_attribs[] = {
         EGL_CONTEXT_CLIENT_VERSION, 2,  // OpenGL ES 2.0 context
         EGL_NONE
     };
-    egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+    egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, context_attribs);
     if (egl_context == EGL_NO_CONTEXT) {
         fprintf(stderr, "Failed to create EGL context\n");
         exit(EXIT_FAILURE);
     }
+}
 
+void init_egl_surface(struct globals *globals) {
     // Create an EGL window surface (bind it to Wayland's surface)
     globals->egl_window = wl_egl_window_create(globals->surface, 900, 900);
-    egl_surface = eglCreateWindowSurface(egl_display, config, (EGLNativeWindowType)globals->egl_window, NULL);
+    egl_surface = eglCreateWindowSurface(egl_display, egl_config, (EGLNativeWindowType)globals->egl_window, NULL);
     if (egl_surface == EGL_NO_SURFACE) {
         fprintf(stderr, "Failed to create EGL surface\n");
         exit(EXIT_FAILURE);
@@ -154,11 +180,22 @@ void check_gl_error(const char *label) {
 static void xdg_surface_configure(void *data, struct xdg_surface *surface, uint32_t serial) {
     struct globals *globals = data;
 
+    TRACE_BEGIN("configure", "xdg_surface.configure");
+    // The arrow ends at the swap that presents the configured state
+    TRACE_FLOW_BEGIN("configure", "configure", serial);
+    pending_configure_serial = serial;
+    PROBE1(configure_received, serial);
+
     // Acknowledge the configuration from the Wayland compositor
     xdg_surface_ack_configure(surface, serial);
+    PROBE1(configure_acked, serial);
 
     // Make the EGL surface current to render the new frame
     eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context);
+    if (!globals->configured.fired) {
+        async_event_fire(&globals->configured);
+    }
+    TRACE_END("configure", "xdg_surface.configure");
 }
 
 /*******************************************
@@ -174,11 +211,16 @@ static const struct xdg_surface_listener xdg_surface_listener = {
  * - This function sets up shaders and renders a colored triangle.
  *******************************************/
 void render_triangle() {
+    TRACE_BEGIN("render", "render_triangle");
+
     // Clear the color buffer with black background
+    TRACE_BEGIN("render", "clear");
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
+    TRACE_END("render", "clear");
 
     // Create and compile the vertex shader
+    TRACE_BEGIN("render", "compile shaders");
     const char *vertex_shader_source =
         "attribute vec2 position;\n"
         "void main() {\n"
@@ -218,6 +260,7 @@ void render_triangle() {
     glAttachShader(shader_program, fragment_shader);
     glLinkProgram(shader_program);
     glUseProgram(shader_program);  // Use the shader program
+    TRACE_END("render", "compile shaders");
 
     // Bind the triangle vertex positions to the shader's "position" attribute
     GLint position_location = glGetAttribLocation(shader_program, "position");
@@ -225,71 +268,48 @@ void render_triangle() {
     glEnableVertexAttribArray(position_location);
 
     // Draw the triangle (3 vertices)
+    TRACE_BEGIN("render", "draw");
     glDrawArrays(GL_TRIANGLES, 0, 3);
+    TRACE_END("render", "draw");
 
     // Swap buffers (render the triangle on the screen)
+    TRACE_BEGIN("present", "eglSwapBuffers");
+    PROBE1(swap, frame_number);
     eglSwapBuffers(egl_display, egl_surface);
+    TRACE_END("present", "eglSwapBuffers");
+    if (pending_configure_serial) {
+        TRACE_FLOW_END("configure", "configure", pending_configure_serial);
+        pending_configure_serial = 0;
+    }
+
+    TRACE_END("render", "render_triangle");
 }
 
 /*******************************************
- * Main function:
- * - Connects to the Wayland display server, initializes EGL, and enters the rendering loop.
+ * Startup continuations:
+ * - on_registry_ready runs once every global has been announced. It checks
+ *   the ones we need, creates the window and its EGL surface and commits.
+ * - on_configured runs on the first configure; only then may we draw.
  *******************************************/
-int main(int argc, char **argv) {
-    struct globals globals = {0};  // Zero-initialize the globals struct
-
-    // Connect to the Wayland display server
-    globals.display = wl_display_connect(NULL);
-    if (!globals.display) {
-        fprintf(stderr, "Failed to connect to Wayland display\n");
-        exit(EXIT_FAILURE);
-    } else {
-        fprintf(stderr, "Connected to Wayland display successfully\n");
-    }
+static void on_configured(void *data) {
+    struct globals *globals = data;
+    globals->ready = true;
+    TRACE_INSTANT("configure", "ready to draw");
+}
 
-    // Get the registry and set up the registry listener
-    struct wl_registry *registry = wl_display_get_registry(globals.display);
-    wl_registry_add_listener(registry, &registry_listener, &globals);
-    /******************************************************************************
-     * 
-     * @WAYLAND_ROUND_TRIP:
-     * - Sends all pending requests from the client to the server.
-     * - Waits for the server to process those requests.
-     * - Receives and processes all corresponding events from the server.
-     *
-     * Why it's needed:
-     * - Wayland communication is asynchronous: requests are sent, but the client
-     *   does not know when the server will process and respond to them.
-     * - wl_display_roundtrip ensures that the client waits until the server has 
-     *   processed its requests and all related events have been handled.
-     * - It synchronizes the client with the server, guaranteeing that critical
-     *   resources (like compositor and xdg_wm_base) are available and ready 
-     *   before proceeding further.
-     *
-     * Example use case:
-     * - After binding to global objects (e.g., compositor, window manager base),
-     *   we need to make sure that these objects are available before trying to
-     *   use them. Calling wl_display_roundtrip ensures the server has processed
-     *   the bindings and the client has received the necessary events confirming
-     *   the bindings were successful.
-     *
-     *******************************************************************************/ 
-    if (wl_display_roundtrip(globals.display) < 0) {
-        fprintf(stderr, "Roundtrip failed\n");
-        exit(EXIT_FAILURE);
-    } else {
-        fprintf(stderr, "Roundtrip completed successfully\n");
-    }
+static void on_registry_ready(void *data) {
+    struct globals *globals = data;
+    TRACE_INSTANT("registry", "globals ready");
 
     // Check if the compositor and wm_base were successfully bound
-    if (!globals.compositor) {
+    if (!globals->compositor) {
         fprintf(stderr, "Failed to bind compositor\n");
         exit(EXIT_FAILURE);
     } else {
         fprintf(stderr, "Compositor bound successfully\n");
     }
 
-    if (!globals.wm_base) {
+    if (!globals->wm_base) {
         fprintf(stderr, "xdg_wm_base is not available\n");
         exit(EXIT_FAILURE);
     } else {
@@ -297,45 +317,110 @@ int main(int argc, char **argv) {
     }
 
     // Create a Wayland surface
-    globals.surface = wl_compositor_create_surface(globals.compositor);
-    if (!globals.surface) {
+    globals->surface = wl_compositor_create_surface(globals->compositor);
+    if (!globals->surface) {
         fprintf(stderr, "Failed to create Wayland surface\n");
         exit(EXIT_FAILURE);
     }
 
     // Create an xdg surface
-    globals.xdg_surface = xdg_wm_base_get_xdg_surface(globals.wm_base, globals.surface);
-    if (!globals.xdg_surface) {
+    globals->xdg_surface = xdg_wm_base_get_xdg_surface(globals->wm_base, globals->surface);
+    if (!globals->xdg_surface) {
         fprintf(stderr, "Failed to create xdg surface\n");
         exit(EXIT_FAILURE);
     }
+    xdg_surface_add_listener(globals->xdg_surface, &xdg_surface_listener, globals);
 
     // Create a top-level xdg surface (window)
-    globals.xdg_toplevel = xdg_surface_get_toplevel(globals.xdg_surface);
-    if (!globals.xdg_toplevel) {
+    globals->xdg_toplevel = xdg_surface_get_toplevel(globals->xdg_surface);
+    if (!globals->xdg_toplevel) {
         fprintf(stderr, "Failed to create xdg toplevel\n");
         exit(EXIT_FAILURE);
     }
 
-    // Commit the surface to display it
-    wl_surface_commit(globals.surface);
+    TRACE_BEGIN("render", "init_egl_surface");
+    init_egl_surface(globals);
+    TRACE_END("render", "init_egl_surface");
+
+    // Commit the surface to display it; the compositor answers with a configure
+    async_event_wait(&globals->configured, on_configured, globals);
+    wl_surface_commit(globals->surface);
+}
+
+/*******************************************
+ * Main function:
+ * - Connects to the Wayland display server, initializes EGL, and enters the rendering loop.
+ *******************************************/
+int main(int argc, char **argv) {
+    struct globals globals = {0};  // Zero-initialize the globals struct
+    startup_begin();
+
+    // Optional timeline tracing, enabled through MYWAYLAND_TRACE
+    trace_init("render");
+
+    // Connect to the Wayland display server
+    globals.display = wl_display_connect(NULL);
+    if (!globals.display) {
+        fprintf(stderr, "Failed to connect to Wayland display\n");
+        exit(EXIT_FAILURE);
+    } else {
+        fprintf(stderr, "Connected to Wayland display successfully\n");
+    }
+
+    /******************************************************************************
+     *
+     * @ASYNC_STARTUP:
+     * - Wayland communication is asynchronous: requests are sent, but the client
+     *   does not know when the server will process and respond to them.
+     * - Instead of blocking in wl_display_roundtrip until the globals have been
+     *   announced, we ask to be called back when they have (include/async.h)
+     *   and use the wait to load and initialize EGL, which only needs the
+     *   wl_display. on_registry_ready then checks the globals and creates the
+     *   window, and on_configured lets the render loop start.
+     *
+     *******************************************************************************/
+    struct wl_registry *registry = wl_display_get_registry(globals.display);
+    wl_registry_add_listener(registry, &registry_listener, &globals);
+    TRACE_BEGIN("registry", "request");
+    if (async_registry_ready(globals.display, on_registry_ready, &globals) < 0) {
+        fprintf(stderr, "Failed to queue registry sync\n");
+        exit(EXIT_FAILURE);
+    }
+    wl_display_flush(globals.display);
+    TRACE_END("registry", "request");
 
-    // Initialize EGL for rendering
-    init_egl(&globals);
+    // Overlaps with the compositor answering the registry request
+    TRACE_BEGIN("render", "init_egl_display");
+    init_egl_display(&globals);
+    TRACE_END("render", "init_egl_display");
 
     // Main rendering loop: render the triangle and handle Wayland events
     int count = 0;
-    while (1) {
-        int dispatch_result = wl_display_dispatch(globals.display);
+    while (!trace_stop_requested()) {
+        TRACE_BEGIN("dispatch", "wl_display_dispatch");
+        int dispatch_result = trace_dispatch(globals.display);
+        TRACE_END("dispatch", "wl_display_dispatch");
         if (dispatch_result == -1) {
             fprintf(stderr, "wl_display_dispatch failed: %s\n", strerror(errno));
             break;  // Exit loop if dispatch fails
         }
+        if (!globals.ready) {
+            continue;  // Still waiting for the globals or the first configure
+        }
 
         fprintf(stderr, "Before rendering triangle %d\n", count);
+        frame_number = count;
+        PROBE1(frame_start, frame_number);
         render_triangle();  // Render the triangle
+        TRACE_BEGIN("present", "eglSwapBuffers");
+        PROBE1(swap, frame_number);
         eglSwapBuffers(egl_display, egl_surface);  // Swap buffers to display it
+        TRACE_END("present", "eglSwapBuffers");
+        PROBE1(frame_end, frame_number);
         fprintf(stderr, "After rendering triangle %d\n", count);
+        if (count == 0) {
+            startup_report("first frame (gl)");
+        }
         ++count;
     }
 
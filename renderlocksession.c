@@ -2,14 +2,37 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <wayland-client.h>
 #include <wayland-egl.h>
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include "xdg-shell-client-protocol.h"
 #include "ext-session-lock-client-protocol.h"
+#include "ext-idle-notify-client-protocol.h"
 #include "ext-session-lock-client-protocol.c"
+#include "ext-idle-notify-client-protocol.c"
 #include "xdg-shell-client-protocol.c"
+#include "include/trace.h"
+#include "include/probes.h"
+#include "include/egl_loader.h"  // Resolves EGL/GLES lazily, must follow the GL headers
+#include "include/startup.h"
+#include "include/etc2.h"
+#include "include/ppm.h"
+#include "include/font.h"
+#include "include/sdf.h"
+#include "include/layout.h"
+#include "include/shm.h"
+#include "include/fill.h"
+#include "include/buffer_cache.h"
+#include "include/transform.h"
 
 // Wayland global variables
 struct globals {
@@ -22,27 +45,105 @@ struct globals {
     struct xdg_toplevel *xdg_toplevel;
     struct ext_session_lock_manager_v1 *session_lock_manager;
     struct ext_session_lock_v1 *session_lock;
+    struct wl_shm *shm;
+    struct ext_idle_notifier_v1 *idle_notifier;
+    struct wl_seat *seat;
+    struct wl_keyboard *keyboard;
+    int32_t width, height;           // Current surface size
+    int32_t pending_width, pending_height;
+    uint32_t output_transform;       // Of the output the toplevel is on
+    uint32_t buffer_transform;       // What the GL buffers are drawn with
+    int32_t buffer_width, buffer_height;
+    bool configured;
     bool locked;
+    bool lock_confirmed;             // ext_session_lock_v1.locked received
 };
 
+static volatile sig_atomic_t running = 1;
+
 // EGL global variables
 EGLDisplay egl_display;
 EGLContext egl_context;
 EGLSurface egl_surface;
 
-// Simple triangle vertices
-static const GLfloat vertices[] = {
-    0.0f,  0.5f,
-   -0.5f, -0.5f,
-    0.5f, -0.5f
+// Number of the frame being rendered, reported by the USDT probes
+static uint64_t frame_number;
+
+// True when we got an OpenGL ES 3 context, which guarantees ETC2 support
+static bool gl_es3;
+
+/*******************************************
+ * Static background image:
+ * - Loaded once from a binary PPM given with --background.
+ * - On GLES3 it is compressed to ETC2 the first time and the compressed
+ *   blocks are cached on disk (see include/etc2.h). Later runs upload
+ *   those blocks directly: 8x less texture memory and upload bandwidth
+ *   than RGBA8, and no image decode at startup.
+ * - --background-compare also uploads the uncompressed image into a
+ *   scratch texture so both upload times can be reported side by side.
+ *******************************************/
+static struct {
+    const char *path;
+    bool compare;
+    GLuint texture;
+    GLuint program;
+    GLint position_location;
+    GLint sampler_location;
+    GLint transform_location;
+} background;
+
+// Fullscreen quad for the background, as a triangle strip
+static const GLfloat background_vertices[] = {
+   -1.0f, -1.0f,
+    1.0f, -1.0f,
+   -1.0f,  1.0f,
+    1.0f,  1.0f
+};
+
+// eglSwapBuffersWithDamage{KHR,EXT}, NULL when the driver has neither
+typedef EGLBoolean (*swap_with_damage_fn)(EGLDisplay, EGLSurface, const EGLint *, EGLint);
+static swap_with_damage_fn swap_buffers_with_damage;
+
+// Defined with the input handling further down
+static const struct wl_seat_listener seat_listener;
+
+/*******************************************
+ * Rendering backends:
+ * - gl:  EGL + GLES into a fullscreen xdg_toplevel.
+ * - shm: software rendering into wl_shm buffers, one lock surface per
+ *   output (see @SHM LOCK SURFACES below).
+ * - --backend picks one; by default gl is tried first and shm takes over
+ *   when the EGL libraries, display or context are unavailable.
+ * - With ext_session_lock_manager_v1 the shm backend is always used: a
+ *   locked session only shows and focuses lock surfaces, so the gl
+ *   backend's xdg_toplevel could never receive the password.
+ *******************************************/
+enum backend {
+    BACKEND_AUTO,
+    BACKEND_GL,
+    BACKEND_SHM,
 };
 
+static enum backend backend = BACKEND_AUTO;
+
+// --no-buffer-transform: draw upright and leave rotation to the compositor
+static bool no_buffer_transform;
+
+// --daemon: stay connected and lock on demand (see @WARM STANDBY)
+static bool daemon_mode;
+
+// Defined with the shm backend further down
+static void shm_output_bind(struct globals *globals, struct wl_registry *registry, uint32_t name, uint32_t version);
+static void shm_output_remove(uint32_t name);
+
 // Wayland registry handler
 static void registry_handler(void *data, struct wl_registry *registry, uint32_t id, const char *interface, uint32_t version) {
     struct globals *globals = data;
 
+    TRACE_BEGIN("registry", "global");
     if (strcmp(interface, "wl_compositor") == 0) {
-        globals->compositor = wl_registry_bind(registry, id, &wl_compositor_interface, 1);
+        // v4 for wl_surface_damage_buffer in the shm backend
+        globals->compositor = wl_registry_bind(registry, id, &wl_compositor_interface, version < 4 ? version : 4);
         printf("Compositor bound\n");
     } else if (strcmp(interface, "xdg_wm_base") == 0) {
         globals->wm_base = wl_registry_bind(registry, id, &xdg_wm_base_interface, 1);
@@ -50,12 +151,23 @@ static void registry_handler(void *data, struct wl_registry *registry, uint32_t
     } else if (strcmp(interface, "ext_session_lock_manager_v1") == 0) {
         globals->session_lock_manager = wl_registry_bind(registry, id, &ext_session_lock_manager_v1_interface, 1);
         printf("Session lock manager bound\n");
+    } else if (strcmp(interface, "wl_shm") == 0) {
+        globals->shm = wl_registry_bind(registry, id, &wl_shm_interface, 1);
+    } else if (strcmp(interface, "wl_output") == 0) {
+        shm_output_bind(globals, registry, id, version);
+    } else if (strcmp(interface, "ext_idle_notifier_v1") == 0) {
+        globals->idle_notifier = wl_registry_bind(registry, id, &ext_idle_notifier_v1_interface, 1);
+    } else if (strcmp(interface, "wl_seat") == 0 && !globals->seat) {
+        globals->seat = wl_registry_bind(registry, id, &wl_seat_interface, 1);
+        wl_seat_add_listener(globals->seat, &seat_listener, globals);
+        printf("Seat bound\n");
     }
+    TRACE_END("registry", "global");
 }
 
-// Wayland registry remove handler (not used in this example)
+// Wayland registry remove handler, only outputs can go away
 static void registry_remover(void *data, struct wl_registry *registry, uint32_t id) {
-    // Handle object removal if necessary
+    shm_output_remove(id);
 }
 
 // The Wayland registry listener
@@ -64,21 +176,31 @@ static const struct wl_registry_listener registry_listener = {
     registry_remover
 };
 
-// Initialize EGL
-void init_egl(struct globals *globals) {
+static EGLConfig egl_config;
+
+/*******************************************
+ * init_egl_context:
+ * - Display, config and context; needs no surface yet.
+ * - Returns false instead of exiting, so the caller can fall back to the
+ *   shm backend on machines without a usable GPU stack.
+ *******************************************/
+static bool
+init_egl_context(struct globals *globals)
+{
     egl_display = eglGetDisplay((EGLNativeDisplayType)globals->display);
     if (egl_display == EGL_NO_DISPLAY) {
         fprintf(stderr, "Failed to get EGL display\n");
-        exit(EXIT_FAILURE);
+        return false;
     }
 
     if (!eglInitialize(egl_display, NULL, NULL)) {
         fprintf(stderr, "Failed to initialize EGL\n");
-        exit(EXIT_FAILURE);
+        return false;
     }
 
+    // Prefer OpenGL ES 3 (ETC2 textures are guaranteed there), fall back to ES 2
     EGLint attribs[] = {
-        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_RENDERABLE_TYPE, 0x0040,  // EGL_OPENGL_ES3_BIT
         EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
         EGL_RED_SIZE, 8,
         EGL_GREEN_SIZE, 8,
@@ -86,21 +208,37 @@ void init_egl(struct globals *globals) {
         EGL_ALPHA_SIZE, 8,
         EGL_NONE
     };
-    EGLConfig config;
-    EGLint num_configs;
-    eglChooseConfig(egl_display, attribs, &config, 1, &num_configs);
-
+    EGLint num_configs = 0;
     EGLint context_attribs[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2,
+        EGL_CONTEXT_CLIENT_VERSION, 3,
         EGL_NONE
     };
-    egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+
+    egl_context = EGL_NO_CONTEXT;
+    if (eglChooseConfig(egl_display, attribs, &egl_config, 1, &num_configs) && num_configs > 0) {
+        egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, context_attribs);
+    }
+    gl_es3 = egl_context != EGL_NO_CONTEXT;
+    if (!gl_es3) {
+        attribs[1] = EGL_OPENGL_ES2_BIT;
+        context_attribs[1] = 2;
+        if (eglChooseConfig(egl_display, attribs, &egl_config, 1, &num_configs) && num_configs > 0) {
+            egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, context_attribs);
+        }
+    }
     if (egl_context == EGL_NO_CONTEXT) {
         fprintf(stderr, "Failed to create EGL context\n");
-        exit(EXIT_FAILURE);
+        eglTerminate(egl_display);
+        return false;
     }
+    return true;
+}
 
-    egl_surface = eglCreateWindowSurface(egl_display, config, (EGLNativeWindowType)globals->egl_window, NULL);
+// Window surface for globals->egl_window; failures here are fatal
+static void
+init_egl_surface(struct globals *globals)
+{
+    egl_surface = eglCreateWindowSurface(egl_display, egl_config, (EGLNativeWindowType)globals->egl_window, NULL);
     if (egl_surface == EGL_NO_SURFACE) {
         fprintf(stderr, "Failed to create EGL surface\n");
         exit(EXIT_FAILURE);
@@ -110,153 +248,2430 @@ void init_egl(struct globals *globals) {
         fprintf(stderr, "Failed to make EGL context current\n");
         exit(EXIT_FAILURE);
     }
+
+    // Lets the compositor recomposite only the rects the layout damaged
+    const char *extensions = eglQueryString(egl_display, EGL_EXTENSIONS);
+    if (extensions && strstr(extensions, "EGL_KHR_swap_buffers_with_damage")) {
+        swap_buffers_with_damage = (swap_with_damage_fn)eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+    } else if (extensions && strstr(extensions, "EGL_EXT_swap_buffers_with_damage")) {
+        swap_buffers_with_damage = (swap_with_damage_fn)eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+    }
+    if (!swap_buffers_with_damage) {
+        fprintf(stderr, "[LAYOUT] No eglSwapBuffersWithDamage, every frame damages the whole surface\n");
+    }
 }
 
-// Render the triangle using OpenGL ES
-void render_triangle() {
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+static double
+elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static GLuint
+compile_shader(GLenum type, const char *source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint compile_status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
+    if (compile_status == GL_FALSE) {
+        fprintf(stderr, "Shader compilation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return shader;
+}
+
+// Uploads RGB8 pixels as an RGBA8 texture, the uncompressed path
+static GLuint
+upload_rgba_texture(const uint8_t *rgb, int width, int height)
+{
+    uint8_t *rgba = malloc((size_t)width * height * 4);
+    if (!rgba) {
+        return 0;
+    }
+    for (size_t i = 0; i < (size_t)width * height; ++i) {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 0xff;
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    free(rgba);
+    return texture;
+}
+
+static bool
+etc2_supported(void)
+{
+    if (gl_es3) {
+        return true;
+    }
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    return extensions && strstr(extensions, "GL_OES_compressed_ETC2_RGB8_texture");
+}
+
+/*******************************************
+ * load_background:
+ * - Must run with the EGL context current.
+ * - Cache hit: the ETC2 blocks come straight from disk, the PPM is never read.
+ * - Cache miss: decode the PPM, encode to ETC2 once, store, upload.
+ * - Without ETC2 support: plain RGBA8 upload.
+ *******************************************/
+static void
+load_background(void)
+{
+    struct stat st;
+    if (stat(background.path, &st) != 0) {
+        fprintf(stderr, "Background %s not found\n", background.path);
+        return;
+    }
+
+    TRACE_BEGIN("render", "load_background");
+    bool compressed = etc2_supported();
+    uint64_t key = etc2_cache_key(background.path, &st);
+    int width = 0, height = 0;
+    uint8_t *rgb = NULL;
+    uint8_t *blocks = compressed ? etc2_cache_load(key, &width, &height) : NULL;
+    bool cache_hit = blocks != NULL;
+    double encode_ms = 0;
+
+    if (!blocks || background.compare) {
+        rgb = ppm_load(background.path, &width, &height);
+        if (!rgb) {
+            free(blocks);
+            TRACE_END("render", "load_background");
+            return;
+        }
+    }
+    if (compressed && !blocks) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        blocks = malloc(etc2_rgb8_size(width, height));
+        if (blocks) {
+            etc2_encode_rgb8(rgb, width, height, blocks);
+            etc2_cache_store(key, width, height, blocks);
+        }
+        encode_ms = elapsed_ms(&start);
+        compressed = blocks != NULL;
+    }
+
+    size_t rgba_bytes = (size_t)width * height * 4;
+    size_t etc2_bytes = etc2_rgb8_size(width, height);
+    struct timespec start;
+
+    if (background.compare && rgb) {
+        glFinish();
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        GLuint scratch = upload_rgba_texture(rgb, width, height);
+        glFinish();
+        fprintf(stderr, "[BACKGROUND] RGBA8 upload: %.2f MiB in %.2f ms\n",
+                rgba_bytes / 1048576.0, elapsed_ms(&start));
+        glDeleteTextures(1, &scratch);
+    }
+
+    glFinish();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (compressed) {
+        glGenTextures(1, &background.texture);
+        glBindTexture(GL_TEXTURE_2D, background.texture);
+        glCompressedTexImage2D(GL_TEXTURE_2D, 0, ETC2_GL_COMPRESSED_RGB8,
+                               width, height, 0, etc2_bytes, blocks);
+    } else {
+        background.texture = upload_rgba_texture(rgb, width, height);
+    }
+    glFinish();
+    double upload_ms = elapsed_ms(&start);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    if (compressed) {
+        fprintf(stderr, "[BACKGROUND] %dx%d ETC2 (%s): %.2f MiB vs %.2f MiB as RGBA8 (%.1fx smaller), "
+                "upload %.2f ms", width, height, cache_hit ? "cache hit" : "encoded",
+                etc2_bytes / 1048576.0, rgba_bytes / 1048576.0,
+                (double)rgba_bytes / etc2_bytes, upload_ms);
+        if (!cache_hit) {
+            fprintf(stderr, ", encode %.0f ms (once)", encode_ms);
+        }
+        fprintf(stderr, "\n");
+    } else {
+        fprintf(stderr, "[BACKGROUND] %dx%d RGBA8 (no ETC2 support): %.2f MiB, upload %.2f ms\n",
+                width, height, rgba_bytes / 1048576.0, upload_ms);
+    }
+    free(rgb);
+    free(blocks);
 
     const char *vertex_shader_source =
         "attribute vec2 position;\n"
+        "uniform mat2 transform;\n"
+        "varying vec2 uv;\n"
         "void main() {\n"
-        "    gl_Position = vec4(position, 0.0, 1.0);\n"
+        "    uv = vec2(position.x * 0.5 + 0.5, 0.5 - position.y * 0.5);\n"
+        "    gl_Position = vec4(transform * position, 0.0, 1.0);\n"
         "}\n";
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_source, NULL);
-    glCompileShader(vertex_shader);
+    const char *fragment_shader_source =
+        "precision mediump float;\n"
+        "uniform sampler2D background;\n"
+        "varying vec2 uv;\n"
+        "void main() {\n"
+        "    gl_FragColor = texture2D(background, uv);\n"
+        "}\n";
+    background.program = glCreateProgram();
+    glAttachShader(background.program, compile_shader(GL_VERTEX_SHADER, vertex_shader_source));
+    glAttachShader(background.program, compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source));
+    glLinkProgram(background.program);
+    background.position_location = glGetAttribLocation(background.program, "position");
+    background.sampler_location = glGetUniformLocation(background.program, "background");
+    background.transform_location = glGetUniformLocation(background.program, "transform");
+    TRACE_END("render", "load_background");
+}
 
-    GLint compile_status;
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &compile_status);
-    if (compile_status == GL_FALSE) {
-        fprintf(stderr, "Vertex shader compilation failed\n");
+static void
+draw_background(uint32_t transform)
+{
+    glUseProgram(background.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, background.texture);
+    glUniform1i(background.sampler_location, 0);
+    glUniformMatrix2fv(background.transform_location, 1, GL_FALSE, transform_ndc[transform]);
+    glVertexAttribPointer(background.position_location, 2, GL_FLOAT, GL_FALSE, 0, background_vertices);
+    glEnableVertexAttribArray(background.position_location);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(background.position_location);
+}
+
+/*******************************************
+ * @LOCK SCREEN UI
+ *******************************************
+ *
+ * The screen is a centred column of four text elements kept in a layout
+ * tree (include/layout.h). Each element only marks itself dirty when its
+ * text actually changes, so:
+ * - the clock ticking damages just the clock's rect;
+ * - typing damages just the password field, which has a minimum width so
+ *   a new dot never moves anything else;
+ * - a status message of a different length re-centres only itself.
+ * When nothing changed no frame is drawn at all.
+ *
+ * The GL backend has two text paths. The default samples a 1-channel copy
+ * of the bitmap font with nearest filtering, which is exact at integer
+ * sizes only. --text sdf draws from the multi-channel distance field
+ * atlas of include/sdf.h with its own shader, at any size. --text-scale
+ * multiplies every text size (e.g. by a fractional output scale) to try
+ * both.
+ *******************************************/
+#define UI_TEXT_MAX 64
+
+struct ui_text {
+    char text[UI_TEXT_MAX];
+    int scale;
+    GLfloat color[4];
+};
+
+static struct {
+    struct layout_tree tree;
+    struct layout_node column, clock, date, password, status;
+    struct ui_text clock_text, date_text, password_text, status_text;
+    char password_buffer[UI_TEXT_MAX];
+    size_t password_length;
+    bool log;                        // --layout-log: print every update
+
+    float text_scale;                // --text-scale, gl only
+    bool sdf;                        // --text sdf
+
+    GLuint atlas;                    // Bitmap (1 channel) or distance field (RGB) atlas
+    struct sdf_atlas sdf_atlas;
+    GLuint program;
+    GLint position_location, texcoord_location;
+    GLint color_location, viewport_location, sampler_location, transform_location;
+    GLint range_location;            // Screen pixels per distance unit (sdf)
+} ui = { .text_scale = 1.0f };
+
+// Screen pixels per font pixel
+static inline float
+ui_text_size(const struct ui_text *t)
+{
+    return t->scale * ui.text_scale;
+}
+
+static void
+ui_measure_text(struct layout_node *node, int32_t *width, int32_t *height)
+{
+    struct ui_text *t = node->data;
+    *width = (int32_t)ceilf(font_text_width(t->text, 1) * ui_text_size(t));
+    *height = (int32_t)ceilf(FONT_GLYPH_HEIGHT * ui_text_size(t));
+}
+
+static void
+ui_set_text(struct layout_node *node, const char *text)
+{
+    struct ui_text *t = node->data;
+    if (strcmp(t->text, text) == 0) {
+        return;
+    }
+    snprintf(t->text, sizeof(t->text), "%s", text);
+    layout_mark_dirty(node);
+}
+
+static void
+ui_init_node(struct layout_node *node, const char *name, struct ui_text *text,
+             int scale, GLfloat r, GLfloat g, GLfloat b)
+{
+    node->name = name;
+    node->kind = LAYOUT_LEAF;
+    node->measure = ui_measure_text;
+    node->data = text;
+    text->scale = scale;
+    text->color[0] = r;
+    text->color[1] = g;
+    text->color[2] = b;
+    text->color[3] = 1.0f;
+    layout_append(&ui.column, node);
+}
+
+static void
+ui_init(void)
+{
+    ui.column.name = "column";
+    ui.column.kind = LAYOUT_COLUMN;
+    ui.column.spacing = 24;
+    ui.tree.root = &ui.column;
+
+    ui_init_node(&ui.clock, "clock", &ui.clock_text, 12, 1.0f, 1.0f, 1.0f);
+    ui_init_node(&ui.date, "date", &ui.date_text, 3, 0.8f, 0.8f, 0.8f);
+    ui_init_node(&ui.password, "password", &ui.password_text, 4, 1.0f, 1.0f, 1.0f);
+    ui_init_node(&ui.status, "status", &ui.status_text, 2, 0.9f, 0.6f, 0.3f);
+
+    ui_set_text(&ui.status, "Type your password");
+}
+
+// Once the backend is known: only GL draws text at other than integer sizes
+static void
+ui_set_text_scale(float text_scale)
+{
+    ui.text_scale = text_scale;
+    // Room for 16 dots before the field has to grow
+    ui.password.min_width = (int32_t)ceilf(font_text_width("****************", 1) *
+                                           ui_text_size(&ui.password_text));
+    ui.password.min_height = (int32_t)ceilf(FONT_GLYPH_HEIGHT * ui_text_size(&ui.password_text));
+    layout_mark_dirty(&ui.password);
+}
+
+// Refreshes the clock and date; only marks them dirty when the text changed
+static void
+ui_update_clock(void)
+{
+    char text[UI_TEXT_MAX];
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+
+    strftime(text, sizeof(text), "%H:%M:%S", &local);
+    ui_set_text(&ui.clock, text);
+    strftime(text, sizeof(text), "%A, %d %B %Y", &local);
+    ui_set_text(&ui.date, text);
+}
+
+// Milliseconds until the wall clock reaches the next whole second
+static int
+ui_ms_until_next_tick(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return 1000 - now.tv_nsec / 1000000;
+}
+
+static void
+ui_update_password(void)
+{
+    char dots[UI_TEXT_MAX];
+    size_t count = ui.password_length < sizeof(dots) - 1 ? ui.password_length : sizeof(dots) - 1;
+    memset(dots, '*', count);
+    dots[count] = '\0';
+    ui_set_text(&ui.password, dots);
+}
+
+// Both text paths place quads in surface coordinates
+static const char *ui_vertex_shader_source =
+    "attribute vec2 position;\n"
+    "attribute vec2 texcoord;\n"
+    "uniform vec2 viewport;\n"
+    "uniform mat2 transform;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "    uv = texcoord;\n"
+    "    vec2 ndc = vec2(position.x * 2.0 / viewport.x - 1.0,\n"
+    "                    1.0 - position.y * 2.0 / viewport.y);\n"
+    "    gl_Position = vec4(transform * ndc, 0.0, 1.0);\n"
+    "}\n";
+
+// Distance field atlas and the shader that thresholds it (--text sdf)
+static void
+ui_init_gl_sdf(void)
+{
+    double start = startup_elapsed_ms();
+    if (!sdf_atlas_build(&ui.sdf_atlas)) {
+        fprintf(stderr, "[TEXT] Out of memory for the distance field atlas\n");
         exit(EXIT_FAILURE);
     }
+    double built = startup_elapsed_ms();
+    glGenTextures(1, &ui.atlas);
+    glBindTexture(GL_TEXTURE_2D, ui.atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, ui.sdf_atlas.width, ui.sdf_atlas.height, 0,
+                 GL_RGB, GL_UNSIGNED_BYTE, ui.sdf_atlas.texels);
+    // Distances interpolate linearly; that is what makes any size work
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    fprintf(stderr, "[TEXT] sdf: %dx%d RGB atlas (%.1f KiB), built in %.2f ms, uploaded in %.2f ms\n",
+            ui.sdf_atlas.width, ui.sdf_atlas.height, ui.sdf_atlas.bytes / 1024.0, built - start,
+            startup_elapsed_ms() - built);
+    sdf_atlas_free(&ui.sdf_atlas);
 
     const char *fragment_shader_source =
+        "precision mediump float;\n"
+        "uniform sampler2D atlas;\n"
+        "uniform vec4 color;\n"
+        "uniform float range;\n"
+        "varying vec2 uv;\n"
+        "float median(vec3 v) {\n"
+        "    return max(min(v.r, v.g), min(max(v.r, v.g), v.b));\n"
+        "}\n"
         "void main() {\n"
-        "    gl_FragColor = vec4(1.0, 0.0, 0.0, 1.0);\n"
+        "    float distance = (median(texture2D(atlas, uv).rgb) - 0.5) * range;\n"
+        "    gl_FragColor = vec4(color.rgb, color.a * clamp(distance + 0.5, 0.0, 1.0));\n"
         "}\n";
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_source, NULL);
-    glCompileShader(fragment_shader);
+    ui.program = glCreateProgram();
+    glAttachShader(ui.program, compile_shader(GL_VERTEX_SHADER, ui_vertex_shader_source));
+    glAttachShader(ui.program, compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source));
+}
 
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &compile_status);
-    if (compile_status == GL_FALSE) {
-        fprintf(stderr, "Fragment shader compilation failed\n");
-        exit(EXIT_FAILURE);
+// Uploads the bitmap font as a GL_LUMINANCE atlas of FONT_ADVANCE-wide cells
+static void
+ui_init_gl_bitmap(void)
+{
+    enum { glyphs = FONT_LAST_CHAR - FONT_FIRST_CHAR + 1, atlas_width = glyphs * FONT_ADVANCE };
+    static uint8_t atlas[FONT_GLYPH_HEIGHT][atlas_width];
+
+    for (int g = 0; g < glyphs; ++g) {
+        for (int y = 0; y < FONT_GLYPH_HEIGHT; ++y) {
+            for (int x = 0; x < FONT_GLYPH_WIDTH; ++x) {
+                if (font_glyphs[g][y] & (0x10 >> x)) {
+                    atlas[y][g * FONT_ADVANCE + x] = 0xff;
+                }
+            }
+        }
     }
 
-    GLuint shader_program = glCreateProgram();
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
-    glLinkProgram(shader_program);
-    glUseProgram(shader_program);
+    glGenTextures(1, &ui.atlas);
+    glBindTexture(GL_TEXTURE_2D, ui.atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, atlas_width, FONT_GLYPH_HEIGHT, 0,
+                 GL_LUMINANCE, GL_UNSIGNED_BYTE, atlas);
+    // Integer scales with nearest sampling keep the pixels crisp
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    GLint position_location = glGetAttribLocation(shader_program, "position");
-    glVertexAttribPointer(position_location, 2, GL_FLOAT, GL_FALSE, 0, vertices);
-    glEnableVertexAttribArray(position_location);
+    const char *fragment_shader_source =
+        "precision mediump float;\n"
+        "uniform sampler2D atlas;\n"
+        "uniform vec4 color;\n"
+        "varying vec2 uv;\n"
+        "void main() {\n"
+        "    gl_FragColor = vec4(color.rgb, color.a * texture2D(atlas, uv).r);\n"
+        "}\n";
+    ui.program = glCreateProgram();
+    glAttachShader(ui.program, compile_shader(GL_VERTEX_SHADER, ui_vertex_shader_source));
+    glAttachShader(ui.program, compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source));
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-    eglSwapBuffers(egl_display, egl_surface);
+static void
+ui_init_gl(void)
+{
+    if (ui.sdf) {
+        ui_init_gl_sdf();
+    } else {
+        ui_init_gl_bitmap();
+    }
+    glLinkProgram(ui.program);
+    ui.position_location = glGetAttribLocation(ui.program, "position");
+    ui.texcoord_location = glGetAttribLocation(ui.program, "texcoord");
+    ui.color_location = glGetUniformLocation(ui.program, "color");
+    ui.viewport_location = glGetUniformLocation(ui.program, "viewport");
+    ui.sampler_location = glGetUniformLocation(ui.program, "atlas");
+    ui.transform_location = glGetUniformLocation(ui.program, "transform");
+    ui.range_location = glGetUniformLocation(ui.program, "range");
 }
 
-// Lock the session
-void lock_session(struct globals *globals) {
-    if (!globals->locked) {
-        globals->session_lock = ext_session_lock_manager_v1_lock(globals->session_lock_manager);
-        globals->locked = true;
-        printf("Session locked.\n");
+// One textured quad per character, placed in the node's rect
+static void
+draw_text_node(const struct layout_node *node)
+{
+    static GLfloat vertices[UI_TEXT_MAX * 6 * 4];
+    const struct ui_text *t = node->data;
+    const float cell = 1.0f / (FONT_LAST_CHAR - FONT_FIRST_CHAR + 1);
+    int count = 0;
+
+    // Fields wider than their text (min_width) keep it centred
+    float size = ui_text_size(t);
+    float x = node->rect.x + (node->rect.width - font_text_width(t->text, 1) * size) / 2;
+    float y0 = node->rect.y, y1 = y0 + FONT_GLYPH_HEIGHT * size;
+    for (const char *c = t->text; *c; ++c) {
+        float x1 = x + FONT_ADVANCE * size;
+        float uv[4], qx0 = x, qx1 = x1, qy0 = y0, qy1 = y1;
+        if (ui.sdf) {
+            // The cell is the glyph plus its padding, where the field fades out
+            sdf_glyph_uv(&ui.sdf_atlas, *c, uv);
+            qx0 = x - SDF_PAD * size;
+            qx1 = x + (FONT_GLYPH_WIDTH + SDF_PAD) * size;
+            qy0 = y0 - SDF_PAD * size;
+            qy1 = y1 + SDF_PAD * size;
+        } else {
+            int index = (font_glyph(*c) - font_glyphs[0]) / FONT_GLYPH_HEIGHT;
+            uv[0] = index * cell, uv[1] = 0, uv[2] = uv[0] + cell, uv[3] = 1;
+        }
+        const GLfloat quad[6][4] = {
+            { qx0, qy0, uv[0], uv[1] }, { qx1, qy0, uv[2], uv[1] }, { qx0, qy1, uv[0], uv[3] },
+            { qx0, qy1, uv[0], uv[3] }, { qx1, qy0, uv[2], uv[1] }, { qx1, qy1, uv[2], uv[3] },
+        };
+        memcpy(&vertices[count * 4], quad, sizeof(quad));
+        count += 6;
+        x = x1;
+    }
+
+    glUniform4f(ui.color_location, t->color[0], t->color[1], t->color[2], t->color[3]);
+    if (ui.sdf) {
+        // The atlas spans 2 * SDF_RANGE font pixels of distance from 0 to 1
+        glUniform1f(ui.range_location, 2 * SDF_RANGE * size);
     }
+    glVertexAttribPointer(ui.position_location, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), vertices);
+    glVertexAttribPointer(ui.texcoord_location, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), vertices + 2);
+    glDrawArrays(GL_TRIANGLES, 0, count);
 }
 
-// Unlock the session
-void unlock_session(struct globals *globals) {
-    if (globals->locked && globals->session_lock) {
-        ext_session_lock_v1_destroy(globals->session_lock);
-        globals->locked = false;
-        printf("Session unlocked.\n");
+/*******************************************
+ * render_frame:
+ * - Draws the whole frame (background + text is a handful of quads, cheaper
+ *   than tracking buffer age for a partial GL redraw).
+ * - Hands the layout damage to the compositor with
+ *   eglSwapBuffersWithDamage, so it only recomposites what changed.
+ *   EGL wants the rects in buffer coordinates with a bottom-left origin.
+ * - Layout coordinates are the surface's; the vertex shaders map them to
+ *   the buffer's orientation (globals->buffer_transform), which can differ
+ *   for an output that is rotated.
+ *******************************************/
+void render_frame(struct globals *globals) {
+    TRACE_BEGIN("render", "render_frame");
+    glViewport(0, 0, globals->buffer_width, globals->buffer_height);
+
+    TRACE_BEGIN("render", "clear");
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    TRACE_END("render", "clear");
+
+    if (background.texture) {
+        TRACE_BEGIN("render", "background");
+        draw_background(globals->buffer_transform);
+        TRACE_END("render", "background");
     }
+
+    TRACE_BEGIN("render", "text");
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(ui.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, ui.atlas);
+    glUniform1i(ui.sampler_location, 0);
+    glUniform2f(ui.viewport_location, globals->width, globals->height);
+    glUniformMatrix2fv(ui.transform_location, 1, GL_FALSE, transform_ndc[globals->buffer_transform]);
+    glEnableVertexAttribArray(ui.position_location);
+    glEnableVertexAttribArray(ui.texcoord_location);
+    for (const struct layout_node *node = ui.column.first_child; node; node = node->next_sibling) {
+        draw_text_node(node);
+    }
+    glDisableVertexAttribArray(ui.texcoord_location);
+    glDisableVertexAttribArray(ui.position_location);
+    glDisable(GL_BLEND);
+    TRACE_END("render", "text");
+
+    TRACE_BEGIN("present", "eglSwapBuffers");
+    PROBE1(swap, frame_number);
+    const struct layout_damage *damage = &ui.tree.damage;
+    if (swap_buffers_with_damage && !damage->full) {
+        EGLint rects[LAYOUT_MAX_DAMAGE * 4];
+        for (int i = 0; i < damage->count; ++i) {
+            const struct layout_rect *d = &damage->rects[i];
+            struct transform_rect r = transform_rect(globals->buffer_transform, globals->width, globals->height,
+                                                     (struct transform_rect){ d->x, d->y, d->width, d->height });
+            rects[i * 4 + 0] = r.x;
+            rects[i * 4 + 1] = globals->buffer_height - r.y - r.height;
+            rects[i * 4 + 2] = r.width;
+            rects[i * 4 + 3] = r.height;
+        }
+        swap_buffers_with_damage(egl_display, egl_surface, rects, damage->count);
+    } else {
+        eglSwapBuffers(egl_display, egl_surface);
+    }
+    TRACE_END("present", "eglSwapBuffers");
+    TRACE_END("render", "render_frame");
 }
 
-void setup_fullscreen(struct globals *globals) {
-    xdg_toplevel_set_fullscreen(globals->xdg_toplevel, NULL); // Use the default output
+/*******************************************
+ * apply_buffer_transform:
+ * - Sizes the EGL window for the output's native orientation and declares
+ *   the transform on the surface; both take effect with the next swap.
+ *   The next frame is drawn in full.
+ *******************************************/
+static void
+apply_buffer_transform(struct globals *globals)
+{
+    uint32_t transform = globals->output_transform;
+    if (no_buffer_transform || wl_compositor_get_version(globals->compositor) <
+                               WL_SURFACE_SET_BUFFER_TRANSFORM_SINCE_VERSION) {
+        transform = WL_OUTPUT_TRANSFORM_NORMAL;
+    }
+    int32_t buffer_width, buffer_height;
+    transform_size(transform, globals->width, globals->height, &buffer_width, &buffer_height);
+    if (buffer_width == globals->buffer_width && buffer_height == globals->buffer_height &&
+        transform == globals->buffer_transform) {
+        return;
+    }
+    globals->buffer_width = buffer_width;
+    globals->buffer_height = buffer_height;
+    if (globals->egl_window) {
+        wl_egl_window_resize(globals->egl_window, buffer_width, buffer_height, 0, 0);
+    }
+    if (transform != globals->buffer_transform) {
+        wl_surface_set_buffer_transform(globals->surface, transform);
+        globals->buffer_transform = transform;
+        ui.tree.needs_full = true;
+    }
 }
 
-int main(int argc, char **argv) {
-    struct globals globals = {0};
+static void
+report_layout_stats(void)
+{
+    const struct layout_stats *s = &ui.tree.stats;
+    uint64_t busy = s->updates - s->idle_updates;
+    fprintf(stderr, "[LAYOUT] %llu updates: %llu idle (avg %.3f us), %llu with changes (avg %.3f us), "
+            "max %.3f us, %llu node visits\n",
+            (unsigned long long)s->updates, (unsigned long long)s->idle_updates,
+            s->idle_updates ? s->idle_us / s->idle_updates : 0.0,
+            (unsigned long long)busy, busy ? (s->total_us - s->idle_us) / busy : 0.0,
+            s->max_us, (unsigned long long)s->nodes_visited);
+}
 
-    globals.display = wl_display_connect(NULL);
-    if (!globals.display) {
-        fprintf(stderr, "Failed to connect to Wayland display\n");
-        exit(EXIT_FAILURE);
+/*******************************************
+ * @SHM LOCK SURFACES
+ *******************************************
+ *
+ * The software backend, for machines without a usable GPU stack (where
+ * llvmpipe would burn a core at fullscreen 4K for a mostly static image).
+ *
+ * - One ext_session_lock_surface_v1 per wl_output, as the protocol
+ *   expects. Without ext_session_lock_manager_v1 a single fullscreen
+ *   xdg_toplevel is used instead, like the gl backend does.
+ * - Buffers come from a content-addressed cache (include/buffer_cache.h)
+ *   keyed by a generation that every layout update bumps. Outputs of the
+ *   same size show the same pixels, so the first one to draw a generation
+ *   renders it and the others attach that same wl_buffer. Each size keeps
+ *   SHM_POOL_BUFFERS buffers; more are only added while all are held.
+ * - Only the layout damage is repainted: background (SIMD fill, or a copy
+ *   from the background pre-scaled to the output) and then the text,
+ *   clipped to the rect. Every cached buffer collects the damage of the
+ *   generations it missed ("stale") and repaints just that when reused.
+ * - The compositor gets just the new damage. A frame callback paces
+ *   redraws: damage arriving while one is outstanding is merged and drawn
+ *   once.
+ * - The layout is computed for the first output's size; other outputs
+ *   show the same column centred.
+ * - Buffers are drawn in the output's native orientation (its
+ *   wl_output.geometry transform) and declared with
+ *   wl_surface_set_buffer_transform, so a rotated panel needs no rotation
+ *   pass in the compositor. Layout and damage stay in surface
+ *   coordinates; shm_paint_rect() maps them to the buffer (see
+ *   include/transform.h). --no-buffer-transform draws upright instead,
+ *   for comparison.
+ * - In --daemon mode the pools are allocated and painted ahead of time,
+ *   at the size each wl_output's mode, scale and transform predict. A
+ *   configure at that size then only repaints what changed since (the
+ *   clock) and commits.
+ *******************************************/
+#define SHM_POOL_BUFFERS 2
+#define SHM_MAX_OUTPUTS 8
+#define SHM_BACKGROUND_COLOR 0xff000000u
+
+struct lock_output {
+    struct globals *globals;
+    struct wl_output *output;        // NULL for the xdg_toplevel fallback
+    uint32_t name;                   // Registry name of the wl_output
+    struct wl_surface *surface;
+    struct ext_session_lock_surface_v1 *lock_surface;
+    int32_t width, height;           // Surface size, in layout coordinates
+    int32_t buffer_width, buffer_height, stride;
+    uint32_t buffer_transform;       // What the buffers are drawn with
+    uint32_t surface_transform;      // Last set on the surface
+    struct buffer_cache_entry *current;   // Attached to the surface
+    uint32_t *background;            // Background scaled to this output, or NULL
+    struct layout_damage damage;     // Not drawn yet
+    bool configured;
+    bool frame_pending;
+    bool fresh;                      // No buffer committed to this surface yet
+
+    // wl_output state, to predict the lock surface size
+    int32_t mode_width, mode_height;
+    int32_t scale;
+    int32_t transform;
+
+    uint64_t frames;
+    uint64_t pixels;                 // Repainted, summed over all frames
+    uint64_t stalls;                 // Damage waiting because every buffer was busy
+    uint64_t shared;                 // Frames that attached a buffer drawn elsewhere (another output, prerender)
+};
+
+static struct {
+    // The last slot is the xdg_toplevel fallback
+    struct lock_output outputs[SHM_MAX_OUTPUTS + 1];
+    struct lock_output *primary;     // Its size is the layout size
+    fill_row_fn fill;
+    const char *fill_name;
+    uint8_t *background_rgb;
+    int background_width, background_height;
+    bool first_frame;
+
+    struct buffer_cache cache;
+    struct layout_damage stale[BUFFER_CACHE_MAX];   // Per cache entry: missed since drawn
+    uint64_t generation;             // Of the layout; with the transform, the cache key
+} shm = { .generation = 1 };
+
+// The cache key of the current content drawn with `transform`
+static inline uint64_t
+shm_content_key(uint32_t transform)
+{
+    return shm.generation << 3 | transform;
+}
+
+static uint32_t
+shm_output_transform(const struct lock_output *out)
+{
+    if (no_buffer_transform || wl_compositor_get_version(out->globals->compositor) <
+                               WL_SURFACE_SET_BUFFER_TRANSFORM_SINCE_VERSION) {
+        return WL_OUTPUT_TRANSFORM_NORMAL;
     }
+    return out->transform;
+}
 
-    struct wl_registry *registry = wl_display_get_registry(globals.display);
-    wl_registry_add_listener(registry, &registry_listener, &globals);
-    wl_display_roundtrip(globals.display);
+static const struct ext_session_lock_surface_v1_listener lock_surface_listener;
+static void standby_committed(void);
+static const struct wl_callback_listener shm_frame_listener;
 
-    if (!globals.wm_base) {
-        fprintf(stderr, "xdg_wm_base is not available in this compositor.\n");
-        exit(EXIT_FAILURE);
+static const struct wl_output_listener shm_output_listener;
+
+static void
+shm_output_create_lock_surface(struct lock_output *out)
+{
+    struct globals *globals = out->globals;
+    out->surface = wl_compositor_create_surface(globals->compositor);
+    out->lock_surface = ext_session_lock_v1_get_lock_surface(globals->session_lock, out->surface, out->output);
+    ext_session_lock_surface_v1_add_listener(out->lock_surface, &lock_surface_listener, out);
+    out->fresh = true;
+    out->surface_transform = WL_OUTPUT_TRANSFORM_NORMAL;
+}
+
+static void
+shm_output_bind(struct globals *globals, struct wl_registry *registry, uint32_t name, uint32_t version)
+{
+    for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+        struct lock_output *out = &shm.outputs[i];
+        if (out->output) {
+            continue;
+        }
+        out->globals = globals;
+        out->name = name;
+        out->scale = 1;
+        // v2 for scale and done
+        out->output = wl_registry_bind(registry, name, &wl_output_interface, version < 2 ? version : 2);
+        wl_output_add_listener(out->output, &shm_output_listener, out);
+        // A hotplugged output needs its own lock surface
+        if (globals->session_lock && backend == BACKEND_SHM) {
+            shm_output_create_lock_surface(out);
+        }
+        return;
+    }
+    fprintf(stderr, "[SHM] More than %d outputs, ignoring output %u\n", SHM_MAX_OUTPUTS, name);
+}
+
+// Drops the cached buffers of a size no output has any more
+static void
+shm_evict_unused(int32_t width, int32_t height)
+{
+    if (width <= 0) {
+        return;
+    }
+    for (int i = 0; i <= SHM_MAX_OUTPUTS; ++i) {
+        if (shm.outputs[i].buffer_width == width && shm.outputs[i].buffer_height == height) {
+            return;
+        }
     }
+    buffer_cache_evict_size(&shm.cache, width, height);
+}
 
-    globals.surface = wl_compositor_create_surface(globals.compositor);
-    if (!globals.surface) {
-        fprintf(stderr, "Failed to create Wayland surface\n");
-        exit(EXIT_FAILURE);
+static void
+shm_output_free_buffers(struct lock_output *out)
+{
+    buffer_cache_detach(&out->current);
+    free(out->background);
+    out->background = NULL;
+}
+
+static void
+shm_output_destroy(struct lock_output *out)
+{
+    int32_t width = out->buffer_width, height = out->buffer_height;
+    shm_output_free_buffers(out);
+    if (out->lock_surface) {
+        ext_session_lock_surface_v1_destroy(out->lock_surface);
     }
+    if (out->surface && out->output) {
+        wl_surface_destroy(out->surface);     // The fallback's surface belongs to globals
+    }
+    if (out->output) {
+        wl_output_destroy(out->output);
+    }
+    if (shm.primary == out) {
+        shm.primary = NULL;
+    }
+    memset(out, 0, sizeof(*out));
+    shm_evict_unused(width, height);
+}
 
-    globals.xdg_surface = xdg_wm_base_get_xdg_surface(globals.wm_base, globals.surface);
-    if (!globals.xdg_surface) {
-        fprintf(stderr, "Failed to create xdg surface\n");
-        exit(EXIT_FAILURE);
+static void
+shm_output_remove(uint32_t name)
+{
+    for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+        if (shm.outputs[i].output && shm.outputs[i].name == name) {
+            shm_output_destroy(&shm.outputs[i]);
+        }
     }
+}
 
-    globals.xdg_toplevel = xdg_surface_get_toplevel(globals.xdg_surface);
-    if (!globals.xdg_toplevel) {
-        fprintf(stderr, "Failed to create xdg toplevel\n");
-        exit(EXIT_FAILURE);
+// Nearest-neighbour stretch of the --background image, like the GL quad,
+// stored in buffer orientation so restoring a rect is a plain copy
+static void
+shm_output_scale_background(struct lock_output *out)
+{
+    if (!shm.background_rgb) {
+        return;
+    }
+    out->background = malloc((size_t)out->stride * out->buffer_height);
+    if (!out->background) {
+        return;
+    }
+    uint32_t inverse = transform_invert(out->buffer_transform);
+    for (int by = 0; by < out->buffer_height; ++by) {
+        uint32_t *dst = out->background + (size_t)by * out->buffer_width;
+        for (int bx = 0; bx < out->buffer_width; ++bx) {
+            struct transform_rect r = transform_rect(inverse, out->buffer_width, out->buffer_height,
+                                                     (struct transform_rect){ bx, by, 1, 1 });
+            const uint8_t *p = shm.background_rgb +
+                ((size_t)(r.y * shm.background_height / out->height) * shm.background_width +
+                 (size_t)(r.x * shm.background_width / out->width)) * 3;
+            dst[bx] = 0xff000000u | (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+        }
+    }
+}
+
+// Sizes the output and makes sure the cache holds buffers of that size
+static bool
+shm_output_allocate(struct lock_output *out, int32_t width, int32_t height, uint32_t transform)
+{
+    out->width = width;
+    out->height = height;
+    out->buffer_transform = transform;
+    transform_size(transform, width, height, &out->buffer_width, &out->buffer_height);
+    out->stride = out->buffer_width * 4;
+    int32_t buffer_width = out->buffer_width, buffer_height = out->buffer_height;
+    while (buffer_cache_count(&shm.cache, buffer_width, buffer_height) < SHM_POOL_BUFFERS) {
+        struct buffer_cache_entry *entry = buffer_cache_add(&shm.cache, buffer_width, buffer_height);
+        if (!entry) {
+            break;          // The rest are added once buffers are released
+        }
+        shm.stale[entry - shm.cache.entries] = (struct layout_damage){ .full = true };
+    }
+    shm_output_scale_background(out);
+    return buffer_cache_count(&shm.cache, buffer_width, buffer_height) > 0;
+}
+
+// Moves the output to buffers of its new size or orientation; new ones start out stale
+static bool
+shm_output_resize(struct lock_output *out, int32_t width, int32_t height)
+{
+    uint32_t transform = shm_output_transform(out);
+    if (width == out->width && height == out->height && transform == out->buffer_transform) {
+        return true;
+    }
+    int32_t old_width = out->buffer_width, old_height = out->buffer_height;
+    TRACE_BEGIN("render", "shm_allocate");
+    free(out->background);
+    out->background = NULL;
+    bool allocated = shm_output_allocate(out, width, height, transform);
+    shm_evict_unused(old_width, old_height);
+    TRACE_END("render", "shm_allocate");
+    if (!allocated) {
+        fprintf(stderr, "[SHM] No buffers for a %dx%d output\n", width, height);
+        return false;
+    }
+    if (!shm.primary) {
+        shm.primary = out;
+    }
+    if (shm.primary == out) {
+        layout_resize(&ui.tree, width, height);
+    }
+    out->damage.full = true;
+    return true;
+}
+
+// Applies an acked configure: the next commit must be at exactly this size
+static void
+shm_output_configure(struct lock_output *out, int32_t width, int32_t height)
+{
+    if (width <= 0 || height <= 0) {
+        return;
     }
+    if (!shm_output_resize(out, width, height)) {
+        running = 0;
+        return;
+    }
+    out->configured = true;
+    out->globals->configured = true;
+}
+
+static uint32_t
+ui_color_xrgb(const GLfloat color[4])
+{
+    return 0xff000000u | (uint32_t)(color[0] * 255.0f) << 16 |
+           (uint32_t)(color[1] * 255.0f) << 8 | (uint32_t)(color[2] * 255.0f);
+}
 
-    // Force full screen
-    setup_fullscreen(&globals);
+// Where the layout's origin lands on an output (or buffer) of this size
+static void
+shm_layout_offset(int32_t width, int32_t height, int32_t *dx, int32_t *dy)
+{
+    *dx = (width - ui.tree.width) / 2;
+    *dy = (height - ui.tree.height) / 2;
+}
+
+static struct transform_rect
+shm_output_to_buffer(const struct lock_output *out, struct layout_rect rect)
+{
+    return transform_rect(out->buffer_transform, out->width, out->height,
+                          (struct transform_rect){ rect.x, rect.y, rect.width, rect.height });
+}
 
-    globals.egl_window = wl_egl_window_create(globals.surface, 600, 600);
-    init_egl(&globals);
+/*******************************************
+ * shm_draw_text_transformed:
+ * - font_draw_text() for a rotated or flipped buffer: every lit glyph
+ *   cell is a scale x scale block in surface coordinates, clipped, mapped
+ *   to the buffer and filled there.
+ *******************************************/
+static void
+shm_draw_text_transformed(const struct lock_output *out, uint32_t *pixels,
+                          const struct layout_rect *clip, int x, int y, int scale,
+                          uint32_t color, const char *text)
+{
+    int32_t clip_x1 = clip->x + clip->width, clip_y1 = clip->y + clip->height;
+    for (; *text; ++text, x += FONT_ADVANCE * scale) {
+        if (x >= clip_x1 || x + FONT_GLYPH_WIDTH * scale <= clip->x) {
+            continue;
+        }
+        const uint8_t *rows = font_glyph((unsigned char)*text);
+        for (int gy = 0; gy < FONT_GLYPH_HEIGHT; ++gy) {
+            for (int gx = 0; gx < FONT_GLYPH_WIDTH; ++gx) {
+                if (!(rows[gy] & (0x10 >> gx))) {
+                    continue;
+                }
+                int32_t x0 = x + gx * scale, y0 = y + gy * scale;
+                int32_t x1 = x0 + scale, y1 = y0 + scale;
+                x0 = x0 > clip->x ? x0 : clip->x;
+                y0 = y0 > clip->y ? y0 : clip->y;
+                x1 = x1 < clip_x1 ? x1 : clip_x1;
+                y1 = y1 < clip_y1 ? y1 : clip_y1;
+                if (x1 <= x0 || y1 <= y0) {
+                    continue;
+                }
+                struct transform_rect b = shm_output_to_buffer(out, (struct layout_rect){ x0, y0, x1 - x0, y1 - y0 });
+                fill_rect(shm.fill, pixels, out->stride, b.x, b.y, b.width, b.height, color);
+            }
+        }
+    }
+}
 
-    wl_surface_commit(globals.surface);
-    wl_display_flush(globals.display);
+// Background, then every text node that overlaps `rect`, clipped to it
+static void
+shm_paint_rect(struct lock_output *out, uint32_t *pixels, struct layout_rect rect)
+{
+    int32_t x0 = rect.x > 0 ? rect.x : 0;
+    int32_t y0 = rect.y > 0 ? rect.y : 0;
+    int32_t x1 = rect.x + rect.width < out->width ? rect.x + rect.width : out->width;
+    int32_t y1 = rect.y + rect.height < out->height ? rect.y + rect.height : out->height;
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+    struct layout_rect clipped = { x0, y0, x1 - x0, y1 - y0 };
 
-    // Lock the session to prevent user interaction
-    lock_session(&globals);
+    struct transform_rect b = shm_output_to_buffer(out, clipped);
+    if (out->background) {
+        fill_copy_rect(pixels, out->background, out->stride, b.x, b.y, b.width, b.height);
+    } else {
+        fill_rect(shm.fill, pixels, out->stride, b.x, b.y, b.width, b.height, SHM_BACKGROUND_COLOR);
+    }
 
-    // Main loop
-    while (wl_display_dispatch(globals.display) != -1) {
-        if (!globals.locked) {
-            render_triangle();
+    int32_t dx, dy;
+    shm_layout_offset(out->width, out->height, &dx, &dy);
+    const int32_t clip[4] = { clipped.x, clipped.y, clipped.width, clipped.height };
+    for (const struct layout_node *node = ui.column.first_child; node; node = node->next_sibling) {
+        struct layout_rect r = node->rect;
+        r.x += dx;
+        r.y += dy;
+        if (!layout_rect_touch(&r, &clipped)) {
+            continue;
+        }
+        // Fields wider than their text (min_width) keep it centred
+        const struct ui_text *t = node->data;
+        int x = r.x + (r.width - font_text_width(t->text, t->scale)) / 2;
+        if (out->buffer_transform == WL_OUTPUT_TRANSFORM_NORMAL) {
+            font_draw_text(pixels, out->width, out->height, out->stride, clip, x, r.y,
+                           t->scale, ui_color_xrgb(t->color), t->text);
+        } else {
+            shm_draw_text_transformed(out, pixels, &clipped, x, r.y, t->scale,
+                                      ui_color_xrgb(t->color), t->text);
         }
     }
+    out->pixels += (uint64_t)clipped.width * clipped.height;
+}
 
-    // Clean up
-    if (globals.session_lock) {
-        ext_session_lock_v1_destroy(globals.session_lock);
+// Adds layout damage to `dst`, moved to the origin used at this size
+static void
+shm_damage_merge(struct layout_damage *dst, const struct layout_damage *src,
+                 int32_t width, int32_t height)
+{
+    if (src->full) {
+        dst->full = true;
+        dst->count = 0;
+        return;
     }
-    if (globals.xdg_toplevel) {
-        xdg_toplevel_destroy(globals.xdg_toplevel);
+    int32_t dx, dy;
+    shm_layout_offset(width, height, &dx, &dy);
+    for (int i = 0; i < src->count; ++i) {
+        struct layout_rect r = src->rects[i];
+        r.x += dx;
+        r.y += dy;
+        layout_damage_add(dst, r);
     }
-    if (globals.xdg_surface) {
-        xdg_surface_destroy(globals.xdg_surface);
+}
+
+// Repaints whatever the buffer missed, leaving it at the current generation
+static void
+shm_buffer_repaint(struct lock_output *out, struct buffer_cache_entry *entry)
+{
+    struct layout_damage *stale = &shm.stale[entry - shm.cache.entries];
+    if (stale->full || entry->key == BUFFER_CACHE_EMPTY || (entry->key & 7) != out->buffer_transform) {
+        shm_paint_rect(out, entry->pixels, (struct layout_rect){ 0, 0, out->width, out->height });
+    } else {
+        for (int i = 0; i < stale->count; ++i) {
+            shm_paint_rect(out, entry->pixels, stale->rects[i]);
+        }
     }
-    if (globals.surface) {
-        wl_surface_destroy(globals.surface);
+    *stale = (struct layout_damage){0};
+    entry->key = shm_content_key(out->buffer_transform);
+}
+
+/*******************************************
+ * shm_output_render:
+ * - Commits the current generation: a buffer another output of this size
+ *   already drew, or else a free one brought up to date.
+ * - Does nothing while a frame callback is outstanding or every buffer is
+ *   still held by the compositor; the frame/release handlers call it again.
+ *******************************************/
+static void
+shm_output_render(struct lock_output *out)
+{
+    if (!out->surface || !out->configured || out->frame_pending ||
+        (!out->fresh && !out->damage.full && out->damage.count == 0)) {
+        return;
     }
-    if (globals.egl_window) {
-        wl_egl_window_destroy(globals.egl_window);
+    uint64_t key = shm_content_key(out->buffer_transform);
+    struct buffer_cache_entry *entry = buffer_cache_lookup(&shm.cache, key, out->buffer_width, out->buffer_height);
+    if (entry && entry != out->current) {
+        ++out->shared;
+    } else if (!entry) {
+        entry = buffer_cache_reserve(&shm.cache, out->buffer_width, out->buffer_height);
+        if (!entry) {
+            ++out->stalls;
+            return;
+        }
+    }
+
+    TRACE_BEGIN("render", "shm_render");
+    PROBE1(frame_start, ++frame_number);
+    if (entry->key != key) {
+        shm_buffer_repaint(out, entry);
+    }
+    PROBE1(frame_end, frame_number);
+
+    if (out->surface_transform != out->buffer_transform) {
+        wl_surface_set_buffer_transform(out->surface, out->buffer_transform);
+        out->surface_transform = out->buffer_transform;
+    }
+    buffer_cache_attach(&out->current, entry, out->surface, frame_number);
+    bool damage_buffer = wl_surface_get_version(out->surface) >= WL_SURFACE_DAMAGE_BUFFER_SINCE_VERSION;
+    if (out->damage.full || out->fresh) {
+        wl_surface_damage(out->surface, 0, 0, INT32_MAX, INT32_MAX);
+    } else {
+        // Scale 1: buffer coordinates only differ by the transform
+        for (int i = 0; i < out->damage.count; ++i) {
+            const struct layout_rect *r = &out->damage.rects[i];
+            if (damage_buffer) {
+                struct transform_rect b = shm_output_to_buffer(out, *r);
+                wl_surface_damage_buffer(out->surface, b.x, b.y, b.width, b.height);
+            } else {
+                wl_surface_damage(out->surface, r->x, r->y, r->width, r->height);
+            }
+        }
+    }
+    struct wl_callback *callback = wl_surface_frame(out->surface);
+    wl_callback_add_listener(callback, &shm_frame_listener, out);
+    out->frame_pending = true;
+    out->damage = (struct layout_damage){0};
+    out->fresh = false;
+    ++out->frames;
+
+    TRACE_BEGIN("present", "commit");
+    PROBE1(commit, frame_number);
+    wl_surface_commit(out->surface);
+    TRACE_END("present", "commit");
+    TRACE_END("render", "shm_render");
+
+    if (daemon_mode) {
+        standby_committed();
+    } else if (!shm.first_frame) {
+        shm.first_frame = true;
+        wl_display_flush(out->globals->display);
+        startup_report("first frame committed (shm)");
+    }
+}
+
+static void
+shm_frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+    struct lock_output *out = data;
+    wl_callback_destroy(callback);
+    out->frame_pending = false;
+    shm_output_render(out);
+}
+
+static const struct wl_callback_listener shm_frame_listener = {
+    .done = shm_frame_done,
+};
+
+static void shm_render_all(void);
+
+// A buffer became free: outputs that found none can draw now
+static void
+shm_buffer_released(void *data)
+{
+    shm_render_all();
+}
+
+static void
+lock_surface_configure(void *data, struct ext_session_lock_surface_v1 *lock_surface,
+                       uint32_t serial, uint32_t width, uint32_t height)
+{
+    struct lock_output *out = data;
+    PROBE1(configure_received, serial);
+    ext_session_lock_surface_v1_ack_configure(lock_surface, serial);
+    PROBE1(configure_acked, serial);
+    shm_output_configure(out, width, height);
+}
+
+static const struct ext_session_lock_surface_v1_listener lock_surface_listener = {
+    .configure = lock_surface_configure,
+};
+
+/*******************************************
+ * Standby (--daemon) helpers:
+ * - The lock surface of an output will be its logical size: the current
+ *   mode divided by the scale, swapped for 90/270 degree transforms. The
+ *   pool is allocated at that size as soon as the output is announced.
+ * - Layout changes while no lock surface exists are only recorded as
+ *   stale damage in the cached buffers; shm_output_prerender() repaints
+ *   them.
+ *******************************************/
+static void
+shm_output_predict(struct lock_output *out)
+{
+    if (!daemon_mode || out->lock_surface || out->mode_width <= 0 || out->scale <= 0) {
+        return;
+    }
+    int32_t width = out->mode_width / out->scale, height = out->mode_height / out->scale;
+    if (out->transform & 1) {
+        int32_t swap = width;
+        width = height;
+        height = swap;
+    }
+    shm_output_resize(out, width, height);
+}
+
+static void
+shm_output_geometry(void *data, struct wl_output *output, int32_t x, int32_t y,
+                    int32_t physical_width, int32_t physical_height, int32_t subpixel,
+                    const char *make, const char *model, int32_t transform)
+{
+    struct lock_output *out = data;
+    if (transform == out->transform) {
+        return;
+    }
+    out->transform = transform;
+    // A rotation also brings a configure with the new size; a flip does not
+    if (out->configured) {
+        shm_output_resize(out, out->width, out->height);
+    }
+}
+
+static void
+shm_output_mode(void *data, struct wl_output *output, uint32_t flags,
+                int32_t width, int32_t height, int32_t refresh)
+{
+    struct lock_output *out = data;
+    if (flags & WL_OUTPUT_MODE_CURRENT) {
+        out->mode_width = width;
+        out->mode_height = height;
+        // v1 outputs never send done
+        if (wl_output_get_version(output) < 2) {
+            shm_output_predict(out);
+        }
+    }
+}
+
+static void
+shm_output_done(void *data, struct wl_output *output)
+{
+    shm_output_predict(data);
+}
+
+static void
+shm_output_scale(void *data, struct wl_output *output, int32_t factor)
+{
+    struct lock_output *out = data;
+    out->scale = factor;
+}
+
+static const struct wl_output_listener shm_output_listener = {
+    .geometry = shm_output_geometry,
+    .mode = shm_output_mode,
+    .done = shm_output_done,
+    .scale = shm_output_scale,
+};
+
+// Brings every free buffer of this output's size to the current generation
+static void
+shm_output_prerender(struct lock_output *out)
+{
+    if (out->width <= 0) {
+        return;
+    }
+    TRACE_BEGIN("render", "shm_prerender");
+    uint64_t key = shm_content_key(out->buffer_transform);
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        struct buffer_cache_entry *entry = &shm.cache.entries[i];
+        if (buffer_cache_free(entry) && entry->width == out->buffer_width &&
+            entry->height == out->buffer_height && entry->key != key) {
+            shm_buffer_repaint(out, entry);
+        }
+    }
+    out->damage = (struct layout_damage){0};    // Already in the buffers
+    TRACE_END("render", "shm_prerender");
+}
+
+// After an unlock: the lock surface goes, the pool and its contents stay
+static void
+shm_output_drop_surface(struct lock_output *out)
+{
+    buffer_cache_detach(&out->current);
+    out->damage = (struct layout_damage){0};
+    if (out->lock_surface) {
+        ext_session_lock_surface_v1_destroy(out->lock_surface);
+        out->lock_surface = NULL;
+    }
+    if (out->surface) {
+        wl_surface_destroy(out->surface);
+        out->surface = NULL;
+    }
+    out->configured = false;
+    out->frame_pending = false;
+    out->fresh = false;
+}
+
+/*******************************************
+ * shm_add_damage:
+ * - Starts a new generation: the damage of one layout update goes to
+ *   every cached buffer (as stale) and every configured output (to be
+ *   committed), each in its own coordinates.
+ *******************************************/
+static void
+shm_add_damage(const struct layout_damage *damage)
+{
+    if (damage->count == 0) {
+        return;
+    }
+    ++shm.generation;
+    for (int i = 0; i < BUFFER_CACHE_MAX; ++i) {
+        // Stale damage is kept in the surface coordinates the entry was drawn for
+        const struct buffer_cache_entry *entry = &shm.cache.entries[i];
+        if (entry->buffer) {
+            int32_t width, height;
+            transform_size(entry->key & 7, entry->width, entry->height, &width, &height);
+            shm_damage_merge(&shm.stale[i], damage, width, height);
+        }
+    }
+    for (int i = 0; i <= SHM_MAX_OUTPUTS; ++i) {
+        struct lock_output *out = &shm.outputs[i];
+        if (out->configured) {
+            shm_damage_merge(&out->damage, damage, out->width, out->height);
+        }
+    }
+}
+
+static void
+shm_render_all(void)
+{
+    for (int i = 0; i <= SHM_MAX_OUTPUTS; ++i) {
+        if (shm.outputs[i].surface) {
+            shm_output_render(&shm.outputs[i]);
+        }
+    }
+}
+
+static void
+shm_report(void)
+{
+    fprintf(stderr, "[SHM] fill kernel %s\n", shm.fill_name);
+    buffer_cache_report(&shm.cache, "buffer cache");
+    for (int i = 0; i <= SHM_MAX_OUTPUTS; ++i) {
+        const struct lock_output *out = &shm.outputs[i];
+        if (!out->frames) {
+            continue;
+        }
+        double area = (double)out->width * out->height;
+        fprintf(stderr, "[SHM] %s %dx%d (output transform %d, buffer transform %u): %llu frames "
+                "(%llu on a buffer drawn before), avg %.1f%% of the output repainted, "
+                "%llu waits for a free buffer\n", out->output ? "output" : "window",
+                out->width, out->height, out->transform, out->buffer_transform,
+                (unsigned long long)out->frames, (unsigned long long)out->shared,
+                100.0 * out->pixels / (area * out->frames), (unsigned long long)out->stalls);
+    }
+}
+
+static void
+shm_cleanup(void)
+{
+    for (int i = 0; i <= SHM_MAX_OUTPUTS; ++i) {
+        shm_output_destroy(&shm.outputs[i]);
+    }
+    buffer_cache_finish(&shm.cache);
+    free(shm.background_rgb);
+}
+
+static void standby_locked(struct globals *globals);
+static void standby_lock_finished(struct globals *globals);
+void unlock_session(struct globals *globals);
+
+static void session_lock_locked(void *data, struct ext_session_lock_v1 *lock) {
+    struct globals *globals = data;
+    globals->lock_confirmed = true;
+    TRACE_INSTANT("lock", "locked");
+    printf("Session locked.\n");
+
+    if (daemon_mode) {
+        standby_locked(globals);
+        return;
+    }
+    fprintf(stderr, "[LOCK] cold start to locked: %.2f ms since main\n", startup_elapsed_ms());
+    // For scripts/lock_latency.sh: measure, then give the session back
+    const char *exit_after = getenv("MYWAYLAND_LOCK_EXIT");
+    if (exit_after && strcmp(exit_after, "1") == 0) {
+        unlock_session(globals);
+        running = 0;
+    }
+}
+
+// The compositor refused the lock (e.g. another locker is running) or ended it
+static void session_lock_finished(void *data, struct ext_session_lock_v1 *lock) {
+    struct globals *globals = data;
+    fprintf(stderr, globals->lock_confirmed ? "The compositor ended the session lock\n"
+                                            : "The compositor did not lock the session\n");
+    ext_session_lock_v1_destroy(lock);
+    globals->session_lock = NULL;
+    globals->locked = false;
+    globals->lock_confirmed = false;
+    TRACE_INSTANT("lock", "finished");
+
+    // The daemon stays resident and waits for the next trigger
+    if (daemon_mode) {
+        standby_lock_finished(globals);
+        return;
+    }
+    for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+        shm_output_drop_surface(&shm.outputs[i]);
+    }
+    running = 0;
+}
+
+static const struct ext_session_lock_v1_listener session_lock_listener = {
+    .locked = session_lock_locked,
+    .finished = session_lock_finished,
+};
+
+// Lock the session; false when there is no output to put a lock surface on
+bool lock_session(struct globals *globals) {
+    if (globals->locked) {
+        return true;
+    }
+    int outputs = 0;
+    for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+        outputs += shm.outputs[i].output != NULL;
+    }
+    if (backend != BACKEND_SHM || outputs == 0) {
+        return false;
+    }
+
+    globals->lock_confirmed = false;
+    globals->session_lock = ext_session_lock_manager_v1_lock(globals->session_lock_manager);
+    ext_session_lock_v1_add_listener(globals->session_lock, &session_lock_listener, globals);
+    globals->locked = true;
+    TRACE_INSTANT("lock", "lock requested");
+
+    // The shm backend draws on one lock surface per output
+    for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+        struct lock_output *out = &shm.outputs[i];
+        if (out->output && !out->lock_surface) {
+            shm_output_create_lock_surface(out);
+        }
+    }
+    return true;
+}
+
+// Unlock the session
+void unlock_session(struct globals *globals) {
+    if (globals->locked && globals->session_lock) {
+        // Only a confirmed lock may be unlocked, an unconfirmed one is withdrawn
+        if (globals->lock_confirmed) {
+            ext_session_lock_v1_unlock_and_destroy(globals->session_lock);
+        } else {
+            ext_session_lock_v1_destroy(globals->session_lock);
+        }
+        globals->session_lock = NULL;
+        globals->locked = false;
+        TRACE_INSTANT("lock", "unlocked");
+        printf("Session unlocked.\n");
+    }
+}
+
+/*******************************************
+ * @CPU ACCOUNTING
+ *******************************************
+ *
+ * What the lock screen costs while it sits there, and per key typed, with
+ * either backend. The process CPU clock (every thread, so a software GL
+ * driver's workers are included) is sampled each time poll() returns, and
+ * the time since the previous wake-up is charged to:
+ * - keys, when that loop iteration handled at least one key press;
+ * - idle otherwise (clock ticks, frame callbacks, buffer releases).
+ * Idle CPU is extrapolated to an hour from the wall time it covered.
+ *******************************************/
+static struct {
+    struct timespec cpu, wall;       // At the previous wake-up
+    bool started;
+    uint64_t keys;                   // Key presses so far
+    uint64_t keys_seen;              // ... as of the previous wake-up
+    double key_cpu_ms;
+    double idle_cpu_ms, idle_wall_ms;
+} cpu;
+
+static double
+timespec_diff_ms(const struct timespec *end, const struct timespec *start)
+{
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Call right after every poll(); the first call only starts the clocks
+static void
+cpu_account(void)
+{
+    struct timespec now_cpu, now_wall;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now_cpu);
+    clock_gettime(CLOCK_MONOTONIC, &now_wall);
+    if (cpu.started) {
+        double cpu_ms = timespec_diff_ms(&now_cpu, &cpu.cpu);
+        if (cpu.keys != cpu.keys_seen) {
+            cpu.key_cpu_ms += cpu_ms;
+        } else {
+            cpu.idle_cpu_ms += cpu_ms;
+            cpu.idle_wall_ms += timespec_diff_ms(&now_wall, &cpu.wall);
+        }
+    }
+    cpu.started = true;
+    cpu.keys_seen = cpu.keys;
+    cpu.cpu = now_cpu;
+    cpu.wall = now_wall;
+}
+
+static void
+report_cpu_usage(void)
+{
+    fprintf(stderr, "[CPU] %s backend: idle %.1f ms CPU over %.1f s (%.1f ms per idle hour), "
+            "%llu keys, %.1f us CPU per key\n", backend == BACKEND_SHM ? "shm" : "gl",
+            cpu.idle_cpu_ms, cpu.idle_wall_ms / 1e3,
+            cpu.idle_wall_ms > 0 ? cpu.idle_cpu_ms * 3600e3 / cpu.idle_wall_ms : 0.0,
+            (unsigned long long)cpu.keys, cpu.keys ? cpu.key_cpu_ms * 1e3 / cpu.keys : 0.0);
+}
+
+/*******************************************
+ * @WARM STANDBY
+ *******************************************
+ *
+ * `--daemon` connects once and then waits, with everything a lock needs
+ * already done: globals bound, fill kernel picked, background decoded and
+ * scaled, and a painted buffer pool per output (see the standby helpers of
+ * the shm backend). It locks when:
+ * - ext_idle_notifier_v1 reports the seat idle for --idle seconds, or
+ * - a client on the control socket sends "lock".
+ *
+ * Locking is then one flush (lock + get_lock_surface for every output)
+ * and, per configure, ack + attach + commit of a buffer that only needed
+ * its clock repainted. The time from trigger to first commit and to the
+ * compositor's locked event is printed per lock; cold starts print
+ * "[LOCK] cold start to locked" for comparison (scripts/lock_latency.sh
+ * runs both). After an unlock the surfaces go and the pool is kept.
+ *
+ * Control socket ($XDG_RUNTIME_DIR/mywayland-lock.sock or --socket), one
+ * command per connection, answered with one line:
+ * - lock     "locked <ms>" once the compositor confirmed it
+ * - status   "locked" or "unlocked"
+ * - unlock   only with --bench-unlock, for benchmarking on a headless
+ *            compositor; otherwise refused
+ * - quit     stops the daemon (a held lock stays held)
+ * `renderlock --ctl <command>` is the matching client.
+ *******************************************/
+#define DAEMON_MAX_CLIENTS 4
+
+static struct {
+    char socket_path[108];           // sizeof(sockaddr_un.sun_path)
+    int listen_fd;
+    int clients[DAEMON_MAX_CLIENTS]; // -1 when free
+    bool waiting[DAEMON_MAX_CLIENTS];// Answered on the locked event
+    uint32_t idle_seconds;
+    bool bench_unlock;
+    struct ext_idle_notification_v1 *idle_notification;
+    bool prerender_pending;
+
+    // The lock in progress
+    bool triggered;
+    const char *trigger_source;
+    struct timespec trigger;
+    double first_commit_ms;          // < 0 until the first commit
+
+    uint64_t locks;
+    double locked_ms_total, locked_ms_max;
+} standby = {
+    .listen_fd = -1,
+    .clients = { -1, -1, -1, -1 },
+    .idle_seconds = 300,
+};
+
+static double
+standby_since_trigger_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_diff_ms(&now, &standby.trigger);
+}
+
+// Repaints whatever changed while no lock surface was shown
+static void
+standby_prerender(void)
+{
+    ui_update_clock();
+    layout_update(&ui.tree);
+    shm_add_damage(&ui.tree.damage);
+    for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+        if (!shm.outputs[i].configured) {
+            shm_output_prerender(&shm.outputs[i]);
+        }
+    }
+    standby.prerender_pending = false;
+}
+
+static void standby_reply_waiting(const char *reply);
+
+static void
+standby_trigger(struct globals *globals, const char *source)
+{
+    if (globals->locked) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &standby.trigger);
+    standby.triggered = true;
+    standby.trigger_source = source;
+    standby.first_commit_ms = -1;
+    TRACE_INSTANT("lock", "trigger");
+
+    // The whole request round goes out first...
+    if (!lock_session(globals)) {
+        fprintf(stderr, "[DAEMON] No output to lock\n");
+        standby.triggered = false;
+        standby_reply_waiting("refused\n");
+        return;
+    }
+    wl_display_flush(globals->display);
+    // ...and the clock is brought up to date while the compositor handles it
+    standby_prerender();
+}
+
+static void
+standby_committed(void)
+{
+    if (standby.triggered && standby.first_commit_ms < 0) {
+        standby.first_commit_ms = standby_since_trigger_ms();
+    }
+}
+
+static void
+standby_close_client(int index)
+{
+    close(standby.clients[index]);
+    standby.clients[index] = -1;
+    standby.waiting[index] = false;
+}
+
+static void
+standby_reply(int index, const char *reply)
+{
+    if (write(standby.clients[index], reply, strlen(reply)) < 0) {
+        fprintf(stderr, "[DAEMON] Failed to answer a control client\n");
+    }
+    standby_close_client(index);
+}
+
+// Answers every `--ctl lock` still waiting for the outcome
+static void
+standby_reply_waiting(const char *reply)
+{
+    for (int i = 0; i < DAEMON_MAX_CLIENTS; ++i) {
+        if (standby.clients[i] >= 0 && standby.waiting[i]) {
+            standby_reply(i, reply);
+        }
+    }
+}
+
+static void
+standby_locked(struct globals *globals)
+{
+    if (!standby.triggered) {
+        return;
+    }
+    double ms = standby_since_trigger_ms();
+    standby.triggered = false;
+    ++standby.locks;
+    standby.locked_ms_total += ms;
+    if (ms > standby.locked_ms_max) {
+        standby.locked_ms_max = ms;
+    }
+    fprintf(stderr, "[DAEMON] lock %llu (%s): trigger to first commit %.2f ms, to locked %.2f ms\n",
+            (unsigned long long)standby.locks, standby.trigger_source, standby.first_commit_ms, ms);
+
+    char reply[64];
+    snprintf(reply, sizeof(reply), "locked %.2f\n", ms);
+    standby_reply_waiting(reply);
+}
+
+// Back to standby: drop the lock surfaces, reset the UI for the next lock
+static void
+standby_unlocked(struct globals *globals)
+{
+    for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+        shm_output_drop_surface(&shm.outputs[i]);
+    }
+    globals->configured = false;
+    ui.password_length = 0;
+    ui_update_password();
+    ui_set_text(&ui.status, "Type your password");
+    standby.prerender_pending = true;
+}
+
+// The compositor refused or ended the lock: back to standby, not out
+static void
+standby_lock_finished(struct globals *globals)
+{
+    if (standby.triggered) {
+        standby.triggered = false;
+        standby_reply_waiting("refused\n");
+    }
+    standby_unlocked(globals);
+    fprintf(stderr, "[DAEMON] Lock finished by the compositor, back to standby\n");
+}
+
+static void
+standby_command(struct globals *globals, int index, const char *command)
+{
+    if (strcmp(command, "lock") == 0) {
+        if (globals->locked) {
+            standby_reply(index, "already locked\n");
+            return;
+        }
+        standby.waiting[index] = true;
+        standby_trigger(globals, "socket");
+    } else if (strcmp(command, "status") == 0) {
+        standby_reply(index, globals->locked ? "locked\n" : "unlocked\n");
+    } else if (strcmp(command, "unlock") == 0) {
+        if (!standby.bench_unlock) {
+            standby_reply(index, "refused\n");
+        } else if (!globals->lock_confirmed || !globals->locked) {
+            standby_reply(index, "not locked\n");
+        } else {
+            unlock_session(globals);
+            standby_unlocked(globals);
+            standby_reply(index, "unlocked\n");
+        }
+    } else if (strcmp(command, "quit") == 0) {
+        running = 0;
+        standby_reply(index, "bye\n");
+    } else {
+        standby_reply(index, "unknown command\n");
+    }
+}
+
+static void
+standby_read_client(struct globals *globals, int index)
+{
+    char command[32];
+    ssize_t length = read(standby.clients[index], command, sizeof(command) - 1);
+    if (length <= 0) {
+        standby_close_client(index);
+        return;
+    }
+    command[length] = '\0';
+    command[strcspn(command, "\r\n")] = '\0';
+    standby_command(globals, index, command);
+}
+
+static void
+standby_accept(void)
+{
+    int fd = accept(standby.listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    for (int i = 0; i < DAEMON_MAX_CLIENTS; ++i) {
+        if (standby.clients[i] < 0) {
+            standby.clients[i] = fd;
+            return;
+        }
+    }
+    close(fd);     // Busy
+}
+
+static bool
+standby_socket_path(const char *path)
+{
+    if (!path) {
+        const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+        if (!runtime_dir) {
+            fprintf(stderr, "[DAEMON] XDG_RUNTIME_DIR is not set, pass --socket\n");
+            return false;
+        }
+        snprintf(standby.socket_path, sizeof(standby.socket_path), "%s/mywayland-lock.sock", runtime_dir);
+    } else if (snprintf(standby.socket_path, sizeof(standby.socket_path), "%s", path) >= (int)sizeof(standby.socket_path)) {
+        fprintf(stderr, "[DAEMON] Socket path too long: %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+static bool
+standby_listen(void)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    memcpy(address.sun_path, standby.socket_path, sizeof(address.sun_path));
+
+    standby.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (standby.listen_fd < 0) {
+        perror("[DAEMON] socket");
+        return false;
+    }
+    unlink(standby.socket_path);     // Left over from a previous run
+    if (bind(standby.listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        chmod(standby.socket_path, 0600) != 0 || listen(standby.listen_fd, DAEMON_MAX_CLIENTS) != 0) {
+        perror("[DAEMON] bind");
+        close(standby.listen_fd);
+        standby.listen_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+static void
+idle_notification_idled(void *data, struct ext_idle_notification_v1 *notification)
+{
+    standby_trigger(data, "idle");
+}
+
+static void
+idle_notification_resumed(void *data, struct ext_idle_notification_v1 *notification)
+{
+}
+
+static const struct ext_idle_notification_v1_listener idle_notification_listener = {
+    .idled = idle_notification_idled,
+    .resumed = idle_notification_resumed,
+};
+
+static void
+standby_report(void)
+{
+    fprintf(stderr, "[DAEMON] %llu locks, trigger to locked avg %.2f ms, max %.2f ms\n",
+            (unsigned long long)standby.locks,
+            standby.locks ? standby.locked_ms_total / standby.locks : 0.0, standby.locked_ms_max);
+}
+
+static void
+standby_cleanup(void)
+{
+    for (int i = 0; i < DAEMON_MAX_CLIENTS; ++i) {
+        if (standby.clients[i] >= 0) {
+            standby_close_client(i);
+        }
+    }
+    if (standby.listen_fd >= 0) {
+        close(standby.listen_fd);
+        unlink(standby.socket_path);
+    }
+    if (standby.idle_notification) {
+        ext_idle_notification_v1_destroy(standby.idle_notification);
+    }
+}
+
+/*******************************************
+ * standby_ctl:
+ * - `renderlock --ctl <command>`: sends one command to a running daemon
+ *   and prints its answer with the round-trip time.
+ *******************************************/
+static int
+standby_ctl(const char *command)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    memcpy(address.sun_path, standby.socket_path, sizeof(address.sun_path));
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "[DAEMON] No daemon listening on %s\n", standby.socket_path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return EXIT_FAILURE;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    char reply[64] = "";
+    ssize_t length = -1;
+    if (write(fd, command, strlen(command)) == (ssize_t)strlen(command)) {
+        length = read(fd, reply, sizeof(reply) - 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    close(fd);
+    if (length <= 0) {
+        fprintf(stderr, "[DAEMON] No answer to %s\n", command);
+        return EXIT_FAILURE;
+    }
+    reply[length] = '\0';
+    reply[strcspn(reply, "\n")] = '\0';
+    printf("%s\n", reply);
+    fprintf(stderr, "[DAEMON] %s: \"%s\" after %.2f ms\n", command, reply, timespec_diff_ms(&end, &start));
+    return EXIT_SUCCESS;
+}
+
+/*******************************************
+ * Keyboard input:
+ * - Keys are taken as raw evdev codes with a fixed US mapping; the typed
+ *   characters are only shown as dots, so a full xkbcommon keymap would
+ *   be wasted work here.
+ * - Enter checks against MYWAYLAND_LOCK_PASSWORD (there is no PAM backend;
+ *   main refuses to lock without it), Backspace deletes, Escape clears the
+ *   field.
+ *******************************************/
+#define KEY_ESC       1
+#define KEY_BACKSPACE 14
+#define KEY_ENTER     28
+
+static const char evdev_ascii[] =
+    "\0\0" "1234567890-=" "\0\0" "qwertyuiop[]" "\0\0" "asdfghjkl;'`" "\0\\" "zxcvbnm,./" "\0\0\0 ";
+
+static void keyboard_keymap(void *data, struct wl_keyboard *keyboard, uint32_t format, int32_t fd, uint32_t size) {
+    close(fd);
+}
+
+static void keyboard_enter(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface, struct wl_array *keys) {
+}
+
+static void keyboard_leave(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface) {
+}
+
+static void keyboard_key(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t time, uint32_t key, uint32_t state) {
+    struct globals *globals = data;
+    if (state != WL_KEYBOARD_KEY_STATE_PRESSED) {
+        return;
+    }
+    PROBE2(key, key, state);
+    TRACE_INSTANT("input", "key");
+    ++cpu.keys;
+
+    if (key == KEY_ENTER) {
+        const char *expected = getenv("MYWAYLAND_LOCK_PASSWORD");
+        ui.password_buffer[ui.password_length] = '\0';
+        if (expected && strcmp(expected, ui.password_buffer) == 0) {
+            unlock_session(globals);
+            if (daemon_mode) {
+                standby_unlocked(globals);
+                return;
+            }
+            running = 0;
+        } else {
+            ui_set_text(&ui.status, "Wrong password");
+        }
+        ui.password_length = 0;
+    } else if (key == KEY_BACKSPACE) {
+        if (ui.password_length > 0) {
+            --ui.password_length;
+        }
+    } else if (key == KEY_ESC) {
+        ui.password_length = 0;
+        ui_set_text(&ui.status, "Type your password");
+    } else if (key < sizeof(evdev_ascii) - 1 && evdev_ascii[key] &&
+               ui.password_length < sizeof(ui.password_buffer) - 1) {
+        ui.password_buffer[ui.password_length++] = evdev_ascii[key];
+    }
+    ui_update_password();
+}
+
+static void keyboard_modifiers(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t depressed, uint32_t latched, uint32_t locked, uint32_t group) {
+}
+
+static void keyboard_repeat_info(void *data, struct wl_keyboard *keyboard, int32_t rate, int32_t delay) {
+}
+
+static const struct wl_keyboard_listener keyboard_listener = {
+    .keymap = keyboard_keymap,
+    .enter = keyboard_enter,
+    .leave = keyboard_leave,
+    .key = keyboard_key,
+    .modifiers = keyboard_modifiers,
+    .repeat_info = keyboard_repeat_info,
+};
+
+static void seat_capabilities(void *data, struct wl_seat *seat, uint32_t capabilities) {
+    struct globals *globals = data;
+    bool has_keyboard = capabilities & WL_SEAT_CAPABILITY_KEYBOARD;
+    if (has_keyboard && !globals->keyboard) {
+        globals->keyboard = wl_seat_get_keyboard(seat);
+        wl_keyboard_add_listener(globals->keyboard, &keyboard_listener, globals);
+    } else if (!has_keyboard && globals->keyboard) {
+        wl_keyboard_destroy(globals->keyboard);
+        globals->keyboard = NULL;
+    }
+}
+
+static void seat_name(void *data, struct wl_seat *seat, const char *name) {
+}
+
+static const struct wl_seat_listener seat_listener = {
+    .capabilities = seat_capabilities,
+    .name = seat_name,
+};
+
+// xdg-shell: the compositor decides our size; 0x0 leaves it to us
+static void xdg_wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial) {
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+    .ping = xdg_wm_base_ping,
+};
+
+static void xdg_toplevel_configure(void *data, struct xdg_toplevel *toplevel, int32_t width, int32_t height, struct wl_array *states) {
+    struct globals *globals = data;
+    globals->pending_width = width;
+    globals->pending_height = height;
+}
+
+static void xdg_toplevel_close(void *data, struct xdg_toplevel *toplevel) {
+    running = 0;
+}
+
+static void xdg_toplevel_configure_bounds(void *data, struct xdg_toplevel *toplevel, int32_t width, int32_t height) {
+}
+
+static void xdg_toplevel_wm_capabilities(void *data, struct xdg_toplevel *toplevel, struct wl_array *capabilities) {
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .configure = xdg_toplevel_configure,
+    .close = xdg_toplevel_close,
+    .configure_bounds = xdg_toplevel_configure_bounds,
+    .wm_capabilities = xdg_toplevel_wm_capabilities,
+};
+
+static void xdg_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial) {
+    struct globals *globals = data;
+    PROBE1(configure_received, serial);
+    xdg_surface_ack_configure(xdg_surface, serial);
+    PROBE1(configure_acked, serial);
+
+    int32_t width = globals->pending_width > 0 ? globals->pending_width : 600;
+    int32_t height = globals->pending_height > 0 ? globals->pending_height : 600;
+    if (width != globals->width || height != globals->height) {
+        globals->width = width;
+        globals->height = height;
+        layout_resize(&ui.tree, width, height);
+    }
+    if (backend == BACKEND_SHM) {
+        shm_output_configure(&shm.outputs[SHM_MAX_OUTPUTS], width, height);
+    } else {
+        apply_buffer_transform(globals);
+    }
+    globals->configured = true;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure,
+};
+
+// The toplevel is drawn in the orientation of the output it entered
+static void surface_enter(void *data, struct wl_surface *surface, struct wl_output *output) {
+    struct globals *globals = data;
+    for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+        if (shm.outputs[i].output == output) {
+            globals->output_transform = shm.outputs[i].transform;
+        }
+    }
+    if (backend == BACKEND_SHM) {
+        struct lock_output *out = &shm.outputs[SHM_MAX_OUTPUTS];
+        out->transform = globals->output_transform;
+        if (out->configured) {
+            shm_output_resize(out, out->width, out->height);
+        }
+    } else if (globals->configured) {
+        apply_buffer_transform(globals);
+    }
+}
+
+static void surface_leave(void *data, struct wl_surface *surface, struct wl_output *output) {
+}
+
+static const struct wl_surface_listener surface_listener = {
+    .enter = surface_enter,
+    .leave = surface_leave,
+};
+
+void setup_fullscreen(struct globals *globals) {
+    xdg_toplevel_set_fullscreen(globals->xdg_toplevel, NULL); // Use the default output
+}
+
+static void handle_signal(int signal) {
+    running = 0;
+}
+
+int main(int argc, char **argv) {
+    struct globals globals = {0};
+    const char *socket_path = NULL, *ctl_command = NULL;
+    float text_scale = 1.0f;
+    startup_begin();
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--background") == 0 && i + 1 < argc) {
+            background.path = argv[++i];
+        } else if (strcmp(argv[i], "--background-compare") == 0) {
+            background.compare = true;
+        } else if (strcmp(argv[i], "--layout-log") == 0) {
+            ui.log = true;
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "gl") == 0 || strcmp(argv[i + 1], "shm") == 0)) {
+            backend = strcmp(argv[++i], "gl") == 0 ? BACKEND_GL : BACKEND_SHM;
+        } else if (strcmp(argv[i], "--no-buffer-transform") == 0) {
+            no_buffer_transform = true;
+        } else if (strcmp(argv[i], "--text") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "bitmap") == 0 || strcmp(argv[i + 1], "sdf") == 0)) {
+            ui.sdf = strcmp(argv[++i], "sdf") == 0;
+        } else if (strcmp(argv[i], "--text-scale") == 0 && i + 1 < argc) {
+            text_scale = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--daemon") == 0) {
+            daemon_mode = true;
+        } else if (strcmp(argv[i], "--idle") == 0 && i + 1 < argc) {
+            standby.idle_seconds = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--bench-unlock") == 0) {
+            standby.bench_unlock = true;
+        } else if (strcmp(argv[i], "--ctl") == 0 && i + 1 < argc) {
+            ctl_command = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--backend gl|shm] [--background image.ppm] [--background-compare] [--layout-log] [--no-buffer-transform]\n"
+                    "       %s [--backend gl] [--text bitmap|sdf] [--text-scale factor] [...]\n"
+                    "       %s --daemon [--idle seconds] [--socket path] [--bench-unlock] [...]\n"
+                    "       %s --ctl lock|status|unlock|quit [--socket path]\n", argv[0], argv[0], argv[0], argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if ((daemon_mode || ctl_command) && !standby_socket_path(socket_path)) {
+        exit(EXIT_FAILURE);
+    }
+    if (ctl_command) {
+        return standby_ctl(ctl_command);
+    }
+    // Without a password nothing but the benchmark hooks could unlock again
+    const char *password = getenv("MYWAYLAND_LOCK_PASSWORD");
+    const char *exit_after = getenv("MYWAYLAND_LOCK_EXIT");
+    bool bench_unlocks = (exit_after && strcmp(exit_after, "1") == 0) ||
+                         (daemon_mode && standby.bench_unlock);
+    if ((!password || !*password) && !bench_unlocks) {
+        fprintf(stderr, "MYWAYLAND_LOCK_PASSWORD is not set; refusing to lock a session "
+                "that could not be unlocked\n");
+        exit(EXIT_FAILURE);
+    }
+    // Standby keeps painted buffers, which only the shm backend has
+    if (daemon_mode) {
+        if (backend == BACKEND_GL) {
+            fprintf(stderr, "[DAEMON] --daemon always draws with the shm backend\n");
+        }
+        backend = BACKEND_SHM;
+    }
+
+    // Optional timeline tracing, enabled through MYWAYLAND_TRACE
+    trace_init("renderlock");
+
+    // Leave the main loop on SIGINT/SIGTERM so the statistics get printed
+    struct sigaction action = { .sa_handler = handle_signal };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    ui_init();
+
+    globals.display = wl_display_connect(NULL);
+    if (!globals.display) {
+        fprintf(stderr, "Failed to connect to Wayland display\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct wl_registry *registry = wl_display_get_registry(globals.display);
+    wl_registry_add_listener(registry, &registry_listener, &globals);
+    TRACE_BEGIN("registry", "roundtrip");
+    wl_display_roundtrip(globals.display);
+    TRACE_END("registry", "roundtrip");
+
+    // A session lock needs lock surfaces, which only the shm backend draws
+    if (globals.session_lock_manager && backend != BACKEND_SHM) {
+        if (backend == BACKEND_GL) {
+            fprintf(stderr, "[LOCK] The gl backend cannot draw lock surfaces, using shm\n");
+        }
+        backend = BACKEND_SHM;
+    }
+
+    // Only now pull in libEGL/libGLESv2 and the driver stack
+    if (backend != BACKEND_SHM) {
+        TRACE_BEGIN("render", "init_egl");
+        bool have_gl = false;
+        if (!egl_loader_load()) {
+            fprintf(stderr, "Failed to load EGL/GLES libraries\n");
+        } else {
+            have_gl = init_egl_context(&globals);
+        }
+        TRACE_END("render", "init_egl");
+        if (!have_gl && backend == BACKEND_GL) {
+            exit(EXIT_FAILURE);
+        }
+        if (!have_gl) {
+            fprintf(stderr, "[SHM] EGL unavailable, falling back to the wl_shm renderer\n");
+        }
+        backend = have_gl ? BACKEND_GL : BACKEND_SHM;
+    }
+    if (backend == BACKEND_SHM && (ui.sdf || text_scale != 1.0f)) {
+        fprintf(stderr, "[TEXT] --text and --text-scale need the gl backend, using bitmap text\n");
+        ui.sdf = false;
+        text_scale = 1.0f;
+    }
+    if (text_scale <= 0) {
+        text_scale = 1.0f;
+    }
+    ui_set_text_scale(text_scale);
+
+    bool use_lock_surfaces = backend == BACKEND_SHM && globals.session_lock_manager;
+    if (daemon_mode && !use_lock_surfaces) {
+        fprintf(stderr, "[DAEMON] ext_session_lock_manager_v1 is not available in this compositor.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!use_lock_surfaces && !globals.wm_base) {
+        fprintf(stderr, "xdg_wm_base is not available in this compositor.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (backend == BACKEND_SHM && !globals.shm) {
+        fprintf(stderr, "wl_shm is not available in this compositor.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (globals.wm_base) {
+        xdg_wm_base_add_listener(globals.wm_base, &xdg_wm_base_listener, &globals);
+    }
+
+    if (backend == BACKEND_SHM) {
+        shm.fill = fill_select(NULL, &shm.fill_name);
+        if (background.path) {
+            shm.background_rgb = ppm_load(background.path, &shm.background_width, &shm.background_height);
+        }
+        buffer_cache_init(&shm.cache, globals.shm, shm_buffer_released, NULL);
+    }
+
+    if (use_lock_surfaces) {
+        if (daemon_mode) {
+            // The wl_output events size and paint each output's pool
+            wl_display_roundtrip(globals.display);
+            if (!standby_listen()) {
+                exit(EXIT_FAILURE);
+            }
+            if (globals.idle_notifier && globals.seat && standby.idle_seconds > 0) {
+                standby.idle_notification = ext_idle_notifier_v1_get_idle_notification(
+                        globals.idle_notifier, standby.idle_seconds * 1000, globals.seat);
+                ext_idle_notification_v1_add_listener(standby.idle_notification, &idle_notification_listener, &globals);
+            } else if (standby.idle_seconds > 0) {
+                fprintf(stderr, "[DAEMON] No ext_idle_notifier_v1, locking on request only\n");
+            }
+            standby_prerender();
+            int prepared = 0;
+            for (int i = 0; i < SHM_MAX_OUTPUTS; ++i) {
+                prepared += shm.outputs[i].width > 0;
+            }
+            fprintf(stderr, "[DAEMON] ready after %.2f ms: %d output(s) prepared, listening on %s\n",
+                    startup_elapsed_ms(), prepared, standby.socket_path);
+        } else {
+            // Lock surfaces for every output; each draws after its first configure
+            if (!lock_session(&globals)) {
+                fprintf(stderr, "No wl_output to put a lock surface on, not locking\n");
+                exit(EXIT_FAILURE);
+            }
+            wl_display_flush(globals.display);
+        }
+    } else {
+        globals.surface = wl_compositor_create_surface(globals.compositor);
+        if (!globals.surface) {
+            fprintf(stderr, "Failed to create Wayland surface\n");
+            exit(EXIT_FAILURE);
+        }
+        wl_surface_add_listener(globals.surface, &surface_listener, &globals);
+
+        globals.xdg_surface = xdg_wm_base_get_xdg_surface(globals.wm_base, globals.surface);
+        if (!globals.xdg_surface) {
+            fprintf(stderr, "Failed to create xdg surface\n");
+            exit(EXIT_FAILURE);
+        }
+        xdg_surface_add_listener(globals.xdg_surface, &xdg_surface_listener, &globals);
+
+        globals.xdg_toplevel = xdg_surface_get_toplevel(globals.xdg_surface);
+        if (!globals.xdg_toplevel) {
+            fprintf(stderr, "Failed to create xdg toplevel\n");
+            exit(EXIT_FAILURE);
+        }
+        xdg_toplevel_add_listener(globals.xdg_toplevel, &xdg_toplevel_listener, &globals);
+
+        // Force full screen
+        setup_fullscreen(&globals);
+
+        if (backend == BACKEND_GL) {
+            TRACE_BEGIN("render", "init_egl");
+            globals.egl_window = wl_egl_window_create(globals.surface, 600, 600);
+            init_egl_surface(&globals);
+            ui_init_gl();
+            TRACE_END("render", "init_egl");
+
+            if (background.path) {
+                load_background();
+            }
+        } else {
+            // No session lock protocol: one shm window, drawn after its configure
+            shm.outputs[SHM_MAX_OUTPUTS].globals = &globals;
+            shm.outputs[SHM_MAX_OUTPUTS].surface = globals.surface;
+        }
+
+        TRACE_BEGIN("present", "commit");
+        PROBE1(commit, frame_number);
+        wl_surface_commit(globals.surface);
+        TRACE_END("present", "commit");
+        wl_display_flush(globals.display);
+        if (backend == BACKEND_GL) {
+            startup_report("surface committed (gl)");
+        }
+    }
+
+    /*******************************************
+     * Main loop:
+     * - Handle queued events, let the layout work out what changed and draw
+     *   only if something did.
+     * - Then sleep in poll() until either the compositor sends something or
+     *   the clock needs its next tick. An idle lock screen wakes once a
+     *   second and, unless the clock text changed, does nothing else.
+     *******************************************/
+    while (running) {
+        TRACE_BEGIN("dispatch", "wl_display_dispatch_pending");
+        int dispatch_result = wl_display_dispatch_pending(globals.display);
+        TRACE_END("dispatch", "wl_display_dispatch_pending");
+        if (dispatch_result == -1) {
+            break;
+        }
+
+        if (daemon_mode && !globals.locked) {
+            // Standby: nothing to show, only outputs that came or changed
+            if (standby.prerender_pending) {
+                standby_prerender();
+            }
+        } else if (globals.configured) {
+            ui_update_clock();
+            TRACE_BEGIN("layout", "layout_update");
+            layout_update(&ui.tree);
+            TRACE_END("layout", "layout_update");
+
+            const struct layout_damage *damage = &ui.tree.damage;
+            if (ui.log) {
+                fprintf(stderr, "[LAYOUT] update %llu: %d damage rect(s)%s\n",
+                        (unsigned long long)ui.tree.stats.updates, damage->count,
+                        damage->full ? " (full)" : "");
+                for (int i = 0; i < damage->count; ++i) {
+                    fprintf(stderr, "[LAYOUT]   %dx%d+%d+%d\n", damage->rects[i].width,
+                            damage->rects[i].height, damage->rects[i].x, damage->rects[i].y);
+                }
+            }
+            if (backend == BACKEND_SHM) {
+                // Outputs still waiting on a frame callback merge it for later
+                if (damage->count > 0) {
+                    shm_add_damage(damage);
+                }
+                shm_render_all();
+            } else if (damage->count > 0) {
+                PROBE1(frame_start, ++frame_number);
+                render_frame(&globals);
+                PROBE1(frame_end, frame_number);
+            }
+        }
+
+        if (wl_display_prepare_read(globals.display) != 0) {
+            continue;  // More events already queued
+        }
+        wl_display_flush(globals.display);
+
+        // The control socket and its clients follow the display fd
+        struct pollfd fds[2 + DAEMON_MAX_CLIENTS] = {
+            { .fd = wl_display_get_fd(globals.display), .events = POLLIN },
+            { .fd = standby.listen_fd, .events = POLLIN },
+        };
+        for (int i = 0; i < DAEMON_MAX_CLIENTS; ++i) {
+            fds[2 + i] = (struct pollfd){ .fd = standby.clients[i], .events = POLLIN };
+        }
+        // In standby the clock is not shown, so there is nothing to tick for
+        int timeout = daemon_mode && !globals.locked ? -1 : ui_ms_until_next_tick();
+        TRACE_BEGIN("dispatch", "poll");
+        int ready = poll(fds, daemon_mode ? 2 + DAEMON_MAX_CLIENTS : 1, timeout);
+        TRACE_END("dispatch", "poll");
+        cpu_account();
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            if (wl_display_read_events(globals.display) == -1) {
+                break;
+            }
+        } else {
+            wl_display_cancel_read(globals.display);
+        }
+
+        if (daemon_mode && ready > 0) {
+            for (int i = 0; i < DAEMON_MAX_CLIENTS; ++i) {
+                if (standby.clients[i] >= 0 && (fds[2 + i].revents & (POLLIN | POLLHUP))) {
+                    standby_read_client(&globals, i);
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                standby_accept();
+            }
+        }
+    }
+    report_layout_stats();
+    report_cpu_usage();
+    if (backend == BACKEND_GL && globals.configured) {
+        fprintf(stderr, "[TRANSFORM] gl: output transform %u, buffer transform %u (%dx%d buffer)\n",
+                globals.output_transform, globals.buffer_transform,
+                globals.buffer_width, globals.buffer_height);
+    }
+    if (daemon_mode) {
+        standby_report();
+        standby_cleanup();
+    }
+    if (backend == BACKEND_SHM) {
+        shm_report();
+    }
+    if (globals.lock_confirmed && !globals.locked) {
+        // Make sure unlock_and_destroy was processed before we disconnect
+        wl_display_roundtrip(globals.display);
+    }
+
+    // Clean up
+    if (globals.keyboard) {
+        wl_keyboard_destroy(globals.keyboard);
+    }
+    if (globals.seat) {
+        wl_seat_destroy(globals.seat);
+    }
+    // A locker that exits without unlocking leaves the session locked;
+    // destroying a confirmed lock would only be a protocol error
+    if (globals.session_lock && !globals.lock_confirmed) {
+        ext_session_lock_v1_destroy(globals.session_lock);
+    }
+    if (backend == BACKEND_SHM) {
+        shm_cleanup();
+    }
+    if (globals.xdg_toplevel) {
+        xdg_toplevel_destroy(globals.xdg_toplevel);
+    }
+    if (globals.xdg_surface) {
+        xdg_surface_destroy(globals.xdg_surface);
+    }
+    if (globals.surface) {
+        wl_surface_destroy(globals.surface);
+    }
+    if (globals.egl_window) {
+        wl_egl_window_destroy(globals.egl_window);
+    }
+    if (backend == BACKEND_GL) {
+        eglDestroyContext(egl_display, egl_context);
+        eglDestroySurface(egl_display, egl_surface);
+        eglTerminate(egl_display);
     }
-    eglDestroyContext(egl_display, egl_context);
-    eglDestroySurface(egl_display, egl_surface);
-    eglTerminate(egl_display);
     wl_display_disconnect(globals.display);
 
     return 0;
@@ -0,0 +1,39 @@
+#!/bin/bash
+#
+# Runs bin/bench under a headless compositor and gates on the baseline.
+#
+#   scripts/bench.sh [bench options]
+#
+# - With no reachable WAYLAND_DISPLAY, starts a headless compositor with
+#   scripts/headless.sh: $BENCH_COMPOSITOR if set (a command line that must
+#   honour WAYLAND_DISPLAY), else weston's headless backend on a private
+#   socket, else sway with the wlroots headless backend on the wayland-N
+#   socket it picks. Without any of them the benchmarks that need a
+#   compositor are reported as skipped.
+# - Results go to bench/results.json. If bench/baseline.json exists (or
+#   BENCH_BASELINE names another file) the run is compared against it and
+#   the exit status is non-zero on a regression beyond BENCH_THRESHOLD
+#   percent (default 10).
+# - BENCH_SAVE=1 stores this run as the new baseline instead.
+#
+set -e
+cd "$(dirname "$0")/.."
+
+BASELINE=${BENCH_BASELINE:-bench/baseline.json}
+RESULTS=bench/results.json
+THRESHOLD=${BENCH_THRESHOLD:-10}
+
+. scripts/headless.sh
+trap headless_stop EXIT
+
+headless_running || headless_start BENCH || true
+
+if [ "${BENCH_SAVE:-0}" = "1" ]; then
+    bin/bench --output "$BASELINE" "$@"
+    echo "[BENCH] Saved baseline to $BASELINE" >&2
+elif [ -f "$BASELINE" ]; then
+    bin/bench --output "$RESULTS" --baseline "$BASELINE" --threshold "$THRESHOLD" "$@"
+else
+    bin/bench --output "$RESULTS" "$@"
+    echo "[BENCH] No baseline at $BASELINE; run with BENCH_SAVE=1 to store one" >&2
+fi
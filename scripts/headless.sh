@@ -0,0 +1,84 @@
+#!/bin/bash
+#
+# Headless compositor for the scripts in this directory. Source it:
+#
+#   . scripts/headless.sh
+#   headless_running || headless_start BENCH || exit 1
+#
+# - headless_start starts $BENCH_COMPOSITOR if set (a command line that
+#   must honour WAYLAND_DISPLAY), else the first of $HEADLESS_COMPOSITORS
+#   (default "weston sway") that is installed: weston's headless backend
+#   or sway with the wlroots headless backend and $HEADLESS_SWAY_CONFIG
+#   (default none). It exports WAYLAND_DISPLAY once the socket is up and
+#   labels its messages with the given tag.
+# - sway ignores WAYLAND_DISPLAY and takes the first free wayland-N, so its
+#   socket is the one that appears in $XDG_RUNTIME_DIR after the launch.
+# - headless_stop kills it. HEADLESS_PID is its pid while it runs.
+#
+
+HEADLESS_PID=
+
+headless_running() {
+    [ -n "$WAYLAND_DISPLAY" ] || return 1
+    case "$WAYLAND_DISPLAY" in
+        /*) [ -S "$WAYLAND_DISPLAY" ] ;;
+        *)  [ -S "${XDG_RUNTIME_DIR:-/run/user/$(id -u)}/$WAYLAND_DISPLAY" ] ;;
+    esac
+}
+
+# Names of the wayland-* sockets in $XDG_RUNTIME_DIR, one per line
+headless_sockets() {
+    local socket
+    for socket in "$XDG_RUNTIME_DIR"/wayland-*; do
+        if [ -S "$socket" ]; then
+            basename "$socket"
+        fi
+    done
+}
+
+headless_start() {
+    local tag=$1
+    local compositors=${HEADLESS_COMPOSITORS:-weston sway}
+    local before= sway=0 socket
+    export XDG_RUNTIME_DIR=${XDG_RUNTIME_DIR:-$(mktemp -d)}
+    export WAYLAND_DISPLAY=mywayland-headless-$$
+
+    if [ -n "$BENCH_COMPOSITOR" ]; then
+        $BENCH_COMPOSITOR >/dev/null 2>&1 &
+    elif [[ " $compositors " == *" weston "* ]] && command -v weston >/dev/null; then
+        weston --backend=headless --socket="$WAYLAND_DISPLAY" --idle-time=0 >/dev/null 2>&1 &
+    elif [[ " $compositors " == *" sway "* ]] && command -v sway >/dev/null; then
+        unset WAYLAND_DISPLAY
+        before=$(headless_sockets)
+        sway=1
+        WLR_BACKENDS=headless WLR_LIBINPUT_NO_DEVICES=1 \
+            sway -c "${HEADLESS_SWAY_CONFIG:-/dev/null}" >/dev/null 2>&1 &
+    else
+        echo "[$tag] No headless compositor found (${compositors// /, } or BENCH_COMPOSITOR)" >&2
+        unset WAYLAND_DISPLAY
+        return 1
+    fi
+    HEADLESS_PID=$!
+
+    for _ in $(seq 50); do
+        if [ "$sway" = 1 ]; then
+            socket=$(headless_sockets | grep -vxF -f <(printf '%s\n' "$before") | head -n 1)
+            if [ -n "$socket" ]; then
+                export WAYLAND_DISPLAY=$socket
+            fi
+        fi
+        headless_running && return 0
+        sleep 0.1
+    done
+    echo "[$tag] Headless compositor did not come up" >&2
+    unset WAYLAND_DISPLAY
+    return 1
+}
+
+headless_stop() {
+    if [ -n "$HEADLESS_PID" ]; then
+        kill "$HEADLESS_PID" 2>/dev/null || true
+        wait "$HEADLESS_PID" 2>/dev/null || true
+        HEADLESS_PID=
+    fi
+}
@@ -0,0 +1,29 @@
+#!/bin/bash
+#
+# Loopback input latency under increasing CPU load.
+#
+#   scripts/input_latency.sh [samples] [loads...]
+#
+# - Starts sway headless through scripts/headless.sh (it offers
+#   zwp_virtual_keyboard_manager_v1 and zwlr_virtual_pointer_manager_v1),
+#   or $BENCH_COMPOSITOR, which must honour WAYLAND_DISPLAY.
+# - Runs bin/inputlat with `samples` injections per kind (default 1000)
+#   once per load, in spinning threads (default: 0, half the CPUs, all
+#   CPUs, twice the CPUs), and prints its [INPUTLAT] summaries and
+#   histograms.
+#
+set -e
+cd "$(dirname "$0")/.."
+. scripts/headless.sh
+
+SAMPLES=${1:-1000}
+shift || true
+CPUS=$(nproc)
+LOADS=${*:-"0 $((CPUS / 2)) $CPUS $((CPUS * 2))"}
+
+trap headless_stop EXIT
+HEADLESS_COMPOSITORS=sway headless_start INPUTLAT || exit 1
+
+for load in $LOADS; do
+    bin/inputlat --samples "$SAMPLES" --load "$load" 2>&1 >/dev/null | grep -v '^\[INPUT\]' || true
+done
@@ -0,0 +1,93 @@
+#!/bin/bash
+#
+# Compares seat_listeners (libwayland-client) with seat_listeners_lite
+# (include/wire.h): startup time, peak RSS and CPU per event.
+#
+#   scripts/lite_compare.sh [runs] [syncs]
+#
+# - Starts sway headless through scripts/headless.sh, or
+#   $BENCH_COMPOSITOR, which must honour WAYLAND_DISPLAY. A headless sway
+#   seat has no keyboard, and seat_listeners gives up without one, so
+#   bin/inputlat runs alongside to create a virtual keyboard.
+# - Startup: `runs` (default 20) cold starts of each with
+#   MYWAYLAND_STARTUP_EXIT=1, so they exit at "globals ready"; prints the
+#   median wall time and peak RSS (GNU time), and the in-process time.
+# - Per event: one run of each with --flood `syncs` (default 20000),
+#   printing its [FLOOD] summary with the CPU time per reply.
+#
+set -e
+cd "$(dirname "$0")/.."
+. scripts/headless.sh
+
+RUNS=${1:-20}
+SYNCS=${2:-20000}
+
+TIME=/usr/bin/time
+if [ ! -x "$TIME" ]; then
+    echo "$TIME (GNU time) is required for peak RSS" >&2
+    exit 1
+fi
+
+KEYBOARD_PID=
+OUT=$(mktemp -d)
+cleanup() {
+    if [ -n "$KEYBOARD_PID" ]; then
+        kill "$KEYBOARD_PID" 2>/dev/null || true
+        wait "$KEYBOARD_PID" 2>/dev/null || true
+    fi
+    headless_stop
+    rm -rf "$OUT"
+}
+trap cleanup EXIT
+
+HEADLESS_COMPOSITORS=sway headless_start LITE || exit 1
+
+if [ -z "$BENCH_COMPOSITOR" ]; then
+    bin/inputlat --keyboard-only --samples 1000000 --interval 1000 >/dev/null 2>&1 &
+    KEYBOARD_PID=$!
+    sleep 0.5
+fi
+
+measure() {
+    local program=$1
+    : > "$OUT/$program.ms"
+    : > "$OUT/$program.kb"
+    : > "$OUT/$program.main"
+    for _ in $(seq "$RUNS"); do
+        local start end
+        start=$(date +%s%N)
+        MYWAYLAND_STARTUP_EXIT=1 "$TIME" -f "%M" -o "$OUT/rss" "bin/$program" \
+            >/dev/null 2>"$OUT/stderr" || true
+        end=$(date +%s%N)
+        echo $(( (end - start) / 1000 )) >> "$OUT/$program.ms"
+        cat "$OUT/rss" >> "$OUT/$program.kb"
+        sed -n 's/^\[STARTUP\] globals ready: \([0-9.]*\) ms.*/\1/p' "$OUT/stderr" >> "$OUT/$program.main"
+    done
+    local ms kb main
+    ms=$(sort -n "$OUT/$program.ms" | awk '{ a[NR] = $1 } END { printf "%.2f", a[int((NR + 1) / 2)] / 1000 }')
+    kb=$(sort -n "$OUT/$program.kb" | awk '{ a[NR] = $1 } END { print a[int((NR + 1) / 2)] }')
+    main=$(sort -n "$OUT/$program.main" | awk '{ a[NR] = $1 } END { print a[int((NR + 1) / 2)] }')
+    printf "%-20s wall %8s ms   since main %8s ms   peak RSS %8s KiB\n" "$program" "$ms" "$main" "$kb"
+}
+
+flood() {
+    local program=$1
+    local pid
+    echo "[LITE] $program --flood $SYNCS"
+    "bin/$program" --flood "$SYNCS" >/dev/null 2>"$OUT/flood" &
+    pid=$!
+    # Both keep running after the flood; stop them once the summary is out
+    for _ in $(seq 600); do
+        grep -q '^\[FLOOD\] synthetic' "$OUT/flood" && break
+        sleep 0.1
+    done
+    kill -INT "$pid" 2>/dev/null || true
+    wait "$pid" 2>/dev/null || true
+    grep -m 1 '^\[FLOOD\] synthetic' "$OUT/flood" | sed 's/^/    /' || true
+}
+
+echo "[LITE] startup, median of $RUNS runs:"
+measure seat_listeners
+measure seat_listeners_lite
+flood seat_listeners
+flood seat_listeners_lite
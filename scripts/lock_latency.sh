@@ -0,0 +1,65 @@
+#!/bin/bash
+#
+# Compares time-to-locked of a cold renderlock start with the warm-standby
+# daemon.
+#
+#   scripts/lock_latency.sh [runs]
+#
+# - Cold: starts `bin/renderlock --backend shm` with MYWAYLAND_LOCK_EXIT=1
+#   (unlock and exit once locked) and reads "[LOCK] cold start to locked".
+# - Warm: starts `bin/renderlock --daemon --bench-unlock` once and drives
+#   it with `--ctl lock` / `--ctl unlock`; the daemon replies with the
+#   trigger-to-locked time.
+# - The compositor must support ext-session-lock-v1. With no reachable
+#   WAYLAND_DISPLAY one is started by scripts/headless.sh
+#   ($BENCH_COMPOSITOR, weston or sway).
+#
+set -e
+cd "$(dirname "$0")/.."
+. scripts/headless.sh
+
+RUNS=${1:-20}
+SOCKET=$(mktemp -u /tmp/mywayland-lock-XXXXXX.sock)
+
+DAEMON_PID=
+cleanup() {
+    if [ -n "$DAEMON_PID" ]; then
+        kill "$DAEMON_PID" 2>/dev/null || true
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    headless_stop
+    rm -f "$SOCKET"
+}
+trap cleanup EXIT
+
+median() {
+    sort -g | awk '{ v[NR] = $1 } END { if (NR) printf "%.2f", NR % 2 ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2 }'
+}
+
+headless_running || headless_start LOCK || exit 1
+
+cold=()
+for _ in $(seq "$RUNS"); do
+    ms=$(MYWAYLAND_LOCK_EXIT=1 bin/renderlock --backend shm 2>&1 >/dev/null |
+         sed -n 's/.*cold start to locked: \([0-9.]*\) ms.*/\1/p')
+    [ -n "$ms" ] && cold+=("$ms")
+done
+
+bin/renderlock --daemon --bench-unlock --idle 0 --socket "$SOCKET" 2>/dev/null &
+DAEMON_PID=$!
+for _ in $(seq 50); do
+    [ -S "$SOCKET" ] && break
+    sleep 0.1
+done
+
+warm=()
+for _ in $(seq "$RUNS"); do
+    reply=$(bin/renderlock --ctl lock --socket "$SOCKET" 2>/dev/null || true)
+    ms=${reply#locked }
+    [ "$ms" != "$reply" ] && warm+=("$ms")
+    bin/renderlock --ctl unlock --socket "$SOCKET" >/dev/null 2>&1 || true
+done
+bin/renderlock --ctl quit --socket "$SOCKET" >/dev/null 2>&1 || true
+
+echo "[LOCK] cold start: ${#cold[@]} runs, median $(printf '%s\n' "${cold[@]}" | median) ms"
+echo "[LOCK] warm standby: ${#warm[@]} runs, median $(printf '%s\n' "${warm[@]}" | median) ms"
@@ -0,0 +1,50 @@
+#!/bin/bash
+#
+# Compares the epoll and io_uring event loops (include/evloop.h) on the
+# same playback: syscalls and wakeups per frame shown.
+#
+#   scripts/loop_compare.sh [clip.y4m] [seconds]
+#
+# - Starts sway headless through scripts/headless.sh, or
+#   $BENCH_COMPOSITOR, which must honour WAYLAND_DISPLAY.
+# - Without a clip, generates a 360p60 test pattern with ffmpeg.
+# - Runs bin/y4mplay --loop for `seconds` (default 10) per backend, once
+#   plain and once with --record and --progress, so the timer and the file
+#   writes go through the loop too, and prints its [LOOP] and [Y4M] lines.
+#
+set -e
+cd "$(dirname "$0")/.."
+. scripts/headless.sh
+
+CLIP=$1
+SECONDS_PER_RUN=${2:-10}
+
+TMP=$(mktemp -d)
+cleanup() {
+    headless_stop
+    rm -rf "$TMP"
+}
+trap cleanup EXIT
+
+if [ -z "$CLIP" ]; then
+    if ! command -v ffmpeg >/dev/null; then
+        echo "[LOOP] No clip given and no ffmpeg to generate one" >&2
+        exit 1
+    fi
+    CLIP=$TMP/clip.y4m
+    ffmpeg -loglevel error -f lavfi -i testsrc=size=640x360:rate=60 -t 5 \
+        -pix_fmt yuv420p "$CLIP"
+fi
+
+HEADLESS_COMPOSITORS=sway headless_start LOOP || exit 1
+
+run() {
+    echo "[LOOP] y4mplay $*"
+    timeout -s INT "$SECONDS_PER_RUN" bin/y4mplay --loop "$@" "$CLIP" 2>&1 >/dev/null |
+        grep -E '^\[LOOP\]|^\[Y4M\] (presented|recorded)' | sed 's/^/    /' || true
+}
+
+for backend in epoll io_uring; do
+    run --event-loop "$backend"
+    run --event-loop "$backend" --record "$TMP/out.y4m" --progress
+done
@@ -0,0 +1,60 @@
+#!/bin/bash
+#
+# Compares cold-start cost of a GL client built with lazily loaded EGL/GLES
+# (the default) against one linked eagerly with -lEGL -lGLESv2.
+#
+#   scripts/startup_compare.sh [program] [runs] [-- program args]
+#
+# program defaults to renderlock. Each run sets MYWAYLAND_STARTUP_EXIT=1 so
+# the client exits right after its startup_report(); we record whole-process
+# wall time and peak RSS (which includes the dynamic loader's work) and
+# print the median of each.
+#
+set -e
+cd "$(dirname "$0")/.."
+
+PROGRAM=${1:-renderlock}
+RUNS=${2:-20}
+shift 2 2>/dev/null || shift $#
+[ "$1" = "--" ] && shift
+
+TIME=/usr/bin/time
+if [ ! -x "$TIME" ]; then
+    echo "$TIME (GNU time) is required for peak RSS" >&2
+    exit 1
+fi
+
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+build() {
+    mkdir -p "$OUT/$1"
+    EAGER_GL=$2 ./build.sh >/dev/null
+    cp "bin/$PROGRAM" "$OUT/$1/$PROGRAM"
+}
+
+measure() {
+    local label=$1 binary=$2
+    : > "$OUT/$label.ms"
+    : > "$OUT/$label.kb"
+    for _ in $(seq "$RUNS"); do
+        local start end
+        start=$(date +%s%N)
+        MYWAYLAND_STARTUP_EXIT=1 "$TIME" -f "%M" -o "$OUT/rss" "$binary" "$@" >/dev/null 2>&1 || true
+        end=$(date +%s%N)
+        echo $(( (end - start) / 1000 )) >> "$OUT/$label.ms"
+        cat "$OUT/rss" >> "$OUT/$label.kb"
+    done
+    local ms kb
+    ms=$(sort -n "$OUT/$label.ms" | awk '{ a[NR] = $1 } END { printf "%.2f", a[int((NR + 1) / 2)] / 1000 }')
+    kb=$(sort -n "$OUT/$label.kb" | awk '{ a[NR] = $1 } END { print a[int((NR + 1) / 2)] }')
+    printf "%-8s wall %8s ms   peak RSS %8s KiB\n" "$label" "$ms" "$kb"
+}
+
+build lazy 0
+build eager 1
+./build.sh >/dev/null   # leave the default build in bin/
+
+echo "$PROGRAM, median of $RUNS runs:"
+measure lazy "$OUT/lazy/$PROGRAM" "$@"
+measure eager "$OUT/eager/$PROGRAM" "$@"
@@ -0,0 +1,50 @@
+#!/bin/bash
+#
+# Measures what drawing in the output's native orientation saves the
+# compositor on a rotated output.
+#
+#   scripts/transform_cost.sh [seconds] [transform]
+#
+# - Starts sway headless through scripts/headless.sh with its output
+#   rotated (default 90), or $BENCH_COMPOSITOR, which must put its output
+#   in that transform itself and honour WAYLAND_DISPLAY.
+# - Runs bin/renderlock for `seconds` (default 20), once with buffer
+#   transforms and once with --no-buffer-transform, and prints the
+#   compositor's CPU time for each run (utime + stime from /proc) next to
+#   renderlock's own [CPU] and [SHM]/[TRANSFORM] lines.
+#
+set -e
+cd "$(dirname "$0")/.."
+. scripts/headless.sh
+
+SECONDS_PER_RUN=${1:-20}
+TRANSFORM=${2:-90}
+
+CONFIG=$(mktemp)
+cleanup() {
+    headless_stop
+    rm -f "$CONFIG"
+}
+trap cleanup EXIT
+
+echo "output * transform $TRANSFORM" > "$CONFIG"
+HEADLESS_COMPOSITORS=sway HEADLESS_SWAY_CONFIG=$CONFIG headless_start TRANSFORM || exit 1
+
+# utime + stime of a process in milliseconds
+cpu_ms() {
+    awk -v hz="$(getconf CLK_TCK)" '{ print ($14 + $15) * 1000 / hz }' "/proc/$1/stat"
+}
+
+run() {
+    local before after
+    before=$(cpu_ms "$HEADLESS_PID")
+    timeout -s INT "$SECONDS_PER_RUN" bin/renderlock "$@" 2>&1 >/dev/null |
+        grep -E '^\[(CPU|SHM|TRANSFORM)\]' | sed 's/^/    /' || true
+    after=$(cpu_ms "$HEADLESS_PID")
+    echo "[TRANSFORM] renderlock $*: compositor used $(awk -v a="$after" -v b="$before" \
+        'BEGIN { printf "%.0f", a - b }') ms CPU in ${SECONDS_PER_RUN} s"
+}
+
+# sway offers ext-session-lock-v1, on which renderlock always draws with shm
+run --backend shm
+run --backend shm --no-buffer-transform
@@ -0,0 +1,384 @@
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <xkbcommon/xkbcommon.h>
+#include "include/wire.h"                 // Socket, wire format, fd passing
+#include "include/startup.h"              // Time and RSS to "globals ready"
+
+/**********************************************
+ * @SEAT LISTENERS WITHOUT LIBWAYLAND
+ **********************************************
+ *
+ * gettext.c's keyboard logger for the case where nothing else is wanted,
+ * e.g. an input telemetry agent left running on every machine: the same
+ * output, but over include/wire.h instead of libwayland-client.
+ *
+ * - Only wl_display, wl_registry, wl_callback, wl_seat and wl_keyboard
+ *   exist, as event signature tables in this file. Requests are written
+ *   straight to the wire (get_registry, sync, bind, get_keyboard, release).
+ * - Objects live in the static table of struct wire; handlers are plain
+ *   switches on the opcode. Nothing is allocated per event, and nothing
+ *   at all by the transport: the keymap fd is mmap'ed, compiled and
+ *   unmapped as before.
+ * - Unlike seat_listeners, a seat without a keyboard is not fatal: the
+ *   agent waits for one to be plugged in, and lets it go again (v3
+ *   wl_keyboard.release) when it is unplugged.
+ * - --raw skips xkbcommon and logs evdev keycodes. The keymap is then
+ *   never mapped, which keeps the whole process free of xkb allocations.
+ *
+ * @COMPARISON:
+ * - startup_report("globals ready") is printed at the same point as in
+ *   seat_listeners (the registry sync), for time and RSS; with
+ *   MYWAYLAND_STARTUP_EXIT=1 both exit there.
+ * - --flood N sends N wl_display.sync like seat_listeners --flood N and
+ *   logs every reply the same way; both print the CPU time per reply.
+ * - scripts/lite_compare.sh runs the two side by side.
+ **********************************************/
+
+#define LITE_SEAT_VERSION 3              // wl_keyboard.release, as in seat_listeners
+#define LITE_SEAT_KEYBOARD 2             // WL_SEAT_CAPABILITY_KEYBOARD
+#define LITE_KEYMAP_XKB_V1 1             // WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1
+#define LITE_KEY_PRESSED 1               // WL_KEYBOARD_KEY_STATE_PRESSED
+#define LITE_FLOOD_IN_FLIGHT (WIRE_MAX_OBJECTS / 2)  // Leaves ids for the seat and keyboard
+
+enum {
+    REGISTRY_GLOBAL,
+    REGISTRY_GLOBAL_REMOVE,
+};
+
+enum {
+    SEAT_CAPABILITIES,
+    SEAT_NAME,
+};
+
+enum {
+    KEYBOARD_KEYMAP,
+    KEYBOARD_ENTER,
+    KEYBOARD_LEAVE,
+    KEYBOARD_KEY,
+    KEYBOARD_MODIFIERS,
+    KEYBOARD_REPEAT_INFO,
+};
+
+static const char *const registry_events[] = { "usu", "u" };
+static const char *const seat_events[] = { "u", "s" };
+static const char *const keyboard_events[] = { "uhu", "u?oa", "u?o", "uuuu", "uuuuu", "ii" };
+
+static const struct wire_interface registry_interface = { "wl_registry", 2, registry_events };
+static const struct wire_interface seat_interface = { "wl_seat", 2, seat_events };
+static const struct wire_interface keyboard_interface = { "wl_keyboard", 6, keyboard_events };
+
+struct lite {
+    struct wire wire;
+    uint32_t registry, seat, seat_name, keyboard;
+    bool raw;
+    bool error;
+
+    struct xkb_context *xkb_context;
+    struct xkb_keymap *keymap;
+    struct xkb_state *xkb_state;
+
+    uint64_t keyboard_events, acquires, releases;
+
+    // Synthetic flood
+    uint64_t flood_sent, flood_done, flood_count;
+    bool flood_reported;
+    struct timespec flood_start, flood_end, flood_cpu_start, flood_cpu_end;
+};
+
+static volatile sig_atomic_t interrupted;
+
+static double
+lite_ms(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+/* Keyboard */
+
+static void
+keyboard_keymap(struct lite *lite, uint32_t format, int fd, uint32_t size)
+{
+    if (lite->raw || format != LITE_KEYMAP_XKB_V1) {
+        printf("Keymap received (%u bytes)\n", size);
+        close(fd);
+        return;
+    }
+    // MAP_PRIVATE: from wl_seat v7 on the fd may be read-only
+    char *keymap_string = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (keymap_string == MAP_FAILED) {
+        fprintf(stderr, "Failed to mmap keymap\n");
+        return;
+    }
+    if (!lite->xkb_context) {
+        lite->xkb_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    }
+    struct xkb_keymap *keymap = lite->xkb_context
+        ? xkb_keymap_new_from_string(lite->xkb_context, keymap_string, XKB_KEYMAP_FORMAT_TEXT_V1,
+                                     XKB_KEYMAP_COMPILE_NO_FLAGS)
+        : NULL;
+    munmap(keymap_string, size);
+    if (!keymap) {
+        fprintf(stderr, "Failed to compile keymap\n");
+        lite->error = true;
+        return;
+    }
+    if (lite->xkb_state) {
+        xkb_state_unref(lite->xkb_state);
+    }
+    if (lite->keymap) {
+        xkb_keymap_unref(lite->keymap);
+    }
+    lite->keymap = keymap;
+    lite->xkb_state = xkb_state_new(keymap);
+    if (!lite->xkb_state) {
+        fprintf(stderr, "Failed to create XKB state\n");
+        lite->error = true;
+    }
+}
+
+// The same lines as seat_listeners' key_log
+static void
+keyboard_key(struct lite *lite, uint32_t key, uint32_t state)
+{
+    const char *action = state == LITE_KEY_PRESSED ? "pressed" : "released";
+    if (!lite->xkb_state) {
+        printf("Key code %u %s\n", key, action);
+        return;
+    }
+    const xkb_keysym_t *syms;
+    if (xkb_state_key_get_syms(lite->xkb_state, key + 8, &syms) <= 0) {
+        return;
+    }
+    if (syms[0] == XKB_KEY_BackSpace) {
+        printf("Backspace %s\n", action);
+    } else {
+        char name[64];
+        xkb_keysym_get_name(syms[0], name, sizeof(name));
+        printf("Key %s %s\n", name, action);
+    }
+}
+
+static void
+keyboard_event(void *data, uint32_t id, uint16_t opcode, const union wire_arg *args)
+{
+    struct lite *lite = data;
+    ++lite->keyboard_events;
+    switch (opcode) {
+    case KEYBOARD_KEYMAP:
+        keyboard_keymap(lite, args[0].u, args[1].fd, args[2].u);
+        break;
+    case KEYBOARD_ENTER:
+        printf("Keyboard entered a surface\n");
+        break;
+    case KEYBOARD_LEAVE:
+        printf("Keyboard left a surface\n");
+        break;
+    case KEYBOARD_KEY:
+        keyboard_key(lite, args[2].u, args[3].u);
+        break;
+    case KEYBOARD_MODIFIERS:
+        if (lite->xkb_state) {
+            xkb_state_update_mask(lite->xkb_state, args[1].u, args[2].u, args[3].u, 0, 0, args[4].u);
+        }
+        break;
+    }
+}
+
+/* Seat */
+
+static void
+seat_event(void *data, uint32_t id, uint16_t opcode, const union wire_arg *args)
+{
+    struct lite *lite = data;
+    if (opcode == SEAT_NAME) {
+        printf("Seat name: %s\n", args[0].s ? args[0].s : "");
+        return;
+    }
+
+    bool present = args[0].u & LITE_SEAT_KEYBOARD;
+    if (present && !lite->keyboard) {
+        lite->keyboard = wire_new_object(&lite->wire, &keyboard_interface, keyboard_event, lite);
+        if (!lite->keyboard || !wire_send(&lite->wire, lite->seat, 1, "n", lite->keyboard)) {
+            lite->error = true;
+            return;
+        }
+        ++lite->acquires;
+        printf("Keyboard capability present\n");
+    } else if (!present && lite->keyboard) {
+        wire_send(&lite->wire, lite->keyboard, 0, "");      // wl_keyboard.release
+        wire_destroy_object(&lite->wire, lite->keyboard);
+        lite->keyboard = 0;
+        ++lite->releases;
+        printf("Keyboard unplugged, waiting for one\n");
+    } else if (!present) {
+        printf("No keyboard yet, waiting for one\n");
+    }
+}
+
+/* Registry */
+
+static void
+registry_event(void *data, uint32_t id, uint16_t opcode, const union wire_arg *args)
+{
+    struct lite *lite = data;
+    if (opcode == REGISTRY_GLOBAL) {
+        if (!lite->seat && args[1].s && strcmp(args[1].s, "wl_seat") == 0) {
+            uint32_t version = args[2].u < LITE_SEAT_VERSION ? args[2].u : LITE_SEAT_VERSION;
+            lite->seat = wire_new_object(&lite->wire, &seat_interface, seat_event, lite);
+            lite->seat_name = args[0].u;
+            if (!lite->seat ||
+                !wire_send(&lite->wire, lite->registry, 0, "usun", args[0].u, "wl_seat", version, lite->seat)) {
+                lite->error = true;
+                return;
+            }
+            printf("Seat bound\n");
+        }
+    } else if (args[0].u == lite->seat_name && lite->seat) {
+        fprintf(stderr, "The seat went away\n");
+        lite->error = true;
+    }
+}
+
+// Registry sync: every global has been announced
+static void
+registry_ready(void *data, uint32_t id, uint16_t opcode, const union wire_arg *args)
+{
+    struct lite *lite = data;
+    if (!lite->seat) {
+        fprintf(stderr, "Seat is NULL\n");
+        lite->error = true;
+        return;
+    }
+    startup_report("globals ready");
+}
+
+/* Synthetic flood, as seat_listeners --flood */
+
+static void
+flood_done(void *data, uint32_t id, uint16_t opcode, const union wire_arg *args)
+{
+    struct lite *lite = data;
+    fprintf(stderr, "[FLOOD] sync %u done\n", args[0].u);
+    if (++lite->flood_done == lite->flood_count) {
+        clock_gettime(CLOCK_MONOTONIC, &lite->flood_end);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &lite->flood_cpu_end);
+    }
+}
+
+// Keeps LITE_FLOOD_IN_FLIGHT syncs going; delete_ids free their ids
+static void
+flood_send(struct lite *lite)
+{
+    while (lite->flood_sent < lite->flood_count &&
+           lite->flood_sent - lite->flood_done < LITE_FLOOD_IN_FLIGHT) {
+        uint32_t callback = wire_new_object(&lite->wire, &wire_callback_interface, flood_done, lite);
+        if (!callback) {
+            return;
+        }
+        if (!wire_send(&lite->wire, WIRE_DISPLAY_ID, 0, "n", callback)) {
+            lite->error = true;
+            return;
+        }
+        ++lite->flood_sent;
+    }
+}
+
+// Once the last reply is in, or at exit if it never came
+static void
+flood_report(struct lite *lite)
+{
+    if (!lite->flood_count || lite->flood_reported) {
+        return;
+    }
+    lite->flood_reported = true;
+    bool finished = lite->flood_done == lite->flood_count;
+    struct timespec now, cpu_now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_now);
+    double cpu_ms = lite_ms(&lite->flood_cpu_start, finished ? &lite->flood_cpu_end : &cpu_now);
+    fprintf(stderr, "[FLOOD] synthetic flood: %llu/%llu syncs answered%s %.1f ms, %.2f us CPU per reply\n",
+            (unsigned long long)lite->flood_done, (unsigned long long)lite->flood_count,
+            finished ? " in" : ", running for",
+            lite_ms(&lite->flood_start, finished ? &lite->flood_end : &now),
+            lite->flood_done ? cpu_ms * 1e3 / lite->flood_done : 0.0);
+}
+
+static void
+handle_signal(int signal)
+{
+    interrupted = 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+    startup_begin();
+    static struct lite lite;         // The object table is large, keep it off the stack
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--raw") == 0) {
+            lite.raw = true;
+        } else if (strcmp(argv[i], "--flood") == 0 && i + 1 < argc) {
+            lite.flood_count = strtoull(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--raw] [--flood syncs]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    struct sigaction action = { .sa_handler = handle_signal };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (!wire_connect(&lite.wire)) {
+        fprintf(stderr, "Unable to connect to Wayland display\n");
+        return EXIT_FAILURE;
+    }
+
+    // get_registry, then a sync that answers once every global is out
+    lite.registry = wire_new_object(&lite.wire, &registry_interface, registry_event, &lite);
+    uint32_t ready = wire_new_object(&lite.wire, &wire_callback_interface, registry_ready, &lite);
+    wire_send(&lite.wire, WIRE_DISPLAY_ID, 1, "n", lite.registry);
+    wire_send(&lite.wire, WIRE_DISPLAY_ID, 0, "n", ready);
+    wire_flush(&lite.wire);
+
+    if (lite.flood_count) {
+        clock_gettime(CLOCK_MONOTONIC, &lite.flood_start);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &lite.flood_cpu_start);
+    }
+    while (!interrupted && !lite.error && !lite.wire.error) {
+        flood_send(&lite);
+        if (wire_wait(&lite.wire) < 0) {
+            break;
+        }
+        if (lite.flood_count && lite.flood_done == lite.flood_count) {
+            flood_report(&lite);
+        }
+    }
+
+    flood_report(&lite);
+    fprintf(stderr, "[INPUT] seat_listeners_lite: %llu devices acquired, %llu released; "
+            "keyboard %llu handled\n", (unsigned long long)lite.acquires,
+            (unsigned long long)lite.releases, (unsigned long long)lite.keyboard_events);
+    wire_report(&lite.wire, "seat_listeners_lite");
+
+    if (lite.xkb_state) {
+        xkb_state_unref(lite.xkb_state);
+    }
+    if (lite.keymap) {
+        xkb_keymap_unref(lite.keymap);
+    }
+    if (lite.xkb_context) {
+        xkb_context_unref(lite.xkb_context);
+    }
+    wire_disconnect(&lite.wire);
+    return lite.seat ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,17 +1,30 @@
-#define _POSIX_C_SOURCE 200112L
+#define _GNU_SOURCE
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <xkbcommon/xkbcommon.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
+#include <linux/input-event-codes.h>
 #include <wayland-client.h>
 #include "protocols/xdg-shell-client-protocol.h"
 #include "protocols/src/xdg-shell-client-protocol.c"
+#include "include/trace.h"
+#include "include/probes.h"
+#include "include/configure.h"
+#include "include/flood.h"
+#include "include/popup.h"
+#include "include/displaylist.h"
+#include "include/hittest.h"
+#include "include/perfcount.h"
 
 /**********************************************
  * @WAYLAND CLIENT EXAMPLE CODE
@@ -80,11 +93,39 @@
  *      the stderr.
  *
  * 6. **Buffer Management**:
- *    - A shared memory buffer is created to store pixel data for drawing.
- *    - The `draw_frame` function is called to render a checkerboard pattern 
- *      onto this buffer.
+ *    - WB_BUFFERS shared memory buffers are created in one pool and reused
+ *      once the compositor releases them; a resize replaces the pool.
+ *    - The `draw_frame` function records the scene (a checkerboard pattern,
+ *      --scene-rects extra rectangles, a box under the pointer and a status
+ *      line) into a display list from include/displaylist.h and plays it
+ *      into a free buffer. Only tiles that differ from what that buffer
+ *      already holds are drawn, spread over --threads threads; only tiles
+ *      that differ from the previous frame are damaged. --no-tile-skip
+ *      draws and damages every tile, for comparison.
+ *    - Every pointer frame looks up the scene rect under the pointer in a
+ *      grid from include/hittest.h (--hit-linear scans them all instead);
+ *      the hovered one is outlined.
+ *    - --perf counts cycles, instructions, cache misses, page faults and
+ *      context switches (software events only where the CPU's counters
+ *      are unavailable) around drawing, committing and dispatch, see
+ *      include/perfcount.h; printed with the frame statistics on exit.
+ *    - `draw_frame` runs on a producer thread. On a frame callback the main
+ *      thread attaches the frame finished meanwhile (handed over through
+ *      an atomic slot) and, if the window changed since, has the next one
+ *      started right away, so drawing overlaps event handling and the
+ *      compositor's work. The main thread only waits when no frame is
+ *      ready. --no-pipeline always waits, for comparison; the waiting
+ *      time and overlap are printed on exit.
  *    - The buffer is attached to the surface and committed to be displayed 
  *      on the screen.
+ *    - Configures go through include/configure.h: only the latest serial is
+ *      acked and at most one frame is drawn per frame callback, at the
+ *      final size. The counts are printed when the window is closed.
+ *
+ * 7. **Context Menu**:
+ *    - A right click opens an xdg_popup menu from include/popup.h. Its
+ *      buffers and surfaces exist before the click, so opening it only
+ *      sends requests; the click-to-visible times are printed at exit.
  *
  * @CONCLUSION:
  * 
@@ -167,6 +208,55 @@ allocate_shm_file(size_t size)
 }
 
 /* Wayland code */
+#define WB_BUFFERS 3     // One on screen, one queued, one being drawn
+#define WB_MAX_DAMAGE 32 // Damage rects kept per frame; beyond that the whole buffer
+
+/* Everything a frame shows that comes from the main thread */
+struct frame_input {
+    int32_t width, height;
+    bool pointer_inside;
+    int32_t pointer_x, pointer_y;
+    int32_t hovered;                     // Scene rect under the pointer, or -1
+};
+
+enum wb_buffer_state {
+    WB_FREE,                             // Released; the producer may take it
+    WB_DRAWING,                          // Owned by the producer
+    WB_READY,                            // In the slot, waiting for a frame callback
+    WB_ATTACHED,                         // Committed, not yet released
+};
+
+struct wb_producer;
+
+struct wb_buffer {
+    struct wl_buffer *wl_buffer;
+    struct dl_target target;             // Pixels and the tile hashes they hold
+    atomic_int state;                    // enum wb_buffer_state
+    struct wb_producer *producer;        // Woken when the buffer is released
+    uint64_t frame_id;                   // Frame last attached, for the trace flow
+    struct frame_input input;            // What was drawn into it
+    int damage_count;                    // -1: the whole buffer
+    int32_t damage[WB_MAX_DAMAGE][4];    // Changed since the frame before it
+};
+
+/* The producer thread and its hand-over slot */
+struct wb_producer {
+    pthread_t thread;
+    pthread_mutex_t mutex;               // Guards the request; never held while drawing
+    pthread_cond_t wake;                 // Request posted, buffer released, quit
+    pthread_cond_t produced;             // The producer went idle
+    struct frame_input request;
+    bool requested, drawing, quit;
+    _Atomic(struct wb_buffer *) ready;   // Finished frame, taken without the mutex
+    bool pipeline;                       // Off with --no-pipeline
+    /* Producer thread counters */
+    uint64_t frames;
+    double produce_ms;
+    /* Main thread counters */
+    uint64_t handed_over, waited;
+    double blocked_ms, blocked_max_ms;
+};
+
 struct client_state {
     /* Globals */
     struct wl_display *wl_display;       // Wayland display connection
@@ -174,6 +264,7 @@ struct client_state {
     struct wl_shm *wl_shm;               // Shared memory object
     struct wl_compositor *wl_compositor; // Compositor interface
     struct xdg_wm_base *xdg_wm_base;     // XDG window manager base interface
+    uint32_t xdg_wm_base_version;        // Bound version; v3 adds popup reposition
     struct wl_seat *wl_seat;             // Input device seat
     /* Objects */
     struct wl_surface *wl_surface;       // Wayland surface
@@ -184,63 +275,525 @@ struct client_state {
     /* State */
     float offset;                        // Offset for drawing (not used here)
     uint32_t last_frame;                 // Last frame number (not used here)
+    uint64_t frame_id;                   // Frames produced so far, used as trace flow ids
     int width, height;                   // Width and height of the surface
     bool closed;                         // Flag for window closure
+    struct configure_state configure;    // Pending/acked configure, frame pacing
     struct pointer_event pointer_event;  // Structure to store current pointer event
+    struct flood *flood;                 // Set with --flood-safe or --flood
+    struct popup_menu menu;              // Right-click menu
+    /* Software rendering */
+    struct wb_buffer buffers[WB_BUFFERS];
+    void *pool_data;                     // Mapping of all buffers
+    size_t pool_size;
+    int buffer_width, buffer_height;
+    struct display_list scene;           // Rebuilt every frame
+    struct dl_tiles tiles;
+    struct dl_player player;
+    struct wb_producer producer;
+    bool tile_skip;                      // Off with --no-tile-skip
+    int scene_rects;                     // --scene-rects
+    struct hit_index hits;               // The scene rects, for the pointer
+    int hovered;                         // Topmost rect under the pointer, or -1
+    bool hit_linear;                     // --hit-linear
+    bool perf;                           // --perf: counters per phase
+    struct perf_phase perf_render;       // draw_frame, on the producer thread
+    struct perf_phase perf_dispatch;     // Event dispatch, includes perf_commit
+    struct perf_phase perf_commit;       // Taking, attaching and damaging a frame
+    uint64_t dl_frames, dl_ops;
+    uint64_t tiles_total, tiles_drawn, tiles_damaged;
+    bool damage_all;                     // Last draw_frame failed, see there
+    double record_ms, play_ms, play_max_ms;
+    struct wl_surface *pointer_surface;  // Surface under the pointer
+    double pointer_x, pointer_y;         // Last position on it
     struct xkb_state *xkb_state;         // Keyboard state
     struct xkb_context *xkb_context;     // XKB context for keyboard handling
     struct xkb_keymap *xkb_keymap;       // Keymap for keyboard
 };
 
+static double
+elapsed_ms(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
 static void
 wl_buffer_release(void *data, struct wl_buffer *wl_buffer)
 {
     /* Sent by the compositor when it's no longer using this buffer */
-    wl_buffer_destroy(wl_buffer);
+    struct wb_buffer *buffer = data;
+    TRACE_BEGIN("present", "wl_buffer.release");
+    TRACE_FLOW_END("frame", "frame", buffer->frame_id);
+    PROBE1(buffer_release, buffer->frame_id);
+    atomic_store(&buffer->state, WB_FREE);
+    /* The producer may be waiting for a buffer */
+    pthread_mutex_lock(&buffer->producer->mutex);
+    pthread_cond_signal(&buffer->producer->wake);
+    pthread_mutex_unlock(&buffer->producer->mutex);
+    TRACE_END("present", "wl_buffer.release");
 }
 
 static const struct wl_buffer_listener wl_buffer_listener = {
     .release = wl_buffer_release,
 };
 
-static struct wl_buffer *
-draw_frame(struct client_state *state)
+static void
+destroy_buffers(struct client_state *state)
+{
+    for (int i = 0; i < WB_BUFFERS; ++i) {
+        struct wb_buffer *buffer = &state->buffers[i];
+        /* Destroying a busy buffer is fine: its storage is never written again */
+        if (buffer->wl_buffer) {
+            wl_buffer_destroy(buffer->wl_buffer);
+        }
+        free(buffer->target.hash);
+        *buffer = (struct wb_buffer){0};
+    }
+    if (state->pool_data) {
+        munmap(state->pool_data, state->pool_size);
+        state->pool_data = NULL;
+    }
+    state->buffer_width = state->buffer_height = 0;
+}
+
+/* WB_BUFFERS buffers of `width` x `height` in one pool, contents unknown.
+ * Only called while the producer is idle with nothing requested. */
+static bool
+create_buffers(struct client_state *state, int width, int height)
 {
-    const int width = 640, height = 480;
+    destroy_buffers(state);
     int stride = width * 4;
-    int size = stride * height;
+    size_t buffer_size = (size_t)stride * height;
+    state->pool_size = buffer_size * WB_BUFFERS;
 
-    int fd = allocate_shm_file(size);
+    int fd = allocate_shm_file(state->pool_size);
     if (fd == -1) {
-        return NULL;
+        return false;
     }
-
-    uint32_t *data = mmap(NULL, size,
+    state->pool_data = mmap(NULL, state->pool_size,
             PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (data == MAP_FAILED) {
+    if (state->pool_data == MAP_FAILED) {
+        state->pool_data = NULL;
         close(fd);
-        return NULL;
+        return false;
     }
 
-    struct wl_shm_pool *pool = wl_shm_create_pool(state->wl_shm, fd, size);
-    struct wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0,
-            width, height, stride, WL_SHM_FORMAT_XRGB8888);
+    size_t tiles = (size_t)((width + DL_TILE_SIZE - 1) / DL_TILE_SIZE)
+            * ((height + DL_TILE_SIZE - 1) / DL_TILE_SIZE);
+    struct wl_shm_pool *pool = wl_shm_create_pool(state->wl_shm, fd, state->pool_size);
+    for (int i = 0; i < WB_BUFFERS; ++i) {
+        struct wb_buffer *buffer = &state->buffers[i];
+        buffer->wl_buffer = wl_shm_pool_create_buffer(pool, i * buffer_size,
+                width, height, stride, WL_SHM_FORMAT_XRGB8888);
+        wl_buffer_add_listener(buffer->wl_buffer, &wl_buffer_listener, buffer);
+        buffer->producer = &state->producer;
+        buffer->target = (struct dl_target){
+            .pixels = (uint32_t *)((uint8_t *)state->pool_data + i * buffer_size),
+            .stride = stride,
+            .hash = calloc(tiles, sizeof(uint64_t)),
+        };
+    }
     wl_shm_pool_destroy(pool);
     close(fd);
 
-    /* Draw checkerboxed background */
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            if ((x + y / 8 * 8) % 16 < 8)
-                data[y * width + x] = 0xFF666666;
-            else
-                data[y * width + x] = 0xFFEEEEEE;
+    state->buffer_width = width;
+    state->buffer_height = height;
+    for (int i = 0; i < WB_BUFFERS; ++i) {
+        if (!state->buffers[i].target.hash) {
+            destroy_buffers(state);
+            return false;
         }
     }
+    return true;
+}
+
+/* Rect `i` of --scene-rects: pseudo-random, fixed for a given window size */
+static void
+scene_rect(int i, int width, int height, int32_t rect[4], uint32_t *color)
+{
+    uint32_t seed = 12345 + i * 2654435761u;
+    uint32_t r[5];
+    for (int j = 0; j < 5; ++j) {
+        seed = seed * 1103515245 + 12345;
+        r[j] = seed >> 8;
+    }
+    rect[2] = 8 + r[2] % 120;
+    rect[3] = 8 + r[3] % 120;
+    rect[0] = r[0] % (width > rect[2] ? width - rect[2] : 1);
+    rect[1] = r[1] % (height > rect[3] ? height - rect[3] : 1);
+    *color = 0xFF000000 | r[4];
+}
 
-    munmap(data, size);
-    wl_buffer_add_listener(buffer, &wl_buffer_listener, NULL);
-    return buffer;
+/* Main thread: keeps the hit-test index in step with the scene rects */
+static void
+layout_hit_regions(struct client_state *state, int width, int height)
+{
+    struct hit_index *hits = &state->hits;
+    if (hits->width == width && hits->height == height) {
+        return;
+    }
+    bool ok = hit_index_resize(hits, width, height);
+    for (int i = 0; i < state->scene_rects && ok; ++i) {
+        int32_t rect[4];
+        uint32_t color;
+        scene_rect(i, width, height, rect, &color);
+        ok = i < hits->count ? hit_index_move(hits, i, rect[0], rect[1], rect[2], rect[3])
+                : hit_index_add(hits, rect[0], rect[1], rect[2], rect[3]) == i;
+    }
+    if (!ok) {
+        fprintf(stderr, "[HIT] Out of memory, pointer hit-testing is off\n");
+        hit_index_free(hits);
+    }
+}
+
+/* Records this frame's drawing; nothing touches pixels here */
+static void
+record_scene(struct client_state *state, const struct frame_input *input)
+{
+    int width = input->width, height = input->height;
+    struct display_list *scene = &state->scene;
+    dl_reset(scene);
+    dl_checker(scene, 0, 0, width, height, 8, 0xFF666666, 0xFFEEEEEE);
+
+    for (int i = 0; i < state->scene_rects; ++i) {
+        int32_t rect[4];
+        uint32_t color;
+        scene_rect(i, width, height, rect, &color);
+        dl_fill(scene, rect[0], rect[1], rect[2], rect[3], color);
+    }
+    if (input->hovered >= 0) {
+        /* Outlined by four thin fills, inside the rect so nothing above it shows through */
+        int32_t r[4];
+        uint32_t color;
+        scene_rect(input->hovered, width, height, r, &color);
+        dl_fill(scene, r[0], r[1], r[2], 2, 0xFFFFFFFF);
+        dl_fill(scene, r[0], r[1] + r[3] - 2, r[2], 2, 0xFFFFFFFF);
+        dl_fill(scene, r[0], r[1], 2, r[3], 0xFFFFFFFF);
+        dl_fill(scene, r[0] + r[2] - 2, r[1], 2, r[3], 0xFFFFFFFF);
+    }
+
+    if (input->pointer_inside) {
+        dl_fill(scene, input->pointer_x - 16, input->pointer_y - 16, 32, 32, 0xFF3366CC);
+    }
+
+    char status[96];
+    snprintf(status, sizeof(status), "frame %llu, %llu/%llu tiles drawn",
+            (unsigned long long)state->producer.frames, (unsigned long long)state->tiles_drawn,
+            (unsigned long long)state->tiles_total);
+    dl_fill(scene, 0, height - 24, font_text_width(status, 2) + 16, 24, 0xFF222222);
+    dl_text(scene, 8, height - 19, 2, 0xFFEEEEEE, status);
+}
+
+static void
+collect_damage(void *data, int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    struct wb_buffer *buffer = data;
+    if (buffer->damage_count < 0 || buffer->damage_count == WB_MAX_DAMAGE) {
+        buffer->damage_count = -1;
+        return;
+    }
+    int32_t *rect = buffer->damage[buffer->damage_count++];
+    rect[0] = x, rect[1] = y, rect[2] = width, rect[3] = height;
+}
+
+/* Producer thread: records and plays `input` into `buffer` */
+static bool
+draw_frame(struct client_state *state, struct wb_buffer *buffer, const struct frame_input *input)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TRACE_BEGIN("render", "record");
+    record_scene(state, input);
+    bool binned = !state->scene.failed
+            && dl_bin(&state->tiles, &state->scene, input->width, input->height);
+    TRACE_END("render", "record");
+    if (!binned) {
+        state->damage_all = true;
+        return false;
+    }
+    state->record_ms += elapsed_ms(&start);
+
+    int tile_count = state->tiles.columns * state->tiles.rows;
+    if (!state->tile_skip) {
+        memset(buffer->target.hash, 0, tile_count * sizeof(uint64_t));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TRACE_BEGIN("render", "playback");
+    int drawn = dl_play(&state->player, &state->scene, &state->tiles, &buffer->target);
+    TRACE_END("render", "playback");
+    if (drawn < 0) {
+        /* dl_bin already replaced the previous list with one that was never
+         * presented, so the next frame's dl_damage would diff against it */
+        state->damage_all = true;
+        return false;
+    }
+    double ms = elapsed_ms(&start);
+    state->play_ms += ms;
+    state->play_max_ms = ms > state->play_max_ms ? ms : state->play_max_ms;
+
+    /* Frames are attached in the order they are drawn, so this is what the
+     * compositor has to update */
+    if (state->tile_skip && !state->damage_all) {
+        buffer->damage_count = 0;
+        state->tiles_damaged += dl_damage(&state->tiles, collect_damage, buffer);
+    } else {
+        state->damage_all = false;
+        buffer->damage_count = -1;
+        state->tiles_damaged += tile_count;
+    }
+    buffer->input = *input;
+
+    ++state->dl_frames;
+    state->dl_ops += state->scene.count;
+    state->tiles_total += tile_count;
+    state->tiles_drawn += drawn;
+    return true;
+}
+
+static void *
+producer_main(void *data)
+{
+    struct client_state *state = data;
+    struct wb_producer *producer = &state->producer;
+
+    trace_set_thread_name("producer");
+    if (state->perf) {
+        perf_phase_open(&state->perf_render, "render");
+    }
+    pthread_mutex_lock(&producer->mutex);
+    while (!producer->quit) {
+        struct wb_buffer *buffer = NULL;
+        for (int i = 0; i < WB_BUFFERS && producer->requested && !buffer; ++i) {
+            int expected = WB_FREE;
+            if (atomic_compare_exchange_strong(&state->buffers[i].state, &expected, WB_DRAWING)) {
+                buffer = &state->buffers[i];
+            }
+        }
+        if (!buffer) {
+            pthread_cond_wait(&producer->wake, &producer->mutex);
+            continue;
+        }
+        struct frame_input input = producer->request;
+        producer->requested = false;
+        producer->drawing = true;
+        pthread_mutex_unlock(&producer->mutex);
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        TRACE_BEGIN("render", "draw_frame");
+        perf_phase_begin(&state->perf_render);
+        bool drawn = draw_frame(state, buffer, &input);
+        perf_phase_end(&state->perf_render);
+        TRACE_END("render", "draw_frame");
+        producer->produce_ms += elapsed_ms(&start);
+        if (drawn) {
+            ++producer->frames;
+            atomic_store(&buffer->state, WB_READY);
+            atomic_store_explicit(&producer->ready, buffer, memory_order_release);
+        } else {
+            atomic_store(&buffer->state, WB_FREE);
+        }
+
+        pthread_mutex_lock(&producer->mutex);
+        producer->drawing = false;
+        pthread_cond_broadcast(&producer->produced);
+    }
+    pthread_mutex_unlock(&producer->mutex);
+    return NULL;
+}
+
+static bool
+producer_start(struct client_state *state, bool pipeline)
+{
+    struct wb_producer *producer = &state->producer;
+    pthread_mutex_init(&producer->mutex, NULL);
+    pthread_cond_init(&producer->wake, NULL);
+    pthread_cond_init(&producer->produced, NULL);
+    atomic_init(&producer->ready, NULL);
+    producer->pipeline = pipeline;
+    return trace_thread_create(&producer->thread, producer_main, state) == 0;
+}
+
+static void
+producer_stop(struct wb_producer *producer)
+{
+    pthread_mutex_lock(&producer->mutex);
+    producer->quit = true;
+    pthread_cond_broadcast(&producer->wake);
+    pthread_mutex_unlock(&producer->mutex);
+    pthread_join(producer->thread, NULL);
+}
+
+/* Queues `input` unless the producer already has something to do */
+static void
+producer_request(struct wb_producer *producer, const struct frame_input *input, bool replace)
+{
+    pthread_mutex_lock(&producer->mutex);
+    if (replace || (!producer->requested && !producer->drawing)) {
+        producer->request = *input;
+        producer->requested = true;
+        pthread_cond_signal(&producer->wake);
+    }
+    pthread_mutex_unlock(&producer->mutex);
+}
+
+/* Whether waiting can end: releases are only read by this thread, so with
+ * every buffer held by the compositor the producer would wait forever */
+static bool
+producer_can_finish(struct client_state *state)
+{
+    struct wb_producer *producer = &state->producer;
+    pthread_mutex_lock(&producer->mutex);
+    bool possible = producer->drawing;
+    pthread_mutex_unlock(&producer->mutex);
+    for (int i = 0; i < WB_BUFFERS && !possible; ++i) {
+        possible = atomic_load(&state->buffers[i].state) == WB_FREE;
+    }
+    return possible;
+}
+
+/* Main thread: blocks until the producer is idle, then empties the slot */
+static struct wb_buffer *
+producer_wait(struct wb_producer *producer)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TRACE_BEGIN("render", "wait for producer");
+    pthread_mutex_lock(&producer->mutex);
+    while (!atomic_load(&producer->ready) && (producer->requested || producer->drawing)) {
+        pthread_cond_wait(&producer->produced, &producer->mutex);
+    }
+    pthread_mutex_unlock(&producer->mutex);
+    TRACE_END("render", "wait for producer");
+    double ms = elapsed_ms(&start);
+    producer->blocked_ms += ms;
+    producer->blocked_max_ms = ms > producer->blocked_max_ms ? ms : producer->blocked_max_ms;
+    return atomic_exchange_explicit(&producer->ready, NULL, memory_order_acquire);
+}
+
+static bool
+frame_input_equal(const struct frame_input *a, const struct frame_input *b)
+{
+    return a->width == b->width && a->height == b->height
+            && a->pointer_inside == b->pointer_inside && a->hovered == b->hovered
+            && (!a->pointer_inside || (a->pointer_x == b->pointer_x && a->pointer_y == b->pointer_y));
+}
+
+static void
+dl_report(const struct client_state *state, const char *label)
+{
+    if (!state->dl_frames) {
+        return;
+    }
+    fprintf(stderr, "[DLIST] %s: %llu frames, %.1f ops/frame, %llu of %llu tiles drawn "
+            "(%.1f%% skipped), %llu damaged, record %.3f ms/frame, playback %.3f ms/frame "
+            "(max %.3f) on %d threads\n", label,
+            (unsigned long long)state->dl_frames, (double)state->dl_ops / state->dl_frames,
+            (unsigned long long)state->tiles_drawn, (unsigned long long)state->tiles_total,
+            state->tiles_total ? 100.0 * (state->tiles_total - state->tiles_drawn) / state->tiles_total : 0,
+            (unsigned long long)state->tiles_damaged,
+            state->record_ms / state->dl_frames, state->play_ms / state->dl_frames,
+            state->play_max_ms, state->player.threads);
+}
+
+static void
+producer_report(const struct wb_producer *producer, const char *label)
+{
+    if (!producer->frames) {
+        return;
+    }
+    /* The share of drawing the main thread did not sit out */
+    double overlap = producer->produce_ms > 0 ? 100.0 * (1 - producer->blocked_ms / producer->produce_ms) : 0;
+    fprintf(stderr, "[PIPELINE] %s: %llu frames drawn off-thread, %llu ready at the frame "
+            "callback, %llu waited for; drawing %.3f ms/frame, main thread blocked %.3f ms "
+            "(max %.3f), overlap %.1f%%\n", label,
+            (unsigned long long)producer->frames, (unsigned long long)producer->handed_over,
+            (unsigned long long)producer->waited, producer->produce_ms / producer->frames,
+            producer->blocked_ms, producer->blocked_max_ms, overlap > 0 ? overlap : 0);
+}
+
+/* Called by the configure state machine, at most once per frame callback.
+ * Attaches the frame the producer drew ahead of time and has it start on
+ * the next one; only when there is none (first frame, resize, nothing
+ * changed since) does this thread wait for the drawing. */
+static void
+attach_frame(struct client_state *state, int32_t width, int32_t height)
+{
+    struct wb_producer *producer = &state->producer;
+    /* One flow per frame: attach -> commit -> release */
+    TRACE_FLOW_BEGIN("frame", "frame", ++state->frame_id);
+    state->width = width;
+    state->height = height;
+    layout_hit_regions(state, width, height);
+
+    struct frame_input input = {
+        .width = width, .height = height,
+        .pointer_inside = state->pointer_surface == state->wl_surface,
+        .pointer_x = (int32_t)state->pointer_x, .pointer_y = (int32_t)state->pointer_y,
+        .hovered = state->hovered,
+    };
+    PROBE1(frame_start, state->frame_id);
+    if (width != state->buffer_width || height != state->buffer_height) {
+        /* Whatever is queued or in the slot has the old size */
+        pthread_mutex_lock(&producer->mutex);
+        producer->requested = false;
+        pthread_mutex_unlock(&producer->mutex);
+        producer_wait(producer);
+        if (!create_buffers(state, width, height)) {
+            fprintf(stderr, "Failed to allocate %dx%d buffers\n", width, height);
+            return;
+        }
+    }
+
+    struct wb_buffer *buffer = atomic_exchange_explicit(&producer->ready, NULL, memory_order_acquire);
+    if (buffer) {
+        ++producer->handed_over;
+    } else if (!producer_can_finish(state)) {
+        /* Try again once the compositor has let go of a buffer */
+        configure_request_redraw(&state->configure);
+        return;
+    } else {
+        producer_request(producer, &input, false);
+        buffer = producer_wait(producer);
+        ++producer->waited;
+    }
+    PROBE1(frame_end, state->frame_id);
+    if (!buffer) {
+        fprintf(stderr, "Failed to draw a %dx%d frame\n", width, height);
+        return;
+    }
+
+    TRACE_BEGIN("present", "attach");
+    atomic_store(&buffer->state, WB_ATTACHED);
+    buffer->frame_id = state->frame_id;
+    wl_surface_attach(state->wl_surface, buffer->wl_buffer, 0, 0);
+    if (buffer->damage_count < 0) {
+        wl_surface_damage_buffer(state->wl_surface, 0, 0, width, height);
+    }
+    for (int i = 0; i < buffer->damage_count; ++i) {
+        wl_surface_damage_buffer(state->wl_surface, buffer->damage[i][0], buffer->damage[i][1],
+                buffer->damage[i][2], buffer->damage[i][3]);
+    }
+    PROBE1(commit, state->frame_id);
+    TRACE_END("present", "attach");
+
+    /* If the window has changed since that frame was started, draw the
+     * change now, while this one is committed and events are handled */
+    if (producer->pipeline && !frame_input_equal(&input, &buffer->input)) {
+        producer_request(producer, &input, true);
+        configure_request_redraw(&state->configure);
+    }
+}
+
+static void
+draw_and_attach(void *data, int32_t width, int32_t height)
+{
+    struct client_state *state = data;
+    perf_phase_begin(&state->perf_commit);
+    attach_frame(state, width, height);
+    perf_phase_end(&state->perf_commit);
 }
 
 static void
@@ -248,17 +801,36 @@ xdg_surface_configure(void *data,
         struct xdg_surface *xdg_surface, uint32_t serial)
 {
     struct client_state *state = data;
-    xdg_surface_ack_configure(xdg_surface, serial);
-
-    struct wl_buffer *buffer = draw_frame(state);
-    wl_surface_attach(state->wl_surface, buffer, 0, 0);
-    wl_surface_commit(state->wl_surface);
+    TRACE_BEGIN("configure", "xdg_surface.configure");
+    configure_surface(&state->configure, serial);
+    TRACE_END("configure", "xdg_surface.configure");
 }
 
 static const struct xdg_surface_listener xdg_surface_listener = {
     .configure = xdg_surface_configure,
 };
 
+static void
+xdg_toplevel_configure(void *data, struct xdg_toplevel *xdg_toplevel,
+        int32_t width, int32_t height, struct wl_array *states)
+{
+    struct client_state *state = data;
+    TRACE_INSTANT("configure", "xdg_toplevel.configure");
+    configure_toplevel(&state->configure, width, height, states);
+}
+
+static void
+xdg_toplevel_close(void *data, struct xdg_toplevel *xdg_toplevel)
+{
+    struct client_state *state = data;
+    state->closed = true;
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .configure = xdg_toplevel_configure,
+    .close = xdg_toplevel_close,
+};
+
 static void
 xdg_wm_base_ping(void *data, struct xdg_wm_base *xdg_wm_base, uint32_t serial)
 {
@@ -276,10 +848,16 @@ wl_pointer_enter(void *data, struct wl_pointer *wl_pointer,
                wl_fixed_t surface_x, wl_fixed_t surface_y)
 {
        struct client_state *client_state = data;
+       client_state->pointer_surface = surface;
+       client_state->pointer_x = wl_fixed_to_double(surface_x);
+       client_state->pointer_y = wl_fixed_to_double(surface_y);
        client_state->pointer_event.event_mask |= POINTER_EVENT_ENTER;
        client_state->pointer_event.serial = serial;
        client_state->pointer_event.surface_x = surface_x,
                client_state->pointer_event.surface_y = surface_y;
+       if (surface == client_state->wl_surface) {
+               configure_request_redraw(&client_state->configure);
+       }
 }
 
 static void
@@ -287,6 +865,12 @@ wl_pointer_leave(void *data, struct wl_pointer *wl_pointer,
                uint32_t serial, struct wl_surface *surface)
 {
        struct client_state *client_state = data;
+       if (client_state->pointer_surface == surface) {
+               client_state->pointer_surface = NULL;
+       }
+       if (surface == client_state->wl_surface) {
+               configure_request_redraw(&client_state->configure);
+       }
        client_state->pointer_event.serial = serial;
        client_state->pointer_event.event_mask |= POINTER_EVENT_LEAVE;
 }
@@ -297,6 +881,15 @@ wl_pointer_motion(void *data, struct wl_pointer *wl_pointer, uint32_t time,
                wl_fixed_t surface_x, wl_fixed_t surface_y)
 {
        struct client_state *client_state = data;
+       client_state->pointer_x = wl_fixed_to_double(surface_x);
+       client_state->pointer_y = wl_fixed_to_double(surface_y);
+       if (popup_menu_owns(&client_state->menu, client_state->pointer_surface)) {
+               popup_menu_motion(&client_state->menu,
+                               client_state->pointer_x, client_state->pointer_y);
+       } else if (client_state->pointer_surface == client_state->wl_surface) {
+               /* The box under the pointer moved */
+               configure_request_redraw(&client_state->configure);
+       }
        client_state->pointer_event.event_mask |= POINTER_EVENT_MOTION;
        client_state->pointer_event.time = time;
        client_state->pointer_event.surface_x = surface_x,
@@ -313,6 +906,21 @@ wl_pointer_button(void *data, struct wl_pointer *wl_pointer, uint32_t serial,
        client_state->pointer_event.serial = serial;
        client_state->pointer_event.button = button,
        client_state->pointer_event.state = state;
+
+       /* Acted on here rather than at wl_pointer.frame: the grab needs
+        * this serial, and the menu latency is timed from this point */
+       if (state != WL_POINTER_BUTTON_STATE_PRESSED) {
+               return;
+       }
+       struct popup_menu *menu = &client_state->menu;
+       if (popup_menu_owns(menu, client_state->pointer_surface)) {
+               popup_menu_click(menu, client_state->pointer_x, client_state->pointer_y);
+       } else if (button == BTN_RIGHT
+                       && client_state->pointer_surface == client_state->wl_surface) {
+               popup_menu_open(menu, client_state->xdg_surface, client_state->wl_seat,
+                               serial, (int32_t)client_state->pointer_x,
+                               (int32_t)client_state->pointer_y);
+       }
 }
 
 static void
@@ -355,11 +963,25 @@ wl_pointer_axis_discrete(void *data, struct wl_pointer *wl_pointer,
        client_state->pointer_event.axes[axis].discrete = discrete;
 }
 
+/* Deferred records (flood-safe mode) */
+enum record_kind {
+       RECORD_POINTER_FRAME = 1,
+       RECORD_POINTER_MOTION,          /* Motion-only frames, coalesced */
+       RECORD_KEY,
+};
+
+struct key_record {
+       xkb_keysym_t sym;
+       uint32_t state;
+       char utf8[16];
+};
+
+_Static_assert(sizeof(struct pointer_event) <= FLOOD_PAYLOAD, "pointer_event must fit a flood record");
+_Static_assert(sizeof(struct key_record) <= FLOOD_PAYLOAD, "key_record must fit a flood record");
+
 static void
-wl_pointer_frame(void *data, struct wl_pointer *wl_pointer)
+pointer_frame_log(const struct pointer_event *event)
 {
-       struct client_state *client_state = data;
-       struct pointer_event *event = &client_state->pointer_event;
        fprintf(stderr, "[DEBUG] pointer frame @ %d: ", event->time);
 
        if (event->event_mask & POINTER_EVENT_ENTER) {
@@ -423,7 +1045,48 @@ wl_pointer_frame(void *data, struct wl_pointer *wl_pointer)
        }
 
        fprintf(stderr, "\n");
+}
+
+static void
+wl_pointer_frame(void *data, struct wl_pointer *wl_pointer)
+{
+       struct client_state *client_state = data;
+       struct pointer_event *event = &client_state->pointer_event;
+       FLOOD_HANDLER_BEGIN(client_state->flood);
+       TRACE_BEGIN("input", "wl_pointer.frame");
+       PROBE1(pointer_frame, event->event_mask);
+
+       /* Which scene rect is under the pointer, on every frame that moved it */
+       if (event->event_mask & (POINTER_EVENT_ENTER | POINTER_EVENT_MOTION | POINTER_EVENT_LEAVE)) {
+               int hovered = -1;
+               if (client_state->pointer_surface == client_state->wl_surface) {
+                       struct hit_index *hits = &client_state->hits;
+                       int32_t x = (int32_t)client_state->pointer_x, y = (int32_t)client_state->pointer_y;
+                       hovered = client_state->hit_linear ? hit_index_lookup_linear(hits, x, y)
+                               : hit_index_lookup(hits, x, y);
+               }
+               if (hovered != client_state->hovered) {
+                       client_state->hovered = hovered;
+                       configure_request_redraw(&client_state->configure);
+               }
+       }
+
+       if (client_state->flood && client_state->flood->enabled) {
+               /* A queued motion-only frame is superseded by the next one */
+               if (event->event_mask == POINTER_EVENT_MOTION) {
+                       flood_push_coalesce(client_state->flood, RECORD_POINTER_MOTION,
+                                       event->time, event, sizeof(*event));
+               } else {
+                       flood_push(client_state->flood, RECORD_POINTER_FRAME,
+                                       event->time, event, sizeof(*event));
+               }
+       } else {
+               pointer_frame_log(event);
+       }
+
        memset(event, 0, sizeof(*event));
+       TRACE_END("input", "wl_pointer.frame");
+       FLOOD_HANDLER_END(client_state->flood);
 }
 
 static const struct wl_pointer_listener wl_pointer_listener = {
@@ -484,21 +1147,59 @@ wl_keyboard_enter(void *data, struct wl_keyboard *wl_keyboard,
 }
 
 static void
-wl_keyboard_key(void *data, struct wl_keyboard *wl_keyboard,
-               uint32_t serial, uint32_t time, uint32_t key, uint32_t state)
+key_log(xkb_keysym_t sym, uint32_t state, const char *utf8)
 {
-       struct client_state *client_state = data;
        char buf[128];
-       uint32_t keycode = key + 8;
-       xkb_keysym_t sym = xkb_state_key_get_one_sym(
-                       client_state->xkb_state, keycode);
        xkb_keysym_get_name(sym, buf, sizeof(buf));
        const char *action =
                state == WL_KEYBOARD_KEY_STATE_PRESSED ? "press" : "release";
        fprintf(stderr, "[DEBUG] key %s: sym: %-12s (%d), ", action, buf, sym);
+       fprintf(stderr, "[DEBUG] utf8: '%s'\n", utf8);
+}
+
+static void
+wl_keyboard_key(void *data, struct wl_keyboard *wl_keyboard,
+               uint32_t serial, uint32_t time, uint32_t key, uint32_t state)
+{
+       struct client_state *client_state = data;
+       FLOOD_HANDLER_BEGIN(client_state->flood);
+       TRACE_BEGIN("input", "wl_keyboard.key");
+       PROBE2(key, key, state);
+       /* Looked up now, against the current modifiers; logged later if deferred */
+       struct key_record record = { .state = state };
+       uint32_t keycode = key + 8;
+       record.sym = xkb_state_key_get_one_sym(
+                       client_state->xkb_state, keycode);
        xkb_state_key_get_utf8(client_state->xkb_state, keycode,
-                       buf, sizeof(buf));
-       fprintf(stderr, "[DEBUG] utf8: '%s'\n", buf);
+                       record.utf8, sizeof(record.utf8));
+       if (client_state->flood && client_state->flood->enabled) {
+               flood_push(client_state->flood, RECORD_KEY, time, &record, sizeof(record));
+       } else {
+               key_log(record.sym, record.state, record.utf8);
+       }
+       TRACE_END("input", "wl_keyboard.key");
+       FLOOD_HANDLER_END(client_state->flood);
+}
+
+/* Runs deferred records from flood_dispatch, within its budget */
+static void
+drain_record(void *data, const struct flood_record *record)
+{
+       switch (record->kind) {
+       case RECORD_POINTER_FRAME:
+       case RECORD_POINTER_MOTION: {
+               struct pointer_event event;
+               memcpy(&event, record->payload, sizeof(event));
+               pointer_frame_log(&event);
+               break;
+       }
+       case RECORD_KEY: {
+               struct key_record key;
+               memcpy(&key, record->payload, sizeof(key));
+               key_log(key.sym, key.state, key.utf8);
+               break;
+       }
+       }
 }
 
 static void
@@ -511,9 +1212,13 @@ wl_keyboard_keymap(void *data, struct wl_keyboard *wl_keyboard,
        char *map_shm = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
        assert(map_shm != MAP_FAILED);
 
+       TRACE_BEGIN("input", "keymap compile");
+       PROBE1(keymap_compile_start, size);
        struct xkb_keymap *xkb_keymap = xkb_keymap_new_from_string(
                        client_state->xkb_context, map_shm,
                        XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS);
+       PROBE1(keymap_compile_end, xkb_keymap != NULL);
+       TRACE_END("input", "keymap compile");
        munmap(map_shm, size);
        close(fd);
 
@@ -538,6 +1243,7 @@ wl_seat_capabilities(void *data, struct wl_seat *wl_seat, uint32_t capabilities)
 {
         struct client_state *state = data;
         /* TODO */
+        TRACE_INSTANT("registry", "seat capabilities");
 
         bool have_pointer = capabilities & WL_SEAT_CAPABILITY_POINTER;
 
@@ -578,6 +1284,7 @@ registry_global(void *data, struct wl_registry *wl_registry,
         uint32_t name, const char *interface, uint32_t version)
 {
     struct client_state *state = data;
+    TRACE_BEGIN("registry", "global");
     if (strcmp(interface, wl_shm_interface.name) == 0) {
         state->wl_shm = wl_registry_bind(
                 wl_registry, name, &wl_shm_interface, 1);
@@ -585,8 +1292,10 @@ registry_global(void *data, struct wl_registry *wl_registry,
         state->wl_compositor = wl_registry_bind(
                 wl_registry, name, &wl_compositor_interface, 4);
     } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
-        state->xdg_wm_base = wl_registry_bind(
-                wl_registry, name, &xdg_wm_base_interface, 1);
+        /* v3 for xdg_popup.reposition; v1 is enough for everything else */
+        state->xdg_wm_base_version = version < 3 ? version : 3;
+        state->xdg_wm_base = wl_registry_bind(wl_registry, name,
+                &xdg_wm_base_interface, state->xdg_wm_base_version);
         xdg_wm_base_add_listener(state->xdg_wm_base,
                 &xdg_wm_base_listener, state);
     } else if (strcmp(interface, wl_seat_interface.name) == 0) {
@@ -595,7 +1304,7 @@ registry_global(void *data, struct wl_registry *wl_registry,
          wl_seat_add_listener(state->wl_seat,
                          &wl_seat_listener, state);
     }
-
+    TRACE_END("registry", "global");
 }
 
 static void
@@ -610,27 +1319,158 @@ static const struct wl_registry_listener wl_registry_listener = {
     .global_remove = registry_global_remove,
 };
 
+static void
+menu_selected(void *data, int item)
+{
+    struct client_state *state = data;
+    fprintf(stderr, "[POPUP] Selected \"%s\"\n", state->menu.items[item]);
+    if (item == 3) {
+        state->closed = true;
+    }
+}
+
 int
 main(int argc, char *argv[])
 {
     struct client_state state = { 0 };
+    unsigned long long flood_count = 0;
+    bool flood_safe = false;
+    bool popup_cold = false;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    state.tile_skip = true;
+    state.hovered = -1;
+    bool pipeline = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--flood-safe") == 0) {
+            flood_safe = true;
+        } else if (strcmp(argv[i], "--flood") == 0 && i + 1 < argc) {
+            flood_count = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--popup-cold") == 0) {
+            popup_cold = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--scene-rects") == 0 && i + 1 < argc) {
+            state.scene_rects = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-tile-skip") == 0) {
+            state.tile_skip = false;
+        } else if (strcmp(argv[i], "--no-pipeline") == 0) {
+            pipeline = false;
+        } else if (strcmp(argv[i], "--hit-linear") == 0) {
+            state.hit_linear = true;
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            state.perf = true;
+        } else {
+            fprintf(stderr, "usage: %s [--flood-safe] [--flood syncs] [--popup-cold]\n"
+                    "       [--threads N] [--scene-rects N] [--no-tile-skip] [--no-pipeline]\n"
+                    "       [--hit-linear] [--perf]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    trace_init("waylandbookexp");
+    if (state.perf) {
+        perf_phase_open(&state.perf_dispatch, "dispatch");
+        perf_phase_open(&state.perf_commit, "commit");
+    }
+    const char *kernel;
+    dl_player_start(&state.player, threads > 0 ? (int)threads : 1, fill_select(NULL, &kernel));
+    if (!producer_start(&state, pipeline)) {
+        fprintf(stderr, "Failed to start the producer thread\n");
+        return 1;
+    }
     state.wl_display = wl_display_connect(NULL);
+    if (!state.wl_display) {
+        fprintf(stderr, "Failed to connect to the Wayland display\n");
+        return 1;
+    }
+    /* The ring is large, keep it off the stack */
+    static struct flood flood;
+    if (flood_safe || flood_count) {
+        flood_init(&flood, state.wl_display, flood_safe);
+        state.flood = &flood;
+    }
     state.wl_registry = wl_display_get_registry(state.wl_display);
     state.xkb_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
     wl_registry_add_listener(state.wl_registry, &wl_registry_listener, &state);
+    TRACE_BEGIN("registry", "roundtrip");
     wl_display_roundtrip(state.wl_display);
+    TRACE_END("registry", "roundtrip");
 
     state.wl_surface = wl_compositor_create_surface(state.wl_compositor);
     state.xdg_surface = xdg_wm_base_get_xdg_surface(
             state.xdg_wm_base, state.wl_surface);
+    configure_init(&state.configure, state.wl_surface, state.xdg_surface,
+            640, 480, draw_and_attach, &state);
     xdg_surface_add_listener(state.xdg_surface, &xdg_surface_listener, &state);
     state.xdg_toplevel = xdg_surface_get_toplevel(state.xdg_surface);
+    xdg_toplevel_add_listener(state.xdg_toplevel, &xdg_toplevel_listener, &state);
     xdg_toplevel_set_title(state.xdg_toplevel, "Example client");
     wl_surface_commit(state.wl_surface);
 
-    while (wl_display_dispatch(state.wl_display)) {
-        /* This space deliberately left blank */
+    static const char *const menu_items[] = { "Copy", "Paste", "Select all", "Close window" };
+    if (!popup_menu_init(&state.menu, state.wl_shm, state.wl_compositor, state.xdg_wm_base,
+                menu_items, 4, popup_cold, menu_selected, &state)) {
+        fprintf(stderr, "[POPUP] Failed to prepare the menu\n");
+        return 1;
     }
 
+    if (flood_count && flood_start(&flood, state.wl_display, flood_count,
+                drain_record, &state) < 0) {
+        fprintf(stderr, "[FLOOD] Connection lost while sending the flood\n");
+        state.closed = true;
+    }
+
+    bool flood_reported = false;
+    while (!state.closed && !trace_stop_requested()) {
+        int ret;
+        perf_phase_begin(&state.perf_dispatch);
+        if (state.flood) {
+            ret = flood_dispatch(state.wl_display, state.flood, -1,
+                    drain_record, &state);
+        } else {
+            TRACE_BEGIN("dispatch", "wl_display_dispatch");
+            ret = trace_dispatch(state.wl_display);
+            TRACE_END("dispatch", "wl_display_dispatch");
+        }
+        perf_phase_end(&state.perf_dispatch);
+        if (ret == -1) {
+            break;
+        }
+        if (flood_count && !flood_reported && flood.flood_done == flood.flood_sent
+                && flood_depth(&flood) == 0) {
+            flood_report(&flood, "waylandbookexp");
+            flood_reported = true;
+        }
+    }
+
+    configure_report(&state.configure, "waylandbookexp");
+    popup_menu_report(&state.menu, "waylandbookexp");
+    popup_menu_finish(&state.menu);
+    producer_stop(&state.producer);
+    dl_report(&state, "waylandbookexp");
+    producer_report(&state.producer, "waylandbookexp");
+    if (state.hits.lookups) {
+        fprintf(stderr, "[HIT] waylandbookexp: %d regions, %llu %s lookups, %.2f regions tested per lookup\n",
+                state.hits.count, (unsigned long long)state.hits.lookups,
+                state.hit_linear ? "linear" : "grid",
+                (double)state.hits.tests / state.hits.lookups);
+    }
+    hit_index_free(&state.hits);
+    if (state.perf) {
+        perf_phase_report(&state.perf_render, "waylandbookexp");
+        perf_phase_report(&state.perf_commit, "waylandbookexp");
+        perf_phase_report(&state.perf_dispatch, "waylandbookexp");
+        perf_phase_close(&state.perf_render);
+        perf_phase_close(&state.perf_commit);
+        perf_phase_close(&state.perf_dispatch);
+    }
+    dl_player_stop(&state.player);
+    destroy_buffers(&state);
+    dl_tiles_free(&state.tiles);
+    dl_free(&state.scene);
+    if (state.flood) {
+        flood_report(state.flood, "waylandbookexp");
+    }
     return 0;
 }
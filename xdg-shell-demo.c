@@ -1,13 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/syscall.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <wayland-client.h> // Wayland client API for interacting with the Wayland server
 #include <wayland-cursor.h> // Wayland cursor support for cursor management
 #include "protocols/xdg-shell-client-protocol.h" // XDG shell protocol for window management
 #include "protocols/src/xdg-shell-client-protocol.c" // Implementation of the stable version of XDG shell protocol
+#include "include/trace.h" // Timeline spans, enabled through MYWAYLAND_TRACE
+#include "include/probes.h" // USDT probes for bpftrace/perf
+#include "include/configure.h" // Configure/ack state machine with frame pacing
+#include "include/shm.h" // wl_shm backing files
+#include "include/input.h" // Seat devices by capability
 
 /************************************************
  * Global Variables Declaration
@@ -19,13 +23,137 @@ struct wl_shm *shm = NULL; // Shared memory for buffer allocation
 struct xdg_wm_base *wm_base = NULL; // XDG shell base for window management
 struct wl_surface *cursor_surface; // Surface for the cursor
 struct wl_cursor_image *cursor_image; // Image representation of the cursor
-struct wl_pointer *pointer; // Pointer object to handle mouse events
+struct input_seat input; // Just the pointer, for the cursor; no keyboard or touch
+struct configure_state configure; // Pending size/serial, acked once per frame
+int closed = 0; // Set when the compositor asks us to close
+
+extern const struct wl_pointer_listener pointer_listener;
+extern const struct wl_seat_listener seat_listener;
+
+/************************************************
+ * Window Buffers
+ * Two shm buffers, reallocated when the configured size changes. A buffer
+ * is only reused once the compositor has released it.
+ ************************************************/
+#define DEMO_BUFFERS 2
+
+struct demo_buffer {
+    struct wl_buffer *buffer;
+    unsigned char *data;
+    int width, height, size;
+    int busy;
+};
+
+struct demo_buffer buffers[DEMO_BUFFERS];
+
+void buffer_release_handler(void *data, struct wl_buffer *wl_buffer) {
+    struct demo_buffer *buffer = data;
+    buffer->busy = 0;
+}
+
+const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release_handler
+};
+
+void buffer_destroy(struct demo_buffer *buffer) {
+    if (buffer->buffer) {
+        wl_buffer_destroy(buffer->buffer);
+        munmap(buffer->data, buffer->size);
+    }
+    buffer->buffer = NULL;
+}
+
+int buffer_create(struct demo_buffer *buffer, int width, int height) {
+    int stride = width * 4; // Stride in bytes (4 bytes per pixel)
+    int size = stride * height; // Total size in bytes
+    int fd = shm_allocate(size);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Map the file into memory
+    unsigned char *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    // Create a shared memory pool from the file descriptor and allocate the buffer in it
+    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, size);
+    buffer->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_ARGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    wl_buffer_add_listener(buffer->buffer, &buffer_listener, buffer);
+
+    buffer->data = data;
+    buffer->width = width;
+    buffer->height = height;
+    buffer->size = size;
+    return 0;
+}
+
+/************************************************
+ * Draw Handler
+ * Called by the configure state machine at most once per frame callback,
+ * always at the latest configured size
+ ************************************************/
+void draw_handler(void *data, int32_t width, int32_t height) {
+    struct demo_buffer *buffer = NULL;
+    for (int i = 0; i < DEMO_BUFFERS; i++) {
+        if (!buffers[i].busy) {
+            buffer = &buffers[i];
+            break;
+        }
+    }
+    if (!buffer) {
+        configure_request_redraw(&configure); // Both on screen, try next frame
+        return;
+    }
+    if (buffer->width != width || buffer->height != height) {
+        buffer_destroy(buffer);
+        if (buffer_create(buffer, width, height) < 0) {
+            fprintf(stderr, "Failed to allocate a %dx%d buffer\n", width, height);
+            return;
+        }
+    }
+
+    // Fill the buffer with a yellow color
+    TRACE_BEGIN("render", "fill");
+    PROBE1(frame_start, configure.redraws);
+    int stride = width * 4;
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) {
+            struct pixel {
+                unsigned char blue; // Blue component
+                unsigned char green; // Green component
+                unsigned char red; // Red component
+                unsigned char alpha; // Alpha component
+            } *px = (struct pixel *)(buffer->data + y * stride + x * 4);
+
+            // Set pixel color to yellow (ARGB)
+            px->alpha = 255; // Fully opaque
+            px->red = 255; // Max red
+            px->green = 255; // Max green
+            px->blue = 0; // No blue
+        }
+    }
+    PROBE1(frame_end, configure.redraws);
+    TRACE_END("render", "fill");
+
+    TRACE_BEGIN("present", "attach");
+    wl_surface_attach(configure.surface, buffer->buffer, 0, 0); // Attach the buffer to the surface
+    wl_surface_damage(configure.surface, 0, 0, width, height);
+    PROBE1(commit, configure.redraws);
+    TRACE_END("present", "attach");
+    buffer->busy = 1;
+}
 
 /************************************************
  * Registry Global Handler
  * This function is called whenever a new global object (like compositor, shm, etc.) is available
  ************************************************/
 void registry_global_handler(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version) {
+    TRACE_BEGIN("registry", "global");
     printf("[LOG] Received interface: %s (version: %d)\n", interface, version);
 
     // Bind to the compositor interface
@@ -40,7 +168,10 @@ void registry_global_handler(void *data, struct wl_registry *registry, uint32_t
     } 
     // Bind to the input seat interface
     else if (strcmp(interface, "wl_seat") == 0) {
-        seat = wl_registry_bind(registry, name, &wl_seat_interface, 1);
+        seat = wl_registry_bind(registry, name, &wl_seat_interface, version < 3 ? version : 3); // v3 for wl_pointer_release
+        // The pointer is acquired when (and while) the seat has one
+        input_seat_init(&input, seat, WL_SEAT_CAPABILITY_POINTER, &pointer_listener, NULL, NULL, NULL);
+        wl_seat_add_listener(seat, &seat_listener, NULL);
         printf("[SUCCESS] Bound to wl_seat\n");
     } 
     // Bind to the XDG window manager interface
@@ -48,6 +179,7 @@ void registry_global_handler(void *data, struct wl_registry *registry, uint32_t
         wm_base = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
         printf("[SUCCESS] Bound to xdg_wm_base\n");
     }
+    TRACE_END("registry", "global");
 }
 
 /************************************************
@@ -66,7 +198,9 @@ const struct wl_registry_listener registry_listener = {
  * Called when the toplevel window is configured (e.g., resized)
  ************************************************/
 void xdg_toplevel_configure_handler(void *data, struct xdg_toplevel *xdg_toplevel, int32_t width, int32_t height, struct wl_array *states) {
+    TRACE_INSTANT("configure", "xdg_toplevel.configure");
     printf("Configure: %dx%d\n", width, height);
+    configure_toplevel(&configure, width, height, states); // Applied on the xdg_surface.configure
 }
 
 /************************************************
@@ -75,6 +209,7 @@ void xdg_toplevel_configure_handler(void *data, struct xdg_toplevel *xdg_topleve
  ************************************************/
 void xdg_toplevel_close_handler(void *data, struct xdg_toplevel *xdg_toplevel) {
     printf("Toplevel closed\n");
+    closed = 1;
 }
 
 /************************************************
@@ -86,26 +221,51 @@ const struct xdg_toplevel_listener xdg_toplevel_listener = {
     .close = xdg_toplevel_close_handler
 };
 
+/************************************************
+ * XDG Surface Configure Handler
+ * Ends a configure sequence; acked (latest serial only) on the next frame
+ ************************************************/
+void xdg_surface_configure_handler(void *data, struct xdg_surface *xdg_surface, uint32_t serial) {
+    TRACE_BEGIN("configure", "xdg_surface.configure");
+    configure_surface(&configure, serial);
+    TRACE_END("configure", "xdg_surface.configure");
+}
+
+const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure_handler
+};
+
 /************************************************
  * Pointer Event Handlers
  * These functions handle mouse pointer events
  ************************************************/
 void pointer_enter_handler(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface, wl_fixed_t x, wl_fixed_t y) {
+    input_seat_event(&input, WL_SEAT_CAPABILITY_POINTER);
+    TRACE_BEGIN("input", "wl_pointer.enter");
     wl_pointer_set_cursor(pointer, serial, cursor_surface, cursor_image->hotspot_x, cursor_image->hotspot_y);
+    TRACE_END("input", "wl_pointer.enter");
     printf("[DEBUG] Pointer entered: %d %d\n", wl_fixed_to_int(x), wl_fixed_to_int(y));
 }
 
-void pointer_leave_handler(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface) {}
+void pointer_leave_handler(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface) {
+    input_seat_event(&input, WL_SEAT_CAPABILITY_POINTER);
+}
 
 void pointer_motion_handler(void *data, struct wl_pointer *pointer, uint32_t time, wl_fixed_t x, wl_fixed_t y) {
+    input_seat_event(&input, WL_SEAT_CAPABILITY_POINTER);
+    TRACE_INSTANT("input", "wl_pointer.motion");
     printf("[DEBUG] Pointer motion: %d %d\n", wl_fixed_to_int(x), wl_fixed_to_int(y));
 }
 
 void pointer_button_handler(void *data, struct wl_pointer *pointer, uint32_t serial, uint32_t time, uint32_t button, uint32_t state) {
+    input_seat_event(&input, WL_SEAT_CAPABILITY_POINTER);
+    TRACE_INSTANT("input", "wl_pointer.button");
     printf("[DEBUG] Button pressed: 0x%x state: %d\n", button, state);
 }
 
 void pointer_axis_handler(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis, wl_fixed_t value) {
+    input_seat_event(&input, WL_SEAT_CAPABILITY_POINTER);
+    TRACE_INSTANT("input", "wl_pointer.axis");
     printf("[DEBUG] Axis movement: %d %f\n", axis, wl_fixed_to_double(value));
 }
 
@@ -121,11 +281,30 @@ const struct wl_pointer_listener pointer_listener = {
     .axis = pointer_axis_handler
 };
 
+/************************************************
+ * Seat Capabilities Handler
+ * Acquires or releases the pointer as the seat gains or loses one
+ ************************************************/
+void seat_capabilities_handler(void *data, struct wl_seat *wl_seat, uint32_t capabilities) {
+    TRACE_INSTANT("input", "wl_seat.capabilities");
+    input_seat_capabilities(&input, capabilities);
+}
+
+void seat_name_handler(void *data, struct wl_seat *wl_seat, const char *name) {}
+
+const struct wl_seat_listener seat_listener = {
+    .capabilities = seat_capabilities_handler,
+    .name = seat_name_handler
+};
+
 /************************************************
  * Main Function
  * This is where the Wayland client starts executing
  ************************************************/
 int main(void) {
+    // Optional timeline tracing, enabled through MYWAYLAND_TRACE
+    trace_init("xdg-shell-demo");
+
     // Connect to the Wayland display server
     struct wl_display *display = wl_display_connect(NULL);
     if (!display) {
@@ -138,12 +317,10 @@ int main(void) {
     wl_registry_add_listener(registry, &registry_listener, NULL);
 
     // Perform a roundtrip to retrieve global objects
+    TRACE_BEGIN("registry", "roundtrip");
     wl_display_roundtrip(display);
+    TRACE_END("registry", "roundtrip");
     
-    // Get the pointer associated with the seat and add event listener
-    pointer = wl_seat_get_pointer(seat);
-    wl_pointer_add_listener(pointer, &pointer_listener, NULL);
-
     // Check for required interfaces
     if (!compositor) {
         fprintf(stderr, "wl_compositor not available\n");
@@ -169,54 +346,14 @@ int main(void) {
     struct xdg_surface *xdg_surface = xdg_wm_base_get_xdg_surface(wm_base, surface);
     struct xdg_toplevel *xdg_toplevel = xdg_surface_get_toplevel(xdg_surface);
 
-    // Add listeners for the xdg_toplevel events
+    // Add listeners for the xdg_surface and xdg_toplevel events
+    configure_init(&configure, surface, xdg_surface, 200, 200, draw_handler, NULL);
+    xdg_surface_add_listener(xdg_surface, &xdg_surface_listener, NULL);
     xdg_toplevel_add_listener(xdg_toplevel, &xdg_toplevel_listener, NULL);
 
     // Set the title of the window
     xdg_toplevel_set_title(xdg_toplevel, "My Wayland Client");
 
-    /************************************************
-     * Configure Shared Memory for Buffer Allocation
-     * The following code sets up a shared memory buffer for drawing
-     ************************************************/
-    int width = 200; // Width of the window
-    int height = 200; // Height of the window
-    int stride = width * 4; // Stride in bytes (4 bytes per pixel)
-    int size = stride * height; // Total size in bytes
-
-    // Create an anonymous file for shared memory
-    int fd = syscall(SYS_memfd_create, "buffer", 0);
-    ftruncate(fd, size); // Set the size of the file
-
-    // Map the file into memory
-    unsigned char *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-
-    memset(data, 0, size); // Clear the memory buffer
-
-    // Create a shared memory pool from the file descriptor
-    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, size);
-
-    // Allocate a buffer in the shared memory pool
-    struct wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_ARGB8888);
-
-    // Fill the buffer with a yellow color
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
-            struct pixel {
-                unsigned char blue; // Blue component
-                unsigned char green; // Green component
-                unsigned char red; // Red component
-                unsigned char alpha; // Alpha component
-            } *px = (struct pixel *)(data + y * stride + x * 4);
-
-            // Set pixel color to yellow (ARGB)
-            px->alpha = 255; // Fully opaque
-            px->red = 255; // Max red
-            px->green = 255; // Max green
-            px->blue = 0; // No blue
-        }
-    }
-
     // Load cursor theme and get the cross cursor image
     struct wl_cursor_theme *cursor_theme = wl_cursor_theme_load("Breeze_Light", 24, shm);
     struct wl_cursor *cursor = wl_cursor_theme_get_cursor(cursor_theme, "cross");
@@ -225,26 +362,32 @@ int main(void) {
 
     /************************************************
      * Initial Commit to the Surface
-     * Attach the buffer to the surface and commit the changes
+     * Commit without a buffer; the compositor answers with a configure and
+     * the first frame is drawn at the size it asks for (200x200 if it
+     * leaves that to us)
      ************************************************/
-    
     wl_surface_commit(surface);
 
-    wl_surface_attach(surface, buffer, 0, 0); // Attach the buffer to the surface
-    wl_surface_commit(surface); // Commit the surface changes to the Wayland compositor
-
     // Main event loop
-    while (1) {
-        wl_display_dispatch(display); // Dispatch events from the display
+    while (!closed && !trace_stop_requested()) {
+        TRACE_BEGIN("dispatch", "wl_display_dispatch");
+        int ret = trace_dispatch(display); // Dispatch events from the display
+        TRACE_END("dispatch", "wl_display_dispatch");
+        if (ret == -1) {
+            break;
+        }
     }
 
+    configure_report(&configure, "xdg-shell-demo");
+    input_seat_report(&input, "xdg-shell-demo");
+    input_seat_finish(&input);
+
     /************************************************
      * Cleanup Resources
-     * (This code will never be reached in the current loop)
      ************************************************/
-    munmap(data, size); // Unmap the shared memory
-    wl_buffer_destroy(buffer); // Destroy the buffer
-    wl_shm_pool_destroy(pool); // Destroy the shared memory pool
+    for (int i = 0; i < DEMO_BUFFERS; i++) {
+        buffer_destroy(&buffers[i]); // Unmap and destroy the buffers
+    }
     wl_display_disconnect(display); // Disconnect from the Wayland display server
 
     return EXIT_SUCCESS; // Exit the program
@@ -0,0 +1,908 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include "protocols/xdg-shell-client-protocol.h"
+#include "protocols/src/xdg-shell-client-protocol.c"
+#include "include/trace.h"
+#include "include/probes.h"
+#include "include/shm.h"
+#include "include/yuv.h"
+#include "include/evloop.h"
+
+/**********************************************
+ * @Y4M VIDEO PLAYER
+ **********************************************
+ *
+ * A streaming workload for the wl_shm path, built on the same skeleton as
+ * waylandbook.example.c: plays an uncompressed YUV4MPEG2 (.y4m) file, e.g.
+ *
+ *     ffmpeg -i clip.mp4 -pix_fmt yuv420p clip.y4m
+ *     ./bin/y4mplay clip.y4m
+ *
+ * @INPUT:
+ * - The file is mmap'ed, never read(). MADV_SEQUENTIAL tells the kernel
+ *   to read ahead aggressively, MADV_WILLNEED on the next few frames
+ *   starts their I/O before they are needed, and frames already shown are
+ *   dropped with MADV_DONTNEED so RSS stays flat on long clips.
+ * - Only 4:2:0 (C420, C420jpeg, C420paldv, C420mpeg2) is accepted, which is
+ *   what ffmpeg writes for yuv420p.
+ *
+ * @CONVERSION:
+ * - I420 -> XRGB8888 with the AVX2/SSE2 kernels from include/yuv.h,
+ *   chosen at runtime (--kernel overrides).
+ * - Each frame is split into row bands converted in parallel by a small
+ *   pool of worker threads plus the main thread (--threads).
+ *
+ * @PRESENTATION:
+ * - A pool of Y4M_BUFFERS wl_shm buffers sharing one pool; a buffer is
+ *   only written after the compositor has released it.
+ * - Pacing is driven by frame callbacks: on each callback the player works
+ *   out which video frame is due from the elapsed time and the clip's
+ *   frame rate. If it fell behind, the frames in between are skipped and
+ *   counted as dropped.
+ *
+ * @REPORT:
+ * - On exit: frames shown and dropped, and conversion throughput
+ *   (conversion only, there is no decoding) in ms/frame, Mpixel/s and
+ *   GiB/s of output. --bench N converts N frames as fast as possible
+ *   without a window to measure the kernels on their own.
+ *
+ * @EVENT LOOP:
+ * - The main loop runs on include/evloop.h, epoll by default or io_uring
+ *   with --event-loop io_uring; the [LOOP] line on exit gives both
+ *   backends' syscalls and wakeups per frame shown.
+ * - --record out.y4m writes every frame shown (not the dropped ones) to a
+ *   new Y4M file straight from the mapping, through the loop's file
+ *   writes: batched with the wait on io_uring, synchronous on epoll.
+ * - --progress prints the playback position from a 1 s loop timer.
+ **********************************************/
+
+#define Y4M_BUFFERS   3     // One on screen, one queued, one being filled
+#define Y4M_READAHEAD 4     // Frames to prefetch with MADV_WILLNEED
+#define Y4M_MAX_THREADS 16
+
+struct y4m_file {
+    uint8_t *data;
+    size_t size;
+    int width, height;
+    int fps_num, fps_den;
+    size_t frame_size;          // Y + U + V bytes
+    size_t first_frame;         // Offset of the first "FRAME" header
+    size_t next_frame;          // Offset of the next header to parse
+    uint64_t frame_index;       // Index of the frame at next_frame
+    size_t released;            // Everything below has been MADV_DONTNEED'ed
+};
+
+struct convert_job;
+
+struct worker {
+    pthread_t thread;
+    struct convert_job *job;
+    int index;
+};
+
+// One frame's conversion, shared by all workers
+struct convert_job {
+    pthread_mutex_t mutex;
+    pthread_cond_t start, done;
+    uint64_t generation;        // Bumped for every frame
+    int pending;                // Workers still busy with this generation
+    bool quit;
+    int bands;                  // Workers + main thread
+    yuv_row_fn row_fn;
+    struct yuv_frame frame;
+    uint32_t *dst;
+    int dst_stride;
+    struct worker workers[Y4M_MAX_THREADS];
+};
+
+struct y4m_buffer {
+    struct wl_buffer *wl_buffer;
+    uint32_t *pixels;
+    bool busy;
+};
+
+struct client_state {
+    /* Globals */
+    struct wl_display *wl_display;
+    struct wl_registry *wl_registry;
+    struct wl_shm *wl_shm;
+    struct wl_compositor *wl_compositor;
+    struct xdg_wm_base *xdg_wm_base;
+    /* Objects */
+    struct wl_surface *wl_surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *xdg_toplevel;
+    struct y4m_buffer buffers[Y4M_BUFFERS];
+    void *pool_data;
+    size_t pool_size;
+    /* Playback */
+    struct y4m_file file;
+    struct convert_job job;
+    bool loop;
+    bool configured;
+    bool closed;
+    bool finished;
+    bool started;
+    struct timespec start_time;
+    uint64_t shown;             // Frames presented
+    uint64_t dropped;           // Frames skipped because we were late
+    uint64_t stalls;            // Callbacks with no free buffer
+    uint64_t converted;
+    double convert_ms;
+    double convert_max_ms;
+    /* Loop */
+    struct evloop evloop;
+    bool readable;              // Display fd became readable this iteration
+    int record_fd;              // -1 without --record
+    uint64_t record_offset;     // Bytes queued so far
+    uint64_t recorded, record_skipped, record_bytes, record_errors;
+};
+
+static double
+timespec_ms(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+/* Y4M parsing */
+
+// Parses the stream header; returns false for anything we cannot play
+static bool
+y4m_parse_header(struct y4m_file *file)
+{
+    const char *magic = "YUV4MPEG2 ";
+    const char *end = memchr(file->data, '\n', file->size < 4096 ? file->size : 4096);
+    if (file->size < strlen(magic) || memcmp(file->data, magic, strlen(magic)) != 0 || !end) {
+        fprintf(stderr, "Not a YUV4MPEG2 file\n");
+        return false;
+    }
+
+    file->fps_num = 25;
+    file->fps_den = 1;
+    char header[4096];
+    size_t length = end - (const char *)file->data;
+    memcpy(header, file->data, length);
+    header[length] = '\0';
+
+    char *save = NULL;
+    for (char *token = strtok_r(header + strlen(magic), " ", &save); token;
+            token = strtok_r(NULL, " ", &save)) {
+        switch (token[0]) {
+        case 'W':
+            file->width = atoi(token + 1);
+            break;
+        case 'H':
+            file->height = atoi(token + 1);
+            break;
+        case 'F':
+            sscanf(token + 1, "%d:%d", &file->fps_num, &file->fps_den);
+            break;
+        case 'C':
+            // 8-bit 4:2:0 only; C420p10 and friends have 16-bit samples
+            if (strcmp(token + 1, "420") != 0 && strcmp(token + 1, "420jpeg") != 0 &&
+                    strcmp(token + 1, "420paldv") != 0 && strcmp(token + 1, "420mpeg2") != 0) {
+                fprintf(stderr, "Unsupported colour space %s, only 8-bit 4:2:0 is handled\n", token + 1);
+                return false;
+            }
+            break;
+        }
+    }
+    if (file->width <= 0 || file->height <= 0 || file->width > 16384 || file->height > 16384 ||
+            file->fps_num <= 0 || file->fps_den <= 0) {
+        fprintf(stderr, "Bad Y4M header\n");
+        return false;
+    }
+
+    size_t chroma = (size_t)((file->width + 1) / 2) * ((file->height + 1) / 2);
+    file->frame_size = (size_t)file->width * file->height + 2 * chroma;
+    file->first_frame = length + 1;
+    file->next_frame = file->first_frame;
+    return true;
+}
+
+/*******************************************
+ * y4m_next_frame:
+ * - Parses the FRAME header at next_frame and returns the frame's planes,
+ *   advancing past it. Returns false at the end of the file (or on a
+ *   truncated frame).
+ * - Also keeps the read-ahead window ahead of the play position and
+ *   releases what lies behind it.
+ *******************************************/
+static bool
+y4m_next_frame(struct y4m_file *file, struct yuv_frame *frame)
+{
+    size_t offset = file->next_frame;
+    if (offset + 6 > file->size || memcmp(file->data + offset, "FRAME", 5) != 0) {
+        return false;
+    }
+    const uint8_t *newline = memchr(file->data + offset, '\n',
+            file->size - offset < 256 ? file->size - offset : 256);
+    if (!newline) {
+        return false;
+    }
+    size_t planes = newline + 1 - file->data;
+    if (planes + file->frame_size > file->size) {
+        return false;
+    }
+
+    int chroma_width = (file->width + 1) / 2;
+    frame->y = file->data + planes;
+    frame->u = frame->y + (size_t)file->width * file->height;
+    frame->v = frame->u + (size_t)chroma_width * ((file->height + 1) / 2);
+    frame->width = file->width;
+    frame->height = file->height;
+    frame->y_stride = file->width;
+    frame->uv_stride = chroma_width;
+
+    file->next_frame = planes + file->frame_size;
+    ++file->frame_index;
+
+    // Prefetch the next frames, give back the pages of the previous ones
+    long page = sysconf(_SC_PAGESIZE);
+    size_t ahead_start = file->next_frame & ~(size_t)(page - 1);
+    size_t ahead_end = file->next_frame + Y4M_READAHEAD * (file->frame_size + 64);
+    ahead_end = ahead_end < file->size ? ahead_end : file->size;
+    if (ahead_end > ahead_start) {
+        madvise(file->data + ahead_start, ahead_end - ahead_start, MADV_WILLNEED);
+    }
+    size_t behind = offset & ~(size_t)(page - 1);
+    if (behind > file->released) {
+        madvise(file->data + file->released, behind - file->released, MADV_DONTNEED);
+        file->released = behind;
+    }
+    return true;
+}
+
+static void
+y4m_rewind(struct y4m_file *file)
+{
+    file->next_frame = file->first_frame;
+    file->frame_index = 0;
+    file->released = 0;
+}
+
+/* Threaded conversion */
+
+static void
+convert_band(struct convert_job *job, int band)
+{
+    int rows = job->frame.height;
+    // Bands are multiples of two rows so no chroma row is shared
+    int per_band = ((rows + job->bands - 1) / job->bands + 1) & ~1;
+    int start = band * per_band;
+    int end = start + per_band < rows ? start + per_band : rows;
+    if (start < end) {
+        yuv_convert_rows(job->row_fn, &job->frame, job->dst, job->dst_stride, start, end);
+    }
+}
+
+static void *
+convert_worker(void *data)
+{
+    struct worker *worker = data;
+    struct convert_job *job = worker->job;
+    uint64_t seen = 0;
+
+    trace_set_thread_name("convert");
+    pthread_mutex_lock(&job->mutex);
+    while (true) {
+        while (!job->quit && job->generation == seen) {
+            pthread_cond_wait(&job->start, &job->mutex);
+        }
+        if (job->quit) {
+            break;
+        }
+        seen = job->generation;
+        pthread_mutex_unlock(&job->mutex);
+
+        TRACE_BEGIN("render", "convert band");
+        convert_band(job, worker->index + 1);
+        TRACE_END("render", "convert band");
+
+        pthread_mutex_lock(&job->mutex);
+        if (--job->pending == 0) {
+            pthread_cond_signal(&job->done);
+        }
+    }
+    pthread_mutex_unlock(&job->mutex);
+    return NULL;
+}
+
+static void
+convert_start_workers(struct convert_job *job, int threads)
+{
+    pthread_mutex_init(&job->mutex, NULL);
+    pthread_cond_init(&job->start, NULL);
+    pthread_cond_init(&job->done, NULL);
+    job->bands = threads;
+    for (int i = 0; i < threads - 1; ++i) {
+        job->workers[i].job = job;
+        job->workers[i].index = i;
+        if (trace_thread_create(&job->workers[i].thread, convert_worker, &job->workers[i]) != 0) {
+            job->bands = i + 1;
+            break;
+        }
+    }
+}
+
+static void
+convert_stop_workers(struct convert_job *job)
+{
+    pthread_mutex_lock(&job->mutex);
+    job->quit = true;
+    pthread_cond_broadcast(&job->start);
+    pthread_mutex_unlock(&job->mutex);
+    for (int i = 0; i < job->bands - 1; ++i) {
+        pthread_join(job->workers[i].thread, NULL);
+    }
+}
+
+// Converts a whole frame, the main thread taking band 0
+static void
+convert_frame(struct client_state *state, const struct yuv_frame *frame, uint32_t *dst)
+{
+    struct convert_job *job = &state->job;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TRACE_BEGIN("render", "convert");
+
+    pthread_mutex_lock(&job->mutex);
+    job->frame = *frame;
+    job->dst = dst;
+    job->dst_stride = frame->width * 4;
+    job->pending = job->bands - 1;
+    ++job->generation;
+    pthread_cond_broadcast(&job->start);
+    pthread_mutex_unlock(&job->mutex);
+
+    convert_band(job, 0);
+
+    pthread_mutex_lock(&job->mutex);
+    while (job->pending > 0) {
+        pthread_cond_wait(&job->done, &job->mutex);
+    }
+    pthread_mutex_unlock(&job->mutex);
+
+    TRACE_END("render", "convert");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ms = timespec_ms(&start, &end);
+    ++state->converted;
+    state->convert_ms += ms;
+    state->convert_max_ms = ms > state->convert_max_ms ? ms : state->convert_max_ms;
+}
+
+static void
+report(const struct client_state *state)
+{
+    const struct y4m_file *file = &state->file;
+    if (state->converted) {
+        double avg = state->convert_ms / state->converted;
+        double pixels = (double)file->width * file->height;
+        fprintf(stderr, "[Y4M] conversion: %llu frames, avg %.3f ms (max %.3f ms), "
+                "%.1f Mpixel/s, %.2f GiB/s written\n",
+                (unsigned long long)state->converted, avg, state->convert_max_ms,
+                pixels / avg / 1e3, pixels * 4 / avg * 1e3 / (1 << 30));
+    }
+    if (state->started) {
+        fprintf(stderr, "[Y4M] presented %llu frames, dropped %llu, %llu callbacks without a free buffer\n",
+                (unsigned long long)state->shown, (unsigned long long)state->dropped,
+                (unsigned long long)state->stalls);
+    }
+    if (state->record_fd >= 0) {
+        fprintf(stderr, "[Y4M] recorded %llu frames, %.1f MiB written, %llu skipped, %llu write errors\n",
+                (unsigned long long)state->recorded, state->record_bytes / (1024.0 * 1024.0),
+                (unsigned long long)state->record_skipped, (unsigned long long)state->record_errors);
+    }
+}
+
+/* Wayland code */
+
+static void
+wl_buffer_release(void *data, struct wl_buffer *wl_buffer)
+{
+    struct y4m_buffer *buffer = data;
+    TRACE_INSTANT("present", "wl_buffer.release");
+    buffer->busy = false;
+}
+
+static const struct wl_buffer_listener wl_buffer_listener = {
+    .release = wl_buffer_release,
+};
+
+static bool
+create_buffers(struct client_state *state)
+{
+    int width = state->file.width, height = state->file.height;
+    int stride = width * 4;
+    size_t size = (size_t)stride * height;
+    state->pool_size = size * Y4M_BUFFERS;
+
+    int fd = shm_allocate(state->pool_size);
+    if (fd < 0) {
+        return false;
+    }
+    state->pool_data = mmap(NULL, state->pool_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (state->pool_data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    struct wl_shm_pool *pool = wl_shm_create_pool(state->wl_shm, fd, state->pool_size);
+    for (int i = 0; i < Y4M_BUFFERS; ++i) {
+        struct y4m_buffer *buffer = &state->buffers[i];
+        buffer->wl_buffer = wl_shm_pool_create_buffer(pool, size * i,
+                width, height, stride, WL_SHM_FORMAT_XRGB8888);
+        buffer->pixels = (uint32_t *)((uint8_t *)state->pool_data + size * i);
+        wl_buffer_add_listener(buffer->wl_buffer, &wl_buffer_listener, buffer);
+    }
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    return true;
+}
+
+static const struct wl_callback_listener frame_listener;
+
+static void
+request_frame(struct client_state *state)
+{
+    struct wl_callback *callback = wl_surface_frame(state->wl_surface);
+    wl_callback_add_listener(callback, &frame_listener, state);
+}
+
+static void
+record_done(void *data, ssize_t result)
+{
+    struct client_state *state = data;
+    if (result < 0) {
+        ++state->record_errors;
+    } else {
+        state->record_bytes += result;
+    }
+}
+
+// Queues the file header, or one frame with a plain FRAME header
+static void
+record_frame(struct client_state *state, const struct yuv_frame *frame)
+{
+    static const char frame_header[] = "FRAME\n";
+    if (state->record_fd < 0) {
+        return;
+    }
+    if (state->evloop.io_pending + 2 > EVLOOP_MAX_IO) {
+        ++state->record_skipped;   // The disk is behind, don't stall playback
+        return;
+    }
+    if (!frame) {
+        evloop_write(&state->evloop, state->record_fd, state->file.data, state->file.first_frame,
+                state->record_offset, record_done, state);
+        state->record_offset += state->file.first_frame;
+        return;
+    }
+    evloop_write(&state->evloop, state->record_fd, frame_header, strlen(frame_header),
+            state->record_offset, record_done, state);
+    state->record_offset += strlen(frame_header);
+    evloop_write(&state->evloop, state->record_fd, frame->y, state->file.frame_size,
+            state->record_offset, record_done, state);
+    state->record_offset += state->file.frame_size;
+    ++state->recorded;
+}
+
+/*******************************************
+ * present:
+ * - Picks the frame due at this point in time, skipping (and counting)
+ *   any we are late for, converts it into a free buffer and commits.
+ * - Always requests the next frame callback, so pacing continues even
+ *   when no new frame is due yet or every buffer is still busy.
+ *******************************************/
+static void
+present(struct client_state *state)
+{
+    struct y4m_file *file = &state->file;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!state->started) {
+        state->started = true;
+        state->start_time = now;
+    }
+
+    // Frame that should be on screen now
+    double elapsed = timespec_ms(&state->start_time, &now) / 1e3;
+    uint64_t due = (uint64_t)(elapsed * file->fps_num / file->fps_den);
+
+    request_frame(state);
+    if (state->shown > 0 && due < file->frame_index) {
+        wl_surface_commit(state->wl_surface);   // Too early for the next frame
+        return;
+    }
+
+    struct y4m_buffer *buffer = NULL;
+    for (int i = 0; i < Y4M_BUFFERS && !buffer; ++i) {
+        if (!state->buffers[i].busy) {
+            buffer = &state->buffers[i];
+        }
+    }
+    if (!buffer) {
+        ++state->stalls;
+        wl_surface_commit(state->wl_surface);
+        return;
+    }
+
+    struct yuv_frame frame;
+    bool have_frame = y4m_next_frame(file, &frame);
+    while (have_frame && file->frame_index <= due) {
+        ++state->dropped;   // Late: skip straight to the frame that is due
+        have_frame = y4m_next_frame(file, &frame);
+    }
+    if (!have_frame && state->loop) {
+        y4m_rewind(file);
+        state->start_time = now;
+        have_frame = y4m_next_frame(file, &frame);
+    }
+    if (!have_frame) {
+        state->finished = true;
+        wl_surface_commit(state->wl_surface);
+        return;
+    }
+
+    PROBE1(frame_start, file->frame_index);
+    convert_frame(state, &frame, buffer->pixels);
+    PROBE1(frame_end, file->frame_index);
+
+    TRACE_BEGIN("present", "attach+commit");
+    wl_surface_attach(state->wl_surface, buffer->wl_buffer, 0, 0);
+    wl_surface_damage_buffer(state->wl_surface, 0, 0, INT32_MAX, INT32_MAX);
+    PROBE1(commit, file->frame_index);
+    wl_surface_commit(state->wl_surface);
+    TRACE_END("present", "attach+commit");
+    buffer->busy = true;
+    ++state->shown;
+    record_frame(state, &frame);
+}
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+    struct client_state *state = data;
+    wl_callback_destroy(callback);
+    present(state);
+}
+
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+static void
+xdg_surface_configure(void *data,
+        struct xdg_surface *xdg_surface, uint32_t serial)
+{
+    struct client_state *state = data;
+    PROBE1(configure_received, serial);
+    xdg_surface_ack_configure(xdg_surface, serial);
+    PROBE1(configure_acked, serial);
+
+    // The first configure starts playback; later ones only need the ack
+    if (!state->configured) {
+        state->configured = true;
+        present(state);
+    }
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure,
+};
+
+static void
+xdg_toplevel_configure(void *data, struct xdg_toplevel *xdg_toplevel,
+        int32_t width, int32_t height, struct wl_array *states)
+{
+    /* The video decides the size */
+}
+
+static void
+xdg_toplevel_close(void *data, struct xdg_toplevel *xdg_toplevel)
+{
+    struct client_state *state = data;
+    state->closed = true;
+}
+
+static void
+xdg_toplevel_configure_bounds(void *data, struct xdg_toplevel *xdg_toplevel,
+        int32_t width, int32_t height)
+{
+}
+
+static void
+xdg_toplevel_wm_capabilities(void *data, struct xdg_toplevel *xdg_toplevel,
+        struct wl_array *capabilities)
+{
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .configure = xdg_toplevel_configure,
+    .close = xdg_toplevel_close,
+    .configure_bounds = xdg_toplevel_configure_bounds,
+    .wm_capabilities = xdg_toplevel_wm_capabilities,
+};
+
+static void
+xdg_wm_base_ping(void *data, struct xdg_wm_base *xdg_wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(xdg_wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+    .ping = xdg_wm_base_ping,
+};
+
+static void
+registry_global(void *data, struct wl_registry *wl_registry,
+        uint32_t name, const char *interface, uint32_t version)
+{
+    struct client_state *state = data;
+    TRACE_BEGIN("registry", "global");
+    if (strcmp(interface, wl_shm_interface.name) == 0) {
+        state->wl_shm = wl_registry_bind(
+                wl_registry, name, &wl_shm_interface, 1);
+    } else if (strcmp(interface, wl_compositor_interface.name) == 0) {
+        state->wl_compositor = wl_registry_bind(
+                wl_registry, name, &wl_compositor_interface, 4);
+    } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+        state->xdg_wm_base = wl_registry_bind(
+                wl_registry, name, &xdg_wm_base_interface, 1);
+        xdg_wm_base_add_listener(state->xdg_wm_base,
+                &xdg_wm_base_listener, state);
+    }
+    TRACE_END("registry", "global");
+}
+
+static void
+registry_global_remove(void *data,
+        struct wl_registry *wl_registry, uint32_t name)
+{
+    /* This space deliberately left blank */
+}
+
+static const struct wl_registry_listener wl_registry_listener = {
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+static void
+display_readable(void *data, uint32_t events)
+{
+    struct client_state *state = data;
+    state->readable = true;
+}
+
+// Only wakes the loop; it checks trace_stop_requested() itself
+static void
+stop_readable(void *data, uint32_t events)
+{
+}
+
+static void
+progress_tick(void *data)
+{
+    struct client_state *state = data;
+    const struct y4m_file *file = &state->file;
+    fprintf(stderr, "[Y4M] frame %llu (%.1f s), %llu shown, %llu dropped\n",
+            (unsigned long long)file->frame_index,
+            (double)file->frame_index * file->fps_den / file->fps_num,
+            (unsigned long long)state->shown, (unsigned long long)state->dropped);
+}
+
+// Converts `frames` frames back to back into a scratch buffer, no window
+static void
+bench(struct client_state *state, long frames)
+{
+    uint32_t *scratch = malloc((size_t)state->file.width * state->file.height * 4);
+    if (!scratch) {
+        return;
+    }
+    for (long i = 0; i < frames && !trace_stop_requested(); ++i) {
+        struct yuv_frame frame;
+        if (!y4m_next_frame(&state->file, &frame)) {
+            y4m_rewind(&state->file);
+            if (!y4m_next_frame(&state->file, &frame)) {
+                break;
+            }
+        }
+        convert_frame(state, &frame, scratch);
+    }
+    free(scratch);
+}
+
+static void
+usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [--threads N] [--kernel scalar|sse2|avx2] [--loop] "
+            "[--bench frames] [--event-loop epoll|io_uring] [--record out.y4m] [--progress] "
+            "file.y4m\n", argv0);
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct client_state state = { .record_fd = -1 };
+    const char *path = NULL, *kernel = NULL, *record_path = NULL;
+    enum evloop_backend backend = EVLOOP_EPOLL;
+    bool progress = false;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN), bench_frames = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            kernel = argv[++i];
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            state.loop = true;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_frames = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--event-loop") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "io_uring") == 0) {
+                backend = EVLOOP_URING;
+            } else if (strcmp(argv[i], "epoll") != 0) {
+                usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--progress") == 0) {
+            progress = true;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!path) {
+        usage(argv[0]);
+    }
+    threads = threads < 1 ? 1 : (threads > Y4M_MAX_THREADS ? Y4M_MAX_THREADS : threads);
+
+    // SIGINT/SIGTERM end playback with a report, traced or not
+    trace_init("y4mplay");
+    trace_catch_stop_signals();
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    state.file.size = st.st_size;
+    state.file.data = mmap(NULL, state.file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (state.file.data == MAP_FAILED) {
+        fprintf(stderr, "Failed to mmap %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    madvise(state.file.data, state.file.size, MADV_SEQUENTIAL);
+    if (!y4m_parse_header(&state.file)) {
+        return EXIT_FAILURE;
+    }
+
+    const char *kernel_name;
+    state.job.row_fn = yuv_select(kernel, &kernel_name);
+    convert_start_workers(&state.job, threads);
+    fprintf(stderr, "[Y4M] %dx%d @ %d/%d fps, %s kernel, %d thread(s)\n",
+            state.file.width, state.file.height, state.file.fps_num, state.file.fps_den,
+            kernel_name, state.job.bands);
+
+    if (bench_frames > 0) {
+        bench(&state, bench_frames);
+        report(&state);
+        convert_stop_workers(&state.job);
+        return EXIT_SUCCESS;
+    }
+
+    state.wl_display = wl_display_connect(NULL);
+    if (!state.wl_display) {
+        fprintf(stderr, "Failed to connect to Wayland display\n");
+        return EXIT_FAILURE;
+    }
+    state.wl_registry = wl_display_get_registry(state.wl_display);
+    wl_registry_add_listener(state.wl_registry, &wl_registry_listener, &state);
+    TRACE_BEGIN("registry", "roundtrip");
+    wl_display_roundtrip(state.wl_display);
+    TRACE_END("registry", "roundtrip");
+    if (!state.wl_shm || !state.wl_compositor || !state.xdg_wm_base) {
+        fprintf(stderr, "Compositor lacks wl_shm, wl_compositor v4 or xdg_wm_base\n");
+        return EXIT_FAILURE;
+    }
+    if (!create_buffers(&state)) {
+        fprintf(stderr, "Failed to allocate the buffer pool\n");
+        return EXIT_FAILURE;
+    }
+
+    state.wl_surface = wl_compositor_create_surface(state.wl_compositor);
+    state.xdg_surface = xdg_wm_base_get_xdg_surface(
+            state.xdg_wm_base, state.wl_surface);
+    xdg_surface_add_listener(state.xdg_surface, &xdg_surface_listener, &state);
+    state.xdg_toplevel = xdg_surface_get_toplevel(state.xdg_surface);
+    xdg_toplevel_add_listener(state.xdg_toplevel, &xdg_toplevel_listener, &state);
+    xdg_toplevel_set_title(state.xdg_toplevel, path);
+
+    if (!evloop_init(&state.evloop, backend) ||
+            !evloop_add_fd(&state.evloop, wl_display_get_fd(state.wl_display), POLLIN,
+                display_readable, &state) ||
+            (trace_signal_fd() >= 0 &&
+             !evloop_add_fd(&state.evloop, trace_signal_fd(), POLLIN, stop_readable, NULL))) {
+        fprintf(stderr, "Failed to set up the event loop: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (progress) {
+        evloop_add_timer(&state.evloop, 1000, progress_tick, &state);
+    }
+    if (record_path) {
+        state.record_fd = open(record_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (state.record_fd < 0) {
+            fprintf(stderr, "Failed to create %s: %s\n", record_path, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        record_frame(&state, NULL);
+    }
+    fprintf(stderr, "[Y4M] %s event loop\n", evloop_backend_name(state.evloop.backend));
+    wl_surface_commit(state.wl_surface);
+
+    // Own loop so SIGINT ends playback with a report
+    while (!trace_stop_requested() && !state.closed && !state.finished) {
+        while (wl_display_prepare_read(state.wl_display) != 0) {
+            wl_display_dispatch_pending(state.wl_display);
+        }
+        wl_display_flush(state.wl_display);
+        state.readable = false;
+        TRACE_BEGIN("dispatch", "evloop");
+        int ready = evloop_run_once(&state.evloop, -1);
+        TRACE_END("dispatch", "evloop");
+        if (ready < 0) {
+            wl_display_cancel_read(state.wl_display);
+            break;
+        }
+        if (!state.readable) {
+            wl_display_cancel_read(state.wl_display);
+            continue;
+        }
+        if (wl_display_read_events(state.wl_display) == -1) {
+            break;
+        }
+        TRACE_BEGIN("dispatch", "wl_display_dispatch_pending");
+        int ret = wl_display_dispatch_pending(state.wl_display);
+        TRACE_END("dispatch", "wl_display_dispatch_pending");
+        if (ret == -1) {
+            break;
+        }
+    }
+
+    evloop_drain(&state.evloop);
+    report(&state);
+    evloop_report(&state.evloop, state.shown);
+    evloop_finish(&state.evloop);
+    if (state.record_fd >= 0) {
+        close(state.record_fd);
+    }
+    convert_stop_workers(&state.job);
+    for (int i = 0; i < Y4M_BUFFERS; ++i) {
+        wl_buffer_destroy(state.buffers[i].wl_buffer);
+    }
+    munmap(state.pool_data, state.pool_size);
+    munmap(state.file.data, state.file.size);
+    xdg_toplevel_destroy(state.xdg_toplevel);
+    xdg_surface_destroy(state.xdg_surface);
+    wl_surface_destroy(state.wl_surface);
+    wl_display_disconnect(state.wl_display);
+    return EXIT_SUCCESS;
+}